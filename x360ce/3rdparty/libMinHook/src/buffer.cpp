@@ -32,37 +32,73 @@
 #include <vector>
 #include <algorithm>
 #include <Windows.h>
+#include "pstdint.h"
 
 #include "buffer.h"
+#include "page.h"
 
 namespace MinHook { namespace
 {
-	struct MEMORY_BLOCK
+	// Every hook buffer (trampoline, relay, address table, backup) fits in one fixed size slot.
+	// Slots are carved from 64KB regions near the target, freed slots are reused before untouched ones.
+	const size_t BlockSize = 0x10000;
+	const size_t SlotSize = 64;
+	const size_t SlotsPerBlock = BlockSize / SlotSize;
+
+	struct MEMORY_REGION
+	{
+		uint8_t*	pAddress;
+		DWORD		protect;
+		size_t		usedCount;					// slots handed out, committed or not
+		size_t		bumpIndex;					// slots from here on were never used
+		size_t		freeCount;
+		uint16_t	freeSlots[SlotsPerBlock];	// stack of freed slot indexes
+	};
+
+	struct PENDING_SLOT
 	{
-		void*	pAddress;
-		DWORD	protect;
-		size_t	uncommittedSize;
-		size_t	uncommittedCount;
-		size_t	fixedSize;
-		size_t	fixedCount;
+		MEMORY_REGION*	pRegion;
+		void*			pSlot;
+	};
+
+	// Regions are kept sorted by address, comparator for lookups by address
+	struct RegionLess
+	{
+		bool operator ()(const MEMORY_REGION* lhs, uintptr_t rhs) const
+		{
+			return reinterpret_cast<uintptr_t>(lhs->pAddress) < rhs;
+		}
+
+		bool operator ()(uintptr_t lhs, const MEMORY_REGION* rhs) const
+		{
+			return lhs < reinterpret_cast<uintptr_t>(rhs->pAddress);
+		}
+
+		bool operator ()(const MEMORY_REGION* lhs, const MEMORY_REGION* rhs) const
+		{
+			return lhs->pAddress < rhs->pAddress;
+		}
 	};
 
-	template <typename T>
-	bool operator <(const MEMORY_BLOCK& lhs, const T& rhs);
-	template <typename T>
-	bool operator <(const T& lhs, const MEMORY_BLOCK& rhs);
-	bool operator <(const MEMORY_BLOCK& lhs, const MEMORY_BLOCK& rhs);
+	typedef std::vector<MEMORY_REGION*>::iterator mr_iter;
 
 	void*			AllocateBuffer(void* const pOrigin, DWORD protect, size_t size);
-	MEMORY_BLOCK*	GetMemoryBlock(void* const pOrigin, DWORD protect, size_t capacity);
+	MEMORY_REGION*	GetMemoryRegion(void* const pOrigin, DWORD protect);
+	MEMORY_REGION*	FindMemoryRegion(void* const pAddress);
+	void			ReleaseSlot(MEMORY_REGION* pRegion, void* const pSlot);
+	void			ReleaseEmptyRegions();
 
-	const size_t BlockSize = 0x10000;
+	inline bool HasFreeSlot(const MEMORY_REGION* pRegion)
+	{
+		return pRegion->freeCount != 0 || pRegion->bumpIndex < SlotsPerBlock;
+	}
 
 #if defined _M_X64
 	intptr_t gMinAddress;
 	intptr_t gMaxAddress;
 #endif
-	std::vector<MEMORY_BLOCK> gMemoryBlocks;
+	std::vector<MEMORY_REGION*>	gMemoryRegions;	// sorted by address, region records never move
+	std::vector<PENDING_SLOT>	gPendingSlots;	// slots allocated since last commit or rollback
 }}
 
 namespace MinHook
@@ -70,24 +106,28 @@ namespace MinHook
 	void InitializeBuffer()
 	{
 #if defined _M_X64
-		SYSTEM_INFO si;
-		GetSystemInfo(&si);
+		void* pMin;
+		void* pMax;
+		GetPageProvider().GetAddressRange(&pMin, &pMax);
 
-		gMinAddress = reinterpret_cast<intptr_t>(si.lpMinimumApplicationAddress);
-		gMaxAddress = reinterpret_cast<intptr_t>(si.lpMaximumApplicationAddress);
+		gMinAddress = reinterpret_cast<intptr_t>(pMin);
+		gMaxAddress = reinterpret_cast<intptr_t>(pMax);
 #endif
 	}
 
 	void UninitializeBuffer()
 	{
-		for (size_t i = 0, count = gMemoryBlocks.size(); i < count; ++i)
+		for (size_t i = 0, count = gMemoryRegions.size(); i < count; ++i)
 		{
-			MEMORY_BLOCK& block = gMemoryBlocks[i];
-			VirtualFree(block.pAddress, 0, MEM_RELEASE);
+			GetPageProvider().Release(gMemoryRegions[i]->pAddress);
+			delete gMemoryRegions[i];
 		}
 
-		std::vector<MEMORY_BLOCK> v;
-		gMemoryBlocks.swap(v);
+		std::vector<MEMORY_REGION*> v;
+		gMemoryRegions.swap(v);
+
+		std::vector<PENDING_SLOT> p;
+		gPendingSlots.swap(p);
 	}
 
 	void* AllocateCodeBuffer(void* const pOrigin, size_t size)
@@ -106,74 +146,48 @@ namespace MinHook
 
 	void FreeBuffer(void* const pBuffer)
 	{
-		for (size_t i = 0, count = gMemoryBlocks.size(); i < count; ++i)
+		MEMORY_REGION* pRegion = FindMemoryRegion(pBuffer);
+		if (pRegion == NULL)
 		{
-			MEMORY_BLOCK& block = gMemoryBlocks[i];
-			void* pBlockEnd = reinterpret_cast<char*>(block.pAddress) + block.fixedSize;
-
-			if (pBuffer >= block.pAddress && pBuffer < pBlockEnd)
-			{
-				assert(("FreeBuffer", (block.uncommittedSize == 0 && block.uncommittedCount == 0)));
-
-				block.fixedCount--;
-
-				if (block.fixedCount == 0)
-				{
-					VirtualFree(block.pAddress, 0, MEM_RELEASE);
-					gMemoryBlocks.erase(gMemoryBlocks.begin()+i);
-				}
-
-				return;
-			}
+			assert(("FreeBuffer", 0));
+			return;
 		}
 
-		assert(("FreeBuffer", 0));
+		ReleaseSlot(pRegion, pBuffer);
+		ReleaseEmptyRegions();
 	}
 
 	void RollbackBuffer()
 	{
-		for (size_t i = 0, count = gMemoryBlocks.size(); i < count; ++i)
+		if (gPendingSlots.empty())
 		{
-			MEMORY_BLOCK& block = gMemoryBlocks[i];
-			if (block.uncommittedSize == 0)
-			{
-				continue;
-			}
+			return;
+		}
 
-			block.uncommittedSize = 0;
-			block.uncommittedCount = 0;
+		for (size_t i = 0, count = gPendingSlots.size(); i < count; ++i)
+		{
+			PENDING_SLOT& slot = gPendingSlots[i];
 
-			if (block.fixedCount == 0)
-			{
-				VirtualFree(block.pAddress, 0, MEM_RELEASE);
-				gMemoryBlocks.erase(gMemoryBlocks.begin()+i);
-				i--;
-				count--;
-			}
+			DWORD op;
+			GetPageProvider().Protect(slot.pSlot, SlotSize, slot.pRegion->protect, &op);
+			ReleaseSlot(slot.pRegion, slot.pSlot);
 		}
+		gPendingSlots.clear();
+
+		// several pending slots may share one region, release regions once all slots are back
+		ReleaseEmptyRegions();
 	}
 
 	void CommitBuffer()
 	{
-		for (size_t i = 0, count = gMemoryBlocks.size(); i < count; ++i)
+		for (size_t i = 0, count = gPendingSlots.size(); i < count; ++i)
 		{
-			MEMORY_BLOCK& block = gMemoryBlocks[i];
-			if (block.uncommittedSize == 0)
-			{
-				continue;
-			}
+			PENDING_SLOT& slot = gPendingSlots[i];
 
-			void* pBuffer = reinterpret_cast<char*>(block.pAddress) + block.fixedSize;
-			size_t size = block.uncommittedSize;
 			DWORD op;
-			VirtualProtect(pBuffer, size, block.protect, &op);
-
-			block.fixedSize += size;
-			block.uncommittedSize = 0;
-
-			block.fixedCount += block.uncommittedCount;
-			block.uncommittedCount = 0;
+			GetPageProvider().Protect(slot.pSlot, SlotSize, slot.pRegion->protect, &op);
 		}
+		gPendingSlots.clear();
 	}
 }
 
@@ -184,137 +198,163 @@ namespace MinHook { namespace
 		assert(("AllocateBuffer", (protect == PAGE_EXECUTE_READ || protect == PAGE_READONLY)));
 		assert(("AllocateBuffer", (size > 0)));
 
-		// ACgEɐ؂グ
-		size = (size + TYPE_ALIGNMENT(void*) - 1) & ~(TYPE_ALIGNMENT(void*) - 1);
-
-		MEMORY_BLOCK* pBlock = GetMemoryBlock(pOrigin, protect, size);
-		if (pBlock == NULL)
+		// Trampoline is at most 5 copied instructions plus a jump, tables and backups are smaller
+		if (size > SlotSize)
 		{
 			return NULL;
 		}
 
-		void* pBuffer = reinterpret_cast<char*>(pBlock->pAddress) + pBlock->fixedSize + pBlock->uncommittedSize;
-		if (VirtualAlloc(pBuffer, size, MEM_COMMIT, pBlock->protect) == NULL)
+		MEMORY_REGION* pRegion = GetMemoryRegion(pOrigin, protect);
+		if (pRegion == NULL)
 		{
 			return NULL;
 		}
 
+		size_t index = (pRegion->freeCount != 0) ? pRegion->freeSlots[--pRegion->freeCount] : pRegion->bumpIndex++;
+		void* pSlot = pRegion->pAddress + index * SlotSize;
+		pRegion->usedCount++;
+
 		DWORD oldProtect;
 		// PAGE_EXECUTE_READ -> PAGE_EXECUTE_READWRITE, PAGE_READONLY -> PAGE_READWRITE
-		if (!VirtualProtect(pBuffer, size, (pBlock->protect << 1), &oldProtect))
+		if (!GetPageProvider().Protect(pSlot, SlotSize, (protect << 1), &oldProtect))
 		{
+			ReleaseSlot(pRegion, pSlot);
+			ReleaseEmptyRegions();
 			return NULL;
 		}
 
-		pBlock->uncommittedSize += size;
-		pBlock->uncommittedCount++;
-		return pBuffer;
+		PENDING_SLOT pending = { pRegion, pSlot };
+		gPendingSlots.push_back(pending);
+		return pSlot;
 	}
 
-	MEMORY_BLOCK* GetMemoryBlock(void* const pOrigin, DWORD protect, size_t capacity)
+	MEMORY_REGION* GetMemoryRegion(void* const pOrigin, DWORD protect)
 	{
-		assert(("GetMemoryBlock", (protect == PAGE_EXECUTE_READ || protect == PAGE_READONLY)));
-		assert(("GetMemoryBlock", (capacity > 0)));
+		assert(("GetMemoryRegion", (protect == PAGE_EXECUTE_READ || protect == PAGE_READONLY)));
 
-		typedef std::vector<MEMORY_BLOCK>::iterator mb_iter;
+		PageProvider& pages = GetPageProvider();
 
 #if defined _M_X64
 		intptr_t minAddr = gMinAddress;
 		intptr_t maxAddr = gMaxAddress;
 		if (pOrigin != NULL)
 		{
-			// pOrigin } 512MB ͈̔
+			// pOrigin +- 512MB, reachable by rel32 from everywhere in the region
 			minAddr = std::max<intptr_t>(minAddr, reinterpret_cast<intptr_t>(pOrigin) - 0x20000000);
 			maxAddr = std::min<intptr_t>(maxAddr, reinterpret_cast<intptr_t>(pOrigin) + 0x20000000);
 		}
 #endif
 
-		// łɓo^ς݂̗̈̒gp\Ȃ̂΁AԂ
-		MEMORY_BLOCK* pBlock = NULL;
+		// Reuse registered region in range with a free slot
 		{
-			mb_iter ib = gMemoryBlocks.begin();
-			mb_iter ie = gMemoryBlocks.end();
+			mr_iter ib = gMemoryRegions.begin();
+			mr_iter ie = gMemoryRegions.end();
 #if defined _M_X64
 			if (pOrigin != NULL)
 			{
-				// OɃAhX͈͂ōi荞
-				ib = std::lower_bound(ib, ie, minAddr);
-				ie = std::lower_bound(ib, ie, maxAddr);
+				ib = std::lower_bound(ib, ie, static_cast<uintptr_t>(minAddr), RegionLess());
+				ie = std::lower_bound(ib, ie, static_cast<uintptr_t>(maxAddr), RegionLess());
 			}
 #endif
-			for (mb_iter i = ib; i != ie; ++i)
+			for (mr_iter i = ib; i != ie; ++i)
 			{
-				if (i->protect == protect && i->fixedSize + i->uncommittedSize + capacity <= BlockSize)
+				if ((*i)->protect == protect && HasFreeSlot(*i))
 				{
-					return &(*i);
+					return *i;
 				}
 			}
 		}
 
-		// Ȃ΁AVȃAhẌm
+		// Otherwise take a new region
 		void* pAlloc = NULL;
 #if defined _M_X64
 		if (pOrigin != NULL)
 		{
-			// ͈͂̒SO֋󂫗̈TĂ
-			intptr_t min = minAddr / BlockSize;
-			intptr_t max = maxAddr / BlockSize;
-			int rel = 0;
-			MEMORY_BASIC_INFORMATION mi = { 0 };
-			for (int i = 0; i < (max - min + 1); ++i)
+			// Nearest free blocks below origin first, then above.
+			// Provider skips used ranges as a whole, so each step is one query.
+			void* pTry = pOrigin;
+			while (pAlloc == NULL)
 			{
-				rel = -rel + (i & 1);
-				void* pQuery = reinterpret_cast<void*>(((min + max) / 2 + rel) * BlockSize);
-				VirtualQuery(pQuery, &mi, sizeof(mi));
-				if (mi.State == MEM_FREE)
+				pTry = pages.FindPrevFree(pTry, reinterpret_cast<void*>(minAddr), BlockSize);
+				if (pTry == NULL)
 				{
-					pAlloc = VirtualAlloc(pQuery, BlockSize, MEM_RESERVE, protect);
-					if (pAlloc != NULL)
-					{
-						break;
-					}
+					break;
 				}
+				pAlloc = pages.Allocate(pTry, BlockSize, protect);
+			}
+
+			pTry = pOrigin;
+			while (pAlloc == NULL)
+			{
+				pTry = pages.FindNextFree(pTry, reinterpret_cast<void*>(maxAddr), BlockSize);
+				if (pTry == NULL)
+				{
+					break;
+				}
+				pAlloc = pages.Allocate(pTry, BlockSize, protect);
 			}
 		}
 		else
-#endif		// X86[hł́AAhX͖ɂȂȂ
+#endif
 		{
-			pAlloc = VirtualAlloc(NULL, BlockSize, MEM_RESERVE, protect);
+			pAlloc = pages.Allocate(NULL, BlockSize, protect);
 		}
 
-		if (pAlloc != NULL)
+		if (pAlloc == NULL)
 		{
-			MEMORY_BLOCK block = { 0 };
-			block.pAddress = pAlloc;
-			block.protect = protect;
+			return NULL;
+		}
 
-#if defined _M_X64
-			mb_iter i = std::lower_bound(gMemoryBlocks.begin(), gMemoryBlocks.end(), pAlloc);
-#elif defined _M_IX86
-			mb_iter i = gMemoryBlocks.end();
-#endif
-			i = gMemoryBlocks.insert(i, block);
+		MEMORY_REGION* pRegion = new MEMORY_REGION;
+		pRegion->pAddress = reinterpret_cast<uint8_t*>(pAlloc);
+		pRegion->protect = protect;
+		pRegion->usedCount = 0;
+		pRegion->bumpIndex = 0;
+		pRegion->freeCount = 0;
 
-			return &(*i);
-		}
+		mr_iter i = std::lower_bound(gMemoryRegions.begin(), gMemoryRegions.end(), pRegion, RegionLess());
+		gMemoryRegions.insert(i, pRegion);
 
-		return NULL;
+		return pRegion;
 	}
 
-	template <typename T>
-	bool operator <(const MEMORY_BLOCK& lhs, const T& rhs)
+	MEMORY_REGION* FindMemoryRegion(void* const pAddress)
 	{
-		return lhs.pAddress < reinterpret_cast<void*>(rhs);
+		// Regions are aligned to their size, base of the region comes straight from the address
+		uintptr_t base = reinterpret_cast<uintptr_t>(pAddress) & ~(BlockSize - 1);
+
+		mr_iter i = std::lower_bound(gMemoryRegions.begin(), gMemoryRegions.end(), base, RegionLess());
+		if (i != gMemoryRegions.end() && reinterpret_cast<uintptr_t>((*i)->pAddress) == base)
+		{
+			return *i;
+		}
+
+		return NULL;
 	}
 
-	template <typename T>
-	bool operator <(const T& lhs, const MEMORY_BLOCK& rhs)
+	void ReleaseSlot(MEMORY_REGION* pRegion, void* const pSlot)
 	{
-		return reinterpret_cast<void*>(lhs) < rhs.pAddress;
+		size_t index = (reinterpret_cast<uint8_t*>(pSlot) - pRegion->pAddress) / SlotSize;
+		assert(("ReleaseSlot", (index < SlotsPerBlock && pRegion->usedCount > 0)));
+
+		pRegion->freeSlots[pRegion->freeCount++] = static_cast<uint16_t>(index);
+		pRegion->usedCount--;
 	}
 
-	bool operator <(const MEMORY_BLOCK& lhs, const MEMORY_BLOCK& rhs)
+	void ReleaseEmptyRegions()
 	{
-		return lhs.pAddress < rhs.pAddress;
+		for (size_t i = 0; i < gMemoryRegions.size(); )
+		{
+			MEMORY_REGION* pRegion = gMemoryRegions[i];
+			if (pRegion->usedCount != 0)
+			{
+				++i;
+				continue;
+			}
+
+			GetPageProvider().Release(pRegion->pAddress);
+			delete pRegion;
+			gMemoryRegions.erase(gMemoryRegions.begin() + i);
+		}
 	}
-}}
\ No newline at end of file
+}}
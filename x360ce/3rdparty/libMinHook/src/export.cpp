@@ -29,7 +29,7 @@
 #include "stdafx.h"
 
 #include <Windows.h>
-#include "..\MinHook.h"
+#include "../MinHook.h"
 #include "hook.h"
 
 using namespace MinHook;
@@ -0,0 +1,252 @@
+/* 
+ *  MinHook - Minimalistic API Hook Library	
+ *  Copyright (C) 2009 Tsuda Kageyu. All rights reserved.
+ *  
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *  
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "stdafx.h"
+
+#include <string.h>
+#include "pstdint.h"
+
+#include "hde_fast.h"
+
+namespace MinHook { namespace
+{
+	enum OPCODE_CLASS
+	{
+		S,		// left to HDE (prefixes, 0F map, rare or tricky opcodes)
+		N,		// opcode only
+		M,		// ModR/M
+		B,		// ModR/M, imm8
+		D,		// ModR/M, imm32
+		I,		// imm8
+		W,		// imm32
+		R,		// rel8
+		L,		// rel32
+		V,		// B8+r, imm32 or imm64 with REX.W
+		X		// REX prefix on x64, INC/DEC on x86
+	};
+
+	const uint8_t OpcodeClass[256] =
+	{
+		M, M, M, M, I, W, S, S, M, M, M, M, I, W, S, S,	// 00
+		M, M, M, M, I, W, S, S, M, M, M, M, I, W, S, S,	// 10
+		M, M, M, M, I, W, S, S, M, M, M, M, I, W, S, S,	// 20
+		M, M, M, M, I, W, S, S, M, M, M, M, I, W, S, S,	// 30
+		X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,	// 40
+		N, N, N, N, N, N, N, N, N, N, N, N, N, N, N, N,	// 50
+		S, S, S, S, S, S, S, S, W, D, I, B, S, S, S, S,	// 60
+		R, R, R, R, R, R, R, R, R, R, R, R, R, R, R, R,	// 70
+		B, D, S, B, M, M, M, M, M, M, M, M, S, M, S, S,	// 80
+		N, N, N, N, N, N, N, N, S, S, S, S, S, S, S, S,	// 90
+		S, S, S, S, S, S, S, S, I, W, S, S, S, S, S, S,	// A0
+		I, I, I, I, I, I, I, I, V, V, V, V, V, V, V, V,	// B0
+		S, S, S, N, S, S, B, D, S, S, S, S, N, S, S, S,	// C0
+		S, S, S, S, S, S, S, S, S, S, S, S, S, S, S, S,	// D0
+		S, S, S, S, S, S, S, S, L, L, S, R, S, S, S, S,	// E0
+		S, S, S, S, S, S, S, S, S, S, S, S, S, S, S, M	// F0
+	};
+
+	inline unsigned int hde_full_disasm(const void* code, hde_t* hs)
+	{
+#if defined _M_X64
+		return hde64_disasm(code, hs);
+#elif defined _M_IX86
+		return hde32_disasm(code, hs);
+#endif
+	}
+
+	// Reads ModR/M, SIB and displacement, returns false for forms fast path does not handle
+	inline bool DecodeModRM(const uint8_t*& p, hde_t* hs)
+	{
+		uint8_t modrm = *p++;
+		hs->modrm = modrm;
+		hs->modrm_mod = modrm >> 6;
+		hs->modrm_reg = (modrm & 0x3F) >> 3;
+		hs->modrm_rm = modrm & 7;
+		hs->flags |= F_MODRM;
+
+		switch (hs->opcode)
+		{
+		case 0x8D:	// LEA needs memory operand
+			if (hs->modrm_mod == 3)
+			{
+				return false;
+			}
+			break;
+		case 0xC6:	// MOV r/m, imm is /0 only
+		case 0xC7:
+			if (hs->modrm_reg != 0)
+			{
+				return false;
+			}
+			break;
+		case 0xFF:	// INC, DEC, near CALL, near JMP, PUSH
+			if (hs->modrm_reg == 3 || hs->modrm_reg == 5 || hs->modrm_reg == 7)
+			{
+				return false;
+			}
+			break;
+		}
+
+		if (hs->modrm_mod == 3)
+		{
+			return true;
+		}
+
+		uint8_t base = hs->modrm_rm;
+		if (hs->modrm_rm == 4)
+		{
+			uint8_t sib = *p++;
+			hs->sib = sib;
+			hs->sib_scale = sib >> 6;
+			hs->sib_index = (sib & 0x3F) >> 3;
+			hs->sib_base = base = sib & 7;
+			hs->flags |= F_SIB;
+		}
+
+		if (hs->modrm_mod == 1)
+		{
+			hs->disp.disp8 = *p++;
+			hs->flags |= F_DISP8;
+		}
+		else if (hs->modrm_mod == 2 || base == 5)
+		{
+			// mod 00 with rm 101 (RIP relative on x64) or SIB base 101 has disp32 only
+			hs->disp.disp32 = *reinterpret_cast<const uint32_t*>(p);
+			p += 4;
+			hs->flags |= F_DISP32;
+		}
+
+		return true;
+	}
+
+	// Returns instruction length, 0 when instruction has to be decoded by HDE
+	inline unsigned int FastDisasm(const uint8_t* code, hde_t* hs)
+	{
+		memset(hs, 0, sizeof(hde_t));
+
+		const uint8_t* p = code;
+		uint8_t cls = OpcodeClass[*p];
+
+#if defined _M_X64
+		if (cls == X)
+		{
+			// HDE leaves hs->rex zero, only split bits are set
+			uint8_t rex = *p++;
+			hs->rex_w = (rex & 0xF) >> 3;
+			hs->rex_r = (rex & 7) >> 2;
+			hs->rex_x = (rex & 3) >> 1;
+			hs->rex_b = rex & 1;
+			hs->flags |= F_PREFIX_REX;
+
+			cls = OpcodeClass[*p];
+			if (cls == X || cls == S)
+			{
+				return 0;
+			}
+		}
+#else
+		if (cls == X)
+		{
+			cls = N;
+		}
+#endif
+		if (cls == S)
+		{
+			return 0;
+		}
+
+		hs->opcode = *p++;
+
+		switch (cls)
+		{
+		case M:
+		case B:
+		case D:
+			if (!DecodeModRM(p, hs))
+			{
+				return 0;
+			}
+			break;
+		}
+
+		switch (cls)
+		{
+		case B:
+		case I:
+			hs->imm.imm8 = *p++;
+			hs->flags |= F_IMM8;
+			break;
+		case R:
+			hs->imm.imm8 = *p++;
+			hs->flags |= F_IMM8 | F_RELATIVE;
+			break;
+		case D:
+		case W:
+			hs->imm.imm32 = *reinterpret_cast<const uint32_t*>(p);
+			p += 4;
+			hs->flags |= F_IMM32;
+			break;
+		case L:
+			hs->imm.imm32 = *reinterpret_cast<const uint32_t*>(p);
+			p += 4;
+			hs->flags |= F_IMM32 | F_RELATIVE;
+			break;
+		case V:
+#if defined _M_X64
+			if (hs->rex_w)
+			{
+				hs->imm.imm64 = *reinterpret_cast<const uint64_t*>(p);
+				p += 8;
+				hs->flags |= F_IMM64;
+				break;
+			}
+#endif
+			hs->imm.imm32 = *reinterpret_cast<const uint32_t*>(p);
+			p += 4;
+			hs->flags |= F_IMM32;
+			break;
+		}
+
+		hs->len = static_cast<uint8_t>(p - code);
+		return hs->len;
+	}
+}}
+
+namespace MinHook
+{
+	unsigned int hde_disasm(const void* code, hde_t* hs)
+	{
+		unsigned int len = FastDisasm(reinterpret_cast<const uint8_t*>(code), hs);
+		if (len != 0)
+		{
+			return len;
+		}
+
+		return hde_full_disasm(code, hs);
+	}
+}
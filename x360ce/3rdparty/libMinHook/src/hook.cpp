@@ -35,9 +35,10 @@
 #include <Windows.h>
 #include "pstdint.h"
 
-#include "..\MinHook.h"
+#include "../MinHook.h"
 #include "hook.h"
 #include "buffer.h"
+#include "page.h"
 #include "trampoline.h"
 #include "thread.h"
 
@@ -56,6 +57,7 @@ namespace MinHook { namespace
 		bool	patchAbove;
 		bool	isEnabled;
 		bool	queueEnable;
+		size_t	listIndex;		// position in gHooks
 		std::vector<uintptr_t>	oldIPs;
 		std::vector<uintptr_t>	newIPs;
 	};
@@ -86,19 +88,27 @@ namespace MinHook { namespace
 	MH_STATUS	EnableAllHooksLL();
 	MH_STATUS	DisableAllHooksLL();
 	HOOK_ENTRY* FindHook(void* const pTarget);
-	bool		IsExecutableAddress(void* pAddress);
+	HOOK_ENTRY* AddHookEntry(const HOOK_ENTRY& hook);
+	void		RemoveHookEntry(HOOK_ENTRY* pHook);
+	void		ClearHookEntries();
+	inline size_t HashTarget(void* const pTarget);
+	void		InsertHookIndex(HOOK_ENTRY* pHook);
+	void		ResizeHookIndex(size_t size);
 	void		WriteRelativeJump(void* pFrom, void* const pTo);
 	void		WriteAbsoluteJump(void* pFrom, void* const pTo, void* pTable);
 
-	template <typename T>
-	bool operator <(const HOOK_ENTRY& lhs, const T& rhs) ;
-	template <typename T>
-	bool operator <(const T& lhs, const HOOK_ENTRY& rhs) ;
-	bool operator <(const HOOK_ENTRY& lhs, const HOOK_ENTRY& rhs);
+	// Hook entries are allocated from fixed size chunks and never move until RemoveHook,
+	// so pointers taken during queued passes stay valid while other hooks are created.
+	const size_t HookChunkSize = 64;
+	const size_t HookIndexMinSize = 64;		// must be power of two
 
 	CriticalSection gCS;
-	std::vector<HOOK_ENTRY> gHooks;
+	std::vector<HOOK_ENTRY*> gHooks;		// dense list of live entries, for passes over all hooks
+	std::vector<HOOK_ENTRY*> gHookIndex;	// open addressing by target, linear probing, at most half full
+	std::vector<HOOK_ENTRY*> gHookChunks;
+	std::vector<HOOK_ENTRY*> gFreeHooks;
 	bool gIsInitialized = false;
+	bool gIsQueueDirty = false;		// some hook has queueEnable != isEnabled
 }}
 
 namespace MinHook
@@ -135,8 +145,8 @@ namespace MinHook
 			return status;
 		}
 
-		std::vector<HOOK_ENTRY> v;
-		gHooks.swap(v);
+		ClearHookEntries();
+		gIsQueueDirty = false;
 
 		// ֐obt@̊J
 		UninitializeBuffer();
@@ -176,7 +186,7 @@ namespace MinHook
 			return MH_ERROR_ALREADY_CREATED;
 		}
 
-		if (!IsExecutableAddress(pTarget) || !IsExecutableAddress(pDetour))
+		if (!GetPageProvider().IsExecutable(pTarget) || !GetPageProvider().IsExecutable(pDetour))
 		{
 			return MH_ERROR_NOT_EXECUTABLE;
 		}
@@ -273,9 +283,7 @@ namespace MinHook
 			hook.oldIPs = ct.oldIPs;
 			hook.newIPs = ct.newIPs;
 
-			std::vector<HOOK_ENTRY>::iterator i	= std::lower_bound(gHooks.begin(), gHooks.end(), hook);
-			i = gHooks.insert(i, hook);
-			pHook = &(*i);
+			pHook = AddHookEntry(hook);
 		}
 
 		// OUT̏
@@ -293,13 +301,10 @@ namespace MinHook
 			return MH_ERROR_NOT_INITIALIZED;
 		}
 
-		std::vector<HOOK_ENTRY>::iterator i 
-			= std::lower_bound(gHooks.begin(), gHooks.end(), pTarget);
-		if (i == gHooks.end() || i->pTarget != pTarget)
+		HOOK_ENTRY *pHook = FindHook(pTarget);
+		if (pHook == NULL)
 			return MH_ERROR_NOT_CREATED;
 
-		HOOK_ENTRY *pHook = &(*i);
-
 		if (pHook->isEnabled)
 		{
 			ScopedThreadExclusive tex(pHook->newIPs, pHook->oldIPs);
@@ -323,7 +328,7 @@ namespace MinHook
 		FreeBuffer(pHook->pRelay);
 #endif
 
-		gHooks.erase(i);
+		RemoveHookEntry(pHook);
 
 		return MH_OK;
 	}
@@ -419,8 +424,9 @@ namespace MinHook
 		{
 			for (size_t i = 0, count = gHooks.size(); i < count; ++i)
 			{
-				HOOK_ENTRY& hook = gHooks[i];
+				HOOK_ENTRY& hook = *gHooks[i];
 				hook.queueEnable = true;
+				if (!hook.isEnabled) gIsQueueDirty = true;
 			}
 
 			return MH_OK;
@@ -433,6 +439,7 @@ namespace MinHook
 		}
 
 		pHook->queueEnable = true;
+		if (!pHook->isEnabled) gIsQueueDirty = true;
 
 		return MH_OK;
 	}
@@ -450,8 +457,9 @@ namespace MinHook
 		{
 			for (size_t i = 0, count = gHooks.size(); i < count; ++i)
 			{
-				HOOK_ENTRY& hook = gHooks[i];
+				HOOK_ENTRY& hook = *gHooks[i];
 				hook.queueEnable = false;
+				if (hook.isEnabled) gIsQueueDirty = true;
 			}
 
 			return MH_OK;
@@ -464,6 +472,7 @@ namespace MinHook
 		}
 
 		pHook->queueEnable = false;
+		if (pHook->isEnabled) gIsQueueDirty = true;
 
 		return MH_OK;
 	}
@@ -477,12 +486,18 @@ namespace MinHook
 			return MH_ERROR_NOT_INITIALIZED;
 		}
 
+		// Hooks queued in state they already have, nothing to write and no threads to freeze
+		if (!gIsQueueDirty)
+		{
+			return MH_OK;
+		}
+
 		std::vector<uintptr_t> oldIPs;
 		std::vector<uintptr_t> newIPs;
 
 		for (size_t i = 0, count = gHooks.size(); i < count; ++i)
 		{
-			HOOK_ENTRY& hook = gHooks[i];
+			HOOK_ENTRY& hook = *gHooks[i];
 			if (hook.isEnabled != hook.queueEnable)
 			{
 				if (hook.queueEnable)
@@ -504,7 +519,7 @@ namespace MinHook
 
 			for (size_t i = 0, count = gHooks.size(); i < count; ++i)
 			{
-				HOOK_ENTRY& hook = gHooks[i];
+				HOOK_ENTRY& hook = *gHooks[i];
 				if (hook.isEnabled != hook.queueEnable)
 				{
 					MH_STATUS status;
@@ -525,6 +540,7 @@ namespace MinHook
 			}
 		}
 
+		gIsQueueDirty = false;
 		return MH_OK;
 	}
 
@@ -541,8 +557,10 @@ namespace MinHook { namespace
 			patchSize += sizeof(JMP_REL_SHORT);
 		}
 
+		PageProvider& pages = GetPageProvider();
+
 		DWORD oldProtect;
-		if (!VirtualProtect(pPatchTarget, patchSize, PAGE_EXECUTE_READWRITE, &oldProtect))
+		if (!pages.Protect(pPatchTarget, patchSize, PAGE_EXECUTE_READWRITE, &oldProtect))
 		{
 			return MH_ERROR_MEMORY_PROTECT;
 		}
@@ -562,7 +580,7 @@ namespace MinHook { namespace
 			memcpy(pHook->pTarget, &jmpAbove, sizeof(jmpAbove));
 		}
 
-		VirtualProtect(pPatchTarget, patchSize, oldProtect, &oldProtect);
+		pages.Protect(pPatchTarget, patchSize, oldProtect, &oldProtect);
 
 		pHook->isEnabled = true;
 		pHook->queueEnable = true;
@@ -580,15 +598,17 @@ namespace MinHook { namespace
 			patchSize += sizeof(JMP_REL_SHORT);
 		}
 
+		PageProvider& pages = GetPageProvider();
+
 		DWORD oldProtect;
-		if (!VirtualProtect(pPatchTarget, patchSize, PAGE_EXECUTE_READWRITE, &oldProtect))
+		if (!pages.Protect(pPatchTarget, patchSize, PAGE_EXECUTE_READWRITE, &oldProtect))
 		{
 			return MH_ERROR_MEMORY_PROTECT;
 		}
 
 		memcpy(pPatchTarget, pHook->pBackup, patchSize);
 
-		VirtualProtect(pPatchTarget, patchSize, oldProtect, &oldProtect);
+		pages.Protect(pPatchTarget, patchSize, oldProtect, &oldProtect);
 
 		pHook->isEnabled = false;
 		pHook->queueEnable = false;
@@ -603,7 +623,7 @@ namespace MinHook { namespace
 
 		for (size_t i = 0, count = gHooks.size(); i < count; ++i)
 		{
-			HOOK_ENTRY& hook = gHooks[i];
+			HOOK_ENTRY& hook = *gHooks[i];
 			if (!hook.isEnabled)
 			{
 				oldIPs.insert(oldIPs.end(), hook.oldIPs.begin(), hook.oldIPs.end());
@@ -617,7 +637,7 @@ namespace MinHook { namespace
 
 			for (size_t i = 0, count = gHooks.size(); i < count; ++i)
 			{
-				HOOK_ENTRY& hook = gHooks[i];
+				HOOK_ENTRY& hook = *gHooks[i];
 				if (!hook.isEnabled)
 				{
 					MH_STATUS status = EnableHookLL(&hook);
@@ -639,7 +659,7 @@ namespace MinHook { namespace
 
 		for (size_t i = 0, count = gHooks.size(); i < count; ++i)
 		{
-			HOOK_ENTRY& hook = gHooks[i];
+			HOOK_ENTRY& hook = *gHooks[i];
 			if (hook.isEnabled)
 			{
 				oldIPs.insert(oldIPs.end(), hook.oldIPs.begin(), hook.oldIPs.end());
@@ -653,7 +673,7 @@ namespace MinHook { namespace
 
 			for (size_t i = 0, count = gHooks.size(); i < count; ++i)
 			{
-				HOOK_ENTRY& hook = gHooks[i];
+				HOOK_ENTRY& hook = *gHooks[i];
 				if (hook.isEnabled)
 				{
 					MH_STATUS status = DisableHookLL(&hook);
@@ -670,26 +690,134 @@ namespace MinHook { namespace
 
 	HOOK_ENTRY* FindHook(void* const pTarget)
 	{
-		std::vector<HOOK_ENTRY>::iterator i 
-			= std::lower_bound(gHooks.begin(), gHooks.end(), pTarget);
-		if (i != gHooks.end() && i->pTarget == pTarget)
+		if (gHookIndex.empty())
 		{
-			return &(*i);
+			return NULL;
+		}
+
+		size_t mask = gHookIndex.size() - 1;
+		for (size_t i = HashTarget(pTarget) & mask; gHookIndex[i] != NULL; i = (i + 1) & mask)
+		{
+			if (gHookIndex[i]->pTarget == pTarget)
+			{
+				return gHookIndex[i];
+			}
 		}
 
 		return NULL;
 	}
 
-	bool IsExecutableAddress(void* pAddress)
+	HOOK_ENTRY* AddHookEntry(const HOOK_ENTRY& hook)
+	{
+		if (gFreeHooks.empty())
+		{
+			HOOK_ENTRY* pChunk = new HOOK_ENTRY[HookChunkSize];
+			gHookChunks.push_back(pChunk);
+
+			for (size_t i = HookChunkSize; i > 0; --i)
+			{
+				gFreeHooks.push_back(&pChunk[i - 1]);
+			}
+		}
+
+		HOOK_ENTRY* pHook = gFreeHooks.back();
+		gFreeHooks.pop_back();
+
+		*pHook = hook;
+		pHook->listIndex = gHooks.size();
+		gHooks.push_back(pHook);
+
+		if (gHooks.size() * 2 > gHookIndex.size())
+		{
+			ResizeHookIndex(std::max<size_t>(HookIndexMinSize, gHookIndex.size() * 2));
+		}
+		else
+		{
+			InsertHookIndex(pHook);
+		}
+
+		return pHook;
+	}
+
+	void RemoveHookEntry(HOOK_ENTRY* pHook)
+	{
+		// Backward shift deletion, entries after the hole move up when their home slot allows it
+		size_t mask = gHookIndex.size() - 1;
+		size_t hole = HashTarget(pHook->pTarget) & mask;
+		while (gHookIndex[hole] != pHook)
+		{
+			hole = (hole + 1) & mask;
+		}
+
+		gHookIndex[hole] = NULL;
+		for (size_t i = (hole + 1) & mask; gHookIndex[i] != NULL; i = (i + 1) & mask)
+		{
+			size_t home = HashTarget(gHookIndex[i]->pTarget) & mask;
+			bool reachable = (hole <= i) ? (hole < home && home <= i) : (hole < home || home <= i);
+			if (!reachable)
+			{
+				gHookIndex[hole] = gHookIndex[i];
+				gHookIndex[i] = NULL;
+				hole = i;
+			}
+		}
+
+		HOOK_ENTRY* pLast = gHooks.back();
+		gHooks[pHook->listIndex] = pLast;
+		pLast->listIndex = pHook->listIndex;
+		gHooks.pop_back();
+
+		*pHook = HOOK_ENTRY();
+		gFreeHooks.push_back(pHook);
+	}
+
+	void ClearHookEntries()
 	{
-		static const DWORD PageExecuteMask 
-			= (PAGE_EXECUTE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY);
+		for (size_t i = 0, count = gHookChunks.size(); i < count; ++i)
+		{
+			delete[] gHookChunks[i];
+		}
 
-		// 蓖Ăss\ȗ̈`FbN
-		MEMORY_BASIC_INFORMATION mi = { 0 };
-		VirtualQuery(pAddress, &mi, sizeof(mi));
+		std::vector<HOOK_ENTRY*>().swap(gHooks);
+		std::vector<HOOK_ENTRY*>().swap(gHookIndex);
+		std::vector<HOOK_ENTRY*>().swap(gHookChunks);
+		std::vector<HOOK_ENTRY*>().swap(gFreeHooks);
+	}
 
-		return ((mi.Protect & PageExecuteMask) != 0);
+	inline size_t HashTarget(void* const pTarget)
+	{
+		// Low bits of function addresses are mostly alignment, mix high bits in
+		uintptr_t x = reinterpret_cast<uintptr_t>(pTarget);
+		x ^= x >> 16;
+#if defined _M_X64
+		x *= 0x9E3779B97F4A7C15ULL;
+		x ^= x >> 32;
+#elif defined _M_IX86
+		x *= 0x9E3779B9U;
+		x ^= x >> 16;
+#endif
+		return static_cast<size_t>(x);
+	}
+
+	void InsertHookIndex(HOOK_ENTRY* pHook)
+	{
+		size_t mask = gHookIndex.size() - 1;
+		size_t i = HashTarget(pHook->pTarget) & mask;
+		while (gHookIndex[i] != NULL)
+		{
+			i = (i + 1) & mask;
+		}
+
+		gHookIndex[i] = pHook;
+	}
+
+	void ResizeHookIndex(size_t size)
+	{
+		gHookIndex.assign(size, NULL);
+		for (size_t i = 0, count = gHooks.size(); i < count; ++i)
+		{
+			InsertHookIndex(gHooks[i]);
+		}
 	}
 
 	void WriteRelativeJump(void* pFrom, void* const pTo)
@@ -710,21 +838,4 @@ namespace MinHook { namespace
 		memcpy(pFrom,  &jmp, sizeof(jmp));
 		memcpy(pTable, &pTo, sizeof(pTo));
 	}
-
-	template <typename T>
-	bool operator <(const HOOK_ENTRY& lhs, const T& rhs)
-	{
-		return lhs.pTarget < reinterpret_cast<void*>(rhs);
-	}
-
-	template <typename T>
-	bool operator <(const T& lhs, const HOOK_ENTRY& rhs)
-	{
-		return reinterpret_cast<void*>(lhs) < rhs.pTarget;
-	}
-
-	bool operator <(const HOOK_ENTRY& lhs, const HOOK_ENTRY& rhs)
-	{
-		return lhs.pTarget < rhs.pTarget;
-	}
 }}
@@ -0,0 +1,105 @@
+/* 
+ *  MinHook - Minimalistic API Hook Library	
+ *  Copyright (C) 2009 Tsuda Kageyu. All rights reserved.
+ *  
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *  
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include "pstdint.h"
+
+namespace MinHook
+{
+	// Moves instruction pointers of frozen threads from patched code to its copy.
+	// oldIPs[i] becomes newIPs[i]. Pairs are sorted once per freeze, so each thread costs
+	// a range check, and a binary search only when IP lies inside the patched range.
+	class IPRelocator
+	{
+	public:
+		IPRelocator(const std::vector<uintptr_t>& oldIPs, const std::vector<uintptr_t>& newIPs)
+			: minIP_(static_cast<uintptr_t>(-1))
+			, maxIP_(0)
+		{
+			size_t count = std::min(oldIPs.size(), newIPs.size());
+			pairs_.reserve(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				IP_PAIR pair = { oldIPs[ i ], newIPs[ i ] };
+				pairs_.push_back(pair);
+				minIP_ = std::min<uintptr_t>(minIP_, pair.oldIP);
+				maxIP_ = std::max<uintptr_t>(maxIP_, pair.oldIP);
+			}
+
+			// first pair wins for duplicate IPs, like linear search did
+			std::stable_sort(pairs_.begin(), pairs_.end());
+		}
+
+		bool empty() const
+		{
+			return pairs_.empty();
+		}
+
+		// Returns true when ip was in patched code and has been replaced
+		bool Relocate(uintptr_t& ip) const
+		{
+			if (ip < minIP_ || ip > maxIP_)
+			{
+				return false;
+			}
+
+			std::vector<IP_PAIR>::const_iterator i = std::lower_bound(pairs_.begin(), pairs_.end(), ip);
+			if (i == pairs_.end() || i->oldIP != ip)
+			{
+				return false;
+			}
+
+			ip = i->newIP;
+			return true;
+		}
+
+	private:
+		struct IP_PAIR
+		{
+			uintptr_t	oldIP;
+			uintptr_t	newIP;
+
+			bool operator <(const IP_PAIR& rhs) const
+			{
+				return oldIP < rhs.oldIP;
+			}
+
+			bool operator <(uintptr_t rhs) const
+			{
+				return oldIP < rhs;
+			}
+		};
+
+		std::vector<IP_PAIR>	pairs_;
+		uintptr_t				minIP_;
+		uintptr_t				maxIP_;
+	};
+}
@@ -0,0 +1,167 @@
+/* 
+ *  MinHook - Minimalistic API Hook Library	
+ *  Copyright (C) 2009 Tsuda Kageyu. All rights reserved.
+ *  
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *  
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "stdafx.h"
+
+#include <Windows.h>
+#include "pstdint.h"
+
+#include "page.h"
+
+namespace MinHook { namespace
+{
+	class VirtualPageProvider : public PageProvider
+	{
+	public:
+		void* Allocate(void* pAddress, size_t size, DWORD protect)
+		{
+			return VirtualAlloc(pAddress, size, MEM_RESERVE | MEM_COMMIT, protect);
+		}
+
+		void Release(void* pAddress)
+		{
+			VirtualFree(pAddress, 0, MEM_RELEASE);
+		}
+
+		bool Protect(void* pAddress, size_t size, DWORD protect, DWORD* pOldProtect)
+		{
+			return VirtualProtect(pAddress, size, protect, pOldProtect) != FALSE;
+		}
+
+		bool IsExecutable(void* pAddress)
+		{
+			static const DWORD PageExecuteMask
+				= (PAGE_EXECUTE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY);
+
+			// Free and reserved pages have Protect 0
+			MEMORY_BASIC_INFORMATION mi = { 0 };
+			VirtualQuery(pAddress, &mi, sizeof(mi));
+
+			return ((mi.Protect & PageExecuteMask) != 0);
+		}
+
+		void* FindPrevFree(void* pOrigin, void* pLimit, size_t granularity)
+		{
+			uintptr_t tryAddr = reinterpret_cast<uintptr_t>(pOrigin);
+			uintptr_t minAddr = reinterpret_cast<uintptr_t>(pLimit);
+
+			// Round down to the allocation granularity and step below origin
+			tryAddr -= tryAddr % granularity;
+			if (tryAddr < granularity)
+			{
+				return NULL;
+			}
+			tryAddr -= granularity;
+
+			while (tryAddr >= minAddr)
+			{
+				MEMORY_BASIC_INFORMATION mbi;
+				if (VirtualQuery(reinterpret_cast<void*>(tryAddr), &mbi, sizeof(mbi)) == 0)
+				{
+					break;
+				}
+
+				if (mbi.State == MEM_FREE)
+				{
+					return reinterpret_cast<void*>(tryAddr);
+				}
+
+				// Skip whole allocation, bases are aligned to granularity
+				uintptr_t base = reinterpret_cast<uintptr_t>(mbi.AllocationBase);
+				if (base < granularity)
+				{
+					break;
+				}
+				tryAddr = base - granularity;
+			}
+
+			return NULL;
+		}
+
+		void* FindNextFree(void* pOrigin, void* pLimit, size_t granularity)
+		{
+			uintptr_t tryAddr = reinterpret_cast<uintptr_t>(pOrigin);
+			uintptr_t maxAddr = reinterpret_cast<uintptr_t>(pLimit);
+
+			// Round down to the allocation granularity and step above origin
+			tryAddr -= tryAddr % granularity;
+			tryAddr += granularity;
+
+			while (tryAddr <= maxAddr)
+			{
+				MEMORY_BASIC_INFORMATION mbi;
+				if (VirtualQuery(reinterpret_cast<void*>(tryAddr), &mbi, sizeof(mbi)) == 0)
+				{
+					break;
+				}
+
+				if (mbi.State == MEM_FREE)
+				{
+					return reinterpret_cast<void*>(tryAddr);
+				}
+
+				// Skip whole region and round up to the next block
+				uintptr_t next = reinterpret_cast<uintptr_t>(mbi.BaseAddress) + mbi.RegionSize;
+				next += granularity - 1;
+				next -= next % granularity;
+				if (next <= tryAddr)
+				{
+					break;
+				}
+				tryAddr = next;
+			}
+
+			return NULL;
+		}
+
+		void GetAddressRange(void** ppMin, void** ppMax)
+		{
+			SYSTEM_INFO si;
+			GetSystemInfo(&si);
+
+			*ppMin = si.lpMinimumApplicationAddress;
+			*ppMax = si.lpMaximumApplicationAddress;
+		}
+	};
+
+	VirtualPageProvider gVirtualPageProvider;
+	PageProvider* gPageProvider = &gVirtualPageProvider;
+}}
+
+namespace MinHook
+{
+	PageProvider& GetPageProvider()
+	{
+		return *gPageProvider;
+	}
+
+	void SetPageProvider(PageProvider* pProvider)
+	{
+		gPageProvider = (pProvider != NULL) ? pProvider : &gVirtualPageProvider;
+	}
+}
@@ -0,0 +1,61 @@
+/* 
+ *  MinHook - Minimalistic API Hook Library	
+ *  Copyright (C) 2009 Tsuda Kageyu. All rights reserved.
+ *  
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *  
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+namespace MinHook
+{
+	// Source of memory pages for hook buffers.
+	// buffer.cpp only decides where slots go, pages come from here,
+	// so slot allocator and trampoline builder can run on top of another page source.
+	class PageProvider
+	{
+	public:
+		virtual ~PageProvider() {}
+
+		// Reserves and commits size bytes at pAddress, anywhere when pAddress is NULL.
+		// Returned address must be aligned to allocation granularity.
+		virtual void*	Allocate(void* pAddress, size_t size, DWORD protect) = 0;
+		virtual void	Release(void* pAddress) = 0;
+		virtual bool	Protect(void* pAddress, size_t size, DWORD protect, DWORD* pOldProtect) = 0;
+
+		// True when pAddress is committed and executable.
+		// Trampoline builder asks only this, so it does not depend on VirtualQuery.
+		virtual bool	IsExecutable(void* pAddress) = 0;
+
+		// Nearest free block of granularity size below (or above) pOrigin, not crossing pLimit.
+		// Returns NULL when there is none. Used and reserved ranges are skipped as a whole.
+		virtual void*	FindPrevFree(void* pOrigin, void* pLimit, size_t granularity) = 0;
+		virtual void*	FindNextFree(void* pOrigin, void* pLimit, size_t granularity) = 0;
+
+		virtual void	GetAddressRange(void** ppMin, void** ppMax) = 0;
+	};
+
+	PageProvider&	GetPageProvider();
+	void			SetPageProvider(PageProvider* pProvider);	// NULL restores VirtualAlloc based provider
+}
@@ -107,7 +107,7 @@ namespace MinHook
 		assert(("ScopedThreadExclusive::ctor", (oldIPs.size() == newIPs.size())));
 
 		GetThreads(threads_);
-		Freeze(threads_, oldIPs, newIPs);
+		Freeze(threads_, IPRelocator(oldIPs, newIPs));
 	}
 
 	ScopedThreadExclusive::~ScopedThreadExclusive()
@@ -115,8 +115,74 @@ namespace MinHook
 		Unfreeze(threads_);
 	}
 
-	void ScopedThreadExclusive::GetThreads(std::vector<DWORD>& threads)
+	void ScopedThreadExclusive::GetThreads(std::vector<HANDLE>& threads)
 	{
+		if (!GetThreadsNt(threads))
+		{
+			GetThreadsSnapshot(threads);
+		}
+	}
+
+	// Walks threads of this process only, system wide snapshot is not needed (Vista and later)
+	bool ScopedThreadExclusive::GetThreadsNt(std::vector<HANDLE>& threads)
+	{
+		typedef LONG (NTAPI *NtGetNextThread_t)(HANDLE, HANDLE, ACCESS_MASK, ULONG, ULONG, PHANDLE);
+		typedef DWORD (WINAPI *GetThreadId_t)(HANDLE);
+
+		static NtGetNextThread_t pNtGetNextThread = NULL;
+		static GetThreadId_t pGetThreadId = NULL;
+		static bool resolved = false;
+		if (!resolved)
+		{
+			HMODULE hNtdll = GetModuleHandleW(L"ntdll.dll");
+			HMODULE hKernel32 = GetModuleHandleW(L"kernel32.dll");
+			if (hNtdll != NULL && hKernel32 != NULL)
+			{
+				pNtGetNextThread = reinterpret_cast<NtGetNextThread_t>(GetProcAddress(hNtdll, "NtGetNextThread"));
+				pGetThreadId = reinterpret_cast<GetThreadId_t>(GetProcAddress(hKernel32, "GetThreadId"));
+			}
+			resolved = true;
+		}
+
+		if (pNtGetNextThread == NULL || pGetThreadId == NULL)
+		{
+			return false;
+		}
+
+		static const DWORD ThreadAccess 
+			= THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_QUERY_INFORMATION | THREAD_SET_CONTEXT;
+
+		DWORD currentId = GetCurrentThreadId();
+		HANDLE hThread = NULL;
+		HANDLE hNext = NULL;
+		while (pNtGetNextThread(GetCurrentProcess(), hThread, ThreadAccess, 0, 0, &hNext) >= 0)
+		{
+			// previous handle is kept unless it is this thread
+			if (hThread != NULL && (threads.empty() || threads.back() != hThread))
+			{
+				CloseHandle(hThread);
+			}
+
+			hThread = hNext;
+			if (pGetThreadId(hThread) != currentId)
+			{
+				threads.push_back(hThread);
+			}
+		}
+
+		if (hThread != NULL && (threads.empty() || threads.back() != hThread))
+		{
+			CloseHandle(hThread);
+		}
+
+		return true;
+	}
+
+	void ScopedThreadExclusive::GetThreadsSnapshot(std::vector<HANDLE>& threads)
+	{
+		static const DWORD ThreadAccess 
+			= THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_QUERY_INFORMATION | THREAD_SET_CONTEXT;
+
 		ScopedHandle hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
 		if (hSnapshot == INVALID_HANDLE_VALUE)
 		{
@@ -131,60 +197,71 @@ namespace MinHook
 				if (te.th32OwnerProcessID == GetCurrentProcessId()
 					&& te.th32ThreadID != GetCurrentThreadId())
 				{
-					threads.push_back(te.th32ThreadID);
+					HANDLE hThread = OpenThread(ThreadAccess, FALSE, te.th32ThreadID);
+					if (hThread != NULL)
+					{
+						threads.push_back(hThread);
+					}
 				}
 			}
 			while (Thread32Next(hSnapshot, &te));
 		}
 	}
 
-	void ScopedThreadExclusive::Freeze(
-		const std::vector<DWORD>& threads, const std::vector<uintptr_t>& oldIPs, const std::vector<uintptr_t>& newIPs)
+	void ScopedThreadExclusive::Freeze(std::vector<HANDLE>& threads, const IPRelocator& relocator)
 	{
-		assert(("ScopedThreadExclusive::freeze", (oldIPs.size() == newIPs.size())));
-
-		static const DWORD ThreadAccess 
-			= THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_QUERY_INFORMATION | THREAD_SET_CONTEXT;
-
+		size_t kept = 0;
 		for (size_t i = 0, count = threads.size(); i < count; ++i)
 		{
-			DWORD tid = threads[i];
-			ScopedHandle hThread = OpenThread(ThreadAccess, FALSE, tid);
-			SuspendThread(hThread);
+			HANDLE hThread = threads[i];
+
+			// thread that can not be suspended (already gone) is dropped, others are still frozen
+			if (SuspendThread(hThread) == static_cast<DWORD>(-1))
+			{
+				CloseHandle(hThread);
+				continue;
+			}
+			threads[kept++] = hThread;
+
+			if (relocator.empty())
+			{
+				continue;
+			}
 
 			// ͈͓ŃXbh~ꍇ́Ag|֐ɐڂ
 			CONTEXT c = { 0 };
 			c.ContextFlags = CONTEXT_CONTROL;
 			if (!GetThreadContext(hThread, &c))
 			{
-				return;
+				continue;
 			}
 
 #if defined _M_X64
-			DWORD64& ip = c.Rip;
+			uintptr_t ip = static_cast<uintptr_t>(c.Rip);
 #elif defined _M_IX86
-			DWORD& ip = c.Eip;
+			uintptr_t ip = static_cast<uintptr_t>(c.Eip);
 #endif
-			for (size_t i = 0; i < oldIPs.size(); ++i)
+			if (relocator.Relocate(ip))
 			{
-				if (ip == oldIPs[ i ])
-				{
-					ip = newIPs[ i ];
-					SetThreadContext(hThread, &c);
-					break;
-				}
+#if defined _M_X64
+				c.Rip = ip;
+#elif defined _M_IX86
+				c.Eip = ip;
+#endif
+				SetThreadContext(hThread, &c);
 			}
 		}
+		threads.resize(kept);
 	}
 
-	void ScopedThreadExclusive::Unfreeze(const std::vector<DWORD>& threads)
+	void ScopedThreadExclusive::Unfreeze(std::vector<HANDLE>& threads)
 	{
 		for (size_t i = 0, count = threads.size(); i < count; ++i)
 		{
-			DWORD tid = threads[i];
-			ScopedHandle hThread = OpenThread(THREAD_SUSPEND_RESUME, FALSE, tid);
-			ResumeThread(hThread);
+			ResumeThread(threads[i]);
+			CloseHandle(threads[i]);
 		}
+		threads.clear();
 	}
 }
 
@@ -32,6 +32,7 @@
 #include <windows.h>
 
 #include "trampoline.h"
+#include "iprelocate.h"
 
 namespace MinHook
 {
@@ -65,15 +66,16 @@ namespace MinHook
 	class ScopedThreadExclusive
 	{
 	private:
-		std::vector<DWORD> threads_;
+		std::vector<HANDLE> threads_;	// suspended threads, opened once for freeze and unfreeze
 	public:
 		ScopedThreadExclusive(const std::vector<uintptr_t>& oldIPs, const std::vector<uintptr_t>& newIPs);
 		~ScopedThreadExclusive();
 	private:
-		static void GetThreads(std::vector<DWORD>& threads);
-		static void Freeze(
-			const std::vector<DWORD>& threads, const std::vector<uintptr_t>& oldIPs, const std::vector<uintptr_t>& newIPs);
-		static void Unfreeze(const std::vector<DWORD>& threads);
+		static void GetThreads(std::vector<HANDLE>& threads);
+		static bool GetThreadsNt(std::vector<HANDLE>& threads);
+		static void GetThreadsSnapshot(std::vector<HANDLE>& threads);
+		static void Freeze(std::vector<HANDLE>& threads, const IPRelocator& relocator);
+		static void Unfreeze(std::vector<HANDLE>& threads);
 	};
 }
 
@@ -31,27 +31,14 @@
 #include <cassert>
 #include <vector>
 #include <algorithm>
-#include <Windows.h>
 #include "pstdint.h"
 
-#if defined _M_X64
-#include "hde64/hde64.h"
-#elif defined _M_IX86
-#include "hde32/hde32.h"
-#endif
-
+#include "hde_fast.h"
+#include "page.h"
 #include "trampoline.h"
 
 namespace MinHook { namespace
 {
-#if defined _M_X64
-	typedef hde64s hde_t;
-	inline unsigned int hde_disasm(const void* code, hde_t* hs) { return hde64_disasm(code, hs); }
-#elif defined _M_IX86
-	typedef hde32s hde_t;
-	inline unsigned int hde_disasm(const void* code, hde_t* hs) { return hde32_disasm(code, hs); }
-#endif
-
 	// ߏݗp\
 #pragma pack(push, 1)
 	struct JMP_REL_SHORT
@@ -96,7 +83,6 @@ namespace MinHook { namespace
 	inline void	SetJccOpcode(const hde_t& hs, JCC_REL& inst);
 	inline void	SetJccOpcode(const hde_t& hs, JCC_ABS& inst);
 	bool		IsCodePadding(uint8_t* pInst, size_t size);
-	bool		IsExecutableAddress(void* pAddress);
 }}
 
 namespace MinHook
@@ -237,7 +223,7 @@ namespace MinHook
 			}
 
 			// Can we place the long jump above the function?
-			if (!IsExecutableAddress(reinterpret_cast<uint8_t*>(ct.pTarget) - sizeof(JMP_REL)))
+			if (!GetPageProvider().IsExecutable(reinterpret_cast<uint8_t*>(ct.pTarget) - sizeof(JMP_REL)))
 			{
 				return false;
 			}
@@ -378,18 +364,6 @@ namespace MinHook { namespace
 			return false;
 		}
 	}
-
-	bool IsExecutableAddress(void* pAddress)
-	{
-		static const DWORD PageExecuteMask 
-			= (PAGE_EXECUTE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY);
-
-		// 蓖Ăss\ȗ̈`FbN
-		MEMORY_BASIC_INFORMATION mi = { 0 };
-		VirtualQuery(pAddress, &mi, sizeof(mi));
-
-		return ((mi.Protect & PageExecuteMask) != 0);
-	}
 }}
 
 
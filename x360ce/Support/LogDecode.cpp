@@ -0,0 +1,196 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Turns binary x360ce log (Options LogBinary=1) into same text as text log.
+//
+//   LogDecode x360ce_game.exe_12345.xlog [x360ce_game.exe_12345.log]
+//
+// Text goes to stdout when no output file is given. Log cut short by crash is decoded up to last whole record.
+// Mapped log (Options LogMapped=1) is read up to its committed offset, mapped text log is copied as it is.
+// Build: cl /EHsc LogDecode.cpp or g++ -O2 -o LogDecode LogDecode.cpp
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "../x360ce/LogFormat.h"
+#include "../x360ce/LogMapFile.h"
+
+#define LOGDECODE_MAX_TEXT 4096
+
+// Log file contents, data of mapped log without its header
+struct LogInput
+{
+	std::vector<unsigned char> bytes;
+	size_t offset;
+	size_t end;
+
+	bool Read(void* data, size_t size)
+	{
+		if (size > end - offset) return false;
+		if (size) memcpy(data, &bytes[offset], size);
+		offset += size;
+		return true;
+	}
+};
+
+static bool LoadFile(const char* name, LogInput* input)
+{
+	FILE* in = fopen(name, "rb");
+	if (!in) return false;
+
+	unsigned char buffer[65536];
+	size_t got;
+	while ((got = fread(buffer, 1, sizeof(buffer), in)) != 0)
+		input->bytes.insert(input->bytes.end(), buffer, buffer + got);
+	fclose(in);
+
+	input->offset = 0;
+	input->end = input->bytes.size();
+
+	LogMapHeader map;
+	if (input->end >= sizeof(map) && memcmp(&input->bytes[0], LOGMAP_MAGIC, sizeof(map.magic)) == 0)
+	{
+		memcpy(&map, &input->bytes[0], sizeof(map));
+		if (map.size >= sizeof(map) && map.size <= input->end)
+		{
+			input->offset = map.size;
+			if (map.committed < input->end - map.size) input->end = map.size + map.committed;
+			else if (map.committed > input->end - map.size) fprintf(stderr, "LogDecode: %s is shorter than its committed size\n", name);
+		}
+	}
+	return true;
+}
+
+static void WriteLine(FILE* out, const LogFileHeader& header, const LogFileRecord& record, const char* text)
+{
+	int64_t time = LogCounterToTime(header, record.counter);
+	uint64_t ms = static_cast<uint64_t>(time / 10000) % (24 * 60 * 60 * 1000);
+
+	fprintf(out, "%02u:%02u:%02u.%03u\t%08u\t%s\n",
+		static_cast<unsigned>(ms / 3600000), static_cast<unsigned>(ms / 60000 % 60),
+		static_cast<unsigned>(ms / 1000 % 60), static_cast<unsigned>(ms % 1000), record.thread, text);
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: LogDecode input.xlog [output.log]\n");
+		return 1;
+	}
+
+	LogInput in;
+	if (!LoadFile(argv[1], &in))
+	{
+		fprintf(stderr, "LogDecode: cannot open %s\n", argv[1]);
+		return 1;
+	}
+
+	bool plain = in.offset && (in.end - in.offset < sizeof(LOGFILE_MAGIC) - 1 ||
+		memcmp(&in.bytes[in.offset], LOGFILE_MAGIC, sizeof(LOGFILE_MAGIC) - 1) != 0);
+
+	LogFileHeader header;
+	if (!plain && (!in.Read(&header, sizeof(header)) || memcmp(header.magic, LOGFILE_MAGIC, sizeof(header.magic)) != 0))
+	{
+		fprintf(stderr, "LogDecode: %s is not binary x360ce log\n", argv[1]);
+		return 1;
+	}
+	if (!plain && header.version != LOGFILE_VERSION)
+	{
+		fprintf(stderr, "LogDecode: %s has unsupported version %u\n", argv[1], header.version);
+		return 1;
+	}
+
+	FILE* out = stdout;
+	if (argc > 2 && !(out = fopen(argv[2], plain ? "wb" : "w")))
+	{
+		fprintf(stderr, "LogDecode: cannot create %s\n", argv[2]);
+		return 1;
+	}
+
+	if (plain)
+	{
+		if (in.end > in.offset) fwrite(&in.bytes[in.offset], 1, in.end - in.offset, out);
+		if (out != stdout) fclose(out);
+		return 0;
+	}
+
+	std::vector<std::string> formats(0x10000);
+	std::vector<unsigned char> data;
+	char text[LOGDECODE_MAX_TEXT];
+	unsigned long records = 0;
+	bool stamp = true;
+	bool partial = false;
+
+	for (;;)
+	{
+		LogFileRecord record;
+		if (!in.Read(&record, sizeof(record)))
+		{
+			partial = in.offset != in.end;
+			break;
+		}
+
+		data.resize(record.length + 1);
+		if (!in.Read(&data[0], record.length))
+		{
+			partial = true;
+			break;
+		}
+		data[record.length] = 0;
+
+		if (record.site == LOGFILE_FORMAT)
+		{
+			uint16_t site;
+			if (record.length < sizeof(site)) continue;
+			memcpy(&site, &data[0], sizeof(site));
+			formats[site].assign(reinterpret_cast<const char*>(&data[sizeof(site)]), record.length - sizeof(site));
+			continue;
+		}
+
+		if (stamp)
+		{
+			fputs("[TIME]\t\t[THREAD]\t[LOG]\n", out);
+			stamp = false;
+		}
+
+		if (record.site == LOGFILE_TEXT)
+			WriteLine(out, header, record, reinterpret_cast<const char*>(&data[0]));
+		else if (formats[record.site].empty())
+		{
+			LogPrintf(text, sizeof(text), "<unknown format %u>", record.site);
+			WriteLine(out, header, record, text);
+		}
+		else
+		{
+			LogFormatMessage(text, sizeof(text), formats[record.site].c_str(), header.pointer, &data[0], record.length);
+			WriteLine(out, header, record, text);
+		}
+		++records;
+	}
+
+	if (partial) fprintf(stderr, "LogDecode: %s ends with partial record\n", argv[1]);
+
+	if (out != stdout) fclose(out);
+
+	fprintf(stderr, "LogDecode: %lu messages\n", records);
+	return 0;
+}
@@ -0,0 +1,75 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Cost per device ID read by game: old wcsstr/swscanf/swprintf path, single pass rewriter and cache hit.
+
+#include "Test.h"
+#include <windows.h>
+#include "DeviceId.h"
+#include "DeviceIdCorpus.h"
+
+static const int ROUNDS = 200000;
+static const DWORD PIDVID = 0x028E045E;
+
+template<typename Func>
+static double Run(const char* name, Func func)
+{
+	wchar_t out[DEVICEID_MAX_LENGTH];
+	size_t total = 0;
+
+	double start = TestSeconds();
+	for (int round = 0; round < ROUNDS; ++round)
+		for (size_t i = 0; i < _countof(g_Corpus); ++i)
+			total += func(g_Corpus[i], out);
+	double ns = (TestSeconds() - start) * 1e9 / (ROUNDS * _countof(g_Corpus));
+
+	printf("%-12s %7.1f ns/id, %u chars written\n", name, ns, (unsigned)total);
+	return ns;
+}
+
+static size_t Old(const wchar_t* str, wchar_t* out)
+{
+	return Reference(str, true, PIDVID, PIDVID, 0, out, DEVICEID_MAX_LENGTH);
+}
+
+static size_t New(const wchar_t* str, wchar_t* out)
+{
+	return Rewrite(str, true, PIDVID, PIDVID, 0, out, DEVICEID_MAX_LENGTH);
+}
+
+static DeviceIdCache g_Cache;
+
+static size_t Cached(const wchar_t* str, wchar_t* out)
+{
+	size_t length = 0;
+	if (g_Cache.Find(str, 1, out, DEVICEID_MAX_LENGTH, &length)) return length;
+	length = New(str, out);
+	g_Cache.Store(str, 1, out, length);
+	return length;
+}
+
+int main()
+{
+	printf("%u ids in corpus\n", (unsigned)_countof(g_Corpus));
+	Run("swscanf", Old);
+	Run("single pass", New);
+	Run("cached", Cached);
+	return 0;
+}
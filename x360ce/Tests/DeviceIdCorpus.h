@@ -0,0 +1,96 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _DEVICEIDCORPUS_H_
+#define _DEVICEIDCORPUS_H_
+
+// Instance IDs seen from XInput detection code of games and the hook code DeviceId.h replaced.
+
+#include <windows.h>
+#include "DeviceId.h"
+
+#include <stdio.h>
+#include <wchar.h>
+
+// Old WMI/SetupApi hook code, result of rewrite for pad with given PIDVID or empty string
+inline size_t Reference(const wchar_t* str, bool ouya, DWORD pidvid, DWORD hookpidvid, DWORD userindex, wchar_t* out, size_t size)
+{
+	unsigned dwVid = 0, dwPid = 0, dummy;
+	out[0] = L'\0';
+
+	const wchar_t* strVid = wcsstr(str, L"VID_");
+	if (!strVid || swscanf(strVid, L"VID_%4X", &dwVid) < 1)
+	{
+		if (!ouya) return 0;
+		strVid = wcsstr(str, L"VID&");
+		if (!strVid || swscanf(strVid, L"VID&%4X%4X", &dummy, &dwVid) < 1) return 0;
+	}
+
+	const wchar_t* strPid = wcsstr(str, L"PID_");
+	if (!strPid || swscanf(strPid, L"PID_%4X", &dwPid) < 1)
+	{
+		if (!ouya) return 0;
+		strPid = wcsstr(str, L"PID&");
+		if (!strPid || swscanf(strPid, L"PID&%4X", &dwPid) < 1) return 0;
+	}
+
+	if ((dwVid | (dwPid << 16)) != pidvid) return 0;
+
+	const wchar_t* bus;
+	if (wcsstr(str, L"USB\\") || wcsstr(str, L"root\\")) bus = L"USB";
+	else if (wcsstr(str, L"HID\\")) bus = L"HID";
+	else return 0;
+
+	const wchar_t* p = wcsrchr(str, L'\\');
+	int length = swprintf(out, size, L"%ls\\VID_%04X&PID_%04X&IG_%02d%ls", bus,
+		hookpidvid & 0xFFFF, hookpidvid >> 16, (int)userindex, p ? p : L"");
+	return length > 0 ? length : 0;
+}
+
+inline size_t Rewrite(const wchar_t* str, bool ouya, DWORD pidvid, DWORD hookpidvid, DWORD userindex, wchar_t* out, size_t size)
+{
+	out[0] = L'\0';
+	DeviceId id;
+	if (!ParseDeviceId(str, ouya, &id) || id.bus == DEVICEID_BUS_NONE) return 0;
+	if ((DWORD)(id.vid | (id.pid << 16)) != pidvid) return 0;
+	return FormatDeviceId(out, size, id, hookpidvid & 0xFFFF, hookpidvid >> 16, userindex);
+}
+
+static const wchar_t* const g_Corpus[] =
+{
+	L"USB\\VID_045E&PID_028E\\6&1A2B3C4D&0&1",
+	L"USB\\VID_046D&PID_C21D\\A1B2C3D4",
+	L"USB\\VID_046D&PID_C21D&MI_00\\7&2F6A&0&0000",
+	L"HID\\VID_046D&PID_C21D&IG_00\\8&3A1B2C&0&0000",
+	L"HID\\VID_054C&PID_05C4&REV_0100&MI_03\\9&ABCDEF&0&0000",
+	L"HID\\{00001124-0000-1000-8000-00805F9B34FB}_VID&0002054C_PID&05C4\\8&2B&0&0000",
+	L"HID\\{00001124-0000-1000-8000-00805F9B34FB}_VID&000205AC_PID&3232\\9&1&0&0000",
+	L"root\\VID_1234&PID_BEAD&REV_0219\\0000",
+	L"ROOT\\HIDCLASS\\0000",
+	L"ACPI\\PNP0303\\4&1D401FB5&0",
+	L"PCI\\VEN_8086&DEV_1E31&SUBSYS_05351028&REV_04\\3&11583659&0&A0",
+	L"BTHENUM\\{00001124-0000-1000-8000-00805F9B34FB}_VID&0002054C_PID&05C4\\7&1",
+	L"HID\\VID_045E&PID_028E&IG_00",
+	L"USB\\VID_045E&PID_02",
+	L"VID_045E&PID_028E",
+	L"",
+};
+
+#endif
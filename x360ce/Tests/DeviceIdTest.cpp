@@ -0,0 +1,280 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Device instance ID parser and rewriter against wcsstr/swscanf/swprintf code it replaced.
+
+#include "Test.h"
+#include <windows.h>
+#include "DeviceId.h"
+#include "DeviceIdCorpus.h"
+
+#include <wchar.h>
+#include <stdlib.h>
+
+// returns number of pads input was rewritten for
+static int CheckSame(const wchar_t* str)
+{
+	int rewritten = 0;
+	static const DWORD pidvids[] = { 0x028E045E, 0xC21D046D, 0x05C4054C, 0x3232AC05, 0xBEAD1234 };
+	wchar_t expected[DEVICEID_MAX_LENGTH * 2];
+	wchar_t actual[DEVICEID_MAX_LENGTH * 2];
+
+	for (int ouya = 0; ouya < 2; ++ouya)
+	{
+		for (size_t i = 0; i < _countof(pidvids); ++i)
+		{
+			size_t a = Reference(str, ouya != 0, pidvids[i], 0x028E045E, 3, expected, _countof(expected));
+			size_t b = Rewrite(str, ouya != 0, pidvids[i], 0x028E045E, 3, actual, _countof(actual));
+			CHECK_EQ(a, b);
+			if (a != b || wcscmp(expected, actual) != 0)
+			{
+				CHECK_EQ(0, wcscmp(expected, actual));
+				printf("input \"%ls\"\n  expected \"%ls\"\n  actual   \"%ls\"\n", str, expected, actual);
+				return rewritten;
+			}
+			rewritten += a != 0;
+		}
+	}
+	return rewritten;
+}
+
+TEST(CorpusMatchesReference)
+{
+	for (size_t i = 0; i < _countof(g_Corpus); ++i)
+		CheckSame(g_Corpus[i]);
+}
+
+TEST(ParsedFields)
+{
+	DeviceId id;
+	CHECK(ParseDeviceId(L"HID\\VID_046D&PID_C21D&IG_00\\8&3A1B2C&0&0000", false, &id));
+	CHECK_EQ(0x046D, id.vid);
+	CHECK_EQ(0xC21D, id.pid);
+	CHECK_EQ(DEVICEID_BUS_HID, id.bus);
+	CHECK(id.suffix && wcscmp(id.suffix, L"\\8&3A1B2C&0&0000") == 0);
+
+	CHECK(!ParseDeviceId(L"HID\\{00001124}_VID&0002054C_PID&05C4\\8", false, &id));
+	CHECK(ParseDeviceId(L"HID\\{00001124}_VID&0002054C_PID&05C4\\8", true, &id));
+	CHECK_EQ(0x054C, id.vid);
+	CHECK_EQ(0x05C4, id.pid);
+}
+
+TEST(OutputTooSmall)
+{
+	DeviceId id;
+	CHECK(ParseDeviceId(L"USB\\VID_045E&PID_028E\\1", false, &id));
+
+	wchar_t out[64];
+	size_t length = FormatDeviceId(out, _countof(out), id, 0x045E, 0x028E, 0);
+	CHECK_EQ(0, wcscmp(out, L"USB\\VID_045E&PID_028E&IG_00\\1"));
+	CHECK_EQ(wcslen(out), length);
+	CHECK_EQ(0, FormatDeviceId(out, length, id, 0x045E, 0x028E, 0));
+	CHECK_EQ(length, FormatDeviceId(out, length + 1, id, 0x045E, 0x028E, 0));
+	CHECK_EQ(length + 1, FormatDeviceId(out, _countof(out), id, 0x045E, 0x028E, 100));
+}
+
+TEST(PropertyNames)
+{
+	CHECK(IsDeviceIdProperty(L"DeviceID"));
+	CHECK(IsDeviceIdProperty(L"deviceid"));
+	CHECK(IsDeviceIdProperty(L"PNPDeviceID"));
+	CHECK(IsDeviceIdProperty(L"PnPDeviceId"));
+	CHECK(IsDeviceIdProperty(L"HardWareID"));
+	CHECK(IsDeviceIdProperty(L"HardwareID"));
+	CHECK(IsDeviceIdProperty(L"CompatibleID"));
+	CHECK(IsDeviceIdProperty(L"CompatID"));
+	CHECK(!IsDeviceIdProperty(L"Name"));
+	CHECK(!IsDeviceIdProperty(L"Caption"));
+	CHECK(!IsDeviceIdProperty(L"Manufacturer"));
+	CHECK(!IsDeviceIdProperty(L"DeviceIDs"));
+	CHECK(!IsDeviceIdProperty(L""));
+	CHECK(!IsDeviceIdProperty(NULL));
+	CHECK(!IsDeviceIdProperty(L"AVeryLongPropertyNameThatIsNotOneOfOurs"));
+
+	CHECK_EQ(DEVICEID_PROPERTY_INSTANCE, GetDeviceIdProperty(L"DeviceID"));
+	CHECK_EQ(DEVICEID_PROPERTY_INSTANCE, GetDeviceIdProperty(L"PNPDeviceID"));
+	CHECK_EQ(DEVICEID_PROPERTY_HARDWARE, GetDeviceIdProperty(L"HardwareID"));
+	CHECK_EQ(DEVICEID_PROPERTY_HARDWARE, GetDeviceIdProperty(L"CompatibleID"));
+	CHECK_EQ(DEVICEID_PROPERTY_HARDWARE, GetDeviceIdProperty(L"CompatID"));
+	CHECK_EQ(DEVICEID_PROPERTY_NONE, GetDeviceIdProperty(L"Name"));
+}
+
+// Walks REG_MULTI_SZ like iHook::RewriteHardwareId does for every entry, expected NULL - entry is kept
+static void CheckHardwareIds(const wchar_t* ids, const wchar_t* const* expected, size_t count, DWORD pidvid)
+{
+	wchar_t out[DEVICEID_MAX_LENGTH];
+	size_t i = 0;
+	for (const wchar_t* p = ids; *p; p += wcslen(p) + 1, ++i)
+	{
+		CHECK(i < count);
+		if (i >= count) return;
+
+		DeviceId id;
+		bool ours = ParseDeviceId(p, false, &id) && (DWORD)(id.vid | (id.pid << 16)) == pidvid;
+		size_t length = ours ? ReplaceDeviceIdPidVid(out, _countof(out), p, 0x045E, 0x028E) : 0;
+		if (!expected[i])
+		{
+			CHECK_EQ(0, length);
+			continue;
+		}
+		CHECK_EQ(wcslen(expected[i]), length);
+		CHECK_EQ(0, wcscmp(expected[i], out));
+	}
+	CHECK_EQ(count, i);
+}
+
+// HardwareID and CompatibleID of Logitech F310 in XInput mode and of DualShock 4, as SetupApi returns them
+TEST(HardwareIdMultiString)
+{
+	static const wchar_t f310hardware[] =
+		L"USB\\VID_046D&PID_C21D&REV_4014\0"
+		L"USB\\VID_046D&PID_C21D\0";
+	static const wchar_t* const f310hardwareExpected[] =
+	{
+		L"USB\\VID_045E&PID_028E&REV_4014",
+		L"USB\\VID_045E&PID_028E"
+	};
+	CheckHardwareIds(f310hardware, f310hardwareExpected, _countof(f310hardwareExpected), 0xC21D046D);
+
+	static const wchar_t f310compatible[] =
+		L"USB\\MS_COMP_XUSB10\0"
+		L"USB\\Class_FF&SubClass_5D&Prot_01\0"
+		L"USB\\Class_FF&SubClass_5D\0"
+		L"USB\\Class_FF\0";
+	static const wchar_t* const f310compatibleExpected[] = { NULL, NULL, NULL, NULL };
+	CheckHardwareIds(f310compatible, f310compatibleExpected, _countof(f310compatibleExpected), 0xC21D046D);
+
+	static const wchar_t ds4hardware[] =
+		L"HID\\VID_054C&PID_05C4&REV_0100\0"
+		L"HID\\VID_054C&PID_05C4\0"
+		L"HID_DEVICE_SYSTEM_GAME\0"
+		L"HID_DEVICE_UP:0001_U:0005\0"
+		L"HID_DEVICE\0";
+	static const wchar_t* const ds4hardwareExpected[] =
+	{
+		L"HID\\VID_045E&PID_028E&REV_0100",
+		L"HID\\VID_045E&PID_028E",
+		NULL,
+		NULL,
+		NULL
+	};
+	CheckHardwareIds(ds4hardware, ds4hardwareExpected, _countof(ds4hardwareExpected), 0x05C4054C);
+
+	// instance ID formatting would take "\VID_..." for instance part
+	DeviceId id;
+	CHECK(ParseDeviceId(L"USB\\VID_046D&PID_C21D&REV_4014", false, &id));
+	CHECK_EQ(0, wcscmp(id.suffix, L"\\VID_046D&PID_C21D&REV_4014"));
+
+	// short digits are not replaced, output must fit
+	wchar_t out[32];
+	CHECK_EQ(0, ReplaceDeviceIdPidVid(out, _countof(out), L"USB\\VID_46D&PID_C21D", 0x045E, 0x028E));
+	CHECK_EQ(0, ReplaceDeviceIdPidVid(out, 21, L"USB\\VID_046D&PID_C21D", 0x045E, 0x028E));
+	CHECK_EQ(21, ReplaceDeviceIdPidVid(out, 22, L"USB\\VID_046D&PID_C21D", 0x045E, 0x028E));
+}
+
+TEST(CacheKeepsResultsAndMisses)
+{
+	DeviceIdCache cache;
+	wchar_t out[DEVICEID_MAX_LENGTH];
+	size_t length = 1;
+
+	CHECK(!cache.Find(L"USB\\VID_045E&PID_028E\\1", 0, out, _countof(out), &length));
+	cache.Store(L"USB\\VID_045E&PID_028E\\1", 0, L"USB\\VID_045E&PID_028E&IG_00\\1", 29);
+	cache.Store(L"ACPI\\PNP0303\\4", 0, L"", 0);
+
+	CHECK(cache.Find(L"USB\\VID_045E&PID_028E\\1", 0, out, _countof(out), &length));
+	CHECK_EQ(29, length);
+	CHECK_EQ(0, wcscmp(out, L"USB\\VID_045E&PID_028E&IG_00\\1"));
+
+	// tag is part of key, short buffer is a miss
+	CHECK(!cache.Find(L"USB\\VID_045E&PID_028E\\1", 2, out, _countof(out), &length));
+	CHECK(!cache.Find(L"USB\\VID_045E&PID_028E\\1", 0, out, 29, &length));
+
+	CHECK(cache.Find(L"ACPI\\PNP0303\\4", 0, out, _countof(out), &length));
+	CHECK_EQ(0, length);
+
+	// oldest entry goes first
+	for (int i = 0; i < DEVICEID_CACHE_SIZE; ++i)
+	{
+		wchar_t key[32];
+		swprintf(key, _countof(key), L"KEY%d", i);
+		cache.Store(key, 0, L"", 0);
+	}
+	CHECK(!cache.Find(L"USB\\VID_045E&PID_028E\\1", 0, out, _countof(out), &length));
+}
+
+// Real ids and ids glued from real tokens, then mutated. Alphabet has no whitespace, sign or 'x',
+// which "%4X" of swscanf accepts as prefix and hand written parser deliberately does not.
+TEST(FuzzMatchesReference)
+{
+	static const wchar_t* const buses[] = { L"USB\\", L"HID\\", L"root\\", L"ROOT\\", L"BTHENUM\\", L"HID\\{00001124-0000}_", L"" };
+	static const wchar_t* const vids[] = { L"VID_045E", L"VID_046D", L"VID&0002054C", L"VID&000205AC", L"VID_1234", L"VID_45E", L"VID&0002", L"VID_" };
+	static const wchar_t* const pids[] = { L"PID_028E", L"PID_C21D", L"PID&05C4", L"PID&3232", L"PID_BEAD", L"PID_28E", L"PID&", L"PID_" };
+	static const wchar_t* const tails[] = { L"\\6&1A2B3C4D&0&1", L"&IG_00\\8&3A&0&0000", L"&MI_00\\7&2F6A", L"&REV_0100", L"\\", L"" };
+	static const wchar_t noise[] = L"VIDPUSBHroot_&\\0123456789ABCDEFabcdef#{}-";
+
+	srand(12345);
+	const int count = 200000;
+	wchar_t str[160];
+	int rewritten = 0;
+	for (int n = 0; n < count; ++n)
+	{
+		if (n % 8 == 0)
+		{
+			wcscpy(str, g_Corpus[rand() % _countof(g_Corpus)]);
+		}
+		else
+		{
+			swprintf(str, 128, L"%ls%ls%ls%ls%ls", buses[rand() % _countof(buses)], vids[rand() % _countof(vids)],
+				rand() % 4 ? L"&" : L"_", pids[rand() % _countof(pids)], tails[rand() % _countof(tails)]);
+		}
+
+		// insert, delete or replace characters
+		int mutations = rand() % 4;
+		for (int i = 0; i < mutations; ++i)
+		{
+			size_t length = wcslen(str);
+			size_t at = length ? rand() % (length + 1) : 0;
+			wchar_t c = noise[rand() % (_countof(noise) - 1)];
+			switch (rand() % 3)
+			{
+			case 0:
+				if (length + 1 >= _countof(str)) break;
+				memmove(str + at + 1, str + at, (length - at + 1) * sizeof(wchar_t));
+				str[at] = c;
+				break;
+			case 1:
+				if (at < length) memmove(str + at, str + at + 1, (length - at) * sizeof(wchar_t));
+				break;
+			default:
+				if (at < length) str[at] = c;
+				break;
+			}
+		}
+
+		int failed = TestFailures();
+		rewritten += CheckSame(str) != 0;
+		if (TestFailures() != failed) break;
+	}
+	printf("%d of %d random ids rewritten\n", rewritten, count);
+	CHECK(rewritten > count / 20);
+}
+
+TEST_MAIN()
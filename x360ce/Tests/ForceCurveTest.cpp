@@ -0,0 +1,132 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Rumble curve table against reference curve it is compiled from.
+
+#include "Test.h"
+#include "ForceCurve.h"
+
+// Largest difference of Map from reference curve over motor speeds from first
+static double MaxError(const ForceCurve& curve, double scale, uint32_t first = 0)
+{
+	double worst = 0.0;
+	for (uint32_t speed = first; speed <= 0xFFFF; ++speed)
+	{
+		double expected = curve.Evaluate(speed / 65535.0) * scale * 65535.0;
+		if (expected > 65535.0) expected = 65535.0;
+		double error = fabs(curve.Map(static_cast<WORD>(speed)) - expected);
+		if (error > worst) worst = error;
+	}
+	return worst;
+}
+
+TEST(LinearIsIdentity)
+{
+	ForceCurve curve;
+	for (uint32_t speed = 0; speed <= 0xFFFF; speed += 17)
+		CHECK(abs(curve.Map(static_cast<WORD>(speed)) - static_cast<int>(speed)) <= 256);
+	CHECK_EQ(0, curve.Map(0));
+	CHECK(curve.Map(0xFFFF) >= 0xFF00);
+}
+
+TEST(TableFollowsGammaCurves)
+{
+	const double gammas[] = { 0.5, 0.7, 1.0, 1.5, 2.2, 3.0 };
+	for (size_t i = 0; i < sizeof(gammas) / sizeof(gammas[0]); ++i)
+	{
+		ForceCurve curve;
+		curve.Set(gammas[i], 0, 100, 100);
+
+		// 256 linear steps, first one of square root curve is steepest
+		CHECK(MaxError(curve, 1.0) <= 0.016 * 65535.0);
+		CHECK(MaxError(curve, 1.0, 0x100) <= 0.005 * 65535.0);
+
+		// table nodes are curve itself
+		for (uint32_t node = 0; node < FORCECURVE_STEPS; ++node)
+		{
+			double expected = curve.Evaluate(node / 256.0) * 65535.0;
+			CHECK(fabs(curve.GetTable()[node] - expected) <= 1.0);
+		}
+	}
+}
+
+TEST(DeadZoneMaxAndScale)
+{
+	ForceCurve curve;
+	curve.Set(1.0, 20, 80, 150);
+
+	CHECK_EQ(0, curve.Map(0x3000));
+	CHECK(abs(curve.Map(0x4000) - 4915) <= 16);
+	CHECK(MaxError(curve, 1.5) <= 0.005 * 65535.0);
+
+	// 80% of 150% clamps at full force
+	CHECK_EQ(0xFFFF, curve.Map(0xFFFF));
+}
+
+TEST(CustomPointsFollowReference)
+{
+	ForceCurve curve;
+	curve.Set(1.0, 0, 100, 100, "0:0,25:60,50:80,100:100");
+
+	CHECK(MaxError(curve, 1.0) <= 0.005 * 65535.0);
+	CHECK(fabs(curve.Evaluate(0.25) - 0.60) < 1e-9);
+	CHECK(fabs(curve.Evaluate(0.75) - 0.90) < 1e-9);
+}
+
+TEST(CustomPointsAboveZeroStayFlat)
+{
+	ForceCurve curve;
+	curve.Set(1.0, 0, 100, 100, "50:10,60:100");
+
+	// below first point output is first point, never negative
+	CHECK(fabs(curve.Evaluate(0.1) - 0.10) < 1e-9);
+	CHECK(fabs(curve.Evaluate(0.5) - 0.10) < 1e-9);
+	CHECK(fabs(curve.Evaluate(0.8) - 1.00) < 1e-9);
+
+	CHECK_EQ(0, curve.GetTable()[0]);
+	for (uint32_t node = 1; node <= FORCECURVE_STEPS / 2; ++node)
+		CHECK(abs(curve.GetTable()[node] - 6554) <= 1);
+	// zero input is still off, so first step departs from curve,
+	// and corners of steep segment fall between table nodes
+	CHECK(MaxError(curve, 1.0, 0x100) <= 0.02 * 65535.0);
+}
+
+TEST(MonotonicCurvesMapMonotonic)
+{
+	ForceCurve curve;
+	curve.Set(2.2, 5, 90, 100);
+
+	WORD last = 0;
+	for (uint32_t speed = 0; speed <= 0xFFFF; ++speed)
+	{
+		WORD out = curve.Map(static_cast<WORD>(speed));
+		CHECK(out >= last);
+		last = out;
+	}
+}
+
+TEST(MagnitudeRange)
+{
+	CHECK_EQ(0, ForceCurve::ToMagnitude(0));
+	CHECK_EQ(10000, ForceCurve::ToMagnitude(0xFFFF));
+	CHECK_EQ(5000, ForceCurve::ToMagnitude(0x8000));
+}
+
+TEST_MAIN()
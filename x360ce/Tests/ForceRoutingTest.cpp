@@ -0,0 +1,195 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Routing of XInput motors to 1, 2 and N actuators: weights built by Build, fixed point Mix,
+// primary motor that selects effect of actuator, and Apply used by XInputSetState with curves.
+
+#include "Test.h"
+#include "ForceCurve.h"
+#include "ForceRouting.h"
+
+static void Mix(const ForceRouting& routing, WORD left, WORD right, WORD out[FFB_MAX_ACTUATORS])
+{
+	WORD motors[FFB_MOTORS];
+	motors[FFB_LEFTMOTOR] = left;
+	motors[FFB_RIGHTMOTOR] = right;
+	memset(out, 0, FFB_MAX_ACTUATORS * sizeof(WORD));
+	routing.Mix(motors, out);
+}
+
+TEST(OneActuatorMixesBothMotors)
+{
+	ForceRouting routing;
+	routing.Build(1, false);
+	CHECK_EQ(1, routing.GetCount());
+
+	WORD out[FFB_MAX_ACTUATORS];
+	Mix(routing, 0x4000, 0, out);
+	CHECK_EQ(0x4000, out[0]);
+	Mix(routing, 0, 0x4000, out);
+	CHECK_EQ(0x4000, out[0]);
+	Mix(routing, 0x4000, 0x2000, out);
+	CHECK_EQ(0x6000, out[0]);
+
+	// sum saturates instead of wrapping
+	Mix(routing, 0xC000, 0xC000, out);
+	CHECK_EQ(0xFFFF, out[0]);
+	CHECK_EQ(0, out[1]);
+}
+
+TEST(OneActuatorIgnoresSwap)
+{
+	ForceRouting routing;
+	routing.Build(1, true);
+
+	WORD out[FFB_MAX_ACTUATORS];
+	Mix(routing, 0x8000, 0x2000, out);
+	CHECK_EQ(0xA000, out[0]);
+	CHECK_EQ(FFB_LEFTMOTOR, routing.GetPrimaryMotor(0));
+}
+
+TEST(TwoActuatorsKeepMotorsApart)
+{
+	ForceRouting routing;
+	routing.Build(2, false);
+	CHECK_EQ(2, routing.GetCount());
+	CHECK_EQ(FFB_LEFTMOTOR, routing.GetPrimaryMotor(0));
+	CHECK_EQ(FFB_RIGHTMOTOR, routing.GetPrimaryMotor(1));
+
+	WORD out[FFB_MAX_ACTUATORS];
+	Mix(routing, 0xFFFF, 0, out);
+	CHECK_EQ(0xFFFF, out[0]);
+	CHECK_EQ(0, out[1]);
+
+	Mix(routing, 0, 0x8000, out);
+	CHECK_EQ(0, out[0]);
+	CHECK_EQ(0x8000, out[1]);
+}
+
+TEST(TwoActuatorsSwapOnce)
+{
+	ForceRouting routing;
+	routing.Build(2, true);
+	CHECK_EQ(FFB_RIGHTMOTOR, routing.GetPrimaryMotor(0));
+	CHECK_EQ(FFB_LEFTMOTOR, routing.GetPrimaryMotor(1));
+
+	WORD out[FFB_MAX_ACTUATORS];
+	Mix(routing, 0xFFFF, 0x1234, out);
+	CHECK_EQ(0x1234, out[0]);
+	CHECK_EQ(0xFFFF, out[1]);
+}
+
+TEST(NActuatorsAlternateMotors)
+{
+	for (uint8_t actuators = 3; actuators <= FFB_MAX_ACTUATORS; ++actuators)
+	{
+		ForceRouting routing;
+		routing.Build(actuators, false);
+		CHECK_EQ(actuators, routing.GetCount());
+
+		WORD out[FFB_MAX_ACTUATORS];
+		Mix(routing, 0x8000, 0x4000, out);
+		for (uint8_t i = 0; i < actuators; ++i)
+		{
+			CHECK_EQ(i & 1 ? 0x4000 : 0x8000, out[i]);
+			CHECK_EQ(i & 1 ? FFB_RIGHTMOTOR : FFB_LEFTMOTOR, routing.GetPrimaryMotor(i));
+		}
+	}
+}
+
+TEST(ActuatorCountIsCapped)
+{
+	ForceRouting routing;
+	routing.Build(9, false);
+	CHECK_EQ(FFB_MAX_ACTUATORS, routing.GetCount());
+}
+
+TEST(NoActuatorsNoForces)
+{
+	ForceRouting routing;
+	routing.Build(0, false);
+	CHECK_EQ(0, routing.GetCount());
+
+	// Mix writes nothing for device without actuators
+	WORD motors[FFB_MOTORS] = { 0xFFFF, 0xFFFF };
+	WORD out[FFB_MAX_ACTUATORS] = { 1, 2, 3, 4 };
+	routing.Mix(motors, out);
+	for (uint8_t i = 0; i < FFB_MAX_ACTUATORS; ++i)
+		CHECK_EQ(i + 1, out[i]);
+}
+
+TEST(RebuildReplacesRouting)
+{
+	// device initialized again with fewer actuators keeps no weights of old ones
+	ForceRouting routing;
+	routing.Build(4, true);
+	routing.Build(1, false);
+	CHECK_EQ(1, routing.GetCount());
+
+	WORD out[FFB_MAX_ACTUATORS];
+	Mix(routing, 0x4000, 0x4000, out);
+	CHECK_EQ(0x8000, out[0]);
+	CHECK_EQ(0, out[1]);
+}
+
+// Apply is what XInputSetState calls, default curves pass motor speeds through
+TEST(ApplyWithDefaultCurves)
+{
+	ForceCurve curve[FFB_MOTORS];
+	ForceRouting routing;
+	routing.Build(2, false);
+
+	WORD out[FFB_MAX_ACTUATORS] = {};
+	routing.Apply(curve, 0x8000, 0x4000, out);
+	CHECK(abs(out[0] - 0x8000) <= 0x100);
+	CHECK(abs(out[1] - 0x4000) <= 0x100);
+}
+
+TEST(ApplyCurvesBeforeMixing)
+{
+	ForceCurve curve[FFB_MOTORS];
+	curve[FFB_LEFTMOTOR].Set(1.0, 0, 50, 100);
+	curve[FFB_RIGHTMOTOR].Set(1.0, 50, 100, 100);
+
+	ForceRouting routing;
+	routing.Build(1, false);
+
+	// right motor in its dead zone, left one at half of max
+	WORD out[FFB_MAX_ACTUATORS] = {};
+	routing.Apply(curve, 0xFFFF, 0x4000, out);
+	CHECK(abs(out[0] - 0x8000) <= 0x100);
+	CHECK(abs(ForceCurve::ToMagnitude(out[0]) - 5000) <= 40);
+}
+
+TEST(ApplySwapsAfterCurves)
+{
+	// curve belongs to XInput motor, so swapped device gets left curve on its second actuator
+	ForceCurve curve[FFB_MOTORS];
+	curve[FFB_LEFTMOTOR].Set(1.0, 0, 25, 100);
+
+	ForceRouting routing;
+	routing.Build(2, true);
+
+	WORD out[FFB_MAX_ACTUATORS] = {};
+	routing.Apply(curve, 0xFFFF, 0xFFFF, out);
+	CHECK(out[0] >= 0xFF00);
+	CHECK(abs(out[1] - 0x4000) <= 0x100);
+}
+
+TEST_MAIN()
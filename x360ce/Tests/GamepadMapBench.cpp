@@ -0,0 +1,102 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Cost of XInputGetStateEx mapping: single pass against old path that read guide before poll
+// and ORed it into state that XInputGetState then rebuilt.
+
+#include "Test.h"
+#include "GamepadMap.h"
+#include "SyntheticDevice.h"
+
+#include <string.h>
+
+static const int FRAMES = 64;
+static const int CALLS = 4000000;
+
+// driver side state, one per frame so every poll sees moving input
+static PadState g_Frames[FRAMES];
+
+static void Poll(Pad& pad, int call)
+{
+	memcpy(&pad.state, &g_Frames[call % FRAMES], sizeof(pad.state));
+}
+
+static DWORD SinglePass(const Mapping& mapping, Pad& pad, XINPUT_STATE& state, int call)
+{
+	Poll(pad, call);
+	bool guide = GuidePressed(mapping, pad);
+	state.dwPacketNumber = call;
+	MapGamepad(mapping, pad, state.Gamepad, guide);
+	return state.Gamepad.wButtons;
+}
+
+static DWORD DoublePath(const Mapping& mapping, Pad& pad, XINPUT_STATE& state, int call)
+{
+	// XInputGetStateEx
+	if (GuidePressed(mapping, pad)) state.Gamepad.wButtons |= XINPUT_GAMEPAD_GUIDE;
+
+	// XInputGetState
+	Poll(pad, call);
+	state.dwPacketNumber = call;
+	MapGamepad(mapping, pad, state.Gamepad, false);
+	return state.Gamepad.wButtons;
+}
+
+template<typename Path>
+static double Run(const char* name, Path path, DWORD& guides)
+{
+	Mapping mapping = DefaultMapping();
+	Pad pad;
+	XINPUT_STATE state;
+	guides = 0;
+
+	double start = TestSeconds();
+	for (int i = 0; i < CALLS; ++i)
+		guides += (path(mapping, pad, state, i) & XINPUT_GAMEPAD_GUIDE) != 0;
+	double ns = (TestSeconds() - start) * 1e9 / CALLS;
+
+	printf("%-12s %7.1f ns/call, guide reported %u of %u\n", name, ns, guides, CALLS);
+	return ns;
+}
+
+int main()
+{
+	for (int i = 0; i < FRAMES; ++i)
+	{
+		PadState& frame = g_Frames[i];
+		memset(&frame, 0, sizeof(frame));
+		frame.lX = (i * 1031) % 65535 - 32767;
+		frame.lY = (i * 2053) % 65535 - 32767;
+		frame.lZ = (i * 4099) % 65535 - 32767;
+		frame.lRx = -frame.lX;
+		frame.lRy = -frame.lY;
+		frame.rgdwPOV[0] = i % 9 == 8 ? (DWORD)-1 : (i % 9) * 4500;
+		for (int j = 0; j < 12; ++j)
+			frame.rgbButtons[j] = (i >> (j % 6)) & 1 ? 0x80 : 0;
+	}
+
+	DWORD single = 0;
+	DWORD twice = 0;
+	Run("single pass", SinglePass, single);
+	Run("double path", DoublePath, twice);
+
+	printf("guide lost by double path: %u\n", single - twice);
+	return 0;
+}
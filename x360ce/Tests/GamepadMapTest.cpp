@@ -0,0 +1,209 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Mapping pass of XInputGetState and XInputGetStateEx on synthetic device state.
+
+#include "Test.h"
+#include "GamepadMap.h"
+#include "SyntheticDevice.h"
+
+#include <string.h>
+
+static XINPUT_GAMEPAD Map(const Mapping& mapping, Pad& pad, bool guide)
+{
+	XINPUT_GAMEPAD gamepad;
+	memset(&gamepad, 0xCC, sizeof(gamepad));
+	MapGamepad(mapping, pad, gamepad, guide);
+	return gamepad;
+}
+
+TEST(IdleDeviceMapsToZero)
+{
+	Mapping mapping = DefaultMapping();
+	Pad pad;
+	XINPUT_GAMEPAD gamepad = Map(mapping, pad, false);
+
+	CHECK_EQ(0, gamepad.wButtons);
+	CHECK_EQ(0, gamepad.bLeftTrigger);
+	CHECK_EQ(0, gamepad.bRightTrigger);
+	CHECK_EQ(0, gamepad.sThumbLX);
+	CHECK_EQ(0, gamepad.sThumbLY);
+	CHECK_EQ(0, gamepad.sThumbRX);
+	CHECK_EQ(0, gamepad.sThumbRY);
+}
+
+TEST(ButtonsFollowMappingTable)
+{
+	Mapping mapping = DefaultMapping();
+	for (int i = 0; i < 10; ++i)
+	{
+		Pad pad;
+		pad.Press(i);
+		CHECK_EQ(buttonIDs[i], Map(mapping, pad, false).wButtons);
+	}
+
+	// unmapped button is ignored
+	Pad pad;
+	pad.Press(0);
+	mapping.Button[0] = -1;
+	CHECK_EQ(0, Map(mapping, pad, false).wButtons);
+}
+
+TEST(GuideIsOneBased)
+{
+	Mapping mapping = DefaultMapping();
+	Pad pad;
+	CHECK(!GuidePressed(mapping, pad));
+
+	pad.Press(10);
+	CHECK(GuidePressed(mapping, pad));
+
+	mapping.guide = 0;
+	CHECK(!GuidePressed(mapping, pad));
+}
+
+TEST(ExtendedStateDiffersOnlyByGuide)
+{
+	Mapping mapping = DefaultMapping();
+	Pad pad;
+	pad.Press(0);
+	pad.Press(7);
+	pad.Press(10);
+	pad.state.rgdwPOV[0] = 9000;
+	pad.state.lX = 20000;
+	pad.state.lRy = -12000;
+	pad.state.lZ = 16000;
+
+	bool guide = GuidePressed(mapping, pad);
+	XINPUT_GAMEPAD plain = Map(mapping, pad, false);
+	XINPUT_GAMEPAD extended = Map(mapping, pad, guide);
+
+	CHECK_EQ(XINPUT_GAMEPAD_A | XINPUT_GAMEPAD_START | XINPUT_GAMEPAD_DPAD_RIGHT, plain.wButtons);
+	CHECK_EQ(plain.wButtons | XINPUT_GAMEPAD_GUIDE, extended.wButtons);
+	CHECK_EQ(plain.bLeftTrigger, extended.bLeftTrigger);
+	CHECK_EQ(plain.bRightTrigger, extended.bRightTrigger);
+	CHECK_EQ(plain.sThumbLX, extended.sThumbLX);
+	CHECK_EQ(plain.sThumbLY, extended.sThumbLY);
+	CHECK_EQ(plain.sThumbRX, extended.sThumbRX);
+	CHECK_EQ(plain.sThumbRY, extended.sThumbRY);
+}
+
+TEST(GuideSurvivesButtonRebuild)
+{
+	// old XInputGetStateEx set guide bit before XInputGetState rebuilt button word
+	Mapping mapping = DefaultMapping();
+	Pad pad;
+	pad.Press(10);
+
+	XINPUT_GAMEPAD gamepad;
+	gamepad.wButtons = XINPUT_GAMEPAD_GUIDE;
+	MapGamepad(mapping, pad, gamepad, false);
+	CHECK_EQ(0, gamepad.wButtons);
+
+	MapGamepad(mapping, pad, gamepad, GuidePressed(mapping, pad));
+	CHECK_EQ(XINPUT_GAMEPAD_GUIDE, gamepad.wButtons);
+}
+
+TEST(PovToDpad)
+{
+	Mapping mapping = DefaultMapping();
+	struct { DWORD pov; WORD buttons; } cases[] =
+	{
+		{ 0, XINPUT_GAMEPAD_DPAD_UP },
+		{ 4500, XINPUT_GAMEPAD_DPAD_UP | XINPUT_GAMEPAD_DPAD_RIGHT },
+		{ 9000, XINPUT_GAMEPAD_DPAD_RIGHT },
+		{ 13500, XINPUT_GAMEPAD_DPAD_RIGHT | XINPUT_GAMEPAD_DPAD_DOWN },
+		{ 18000, XINPUT_GAMEPAD_DPAD_DOWN },
+		{ 22500, XINPUT_GAMEPAD_DPAD_DOWN | XINPUT_GAMEPAD_DPAD_LEFT },
+		{ 27000, XINPUT_GAMEPAD_DPAD_LEFT },
+		{ 31500, XINPUT_GAMEPAD_DPAD_LEFT | XINPUT_GAMEPAD_DPAD_UP },
+		{ (DWORD)-1, 0 },
+	};
+
+	for (size_t i = 0; i < _countof(cases); ++i)
+	{
+		Pad pad;
+		pad.state.rgdwPOV[0] = cases[i].pov;
+		CHECK_EQ(cases[i].buttons, Map(mapping, pad, false).wButtons);
+	}
+}
+
+TEST(SticksAndInversion)
+{
+	Mapping mapping = DefaultMapping();
+	Pad pad;
+	pad.state.lX = 32767;
+	pad.state.lY = 32767;
+	pad.state.lRx = -1000;
+	pad.state.lRy = -32767;
+
+	XINPUT_GAMEPAD gamepad = Map(mapping, pad, false);
+	CHECK_EQ(32767, gamepad.sThumbLX);
+	CHECK_EQ(-32767, gamepad.sThumbLY);
+	CHECK_EQ(-1000, gamepad.sThumbRX);
+	CHECK_EQ(32767, gamepad.sThumbRY);
+}
+
+TEST(AxisDeadzone)
+{
+	Mapping mapping = DefaultMapping();
+	Pad pad;
+	pad.axisdeadzone[0] = 4000;
+	pad.state.lX = 3999;
+	CHECK_EQ(0, Map(mapping, pad, false).sThumbLX);
+	pad.state.lX = -4000;
+	CHECK_EQ(0, Map(mapping, pad, false).sThumbLX);
+	pad.state.lX = 4001;
+	CHECK_EQ(4001, Map(mapping, pad, false).sThumbLX);
+}
+
+TEST(HalfAxisTriggers)
+{
+	Mapping mapping = DefaultMapping();
+	Pad pad;
+	pad.state.lZ = 32767;
+	XINPUT_GAMEPAD gamepad = Map(mapping, pad, false);
+	CHECK_EQ(255, gamepad.bLeftTrigger);
+	CHECK_EQ(0, gamepad.bRightTrigger);
+
+	pad.state.lZ = -32768;
+	gamepad = Map(mapping, pad, false);
+	CHECK_EQ(0, gamepad.bLeftTrigger);
+	CHECK_EQ(255, gamepad.bRightTrigger);
+}
+
+TEST(DigitalTriggerAndStick)
+{
+	Mapping mapping = DefaultMapping();
+	mapping.Trigger[1].type = DIGITAL;
+	mapping.Trigger[1].id = 20;
+	mapping.Axis[0].hasDigital = true;
+	mapping.Axis[0].positiveButtonID = 21;
+	mapping.Axis[0].negativeButtonID = 22;
+
+	Pad pad;
+	pad.Press(20);
+	pad.Press(22);
+	XINPUT_GAMEPAD gamepad = Map(mapping, pad, false);
+	CHECK_EQ(255, gamepad.bRightTrigger);
+	CHECK_EQ(-32767, gamepad.sThumbLX);
+}
+
+TEST_MAIN()
@@ -0,0 +1,264 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Guide button waits against synthetic backend: pad state is set by test,
+// events and overlapped results come from compat windows.h.
+
+#include "Test.h"
+#include <windows.h>
+#include "GuideButton.h"
+
+// Pad whose guide button is pressed by test and which signals notify event like DirectInput does
+class SyntheticPad
+{
+public:
+	SyntheticPad(GuideButtonWait& wait)
+		:m_wait(wait)
+		, m_guide(false)
+		, m_polls(0)
+	{
+	}
+
+	// device reports new data
+	void Press(bool pressed)
+	{
+		m_guide = pressed;
+		SetEvent(m_wait.GetNotifyEvent());
+	}
+
+	// what poll callback of XInputWaitForGuideButton does
+	void Poll()
+	{
+		InterlockedIncrement(&m_polls);
+		m_wait.Update(m_guide);
+	}
+
+	LONG Polls() const
+	{
+		return m_polls;
+	}
+
+private:
+	GuideButtonWait& m_wait;
+	volatile bool m_guide;
+	volatile LONG m_polls;
+};
+
+struct Waiter
+{
+	GuideButtonWait* wait;
+	SyntheticPad* pad;
+	volatile DWORD result;
+	volatile bool done;
+	double cpu;
+	pthread_t thread;
+
+	static void* Proc(void* param)
+	{
+		Waiter* waiter = static_cast<Waiter*>(param);
+
+		timespec start, end;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+		waiter->result = waiter->wait->Wait([waiter]() { waiter->pad->Poll(); });
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+
+		waiter->cpu = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+		waiter->done = true;
+		return NULL;
+	}
+
+	void Start(GuideButtonWait& w, SyntheticPad& p)
+	{
+		wait = &w;
+		pad = &p;
+		result = 0xFFFFFFFF;
+		done = false;
+		pthread_create(&thread, NULL, Proc, this);
+	}
+
+	void Join()
+	{
+		pthread_join(thread, NULL);
+	}
+};
+
+TEST(PressWakesBlockingWaiter)
+{
+	GuideButtonWait wait;
+	SyntheticPad pad(wait);
+
+	Waiter waiter;
+	waiter.Start(wait, pad);
+	Sleep(20);
+	CHECK(!waiter.done);
+
+	pad.Press(true);
+	waiter.Join();
+	CHECK_EQ(ERROR_SUCCESS, waiter.result);
+	CHECK(pad.Polls() >= 1);
+}
+
+TEST(PollerWakesWaiterWithoutNotify)
+{
+	GuideButtonWait wait;
+	SyntheticPad pad(wait);
+
+	Waiter waiter;
+	waiter.Start(wait, pad);
+	Sleep(20);
+
+	// game calling XInputGetState reports state itself
+	wait.Update(true);
+	waiter.Join();
+	CHECK_EQ(ERROR_SUCCESS, waiter.result);
+	CHECK_EQ(0, pad.Polls());
+}
+
+TEST(WaiterUsesNoCpu)
+{
+	GuideButtonWait wait;
+	SyntheticPad pad(wait);
+
+	Waiter waiter;
+	waiter.Start(wait, pad);
+	Sleep(200);
+	CHECK(!waiter.done);
+	CHECK_EQ(0, pad.Polls());
+
+	wait.Cancel();
+	waiter.Join();
+	CHECK(waiter.cpu < 0.02);
+}
+
+TEST(ReleaseDoesNotWake)
+{
+	GuideButtonWait wait;
+	SyntheticPad pad(wait);
+
+	Waiter waiter;
+	waiter.Start(wait, pad);
+	pad.Press(false);
+	Sleep(50);
+	CHECK(!waiter.done);
+	CHECK(pad.Polls() >= 1);
+
+	pad.Press(true);
+	waiter.Join();
+	CHECK_EQ(ERROR_SUCCESS, waiter.result);
+}
+
+TEST(CancelWakesAllWaitersAndRearms)
+{
+	GuideButtonWait wait;
+	SyntheticPad pad(wait);
+
+	Waiter waiters[3];
+	for (int i = 0; i < 3; ++i) waiters[i].Start(wait, pad);
+	Sleep(20);
+
+	wait.Cancel();
+	for (int i = 0; i < 3; ++i)
+	{
+		waiters[i].Join();
+		CHECK_EQ(ERROR_CANCELLED, waiters[i].result);
+	}
+
+	// next wait blocks again
+	Waiter next;
+	next.Start(wait, pad);
+	Sleep(20);
+	CHECK(!next.done);
+	pad.Press(true);
+	next.Join();
+	CHECK_EQ(ERROR_SUCCESS, next.result);
+}
+
+TEST(OverlappedWaitCompletesOnPress)
+{
+	GuideButtonWait wait;
+	OVERLAPPED overlapped = {};
+	overlapped.hEvent = CreateEvent(NULL, TRUE, TRUE, NULL);
+
+	CHECK_EQ(ERROR_IO_PENDING, wait.WaitAsync(&overlapped));
+	CHECK(!HasOverlappedIoCompleted(&overlapped));
+	CHECK_EQ(WAIT_TIMEOUT, WaitForSingleObject(overlapped.hEvent, 10));
+
+	DWORD transferred = 1;
+	CHECK(!GetOverlappedResult(NULL, &overlapped, &transferred, FALSE));
+	CHECK_EQ(ERROR_IO_INCOMPLETE, GetLastError());
+
+	wait.Update(true);
+	CHECK(HasOverlappedIoCompleted(&overlapped));
+	CHECK_EQ(WAIT_OBJECT_0, WaitForSingleObject(overlapped.hEvent, 0));
+	CHECK(GetOverlappedResult(NULL, &overlapped, &transferred, TRUE));
+	CHECK_EQ(0, transferred);
+
+	CloseHandle(overlapped.hEvent);
+}
+
+TEST(OverlappedWaitWhilePressedCompletesAtOnce)
+{
+	GuideButtonWait wait;
+	wait.Update(true);
+
+	OVERLAPPED overlapped = {};
+	overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	CHECK_EQ(ERROR_SUCCESS, wait.WaitAsync(&overlapped));
+	CHECK(HasOverlappedIoCompleted(&overlapped));
+	CHECK(GetOverlappedResult(NULL, &overlapped, NULL, FALSE));
+	CloseHandle(overlapped.hEvent);
+}
+
+TEST(OverlappedWaitCanceled)
+{
+	GuideButtonWait wait;
+	OVERLAPPED overlapped = {};
+	overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+	CHECK_EQ(ERROR_IO_PENDING, wait.WaitAsync(&overlapped));
+	wait.Cancel();
+
+	CHECK(HasOverlappedIoCompleted(&overlapped));
+	CHECK(!GetOverlappedResult(NULL, &overlapped, NULL, TRUE));
+	CHECK_EQ(ERROR_OPERATION_ABORTED, GetLastError());
+
+	// canceled wait is not completed again by later press
+	overlapped.Internal = 0x1234;
+	wait.Update(true);
+	CHECK_EQ(0x1234, overlapped.Internal);
+	CloseHandle(overlapped.hEvent);
+}
+
+TEST(OverlappedWaitsAreBounded)
+{
+	GuideButtonWait wait;
+	OVERLAPPED overlapped[GUIDEWAIT_MAX_PENDING + 1] = {};
+
+	for (int i = 0; i < GUIDEWAIT_MAX_PENDING; ++i)
+		CHECK_EQ(ERROR_IO_PENDING, wait.WaitAsync(&overlapped[i]));
+	CHECK_EQ(ERROR_BUSY, wait.WaitAsync(&overlapped[GUIDEWAIT_MAX_PENDING]));
+	CHECK_EQ(ERROR_BAD_ARGUMENTS, wait.WaitAsync(NULL));
+
+	wait.Update(true);
+	for (int i = 0; i < GUIDEWAIT_MAX_PENDING; ++i)
+		CHECK_EQ(0, overlapped[i].Internal);
+}
+
+TEST_MAIN()
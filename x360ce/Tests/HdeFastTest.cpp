@@ -0,0 +1,183 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Fast prologue decoder of MinHook hde_fast.cpp against full HDE.
+// Every instruction the fast path takes has to come out exactly as HDE decodes it.
+
+#include <windows.h>
+#include <stdlib.h>
+
+#include "hde_fast.h"
+#include "Test.h"
+
+using namespace MinHook;
+
+namespace
+{
+	inline unsigned int HdeDisasm(const void* code, hde_t* hs)
+	{
+#if defined _M_X64
+		return hde64_disasm(code, hs);
+#else
+		return hde32_disasm(code, hs);
+#endif
+	}
+
+	// Same length and every field, fast path must not leave stale or extra bits
+	bool SameAsHde(const uint8_t* code, size_t size)
+	{
+		hde_t fast;
+		hde_t full;
+		unsigned int fastLen = hde_disasm(code, &fast);
+		unsigned int fullLen = HdeDisasm(code, &full);
+		if (fastLen == fullLen && memcmp(&fast, &full, sizeof(hde_t)) == 0)
+		{
+			return true;
+		}
+
+		fprintf(stderr, "decoders differ (%u != %u) for", fastLen, fullLen);
+		for (size_t i = 0; i < size; ++i)
+		{
+			fprintf(stderr, " %02X", code[i]);
+		}
+		fprintf(stderr, "\n");
+		return false;
+	}
+
+	// Opcodes fast path decodes itself, from its class table
+	const uint8_t FastOpcodes[] =
+	{
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x08, 0x0B, 0x0C, 0x0D, 0x10, 0x13, 0x18, 0x1B, 0x20, 0x23,
+		0x25, 0x28, 0x29, 0x2B, 0x2D, 0x30, 0x31, 0x33, 0x38, 0x39, 0x3B, 0x3C, 0x3D, 0x50, 0x53, 0x55,
+		0x57, 0x58, 0x5B, 0x5D, 0x5F, 0x68, 0x69, 0x6A, 0x6B, 0x70, 0x74, 0x75, 0x7F, 0x80, 0x81, 0x83,
+		0x84, 0x85, 0x87, 0x88, 0x89, 0x8A, 0x8B, 0x8D, 0x90, 0x97, 0xA8, 0xA9, 0xB0, 0xB7, 0xB8, 0xBF,
+		0xC3, 0xC6, 0xC7, 0xCC, 0xE8, 0xE9, 0xEB, 0xFF
+	};
+
+	// Random instruction start, mostly fast path opcodes with or without REX, rest fully random
+	void Generate(uint8_t* code, size_t size)
+	{
+		for (size_t i = 0; i < size; ++i)
+		{
+			code[i] = static_cast<uint8_t>(rand());
+		}
+
+		size_t i = 0;
+		switch (rand() % 4)
+		{
+		case 0:
+			return;
+		case 1:
+			code[i++] = static_cast<uint8_t>(0x40 | (rand() & 0xF));
+			break;
+		}
+		code[i] = FastOpcodes[rand() % sizeof(FastOpcodes)];
+
+		// ModR/M forms that need SIB or disp32 are the error prone ones
+		if (rand() % 2)
+		{
+			static const uint8_t forms[] = { 0x04, 0x05, 0x44, 0x84, 0x0C, 0x15, 0x24, 0x25 };
+			code[i + 1] = static_cast<uint8_t>((forms[rand() % sizeof(forms)] & 0xC7) | (code[i + 1] & 0x38));
+		}
+	}
+}
+
+TEST(CommonPrologues)
+{
+	struct Case
+	{
+		uint8_t code[16];
+		unsigned int len;
+	};
+
+	static const Case cases[] =
+	{
+		{ { 0x55 }, 1 },										// push rbp
+		{ { 0x48, 0x89, 0xE5 }, 3 },							// mov rbp, rsp
+		{ { 0x48, 0x83, 0xEC, 0x28 }, 4 },						// sub rsp, 28h
+		{ { 0x48, 0x81, 0xEC, 0x00, 0x01, 0x00, 0x00 }, 7 },	// sub rsp, 100h
+		{ { 0x48, 0x89, 0x5C, 0x24, 0x08 }, 5 },				// mov [rsp+8], rbx
+		{ { 0x48, 0x8D, 0x05, 0x10, 0x00, 0x00, 0x00 }, 7 },	// lea rax, [rip+10h]
+		{ { 0x8B, 0x05, 0x10, 0x00, 0x00, 0x00 }, 6 },			// mov eax, [rip+10h]
+		{ { 0x48, 0xB8, 1, 2, 3, 4, 5, 6, 7, 8 }, 10 },			// mov rax, imm64
+		{ { 0xB8, 0x2A, 0x00, 0x00, 0x00 }, 5 },				// mov eax, 42
+		{ { 0xE8, 0x00, 0x00, 0x00, 0x00 }, 5 },				// call rel32
+		{ { 0xE9, 0x00, 0x00, 0x00, 0x00 }, 5 },				// jmp rel32
+		{ { 0xEB, 0xFE }, 2 },									// jmp short
+		{ { 0x74, 0x02 }, 2 },									// je short
+		{ { 0xFF, 0x25, 0x00, 0x00, 0x00, 0x00 }, 6 },			// jmp [rip]
+		{ { 0xC7, 0x44, 0x24, 0x08, 1, 0, 0, 0 }, 8 },			// mov dword [rsp+8], 1
+		{ { 0xC3 }, 1 },										// ret
+		{ { 0x0F, 0x1F, 0x44, 0x00, 0x00 }, 5 },				// nop dword [rax+rax], left to HDE
+	};
+
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+	{
+		hde_t hs;
+		CHECK_EQ(cases[i].len, hde_disasm(cases[i].code, &hs));
+		CHECK(SameAsHde(cases[i].code, cases[i].len));
+	}
+}
+
+TEST(FuzzMatchesHde)
+{
+	srand(39);
+
+	int mismatches = 0;
+	for (int i = 0; i < 1000000 && mismatches < 10; ++i)
+	{
+		uint8_t code[32];
+		Generate(code, sizeof(code));
+		if (!SameAsHde(code, 16))
+		{
+			++mismatches;
+		}
+	}
+	CHECK_EQ(0, mismatches);
+}
+
+TEST(EveryOpcodeWithEveryModRM)
+{
+	int mismatches = 0;
+	for (int rex = 0; rex < 2; ++rex)
+	{
+		for (int opcode = 0; opcode < 256; ++opcode)
+		{
+			for (int modrm = 0; modrm < 256; ++modrm)
+			{
+				uint8_t code[32];
+				memset(code, 0x11, sizeof(code));
+
+				size_t i = 0;
+				if (rex) code[i++] = 0x48;
+				code[i++] = static_cast<uint8_t>(opcode);
+				code[i++] = static_cast<uint8_t>(modrm);
+				code[i] = 0x24;		// SIB with no base register quirks
+				if (!SameAsHde(code, 16) && ++mismatches >= 10)
+				{
+					CHECK_EQ(0, mismatches);
+					return;
+				}
+			}
+		}
+	}
+	CHECK_EQ(0, mismatches);
+}
+
+TEST_MAIN()
@@ -0,0 +1,291 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Slot allocator of MinHook buffer.cpp on mmap pages: slot reuse, region lifetime,
+// write access of pending slots and placement near hook target.
+
+#include <windows.h>
+#include <stdlib.h>
+
+#include "buffer.h"
+#include "MinHookPosix.h"
+#include "Test.h"
+
+using namespace MinHook;
+
+namespace
+{
+	// Page source that can be told to fail, counts blocks through base provider
+	class FaultyPages : public PosixPageProvider
+	{
+	public:
+		FaultyPages()
+			:failAllocate(false)
+			, failProtect(false)
+		{
+		}
+
+		void* Allocate(void* pAddress, size_t size, DWORD protect)
+		{
+			return failAllocate ? NULL : PosixPageProvider::Allocate(pAddress, size, protect);
+		}
+
+		bool Protect(void* pAddress, size_t size, DWORD protect, DWORD* pOldProtect)
+		{
+			return failProtect ? false : PosixPageProvider::Protect(pAddress, size, protect, pOldProtect);
+		}
+
+		bool failAllocate;
+		bool failProtect;
+	};
+
+	// Fresh allocator state and page source for every test
+	struct BufferScope
+	{
+		BufferScope()
+		{
+			SetPageProvider(&pages);
+			InitializeBuffer();
+		}
+
+		~BufferScope()
+		{
+			UninitializeBuffer();
+			SetPageProvider(NULL);
+		}
+
+		DWORD Protection(void* p)
+		{
+			DWORD protect = 0;
+			pages.Query(p, &protect);
+			return protect;
+		}
+
+		FaultyPages pages;
+	};
+
+	uintptr_t Distance(const void* a, const void* b)
+	{
+		intptr_t d = reinterpret_cast<intptr_t>(a) - reinterpret_cast<intptr_t>(b);
+		return static_cast<uintptr_t>(d < 0 ? -d : d);
+	}
+
+	int NearTarget()
+	{
+		return rand();
+	}
+}
+
+TEST(CodeSlotIsWritableUntilCommit)
+{
+	BufferScope scope;
+
+	uint8_t* p = static_cast<uint8_t*>(AllocateCodeBuffer(NULL, 16));
+	CHECK(p != NULL);
+	CHECK_EQ(PAGE_EXECUTE_READWRITE, scope.Protection(p));
+
+	// mov eax, 42; ret
+	static const uint8_t code[] = { 0xB8, 0x2A, 0x00, 0x00, 0x00, 0xC3 };
+	memcpy(p, code, sizeof(code));
+	CommitBuffer();
+
+	CHECK_EQ(PAGE_EXECUTE_READ, scope.Protection(p));
+	CHECK_EQ(42, reinterpret_cast<int(*)()>(p)());
+
+	FreeBuffer(p);
+}
+
+TEST(DataSlotIsReadOnlyAfterCommit)
+{
+	BufferScope scope;
+
+	void* p = AllocateDataBuffer(NULL, sizeof(uintptr_t));
+	CHECK(p != NULL);
+	CHECK_EQ(PAGE_READWRITE, scope.Protection(p));
+
+	CommitBuffer();
+	CHECK_EQ(PAGE_READONLY, scope.Protection(p));
+
+	FreeBuffer(p);
+}
+
+TEST(SlotsShareAlignedRegionPerProtection)
+{
+	BufferScope scope;
+
+	void* a = AllocateCodeBuffer(NULL, 64);
+	void* b = AllocateCodeBuffer(NULL, 1);
+	void* c = AllocateDataBuffer(NULL, 8);
+	CommitBuffer();
+
+	CHECK(a != b);
+	CHECK_EQ(0, reinterpret_cast<uintptr_t>(a) % 64);
+	CHECK_EQ(0, reinterpret_cast<uintptr_t>(b) % 64);
+	CHECK_EQ(reinterpret_cast<uintptr_t>(a) & ~0xFFFF, reinterpret_cast<uintptr_t>(b) & ~0xFFFF);
+	CHECK(reinterpret_cast<uintptr_t>(a) >> 16 != reinterpret_cast<uintptr_t>(c) >> 16);
+	CHECK_EQ(2, scope.pages.Allocated());
+
+	FreeBuffer(a);
+	FreeBuffer(b);
+	FreeBuffer(c);
+}
+
+TEST(FreedSlotIsReusedFirst)
+{
+	BufferScope scope;
+
+	void* a = AllocateCodeBuffer(NULL, 16);
+	void* b = AllocateCodeBuffer(NULL, 16);
+	CommitBuffer();
+
+	FreeBuffer(a);
+	void* c = AllocateCodeBuffer(NULL, 16);
+	CommitBuffer();
+	CHECK(c == a);
+	CHECK_EQ(1, scope.pages.Allocated());
+
+	FreeBuffer(b);
+	FreeBuffer(c);
+}
+
+TEST(LastFreedSlotReleasesRegion)
+{
+	BufferScope scope;
+
+	void* a = AllocateCodeBuffer(NULL, 16);
+	void* b = AllocateCodeBuffer(NULL, 16);
+	CommitBuffer();
+
+	FreeBuffer(a);
+	CHECK_EQ(1, scope.pages.Allocated());
+
+	DWORD protect;
+	FreeBuffer(b);
+	CHECK_EQ(0, scope.pages.Allocated());
+	CHECK(!scope.pages.Query(b, &protect));
+}
+
+TEST(RollbackReturnsOnlyPendingSlots)
+{
+	BufferScope scope;
+
+	void* kept = AllocateCodeBuffer(NULL, 16);
+	CommitBuffer();
+
+	void* a = AllocateCodeBuffer(NULL, 16);
+	void* b = AllocateDataBuffer(NULL, 16);
+	CHECK(a != NULL && b != NULL);
+	CHECK_EQ(2, scope.pages.Allocated());
+
+	RollbackBuffer();
+	CHECK_EQ(1, scope.pages.Allocated());
+	CHECK_EQ(PAGE_EXECUTE_READ, scope.Protection(kept));
+
+	// rolled back slot is handed out again
+	CHECK(AllocateCodeBuffer(NULL, 16) == a);
+	RollbackBuffer();
+
+	FreeBuffer(kept);
+	CHECK_EQ(0, scope.pages.Allocated());
+}
+
+TEST(FullRegionOpensAnother)
+{
+	BufferScope scope;
+
+	std::vector<void*> slots;
+	for (size_t i = 0; i < 0x10000 / 64 + 1; ++i)
+	{
+		slots.push_back(AllocateDataBuffer(NULL, 64));
+	}
+	CommitBuffer();
+
+	CHECK(slots.back() != NULL);
+	CHECK_EQ(2, scope.pages.Allocated());
+
+	std::sort(slots.begin(), slots.end());
+	CHECK(std::adjacent_find(slots.begin(), slots.end()) == slots.end());
+
+	for (size_t i = 0; i < slots.size(); ++i)
+	{
+		FreeBuffer(slots[i]);
+	}
+	CHECK_EQ(0, scope.pages.Allocated());
+}
+
+TEST(OversizedBufferIsRefused)
+{
+	BufferScope scope;
+
+	CHECK(AllocateCodeBuffer(NULL, 65) == NULL);
+	CHECK_EQ(0, scope.pages.Allocated());
+}
+
+TEST(CodeGoesNearOrigin)
+{
+	BufferScope scope;
+
+	// function of this binary and a stack address, far apart in a PIE process
+	void* text = reinterpret_cast<void*>(&NearTarget);
+	int local = 0;
+	void* stack = &local;
+
+	void* a = AllocateCodeBuffer(text, 16);
+	void* b = AllocateCodeBuffer(stack, 16);
+	CommitBuffer();
+
+	CHECK(a != NULL && b != NULL);
+#if defined _M_X64
+	CHECK(Distance(a, text) < 0x20000000);
+	CHECK(Distance(b, stack) < 0x20000000);
+	CHECK(Distance(text, stack) < 0x20000000 || reinterpret_cast<uintptr_t>(a) >> 16 != reinterpret_cast<uintptr_t>(b) >> 16);
+#endif
+
+	// next slot for the same origin comes from the same region
+	void* c = AllocateCodeBuffer(text, 16);
+	CommitBuffer();
+	CHECK_EQ(reinterpret_cast<uintptr_t>(a) >> 16, reinterpret_cast<uintptr_t>(c) >> 16);
+
+	FreeBuffer(a);
+	FreeBuffer(b);
+	FreeBuffer(c);
+}
+
+TEST(PageFailuresGiveNull)
+{
+	BufferScope scope;
+
+	scope.pages.failAllocate = true;
+	CHECK(AllocateCodeBuffer(NULL, 16) == NULL);
+	CHECK(AllocateCodeBuffer(reinterpret_cast<void*>(&NearTarget), 16) == NULL);
+	scope.pages.failAllocate = false;
+
+	// region taken for failed slot is given back at once
+	scope.pages.failProtect = true;
+	CHECK(AllocateCodeBuffer(NULL, 16) == NULL);
+	CHECK_EQ(0, scope.pages.Allocated());
+	scope.pages.failProtect = false;
+
+	void* p = AllocateCodeBuffer(NULL, 16);
+	CHECK(p != NULL);
+	CommitBuffer();
+	FreeBuffer(p);
+}
+
+TEST_MAIN()
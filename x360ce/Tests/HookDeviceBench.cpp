@@ -0,0 +1,84 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// DirectInput enumeration lookup with 100 hooked pads: product GUID index against linear scan.
+
+#include "Test.h"
+#include <windows.h>
+#include "HookDevice.h"
+
+static const DWORD DEVICES = 100;
+static const int ROUNDS = 20000;
+
+static GUID Product(DWORD pidvid)
+{
+	GUID guid = { pidvid, 0, 0, { 0, 0, 'P', 'I', 'D', 'V', 'I', 'D' } };
+	return guid;
+}
+
+static const iHookDevice* LinearFind(const GUID& productid, const std::vector<iHookDevice>& devices)
+{
+	for (auto device = devices.begin(); device != devices.end(); ++device)
+	{
+		if (device->GetHookState() && IsEqualGUID(device->GetProductGUID(), productid))
+			return &(*device);
+	}
+	return nullptr;
+}
+
+int main()
+{
+	std::vector<iHookDevice> devices;
+	for (DWORD i = 0; i < DEVICES; ++i)
+	{
+		GUID instance = Product(i);
+		devices.push_back(iHookDevice(i, Product(0x10000 + i * 0x101), instance));
+	}
+
+	iHookDeviceIndex index;
+	index.Build(devices, 0x028E045E);
+
+	// every enumeration reports each hooked pad and as many devices that are not hooked
+	std::vector<GUID> enumerated;
+	for (DWORD i = 0; i < DEVICES; ++i)
+	{
+		enumerated.push_back(Product(0x10000 + i * 0x101));
+		enumerated.push_back(Product(0x90000 + i));
+	}
+
+	size_t found = 0;
+	double start = TestSeconds();
+	for (int round = 0; round < ROUNDS; ++round)
+		for (size_t i = 0; i < enumerated.size(); ++i)
+			found += index.Find(enumerated[i], devices) != nullptr;
+	double indexed = (TestSeconds() - start) * 1e9 / (ROUNDS * enumerated.size());
+
+	size_t scanned = 0;
+	start = TestSeconds();
+	for (int round = 0; round < ROUNDS; ++round)
+		for (size_t i = 0; i < enumerated.size(); ++i)
+			scanned += LinearFind(enumerated[i], devices) != nullptr;
+	double linear = (TestSeconds() - start) * 1e9 / (ROUNDS * enumerated.size());
+
+	printf("%u devices, %u lookups per enumeration\n", DEVICES, (unsigned)enumerated.size());
+	printf("index        %7.1f ns/lookup, %u found\n", indexed, (unsigned)found);
+	printf("linear scan  %7.1f ns/lookup, %u found\n", linear, (unsigned)scanned);
+	return found == scanned ? 0 : 1;
+}
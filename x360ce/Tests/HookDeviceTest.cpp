@@ -0,0 +1,164 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Product GUID index used by DirectInput enumeration hooks.
+
+#include "Test.h"
+#include <windows.h>
+#include "HookDevice.h"
+
+static GUID Product(DWORD pidvid, BYTE tail = 0)
+{
+	GUID guid = { pidvid, 0, 0, { 0, 0, 'P', 'I', 'D', 'V', 'I', tail } };
+	return guid;
+}
+
+static GUID Instance(DWORD index)
+{
+	GUID guid = { index, 1, 2, { 3, 4, 5, 6, 7, 8, 9, 10 } };
+	return guid;
+}
+
+static const DWORD FAKE = 0x028E045E;
+
+TEST(FindsEveryDevice)
+{
+	std::vector<iHookDevice> devices;
+	for (DWORD i = 0; i < 100; ++i)
+		devices.push_back(iHookDevice(i, Product(0x10000 + i), Instance(i)));
+
+	iHookDeviceIndex index;
+	index.Build(devices, FAKE);
+
+	for (DWORD i = 0; i < 100; ++i)
+	{
+		const iHookDeviceIndex::Entry* entry = index.Find(Product(0x10000 + i), devices);
+		CHECK(entry != nullptr);
+		if (!entry) continue;
+		CHECK_EQ(i, devices[entry->position - 1].GetUserIndex());
+		CHECK_EQ(FAKE, entry->spoofid.Data1);
+		CHECK_EQ(0, memcmp(entry->spoofid.Data4, Product(0).Data4, 8));
+	}
+	CHECK(index.Find(Product(0x20000), devices) == nullptr);
+}
+
+TEST(EmptyIndexFindsNothing)
+{
+	std::vector<iHookDevice> devices;
+	devices.push_back(iHookDevice(0, Product(1), Instance(0)));
+
+	iHookDeviceIndex index;
+	CHECK(index.Empty());
+	CHECK(index.Find(Product(1), devices) == nullptr);
+
+	index.Build(devices, FAKE);
+	CHECK(!index.Empty());
+	index.Clear();
+	CHECK(index.Find(Product(1), devices) == nullptr);
+}
+
+TEST(FirstDeviceWithProductWins)
+{
+	std::vector<iHookDevice> devices;
+	devices.push_back(iHookDevice(0, Product(7), Instance(0)));
+	devices.push_back(iHookDevice(1, Product(7), Instance(1)));
+
+	iHookDeviceIndex index;
+	index.Build(devices, FAKE);
+
+	const iHookDeviceIndex::Entry* entry = index.Find(Product(7), devices);
+	CHECK(entry != nullptr);
+	if (entry) CHECK_EQ(0, devices[entry->position - 1].GetUserIndex());
+}
+
+TEST(UnhookedDeviceIsSkipped)
+{
+	// same product on two ports, first one not hooked: second is found like linear scan would
+	std::vector<iHookDevice> devices;
+	devices.push_back(iHookDevice(0, Product(7), Instance(0)));
+	devices.push_back(iHookDevice(1, Product(7), Instance(1)));
+	devices.push_back(iHookDevice(2, Product(8), Instance(2)));
+	devices[0].Disable();
+
+	iHookDeviceIndex index;
+	index.Build(devices, FAKE);
+
+	const iHookDeviceIndex::Entry* entry = index.Find(Product(7), devices);
+	CHECK(entry != nullptr);
+	if (entry) CHECK_EQ(1, devices[entry->position - 1].GetUserIndex());
+
+	// hook state is read on lookup, not at build
+	devices[1].Disable();
+	CHECK(index.Find(Product(7), devices) == nullptr);
+	devices[0].Enable();
+	entry = index.Find(Product(7), devices);
+	CHECK(entry != nullptr);
+	if (entry) CHECK_EQ(0, devices[entry->position - 1].GetUserIndex());
+}
+
+TEST(CollidingProductsKeepProbing)
+{
+	// GUIDs differing only in last byte, many land on neighbouring slots
+	std::vector<iHookDevice> devices;
+	for (BYTE i = 0; i < 64; ++i)
+		devices.push_back(iHookDevice(i, Product(5, i), Instance(i)));
+	for (BYTE i = 0; i < 64; i += 2)
+		devices[i].Disable();
+
+	iHookDeviceIndex index;
+	index.Build(devices, FAKE);
+
+	for (BYTE i = 0; i < 64; ++i)
+	{
+		const iHookDeviceIndex::Entry* entry = index.Find(Product(5, i), devices);
+		if (i & 1)
+		{
+			CHECK(entry != nullptr);
+			if (entry) CHECK_EQ(i, devices[entry->position - 1].GetUserIndex());
+		}
+		else CHECK(entry == nullptr);
+	}
+}
+
+TEST(GrowingDeviceListKeepsEntriesValid)
+{
+	// positions stay valid when vector reallocates, device added after build is not indexed until rebuild
+	std::vector<iHookDevice> devices;
+	devices.push_back(iHookDevice(0, Product(1), Instance(0)));
+	devices.shrink_to_fit();
+
+	iHookDeviceIndex index;
+	index.Build(devices, FAKE);
+
+	for (DWORD i = 1; i < 100; ++i)
+		devices.push_back(iHookDevice(i, Product(1 + i), Instance(i)));
+
+	const iHookDeviceIndex::Entry* entry = index.Find(Product(1), devices);
+	CHECK(entry != nullptr);
+	if (entry) CHECK_EQ(0, devices[entry->position - 1].GetUserIndex());
+	CHECK(index.Find(Product(50), devices) == nullptr);
+
+	index.Build(devices, FAKE);
+	entry = index.Find(Product(50), devices);
+	CHECK(entry != nullptr);
+	if (entry) CHECK_EQ(49, devices[entry->position - 1].GetUserIndex());
+}
+
+TEST_MAIN()
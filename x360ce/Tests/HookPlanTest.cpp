@@ -0,0 +1,177 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Hook plan of InputHook fed with module load stream like the one loader notification reports while game starts.
+
+#include "HookPlan.h"
+#include "Test.h"
+#include <windows.h>
+
+#include <wchar.h>
+
+enum
+{
+	CLASS_LL = 1 << 0,
+	CLASS_COM = 1 << 1,
+	CLASS_DI = 1 << 2,
+	CLASS_SA = 1 << 3,
+	CLASS_WT = 1 << 4,
+	CLASS_ALL = CLASS_LL | CLASS_COM | CLASS_DI | CLASS_SA | CLASS_WT
+};
+
+static void SetupPlan(iHookPlan& plan)
+{
+	CHECK(plan.Add(CLASS_LL, NULL));
+	CHECK(plan.Add(CLASS_COM, L"ole32.dll"));
+	CHECK(plan.Add(CLASS_DI, L"dinput8.dll"));
+	CHECK(plan.Add(CLASS_SA, L"setupapi.dll"));
+	CHECK(plan.Add(CLASS_WT, L"wintrust.dll"));
+}
+
+static bool NothingLoaded(const wchar_t*)
+{
+	return false;
+}
+
+static bool Ole32Loaded(const wchar_t* module)
+{
+	return wcscmp(module, L"ole32.dll") == 0;
+}
+
+// Feeds every module of stream, due[i] gets classes that became due by load i
+static void Feed(iHookPlan& plan, const wchar_t* const* stream, size_t count, uint32_t* due)
+{
+	for (size_t i = 0; i < count; ++i) due[i] = plan.OnModuleLoaded(stream[i]);
+}
+
+TEST(AlwaysPresentDueAtStart)
+{
+	iHookPlan plan;
+	SetupPlan(plan);
+
+	CHECK_EQ(CLASS_LL, plan.Start(CLASS_ALL, NothingLoaded));
+	CHECK_EQ(CLASS_COM | CLASS_DI | CLASS_SA | CLASS_WT, plan.GetPending());
+}
+
+TEST(LoadedModulesDueAtStart)
+{
+	iHookPlan plan;
+	SetupPlan(plan);
+
+	CHECK_EQ(CLASS_LL | CLASS_COM, plan.Start(CLASS_ALL, Ole32Loaded));
+	CHECK_EQ(CLASS_DI | CLASS_SA | CLASS_WT, plan.GetPending());
+	CHECK_EQ(0, plan.OnModuleLoaded(L"C:\\Windows\\System32\\ole32.dll"));
+}
+
+TEST(DisabledClassesIgnored)
+{
+	iHookPlan plan;
+	SetupPlan(plan);
+
+	CHECK_EQ(0, plan.Start(CLASS_DI, Ole32Loaded));
+	CHECK_EQ(CLASS_DI, plan.GetPending());
+	CHECK_EQ(0, plan.OnModuleLoaded(L"setupapi.dll"));
+	CHECK_EQ(CLASS_DI, plan.OnModuleLoaded(L"dinput8.dll"));
+	CHECK_EQ(0, plan.GetPending());
+}
+
+TEST(LoadStream)
+{
+	iHookPlan plan;
+	SetupPlan(plan);
+	plan.Start(CLASS_ALL, NothingLoaded);
+
+	static const wchar_t* const stream[] =
+	{
+		L"C:\\Windows\\SYSTEM32\\ntdll.dll",
+		L"C:\\Windows\\System32\\KERNEL32.DLL",
+		L"C:\\Windows\\System32\\USER32.dll",
+		L"C:\\Windows\\System32\\OLE32.DLL",
+		L"C:\\Windows\\System32\\combase.dll",
+		L"C:\\Windows\\System32\\ole32.dll",
+		L"DINPUT8",
+		L"C:/Games/Game/dinput8.dll",
+		L"C:\\Windows\\System32\\setupapi.dll.mui",
+		L"C:\\Windows\\System32\\SetupApi",
+		L"wintrust.dl",
+		L"",
+		L"C:\\Windows\\System32\\",
+		L"C:\\Windows\\System32\\WinTrust.Dll",
+		L"C:\\Windows\\System32\\wintrust.dll",
+	};
+	static const uint32_t expected[] =
+	{
+		0, 0, 0, CLASS_COM, 0, 0, CLASS_DI, 0, 0, CLASS_SA, 0, 0, 0, CLASS_WT, 0
+	};
+
+	uint32_t due[_countof(stream)];
+	Feed(plan, stream, _countof(stream), due);
+
+	for (size_t i = 0; i < _countof(stream); ++i) CHECK_EQ(expected[i], due[i]);
+	CHECK_EQ(0, plan.GetPending());
+}
+
+TEST(NullPathIgnored)
+{
+	iHookPlan plan;
+	SetupPlan(plan);
+	plan.Start(CLASS_ALL, NothingLoaded);
+
+	CHECK_EQ(0, plan.OnModuleLoaded(NULL));
+	CHECK_EQ(CLASS_COM | CLASS_DI | CLASS_SA | CLASS_WT, plan.GetPending());
+}
+
+// Timeout of hook thread cancels plan, modules loaded after it install nothing
+TEST(CancelStopsStream)
+{
+	iHookPlan plan;
+	SetupPlan(plan);
+	plan.Start(CLASS_ALL, NothingLoaded);
+
+	CHECK_EQ(CLASS_DI, plan.OnModuleLoaded(L"dinput8.dll"));
+	plan.Cancel();
+	CHECK_EQ(0, plan.GetPending());
+	CHECK_EQ(0, plan.OnModuleLoaded(L"ole32.dll"));
+	CHECK_EQ(0, plan.OnModuleLoaded(L"setupapi.dll"));
+}
+
+// Second Start plans again from scratch
+TEST(Restart)
+{
+	iHookPlan plan;
+	SetupPlan(plan);
+	plan.Start(CLASS_ALL, NothingLoaded);
+	plan.OnModuleLoaded(L"ole32.dll");
+
+	CHECK_EQ(CLASS_LL, plan.Start(CLASS_LL | CLASS_COM, NothingLoaded));
+	CHECK_EQ(CLASS_COM, plan.GetPending());
+	CHECK_EQ(CLASS_COM, plan.OnModuleLoaded(L"ole32"));
+}
+
+TEST(TableFull)
+{
+	iHookPlan plan;
+	for (uint32_t i = 0; i < HOOKPLAN_MAX_CLASSES; ++i) CHECK(plan.Add(1u << i, L"x.dll"));
+	CHECK(!plan.Add(1u << HOOKPLAN_MAX_CLASSES, L"y.dll"));
+
+	CHECK_EQ(0, plan.Start(0xFFFFFFFF, NothingLoaded));
+	CHECK_EQ((1u << HOOKPLAN_MAX_CLASSES) - 1, plan.OnModuleLoaded(L"X.DLL"));
+}
+
+TEST_MAIN()
@@ -0,0 +1,114 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Hook registry of MinHook hook.cpp at growing hook counts: target lookup (FindHook) for hits and misses,
+// and remove (RemoveHookEntry backward shift and slot release). Lookups go through MH_QueueEnableHook,
+// which does nothing but take the lock, find entry and set a flag. Half of hooks are removed per round,
+// so their regions stay mapped and no page is released.
+// Linear scan of target list is printed for reference.
+
+#include <windows.h>
+#include <algorithm>
+#include <vector>
+
+#include <MinHook.h>
+#include "MinHookPosix.h"
+#include "SyntheticCode.h"
+#include "Test.h"
+
+static const int COUNTS[] = { 16, 256, 4096 };
+static const int LOOKUPS = 2000000;
+static const int REMOVES = 50000;
+
+static int Detour()
+{
+	return -1;
+}
+
+static int Run(int count)
+{
+	SyntheticCode code(count * 16 + 0x1000);
+	std::vector<void*> targets;
+	for (int i = 0; i < count; ++i)
+	{
+		targets.push_back(code.EmitReturn(i));
+	}
+	if (!code.Seal()) return 1;
+
+	MinHook::PosixPageProvider pages;
+	MinHook::SetPageProvider(&pages);
+	if (MH_Initialize() != MH_OK) return 1;
+
+	int failures = 0;
+	void* original;
+	for (int i = 0; i < count; ++i)
+		failures += MH_CreateHook(targets[i], reinterpret_cast<void*>(&Detour), &original) != MH_OK;
+
+	// visit targets in scattered order, not the order they were created in
+	std::vector<void*> order(targets);
+	for (size_t i = order.size(); i > 1; --i)
+		std::swap(order[i - 1], order[(i * 7919) % i]);
+
+	double start = TestSeconds();
+	for (int i = 0; i < LOOKUPS; ++i)
+		failures += MH_QueueEnableHook(order[i % count]) != MH_OK;
+	double hit = (TestSeconds() - start) * 1e9 / LOOKUPS;
+
+	// middle of hooked function is executable but not a hook target
+	start = TestSeconds();
+	for (int i = 0; i < LOOKUPS; ++i)
+		failures += MH_QueueEnableHook(static_cast<uint8_t*>(order[i % count]) + 1) != MH_ERROR_NOT_CREATED;
+	double miss = (TestSeconds() - start) * 1e9 / LOOKUPS;
+
+	double removing = 0;
+	int removed = 0;
+	while (removed < REMOVES)
+	{
+		start = TestSeconds();
+		for (int i = 0; i < count; i += 2)
+			failures += MH_RemoveHook(order[i]) != MH_OK;
+		removing += TestSeconds() - start;
+		removed += (count + 1) / 2;
+
+		for (int i = 0; i < count; i += 2)
+			failures += MH_CreateHook(order[i], reinterpret_cast<void*>(&Detour), &original) != MH_OK;
+	}
+	double remove = removing * 1e9 / removed;
+
+	size_t found = 0;
+	start = TestSeconds();
+	for (int i = 0; i < LOOKUPS; ++i)
+		found += std::find(targets.begin(), targets.end(), order[i % count]) != targets.end();
+	double linear = (TestSeconds() - start) * 1e9 / LOOKUPS;
+
+	MH_Uninitialize();
+	MinHook::SetPageProvider(NULL);
+
+	printf("%5d hooks  lookup hit %6.1f ns  miss %6.1f ns  remove %6.1f ns  linear scan %7.1f ns\n",
+		count, hit, miss, remove, linear);
+	return failures + (found != static_cast<size_t>(LOOKUPS));
+}
+
+int main()
+{
+	int failures = 0;
+	for (size_t i = 0; i < sizeof(COUNTS) / sizeof(COUNTS[0]); ++i)
+		failures += Run(COUNTS[i]);
+	return failures ? 1 : 0;
+}
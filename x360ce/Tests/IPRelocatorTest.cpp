@@ -0,0 +1,168 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Instruction pointer relocation of frozen threads, MinHook iprelocate.h,
+// against the linear search it replaced.
+
+#include <windows.h>
+#include <stdlib.h>
+
+#include "iprelocate.h"
+#include "Test.h"
+
+using MinHook::IPRelocator;
+
+namespace
+{
+	// Old ScopedThreadExclusive::Freeze lookup, first matching pair wins
+	bool LinearRelocate(const std::vector<uintptr_t>& oldIPs, const std::vector<uintptr_t>& newIPs, uintptr_t& ip)
+	{
+		for (size_t i = 0; i < oldIPs.size() && i < newIPs.size(); ++i)
+		{
+			if (oldIPs[i] == ip)
+			{
+				ip = newIPs[i];
+				return true;
+			}
+		}
+		return false;
+	}
+
+	uintptr_t RandomIP()
+	{
+		return static_cast<uintptr_t>(0x140001000) + static_cast<uintptr_t>(rand() % 64);
+	}
+}
+
+TEST(EmptyRelocatesNothing)
+{
+	std::vector<uintptr_t> none;
+	IPRelocator relocator(none, none);
+	CHECK(relocator.empty());
+
+	uintptr_t ips[] = { 0, 1, 0x140001000, static_cast<uintptr_t>(-1) };
+	for (size_t i = 0; i < sizeof(ips) / sizeof(ips[0]); ++i)
+	{
+		uintptr_t ip = ips[i];
+		CHECK(!relocator.Relocate(ip));
+		CHECK(ip == ips[i]);
+	}
+}
+
+TEST(MatchingIPsMove)
+{
+	// target 0x1000, instructions at +0, +1, +4 copied to trampoline at 0x9000
+	std::vector<uintptr_t> oldIPs;
+	std::vector<uintptr_t> newIPs;
+	oldIPs.push_back(0x1004); newIPs.push_back(0x9008);
+	oldIPs.push_back(0x1000); newIPs.push_back(0x9000);
+	oldIPs.push_back(0x1001); newIPs.push_back(0x9001);
+
+	IPRelocator relocator(oldIPs, newIPs);
+	CHECK(!relocator.empty());
+
+	uintptr_t ip = 0x1000;
+	CHECK(relocator.Relocate(ip));
+	CHECK_EQ(0x9000, ip);
+
+	ip = 0x1004;
+	CHECK(relocator.Relocate(ip));
+	CHECK_EQ(0x9008, ip);
+
+	// inside patched range but in the middle of an instruction, and outside of it
+	uintptr_t others[] = { 0x1002, 0x1003, 0x0FFF, 0x1005, 0 };
+	for (size_t i = 0; i < sizeof(others) / sizeof(others[0]); ++i)
+	{
+		ip = others[i];
+		CHECK(!relocator.Relocate(ip));
+		CHECK(ip == others[i]);
+	}
+}
+
+TEST(FirstPairWinsForDuplicates)
+{
+	std::vector<uintptr_t> oldIPs;
+	std::vector<uintptr_t> newIPs;
+	oldIPs.push_back(0x2000); newIPs.push_back(0x3000);
+	oldIPs.push_back(0x1000); newIPs.push_back(0x4000);
+	oldIPs.push_back(0x2000); newIPs.push_back(0x5000);
+
+	IPRelocator relocator(oldIPs, newIPs);
+	uintptr_t ip = 0x2000;
+	CHECK(relocator.Relocate(ip));
+	CHECK_EQ(0x3000, ip);
+}
+
+TEST(ExtraIPsWithoutPairAreIgnored)
+{
+	std::vector<uintptr_t> oldIPs;
+	std::vector<uintptr_t> newIPs;
+	oldIPs.push_back(0x1000); newIPs.push_back(0x9000);
+	oldIPs.push_back(0x1005);
+
+	IPRelocator relocator(oldIPs, newIPs);
+	uintptr_t ip = 0x1005;
+	CHECK(!relocator.Relocate(ip));
+	CHECK_EQ(0x1005, ip);
+}
+
+TEST(HighestAddressIsRelocated)
+{
+	std::vector<uintptr_t> oldIPs(1, static_cast<uintptr_t>(-1));
+	std::vector<uintptr_t> newIPs(1, 0x9000);
+
+	IPRelocator relocator(oldIPs, newIPs);
+	uintptr_t ip = static_cast<uintptr_t>(-1);
+	CHECK(relocator.Relocate(ip));
+	CHECK_EQ(0x9000, ip);
+}
+
+TEST(FuzzMatchesLinearSearch)
+{
+	srand(42);
+
+	int mismatches = 0;
+	for (int round = 0; round < 20000; ++round)
+	{
+		// hooks batched by ApplyQueued give many pairs, duplicates happen when hooks share code
+		std::vector<uintptr_t> oldIPs;
+		std::vector<uintptr_t> newIPs;
+		int pairs = rand() % 40;
+		for (int i = 0; i < pairs; ++i)
+		{
+			oldIPs.push_back(RandomIP());
+			newIPs.push_back(0x7FF000000000ULL + rand());
+		}
+
+		IPRelocator relocator(oldIPs, newIPs);
+		for (int i = 0; i < 16; ++i)
+		{
+			uintptr_t ip = (rand() % 8) ? RandomIP() : static_cast<uintptr_t>(rand());
+			uintptr_t expected = ip;
+			bool moved = relocator.Relocate(ip);
+			if (moved != LinearRelocate(oldIPs, newIPs, expected) || ip != expected)
+			{
+				++mismatches;
+			}
+		}
+	}
+	CHECK_EQ(0, mismatches);
+}
+
+TEST_MAIN()
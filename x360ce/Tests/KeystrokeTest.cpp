@@ -0,0 +1,356 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Keystroke ordering and repeat timing, time is given by test so every case is deterministic.
+
+#include "Test.h"
+#include <windows.h>
+#include <xinput.h>
+#include "Keystroke.h"
+
+#include <algorithm>
+#include <vector>
+
+struct Key
+{
+	WORD vk;
+	WORD flags;
+};
+
+// Reads like XInputGetKeystroke at time of last update
+static std::vector<Key> Drain(KeystrokeGenerator& generator, DWORD user = 0)
+{
+	std::vector<Key> keys;
+	XINPUT_KEYSTROKE keystroke;
+	while (generator.Pop(keystroke, generator.GetLastUpdate()))
+	{
+		CHECK_EQ(user, keystroke.UserIndex);
+		Key key = { keystroke.VirtualKey, keystroke.Flags };
+		keys.push_back(key);
+	}
+	return keys;
+}
+
+// Game calls XInputGetKeystroke at now and finds queue empty
+static void Listen(KeystrokeGenerator& generator, DWORD now)
+{
+	XINPUT_KEYSTROKE keystroke;
+	CHECK(!generator.Pop(keystroke, now));
+}
+
+static const WORD DOWN = XINPUT_KEYSTROKE_KEYDOWN;
+static const WORD UP = XINPUT_KEYSTROKE_KEYUP;
+static const WORD REPEAT = XINPUT_KEYSTROKE_KEYDOWN | XINPUT_KEYSTROKE_REPEAT;
+
+// Every key goes DOWN, REPEAT..., UP, nothing before DOWN or after UP
+static bool Paired(const std::vector<Key>& keys, bool released)
+{
+	std::vector<WORD> down;
+	for (size_t i = 0; i < keys.size(); ++i)
+	{
+		std::vector<WORD>::iterator held = std::find(down.begin(), down.end(), keys[i].vk);
+		if (keys[i].flags == DOWN)
+		{
+			if (held != down.end()) return false;
+			down.push_back(keys[i].vk);
+		}
+		else if (held == down.end()) return false;
+		else if (keys[i].flags == UP) down.erase(held);
+	}
+	return !released || down.empty();
+}
+
+TEST(PressAndRelease)
+{
+	KeystrokeGenerator generator;
+	Listen(generator, 1000);
+	generator.Update(2, XINPUT_GAMEPAD_A, 1000);
+	generator.Update(2, 0, 1050);
+
+	std::vector<Key> keys = Drain(generator, 2);
+	CHECK_EQ(2, keys.size());
+	CHECK_EQ(VK_PAD_A, keys[0].vk);
+	CHECK_EQ(DOWN, keys[0].flags);
+	CHECK_EQ(VK_PAD_A, keys[1].vk);
+	CHECK_EQ(UP, keys[1].flags);
+	CHECK_EQ(1050, generator.GetLastUpdate());
+}
+
+TEST(NoChangeNoKeystroke)
+{
+	KeystrokeGenerator generator;
+	for (DWORD now = 0; now < 1000; now += 16)
+		generator.Update(0, 0, now);
+	CHECK_EQ(0, Drain(generator).size());
+}
+
+TEST(SimultaneousChangesInButtonOrder)
+{
+	KeystrokeGenerator generator;
+	Listen(generator, 0);
+	generator.Update(0, XINPUT_GAMEPAD_DPAD_UP | XINPUT_GAMEPAD_B | XINPUT_GAMEPAD_START, 0);
+	generator.Update(0, XINPUT_GAMEPAD_B, 10);
+
+	std::vector<Key> keys = Drain(generator);
+	CHECK_EQ(5, keys.size());
+	if (keys.size() != 5) return;
+
+	CHECK_EQ(VK_PAD_B, keys[0].vk);
+	CHECK_EQ(VK_PAD_START, keys[1].vk);
+	CHECK_EQ(VK_PAD_DPAD_UP, keys[2].vk);
+	for (int i = 0; i < 3; ++i) CHECK_EQ(DOWN, keys[i].flags);
+
+	CHECK_EQ(VK_PAD_START, keys[3].vk);
+	CHECK_EQ(VK_PAD_DPAD_UP, keys[4].vk);
+	CHECK_EQ(UP, keys[3].flags);
+	CHECK_EQ(UP, keys[4].flags);
+}
+
+TEST(RepeatDelayAndRate)
+{
+	KeystrokeGenerator generator;
+	Listen(generator, 0);
+	generator.Update(0, XINPUT_GAMEPAD_X, 0);
+	CHECK_EQ(1, Drain(generator).size());
+
+	// nothing before delay, however often it is polled
+	for (DWORD now = 1; now < KEYSTROKE_REPEAT_DELAY; ++now)
+		generator.Update(0, XINPUT_GAMEPAD_X, now);
+	CHECK_EQ(0, Drain(generator).size());
+
+	generator.Update(0, XINPUT_GAMEPAD_X, KEYSTROKE_REPEAT_DELAY);
+	std::vector<Key> keys = Drain(generator);
+	CHECK_EQ(1, keys.size());
+	if (keys.size() == 1) CHECK_EQ(REPEAT, keys[0].flags);
+
+	// then one repeat per rate interval
+	DWORD start = KEYSTROKE_REPEAT_DELAY;
+	for (DWORD now = start + 1; now <= start + 10 * KEYSTROKE_REPEAT_RATE; ++now)
+		generator.Update(0, XINPUT_GAMEPAD_X, now);
+	CHECK_EQ(10, Drain(generator).size());
+}
+
+TEST(RepeatIsTimedNotCounted)
+{
+	// slow poller gets one repeat per poll once interval passed, not one per call
+	KeystrokeGenerator generator;
+	Listen(generator, 0);
+	generator.Update(0, XINPUT_GAMEPAD_Y, 0);
+	generator.Update(0, XINPUT_GAMEPAD_Y, 1000);
+	generator.Update(0, XINPUT_GAMEPAD_Y, 1050);
+	generator.Update(0, XINPUT_GAMEPAD_Y, 1100);
+
+	std::vector<Key> keys = Drain(generator);
+	CHECK_EQ(3, keys.size());
+	if (keys.size() == 3)
+	{
+		CHECK_EQ(DOWN, keys[0].flags);
+		CHECK_EQ(REPEAT, keys[1].flags);
+		CHECK_EQ(REPEAT, keys[2].flags);
+	}
+}
+
+TEST(RepeatRestartsOnNewPress)
+{
+	KeystrokeGenerator generator;
+	Listen(generator, 0);
+	generator.Update(0, XINPUT_GAMEPAD_A, 0);
+	generator.Update(0, 0, 300);
+	generator.Update(0, XINPUT_GAMEPAD_A, 350);
+	generator.Update(0, XINPUT_GAMEPAD_A, 500);
+	CHECK_EQ(3, Drain(generator).size());
+
+	generator.Update(0, XINPUT_GAMEPAD_A, 350 + KEYSTROKE_REPEAT_DELAY);
+	CHECK_EQ(1, Drain(generator).size());
+}
+
+TEST(ButtonsRepeatIndependently)
+{
+	KeystrokeGenerator generator;
+	Listen(generator, 0);
+	generator.Update(0, XINPUT_GAMEPAD_A, 0);
+	generator.Update(0, XINPUT_GAMEPAD_A | XINPUT_GAMEPAD_B, 200);
+	Drain(generator);
+
+	generator.Update(0, XINPUT_GAMEPAD_A | XINPUT_GAMEPAD_B, KEYSTROKE_REPEAT_DELAY);
+	std::vector<Key> keys = Drain(generator);
+	CHECK_EQ(1, keys.size());
+	if (keys.size() == 1) CHECK_EQ(VK_PAD_A, keys[0].vk);
+
+	generator.Update(0, XINPUT_GAMEPAD_A | XINPUT_GAMEPAD_B, 200 + KEYSTROKE_REPEAT_DELAY);
+	keys = Drain(generator);
+	CHECK_EQ(2, keys.size());
+	if (keys.size() == 2)
+	{
+		CHECK_EQ(VK_PAD_A, keys[0].vk);
+		CHECK_EQ(VK_PAD_B, keys[1].vk);
+	}
+}
+
+TEST(RepeatAcrossTickWraparound)
+{
+	KeystrokeGenerator generator;
+	DWORD start = 0xFFFFFF00;
+	Listen(generator, start);
+	generator.Update(0, XINPUT_GAMEPAD_BACK, start);
+	generator.Update(0, XINPUT_GAMEPAD_BACK, start + KEYSTROKE_REPEAT_DELAY - 1);
+	CHECK_EQ(1, Drain(generator).size());
+
+	generator.Update(0, XINPUT_GAMEPAD_BACK, start + KEYSTROKE_REPEAT_DELAY);
+	CHECK_EQ(1, Drain(generator).size());
+}
+
+TEST(NoReaderNoKeystrokes)
+{
+	// game that only calls XInputGetState
+	KeystrokeGenerator generator;
+	for (DWORD now = 0; now < 10000; now += 16)
+		generator.Update(0, (now / 500) & 1 ? XINPUT_GAMEPAD_A : 0, now);
+	CHECK_EQ(0, Drain(generator).size());
+}
+
+TEST(IdleReaderGetsReleaseOfQueuedPress)
+{
+	KeystrokeGenerator generator;
+	Listen(generator, 0);
+	generator.Update(0, XINPUT_GAMEPAD_A, 100);
+
+	// reader gone, A queued before is still released, B pressed since is not queued at all
+	DWORD idle = 100 + KEYSTROKE_IDLE_TIMEOUT;
+	generator.Update(0, XINPUT_GAMEPAD_B, idle);
+	generator.Update(0, XINPUT_GAMEPAD_B, idle + KEYSTROKE_REPEAT_DELAY);
+	generator.Update(0, 0, idle + KEYSTROKE_REPEAT_DELAY + 10);
+
+	std::vector<Key> keys = Drain(generator);
+	CHECK_EQ(2, keys.size());
+	if (keys.size() == 2)
+	{
+		CHECK_EQ(VK_PAD_A, keys[0].vk);
+		CHECK_EQ(DOWN, keys[0].flags);
+		CHECK_EQ(VK_PAD_A, keys[1].vk);
+		CHECK_EQ(UP, keys[1].flags);
+	}
+
+	// reader back, next press is queued
+	generator.Update(0, XINPUT_GAMEPAD_B, idle + 1000);
+	keys = Drain(generator);
+	CHECK_EQ(1, keys.size());
+}
+
+TEST(HeldButtonLeavesRoomForPresses)
+{
+	// reader that polled once and then stalls while A is held, repeats stop short of filling queue
+	KeystrokeGenerator generator;
+	Listen(generator, 0);
+	DWORD now = 0;
+	for (; now < KEYSTROKE_IDLE_TIMEOUT - 100; now += 10)
+		generator.Update(0, XINPUT_GAMEPAD_A, now);
+
+	generator.Update(0, XINPUT_GAMEPAD_A | XINPUT_GAMEPAD_B, now);
+	generator.Update(0, 0, now + 10);
+
+	std::vector<Key> keys = Drain(generator);
+	CHECK(keys.size() < KEYSTROKE_QUEUE_SIZE);
+	CHECK(Paired(keys, true));
+	CHECK(keys.size() >= 4);
+	if (keys.size() >= 4)
+	{
+		CHECK_EQ(VK_PAD_B, keys[keys.size() - 3].vk);
+		CHECK_EQ(DOWN, keys[keys.size() - 3].flags);
+		CHECK_EQ(UP, keys[keys.size() - 2].flags);
+		CHECK_EQ(UP, keys[keys.size() - 1].flags);
+	}
+}
+
+TEST(FullQueueNeverDropsKeyUp)
+{
+	// reader stalls while every button is mashed, each press that got queued is released
+	KeystrokeGenerator generator;
+	Listen(generator, 0);
+	unsigned int seed = 29;
+	DWORD now = 0;
+	for (int i = 0; i < 2000 && now < KEYSTROKE_IDLE_TIMEOUT; ++i, now += 2)
+		generator.Update(0, static_cast<WORD>(rand_r(&seed)) & 0xF3FF, now);
+	generator.Update(0, 0, now);
+
+	std::vector<Key> keys = Drain(generator);
+	CHECK(keys.size() <= KEYSTROKE_QUEUE_SIZE);
+	CHECK(Paired(keys, true));
+
+	// presses dropped on full queue do not leave state behind
+	generator.Update(0, XINPUT_GAMEPAD_A, now + 10);
+	generator.Update(0, 0, now + 20);
+	keys = Drain(generator);
+	CHECK_EQ(2, keys.size());
+	CHECK(Paired(keys, true));
+}
+
+struct PollThread
+{
+	KeystrokeGenerator* generator;
+	pthread_barrier_t* barrier;
+	DWORD ticks;
+
+	static void* Proc(void* param)
+	{
+		PollThread* thread = static_cast<PollThread*>(param);
+		for (DWORD now = 0; now <= thread->ticks; ++now)
+		{
+			pthread_barrier_wait(thread->barrier);
+			thread->generator->Update(0, XINPUT_GAMEPAD_A, now);
+		}
+		return NULL;
+	}
+};
+
+TEST(ConcurrentPollsRepeatOnce)
+{
+	// game threads polling one user on same tick, every keystroke is generated once
+	const int count = 4;
+	const DWORD repeats = 30;
+
+	KeystrokeGenerator generator;
+	pthread_barrier_t barrier;
+	pthread_barrier_init(&barrier, NULL, count);
+	Listen(generator, 0);
+
+	PollThread threads[count];
+	pthread_t handles[count];
+	for (int i = 0; i < count; ++i)
+	{
+		threads[i].generator = &generator;
+		threads[i].barrier = &barrier;
+		threads[i].ticks = KEYSTROKE_REPEAT_DELAY + repeats * KEYSTROKE_REPEAT_RATE - 1;
+		pthread_create(&handles[i], NULL, PollThread::Proc, &threads[i]);
+	}
+	for (int i = 0; i < count; ++i)
+		pthread_join(handles[i], NULL);
+	pthread_barrier_destroy(&barrier);
+
+	std::vector<Key> keys = Drain(generator);
+	CHECK_EQ(1 + repeats, keys.size());
+	if (keys.empty()) return;
+
+	CHECK_EQ(DOWN, keys[0].flags);
+	for (size_t i = 1; i < keys.size(); ++i)
+		CHECK_EQ(REPEAT, keys[i].flags);
+}
+
+TEST_MAIN()
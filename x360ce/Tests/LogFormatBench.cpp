@@ -0,0 +1,170 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Per call cost of PrintLog on calling thread, binary log against text log.
+// Both take time stamp, claim queue record and commit it; binary copies raw arguments of
+// registered format, text formats message with vsnprintf. Writer side is Front and Pop only.
+// Decoded binary message is checked against text one, so both paths produce same line.
+// %p is left out, it is printed the way of Windows CRT by decoder and of glibc by vsnprintf.
+
+#include <windows.h>
+#include <stdarg.h>
+
+#include "LogFormat.h"
+#include "LogQueue.h"
+#include "Test.h"
+
+static const int CALLS = 2000000;
+
+struct Site
+{
+	const char* name;
+	const char* format;
+	int count;
+	unsigned char types[LOGFORMAT_MAX_ARGS];
+};
+
+static Site SITES[] =
+{
+	{ "no arguments", "Hook timeout", 0, {} },
+	{ "int", "[PAD%d] Device Reacquired", 0, {} },
+	{ "string", "GUID change: %s", 0, {} },
+	{ "mixed", "%s: %ls -> 0x%08X (%u) %d", 0, {} },
+};
+
+static LogQueue queue;
+
+static inline LONGLONG Counter()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static void LogBinary(const Site& site, const char* format, ...)
+{
+	LogRecord* record = queue.Claim();
+	if (!record) return;
+
+	record->counter = Counter();
+	record->thread = 1;
+	record->site = 1;
+
+	va_list vaargs;
+	va_start(vaargs, format);
+	record->length = static_cast<WORD>(LogCaptureArgs(site.types, site.count,
+		reinterpret_cast<unsigned char*>(record->data), LOGGER_LINE_SIZE, vaargs));
+	va_end(vaargs);
+	queue.Commit(record);
+}
+
+static void LogText(const Site&, const char* format, ...)
+{
+	LogRecord* record = queue.Claim();
+	if (!record) return;
+
+	record->counter = Counter();
+	record->thread = 1;
+	record->site = LOGFILE_TEXT;
+
+	va_list vaargs;
+	va_start(vaargs, format);
+	vsnprintf(record->data, LOGGER_LINE_SIZE, format, vaargs);
+	va_end(vaargs);
+	record->length = static_cast<WORD>(strlen(record->data));
+	queue.Commit(record);
+}
+
+// Pops record and gives its text, binary one decoded like LogDecode does
+static void Take(const char* format, char* text, size_t size)
+{
+	LogRecord* record = queue.Front();
+	if (!record)
+	{
+		text[0] = '\0';
+		return;
+	}
+
+	if (record->site == LOGFILE_TEXT) snprintf(text, size, "%.*s", (int)record->length, record->data);
+	else LogFormatMessage(text, size, format, sizeof(void*), reinterpret_cast<const unsigned char*>(record->data), record->length);
+	queue.Pop(record);
+}
+
+typedef void(*LogFunc)(const Site& site, const char* format, ...);
+
+static inline void Call(LogFunc log, const Site& site, int i)
+{
+	switch (&site - SITES)
+	{
+	case 0:
+		log(site, site.format);
+		break;
+	case 1:
+		log(site, site.format, i & 3);
+		break;
+	case 2:
+		log(site, site.format, "{6F1D2B60-D5A0-11CF-BFC7-444553540000}");
+		break;
+	default:
+		log(site, site.format, "EnumDevices", L"Controller (XBOX 360 For Windows)", i, i * 3u, -i);
+		break;
+	}
+}
+
+static double Measure(LogFunc log, const Site& site)
+{
+	double start = TestSeconds();
+	for (int i = 0; i < CALLS; ++i)
+	{
+		Call(log, site, i);
+		LogRecord* record = queue.Front();
+		if (record) queue.Pop(record);
+	}
+	return (TestSeconds() - start) * 1e9 / CALLS;
+}
+
+int main()
+{
+	int failures = 0;
+	printf("arguments           binary ns/call   text ns/call\n");
+
+	for (size_t s = 0; s < _countof(SITES); ++s)
+	{
+		Site& site = SITES[s];
+		site.count = LogParseFormat(site.format, sizeof(void*), site.types);
+
+		char binary[LOGGER_LINE_SIZE + 1];
+		char text[LOGGER_LINE_SIZE + 1];
+		Call(LogBinary, site, 7);
+		Take(site.format, binary, sizeof(binary));
+		Call(LogText, site, 7);
+		Take(site.format, text, sizeof(text));
+		if (site.count < 0 || strcmp(binary, text) != 0)
+		{
+			printf("%s: \"%s\" != \"%s\"\n", site.name, binary, text);
+			++failures;
+		}
+
+		double b = Measure(LogBinary, site);
+		double t = Measure(LogText, site);
+		printf("%-16s %15.1f %14.1f\n", site.name, b, t);
+	}
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,187 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Log statements of LogLevel.h: disabled statement evaluates no argument and allocates nothing,
+// enabled one reaches PrintLogSite once with its own site. Allocations are counted by operator new.
+
+#include <windows.h>
+
+// category compiled out by project
+#define LOG_CATEGORIES (LOG_ALL & ~LOG_HOOKWT)
+#include "LogLevel.h"
+#include "Test.h"
+
+#include <new>
+#include <string>
+
+static long allocations = 0;
+
+void* operator new(size_t size)
+{
+	++allocations;
+	void* p = malloc(size ? size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) throw()
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) throw()
+{
+	free(p);
+}
+
+static int printed = 0;
+static LogSite* lastsite = NULL;
+static char lastline[256];
+
+void PrintLogSite(LogSite& site, const char* format, ...)
+{
+	va_list vaargs;
+	va_start(vaargs, format);
+	vsnprintf(lastline, sizeof(lastline), format, vaargs);
+	va_end(vaargs);
+
+	++printed;
+	lastsite = &site;
+}
+
+static int evaluated = 0;
+
+// Argument built the way GUIDtoStringA and ModuleFullPathA build theirs
+static std::string Expensive(int pad)
+{
+	++evaluated;
+	std::string text("{6F1D2B60-D5A0-11CF-BFC7-444553540000} of pad ");
+	text += static_cast<char>('0' + pad);
+	return text;
+}
+
+static void SetMasks(DWORD categories, int level)
+{
+	for (int i = LOGLEVEL_ERROR; i <= LOGLEVEL_TRACE; ++i)
+		LogMasks()[i] = i <= level ? categories : 0;
+}
+
+static void Reset()
+{
+	allocations = 0;
+	evaluated = 0;
+	printed = 0;
+	lastsite = NULL;
+	lastline[0] = '\0';
+}
+
+TEST(DisabledAtRunTime)
+{
+	SetMasks(0, 0);
+	Reset();
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		LogInfo(LOG_HOOKDI, "GUID change: %s", Expensive(i & 3).c_str());
+		PrintLog("[PAD%d] %s", i, Expensive(i & 3).c_str());
+	}
+
+	CHECK_EQ(0, allocations);
+	CHECK_EQ(0, evaluated);
+	CHECK_EQ(0, printed);
+}
+
+TEST(OtherCategoryOrLevelDisabled)
+{
+	SetMasks(LOG_CORE | LOG_HOOKDI, LOGLEVEL_INFO);
+	Reset();
+
+	LogInfo(LOG_HOOKSA, "%s", Expensive(0).c_str());
+	LogDebug(LOG_HOOKDI, "%s", Expensive(1).c_str());
+	LogDebug(LOG_CORE, "%s", Expensive(2).c_str());
+
+	CHECK_EQ(0, allocations);
+	CHECK_EQ(0, evaluated);
+	CHECK_EQ(0, printed);
+}
+
+TEST(CompiledOut)
+{
+	SetMasks(LOG_ALL, LOGLEVEL_TRACE);
+	Reset();
+
+	// LOG_HOOKWT is outside LOG_CATEGORIES, trace is above LOG_MAX_LEVEL of release build
+	LogError(LOG_HOOKWT, "%s", Expensive(0).c_str());
+#if LOG_MAX_LEVEL < LOGLEVEL_TRACE
+	LogTrace(LOG_CORE, "%s", Expensive(1).c_str());
+#endif
+
+	CHECK_EQ(0, allocations);
+	CHECK_EQ(0, evaluated);
+	CHECK_EQ(0, printed);
+	CHECK(!LogEnabled(LOG_HOOKWT, LOGLEVEL_ERROR));
+}
+
+TEST(EnabledEvaluatesOnce)
+{
+	SetMasks(LOG_HOOKDI, LOGLEVEL_INFO);
+	Reset();
+
+	LogInfo(LOG_HOOKDI, "GUID change: %s", Expensive(2).c_str());
+
+	CHECK_EQ(1, evaluated);
+	CHECK_EQ(1, printed);
+	CHECK(allocations > 0);
+	CHECK(strcmp(lastline, "GUID change: {6F1D2B60-D5A0-11CF-BFC7-444553540000} of pad 2") == 0);
+	CHECK(lastsite && lastsite->category == LOG_HOOKDI && lastsite->level == LOGLEVEL_INFO);
+}
+
+// Enabled statement with plain arguments allocates nothing either
+TEST(EnabledPlainArguments)
+{
+	SetMasks(LOG_CORE, LOGLEVEL_INFO);
+	Reset();
+
+	PrintLog("[PAD%d] Device Reacquired", 3);
+
+	CHECK_EQ(0, allocations);
+	CHECK_EQ(1, printed);
+	CHECK(strcmp(lastline, "[PAD3] Device Reacquired") == 0);
+}
+
+// Every statement has own static site, same statement always gives same one
+TEST(SitePerStatement)
+{
+	SetMasks(LOG_CORE, LOGLEVEL_INFO);
+
+	LogSite* sites[3];
+	for (int i = 0; i < 2; ++i)
+	{
+		PrintLog("first %d", i);
+		sites[i] = lastsite;
+	}
+	PrintLog("second %d", 0);
+	sites[2] = lastsite;
+
+	CHECK(sites[0] == sites[1]);
+	CHECK(sites[0] != sites[2]);
+	CHECK(strcmp(sites[0]->format, "first %d") == 0);
+}
+
+TEST_MAIN()
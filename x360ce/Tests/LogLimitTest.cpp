@@ -0,0 +1,170 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Log limiter of log writer: repeats of call site, their expiry and rate limit of categories.
+
+#include "LogLimit.h"
+#include "Test.h"
+
+static const int64_t SECOND = 1000;		// counter ticks per second
+
+static bool Check(LogLimiter& limiter, uint16_t site, int64_t counter, const char* text, uint32_t* repeated)
+{
+	return limiter.Check(site, 0, false, counter, text, strlen(text), repeated);
+}
+
+TEST(RepeatsCounted)
+{
+	LogLimiter* limiter = new LogLimiter;
+	uint32_t repeated;
+
+	CHECK(Check(*limiter, 1, 0, "pad 1", &repeated));
+	CHECK_EQ(0, repeated);
+	for (int i = 0; i < 5; ++i) CHECK(!Check(*limiter, 1, i, "pad 1", &repeated));
+
+	CHECK(Check(*limiter, 1, 6, "pad 2", &repeated));
+	CHECK_EQ(5, repeated);
+	CHECK(Check(*limiter, 1, 7, "pad 1", &repeated));
+	CHECK_EQ(0, repeated);
+	delete limiter;
+}
+
+// Messages told apart by bytes, not by hash of them
+TEST(SameLengthDifferentBytes)
+{
+	LogLimiter* limiter = new LogLimiter;
+	uint32_t repeated;
+
+	unsigned char a[LOGLIMIT_MAX_DATA];
+	unsigned char b[LOGLIMIT_MAX_DATA];
+	memset(a, 0x5A, sizeof(a));
+	memcpy(b, a, sizeof(b));
+	b[sizeof(b) - 1] ^= 1;
+
+	CHECK(limiter->Check(1, 0, false, 0, a, sizeof(a), &repeated));
+	CHECK(limiter->Check(1, 0, false, 1, b, sizeof(b), &repeated));
+	CHECK(!limiter->Check(1, 0, false, 2, b, sizeof(b), &repeated));
+	CHECK(limiter->Check(1, 0, false, 3, b, sizeof(b) - 1, &repeated));
+	CHECK_EQ(1, repeated);
+	delete limiter;
+}
+
+TEST(SitesAreSeparate)
+{
+	LogLimiter* limiter = new LogLimiter;
+	uint32_t repeated;
+
+	CHECK(Check(*limiter, 1, 0, "same", &repeated));
+	CHECK(Check(*limiter, 2, 0, "same", &repeated));
+	CHECK(!Check(*limiter, 1, 0, "same", &repeated));
+	CHECK(!Check(*limiter, 2, 0, "same", &repeated));
+
+	// no site and site out of range are never deduplicated
+	CHECK(Check(*limiter, 0, 0, "same", &repeated));
+	CHECK(Check(*limiter, 0, 0, "same", &repeated));
+	CHECK(Check(*limiter, LOGLIMIT_MAX_SITES, 0, "same", &repeated));
+	CHECK(Check(*limiter, LOGLIMIT_MAX_SITES, 0, "same", &repeated));
+	delete limiter;
+}
+
+TEST(LongMessageNotDeduplicated)
+{
+	LogLimiter* limiter = new LogLimiter;
+	uint32_t repeated;
+
+	unsigned char data[LOGLIMIT_MAX_DATA + 1] = {};
+	CHECK(limiter->Check(1, 0, false, 0, data, sizeof(data), &repeated));
+	CHECK(limiter->Check(1, 0, false, 0, data, sizeof(data), &repeated));
+	delete limiter;
+}
+
+// Repeat is written again once it has been held back for summary interval
+TEST(RepeatsExpire)
+{
+	LogLimiter* limiter = new LogLimiter;
+	limiter->SetExpiry(10 * SECOND);
+	uint32_t repeated;
+
+	CHECK(Check(*limiter, 1, 0, "device lost", &repeated));
+	CHECK(!Check(*limiter, 1, 5 * SECOND, "device lost", &repeated));
+	CHECK(!Check(*limiter, 1, 10 * SECOND - 1, "device lost", &repeated));
+	CHECK(Check(*limiter, 1, 10 * SECOND, "device lost", &repeated));
+	CHECK_EQ(2, repeated);
+
+	// expiry counts from message written last
+	CHECK(!Check(*limiter, 1, 19 * SECOND, "device lost", &repeated));
+	CHECK(Check(*limiter, 1, 20 * SECOND, "device lost", &repeated));
+	CHECK_EQ(1, repeated);
+	delete limiter;
+}
+
+TEST(FlushReportsRepeats)
+{
+	LogLimiter* limiter = new LogLimiter;
+	uint32_t repeated;
+
+	Check(*limiter, 3, 0, "x", &repeated);
+	Check(*limiter, 3, 0, "x", &repeated);
+	Check(*limiter, 3, 0, "x", &repeated);
+
+	int sites = 0;
+	uint32_t count = 0;
+	limiter->Flush([&](uint16_t site, uint32_t n) { ++sites; count = n; CHECK_EQ(3, site); },
+		[&](unsigned int, uint32_t) { CHECK(false); });
+	CHECK_EQ(1, sites);
+	CHECK_EQ(2, count);
+
+	// repeats after flush are still held back, next different message reports only them
+	CHECK(!Check(*limiter, 3, 1, "x", &repeated));
+	CHECK(Check(*limiter, 3, 2, "y", &repeated));
+	CHECK_EQ(1, repeated);
+	delete limiter;
+}
+
+TEST(RateLimit)
+{
+	LogLimiter* limiter = new LogLimiter;
+	limiter->SetRate(10, 5, SECOND);
+	uint32_t repeated;
+
+	int written = 0;
+	char text[16];
+	for (int i = 0; i < 100; ++i)
+	{
+		snprintf(text, sizeof(text), "%d", i);
+		if (limiter->Check(1, 4, true, 0, text, strlen(text), &repeated)) ++written;
+	}
+	CHECK_EQ(5, written);
+
+	// other category and messages not subject to limit pass
+	CHECK(limiter->Check(1, 5, true, 0, "a", 1, &repeated));
+	CHECK(limiter->Check(1, 4, false, 0, "b", 1, &repeated));
+
+	// one more after interval of one message
+	CHECK(limiter->Check(1, 4, true, SECOND / 10, "c", 1, &repeated));
+	CHECK(!limiter->Check(1, 4, true, SECOND / 10, "d", 1, &repeated));
+
+	uint32_t suppressed = 0;
+	limiter->Flush([&](uint16_t, uint32_t) {},
+		[&](unsigned int category, uint32_t n) { CHECK_EQ(4, category); suppressed = n; });
+	CHECK_EQ(96, suppressed);
+	delete limiter;
+}
+
+TEST_MAIN()
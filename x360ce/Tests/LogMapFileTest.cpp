@@ -0,0 +1,247 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Mapped log file: data and committed offset visible in file while it is open, size cut on close,
+// growth past first chunk and rotation of older files. Files are created in temporary directory.
+
+#include "LogMapFile.h"
+#include "Test.h"
+
+#include <stdlib.h>
+#include <string>
+#include <sys/stat.h>
+
+static std::string TempDir()
+{
+	char dir[] = "/tmp/LogMapFileTestXXXXXX";
+	return mkdtemp(dir) ? dir : "";
+}
+
+static std::string ReadFile(const std::string& path)
+{
+	std::string data;
+	FILE* file = fopen(path.c_str(), "rb");
+	if (!file) return data;
+
+	char buffer[65536];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) data.append(buffer, read);
+	fclose(file);
+	return data;
+}
+
+static bool Exists(const std::string& path)
+{
+	struct stat info;
+	return stat(path.c_str(), &info) == 0;
+}
+
+// Data after header up to committed offset, empty when header is not valid
+static std::string Committed(const std::string& file)
+{
+	if (file.size() < sizeof(LogMapHeader)) return "<short>";
+
+	LogMapHeader header;
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.magic, LOGMAP_MAGIC, sizeof(header.magic)) != 0 || header.version != LOGMAP_VERSION
+		|| header.size != sizeof(LogMapHeader) || header.size + header.committed > file.size()) return "<invalid>";
+
+	return file.substr(header.size, header.committed);
+}
+
+static void RemoveAll(const std::string& dir, const char* name, uint32_t count)
+{
+	std::string path = dir + "/" + name;
+	remove(path.c_str());
+	for (uint32_t i = 1; i <= count; ++i) remove((path + "." + std::to_string(i)).c_str());
+	rmdir(dir.c_str());
+}
+
+TEST(WritesVisibleWhileOpen)
+{
+	std::string dir = TempDir();
+	std::string path = dir + "/x360ce.log";
+
+	LogMapFile map;
+	CHECK(map.Open(path.c_str(), 0, 0));
+	CHECK(map.IsOpen());
+
+	std::string file = ReadFile(path);
+	CHECK_EQ(LOGMAP_CHUNK, file.size());
+	CHECK(Committed(file) == "");
+
+	CHECK(map.Write("first line\n", 11));
+	CHECK(map.Write("second line\n", 12));
+	CHECK(Committed(ReadFile(path)) == "first line\nsecond line\n");
+
+	map.Close();
+	CHECK(!map.IsOpen());
+	CHECK(!map.Write("x", 1));
+
+	file = ReadFile(path);
+	CHECK_EQ(sizeof(LogMapHeader) + 23, file.size());
+	CHECK(Committed(file) == "first line\nsecond line\n");
+
+	RemoveAll(dir, "x360ce.log", 0);
+}
+
+TEST(GrowsPastChunk)
+{
+	std::string dir = TempDir();
+	std::string path = dir + "/x360ce.log";
+
+	LogMapFile map;
+	CHECK(map.Open(path.c_str(), LOGMAP_MAX_LIMIT, 0));
+
+	std::string expected;
+	char line[1000];
+	for (int i = 0; i < 3000; ++i)
+	{
+		memset(line, 'a' + i % 26, sizeof(line));
+		CHECK(map.Write(line, sizeof(line)));
+		expected.append(line, sizeof(line));
+	}
+
+	std::string file = ReadFile(path);
+	CHECK_EQ(3 * LOGMAP_CHUNK, file.size());
+	CHECK(Committed(file) == expected);
+
+	map.Close();
+	CHECK(Committed(ReadFile(path)) == expected);
+	CHECK_EQ(0, map.TakeUntruncated());
+
+	RemoveAll(dir, "x360ce.log", 0);
+}
+
+TEST(WriteSpansChunks)
+{
+	std::string dir = TempDir();
+	std::string path = dir + "/x360ce.log";
+
+	LogMapFile map;
+	CHECK(map.Open(path.c_str(), LOGMAP_MAX_LIMIT, 0));
+
+	// one write bigger than mapped window, then one that ends exactly at chunk boundary
+	std::string expected(LOGMAP_CHUNK * 2 + 100, 'x');
+	for (size_t i = 0; i < expected.size(); ++i) expected[i] = static_cast<char>('a' + i % 26);
+	CHECK(map.Write(expected.data(), expected.size()));
+
+	std::string tail(3 * LOGMAP_CHUNK - sizeof(LogMapHeader) - expected.size(), 'z');
+	CHECK(map.Write(tail.data(), tail.size()));
+	expected += tail;
+
+	std::string file = ReadFile(path);
+	CHECK_EQ(3 * LOGMAP_CHUNK, file.size());
+	CHECK(Committed(file) == expected);
+
+	CHECK(map.Write("!", 1));
+	expected += "!";
+	CHECK_EQ(4 * LOGMAP_CHUNK, ReadFile(path).size());
+
+	map.Close();
+	CHECK(Committed(ReadFile(path)) == expected);
+
+	RemoveAll(dir, "x360ce.log", 0);
+}
+
+TEST(FullAtLimit)
+{
+	std::string dir = TempDir();
+	std::string path = dir + "/x360ce.log";
+
+	// limit below one chunk is raised to it
+	LogMapFile map;
+	CHECK(map.Open(path.c_str(), 1, 0));
+
+	static char data[LOGMAP_CHUNK];
+	size_t room = LOGMAP_CHUNK - sizeof(LogMapHeader);
+	CHECK(!map.Full(room + 1));
+	CHECK(map.Write(data, room / 2));
+	CHECK(!map.Full(room - room / 2));
+	CHECK(map.Full(room - room / 2 + 1));
+
+	RemoveAll(dir, "x360ce.log", 0);
+}
+
+TEST(RotateKeepsCount)
+{
+	std::string dir = TempDir();
+	std::string path = dir + "/x360ce.log";
+
+	LogMapFile map;
+	CHECK(map.Open(path.c_str(), 0, 3));
+
+	const char* texts[] = { "A", "B", "C", "D", "E" };
+	for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); ++i)
+	{
+		if (i) CHECK(map.Rotate());
+		CHECK(map.Write(texts[i], 1));
+	}
+	map.Close();
+
+	CHECK(Committed(ReadFile(path)) == "E");
+	CHECK(Committed(ReadFile(path + ".1")) == "D");
+	CHECK(Committed(ReadFile(path + ".2")) == "C");
+	CHECK(Committed(ReadFile(path + ".3")) == "B");
+	CHECK(!Exists(path + ".4"));
+
+	RemoveAll(dir, "x360ce.log", 3);
+}
+
+TEST(RotateWithoutOlderFiles)
+{
+	std::string dir = TempDir();
+	std::string path = dir + "/x360ce.log";
+
+	LogMapFile map;
+	CHECK(map.Open(path.c_str(), 0, 0));
+	CHECK(map.Write("old", 3));
+	CHECK(map.Rotate());
+	CHECK(map.Write("new", 3));
+	map.Close();
+
+	CHECK(Committed(ReadFile(path)) == "new");
+	CHECK(!Exists(path + ".1"));
+
+	// one older file
+	CHECK(map.Open(path.c_str(), 0, 1));
+	CHECK(map.Write("1", 1));
+	CHECK(map.Rotate());
+	CHECK(map.Write("2", 1));
+	CHECK(map.Rotate());
+	CHECK(map.Write("3", 1));
+	map.Close();
+
+	CHECK(Committed(ReadFile(path)) == "3");
+	CHECK(Committed(ReadFile(path + ".1")) == "2");
+	CHECK(!Exists(path + ".2"));
+
+	RemoveAll(dir, "x360ce.log", 1);
+}
+
+TEST(PathTooLong)
+{
+	std::string path(LOGMAP_MAX_PATH - 11, 'x');
+
+	LogMapFile map;
+	CHECK(!map.Open(path.c_str(), 0, 0));
+	CHECK(!map.IsOpen());
+}
+
+TEST_MAIN()
@@ -0,0 +1,145 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Log queue of Logger with many threads logging at once and writer draining it.
+// Producers retry while queue is full, so every message gets through and ns/message is cost of
+// claim and commit under contention. Messages of each producer have to come out in order.
+
+#include <windows.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "LogQueue.h"
+#include "Test.h"
+
+static const int PRODUCERS[] = { 1, 2, 4, 8 };
+static const int MESSAGES = 2000000;	// per run, split between producers
+static const int MAX_PRODUCERS = 8;
+
+struct Run
+{
+	LogQueue queue;
+	int producers;
+	int messages;		// per producer
+	volatile LONG full;	// claims that found queue full
+	volatile LONG started;
+};
+
+struct Producer
+{
+	Run* run;
+	DWORD thread;
+};
+
+static void* ProducerProc(void* param)
+{
+	Producer* producer = static_cast<Producer*>(param);
+	Run* run = producer->run;
+
+	InterlockedIncrement(&run->started);
+	while (run->started < run->producers + 1) sched_yield();
+
+	LONG full = 0;
+	for (int i = 0; i < run->messages; ++i)
+	{
+		LogRecord* record;
+		while ((record = run->queue.Claim()) == NULL)
+		{
+			++full;
+			sched_yield();
+		}
+
+		record->thread = producer->thread;
+		record->counter = i;
+		record->length = sizeof(int);
+		memcpy(record->data, &i, sizeof(int));
+		run->queue.Commit(record);
+	}
+
+	__sync_add_and_fetch(&run->full, full);
+	return NULL;
+}
+
+// Reads everything like log writer, returns number of messages out of order
+static int Consume(Run* run)
+{
+	LONGLONG next[MAX_PRODUCERS] = {};
+	int errors = 0;
+	int total = run->producers * run->messages;
+
+	InterlockedIncrement(&run->started);
+	for (int received = 0; received < total;)
+	{
+		LogRecord* record = run->queue.Front();
+		if (!record)
+		{
+			sched_yield();
+			continue;
+		}
+
+		int value;
+		memcpy(&value, record->data, sizeof(int));
+		if (record->thread >= (DWORD)run->producers || record->counter != next[record->thread] || value != record->counter) ++errors;
+		else ++next[record->thread];
+
+		run->queue.Pop(record);
+		++received;
+	}
+	return errors;
+}
+
+int main()
+{
+	int failures = 0;
+	printf("producers      ns/message   full claims\n");
+
+	for (size_t p = 0; p < _countof(PRODUCERS); ++p)
+	{
+		Run* run = new Run;
+		run->producers = PRODUCERS[p];
+		run->messages = MESSAGES / run->producers;
+		run->full = 0;
+		run->started = 0;
+
+		pthread_t threads[MAX_PRODUCERS];
+		Producer producers[MAX_PRODUCERS];
+		for (int i = 0; i < run->producers; ++i)
+		{
+			producers[i].run = run;
+			producers[i].thread = i;
+			pthread_create(&threads[i], NULL, ProducerProc, &producers[i]);
+		}
+
+		double start = TestSeconds();
+		int errors = Consume(run);
+		double seconds = TestSeconds() - start;
+		for (int i = 0; i < run->producers; ++i) pthread_join(threads[i], NULL);
+
+		if (errors || run->queue.Pending())
+		{
+			printf("%d messages out of order, %d left in queue\n", errors, (int)run->queue.Pending());
+			++failures;
+		}
+
+		printf("%9d %15.1f %13d\n", run->producers, seconds * 1e9 / (run->producers * run->messages), (int)run->full);
+		delete run;
+	}
+
+	return failures ? 1 : 0;
+}
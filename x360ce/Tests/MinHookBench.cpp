@@ -0,0 +1,105 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Hooks per second of MinHook on mmap pages, for create, enable one by one,
+// queued enable of all and remove. Targets are small functions in sealed pages.
+
+#include <windows.h>
+#include <vector>
+
+#include <MinHook.h>
+#include "MinHookPosix.h"
+#include "SyntheticCode.h"
+#include "Test.h"
+
+static const int TARGETS = 1024;
+static const int ROUNDS = 5;
+
+static int Detour()
+{
+	return -1;
+}
+
+static void Report(const char* name, double seconds, int hooks)
+{
+	printf("%-14s %9.0f hooks/s %8.2f us/hook\n", name, hooks / seconds, seconds * 1e6 / hooks);
+}
+
+int main()
+{
+	SyntheticCode code(TARGETS * 16 + 0x1000);
+	std::vector<void*> targets;
+	for (int i = 0; i < TARGETS; ++i)
+	{
+		targets.push_back(code.EmitReturn(i));
+	}
+	if (!code.Seal()) return 1;
+
+	MinHook::PosixPageProvider pages;
+	MinHook::SetPageProvider(&pages);
+	if (MH_Initialize() != MH_OK) return 1;
+
+	double create = 0, enable = 0, disable = 0, queued = 0, remove = 0;
+	int failures = 0;
+	for (int round = 0; round < ROUNDS; ++round)
+	{
+		double start = TestSeconds();
+		for (int i = 0; i < TARGETS; ++i)
+		{
+			void* original;
+			failures += MH_CreateHook(targets[i], reinterpret_cast<void*>(&Detour), &original) != MH_OK;
+		}
+		create += TestSeconds() - start;
+
+		start = TestSeconds();
+		for (int i = 0; i < TARGETS; ++i)
+			failures += MH_EnableHook(targets[i]) != MH_OK;
+		enable += TestSeconds() - start;
+
+		failures += reinterpret_cast<int(*)()>(targets[TARGETS - 1])() != -1;
+
+		start = TestSeconds();
+		for (int i = 0; i < TARGETS; ++i)
+			failures += MH_DisableHook(targets[i]) != MH_OK;
+		disable += TestSeconds() - start;
+
+		start = TestSeconds();
+		failures += MH_QueueEnableHook(MH_ALL_HOOKS) != MH_OK;
+		failures += MH_ApplyQueued() != MH_OK;
+		failures += MH_QueueDisableHook(MH_ALL_HOOKS) != MH_OK;
+		failures += MH_ApplyQueued() != MH_OK;
+		queued += (TestSeconds() - start) / 2;
+
+		start = TestSeconds();
+		for (int i = 0; i < TARGETS; ++i)
+			failures += MH_RemoveHook(targets[i]) != MH_OK;
+		remove += TestSeconds() - start;
+	}
+
+	MH_Uninitialize();
+	MinHook::SetPageProvider(NULL);
+
+	printf("%d targets, %d rounds, mmap page provider\n", TARGETS, ROUNDS);
+	Report("create", create, TARGETS * ROUNDS);
+	Report("enable", enable, TARGETS * ROUNDS);
+	Report("disable", disable, TARGETS * ROUNDS);
+	Report("queued enable", queued, TARGETS * ROUNDS);
+	Report("remove", remove, TARGETS * ROUNDS);
+	return failures ? 1 : 0;
+}
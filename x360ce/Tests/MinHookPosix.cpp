@@ -0,0 +1,86 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Linux replacements for page.cpp and thread.cpp of MinHook, linked into MinHook tests.
+
+#include "stdafx.h"
+
+#include "page.h"
+#include "thread.h"
+#include "MinHookPosix.h"
+
+namespace MinHook { namespace
+{
+	PosixPageProvider gPosixPageProvider;
+	PageProvider* gPageProvider = &gPosixPageProvider;
+}}
+
+namespace MinHook
+{
+	PageProvider& GetPageProvider()
+	{
+		return *gPageProvider;
+	}
+
+	void SetPageProvider(PageProvider* pProvider)
+	{
+		gPageProvider = (pProvider != NULL) ? pProvider : &gPosixPageProvider;
+	}
+
+	CriticalSection::CriticalSection()
+	{
+		InitializeCriticalSection(&cs_);
+	}
+
+	CriticalSection::~CriticalSection()
+	{
+		DeleteCriticalSection(&cs_);
+	}
+
+	void CriticalSection::enter()
+	{
+		EnterCriticalSection(&cs_);
+	}
+
+	void CriticalSection::leave()
+	{
+		LeaveCriticalSection(&cs_);
+	}
+
+	CriticalSection::ScopedLock::ScopedLock(CriticalSection& cs)
+		: cs_(cs)
+	{
+		cs_.enter();
+	}
+
+	CriticalSection::ScopedLock::~ScopedLock()
+	{
+		cs_.leave();
+	}
+
+	// Tests do not run hooked code on other threads while hooks are written, nothing to freeze
+	ScopedThreadExclusive::ScopedThreadExclusive(const std::vector<uintptr_t>& oldIPs, const std::vector<uintptr_t>& newIPs)
+	{
+		assert(("ScopedThreadExclusive::ctor", (oldIPs.size() == newIPs.size())));
+	}
+
+	ScopedThreadExclusive::~ScopedThreadExclusive()
+	{
+	}
+}
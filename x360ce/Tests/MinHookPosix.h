@@ -0,0 +1,327 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _MINHOOKPOSIX_H_
+#define _MINHOOKPOSIX_H_
+
+// MinHook page provider on top of mmap, so buffer allocator, trampoline builder and hook engine
+// run on Linux with real executable pages. Protection of a page is looked up in /proc/self/maps
+// the first time and then remembered along with own changes, so pages provider has seen
+// must not be remapped or protected behind its back.
+
+#include <windows.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "page.h"
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+namespace MinHook
+{
+	class PosixPageProvider : public PageProvider
+	{
+	public:
+		static const size_t Granularity = 0x10000;	// allocation granularity of Windows, buffer.cpp relies on it
+
+		PosixPageProvider()
+			:m_pageSize(static_cast<uintptr_t>(sysconf(_SC_PAGESIZE)))
+		{
+		}
+
+		void* Allocate(void* pAddress, size_t size, DWORD protect)
+		{
+			uintptr_t base;
+			if (pAddress != NULL)
+			{
+				void* p = mmap(pAddress, size, PosixProtect(protect), MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+				if (p == MAP_FAILED)
+				{
+					return NULL;
+				}
+
+				// kernels before 4.17 take the flag as a hint
+				if (p != pAddress)
+				{
+					munmap(p, size);
+					return NULL;
+				}
+				base = reinterpret_cast<uintptr_t>(p);
+			}
+			else
+			{
+				// mmap aligns to pages only, map one granule more and cut both ends
+				void* p = mmap(NULL, size + Granularity, PosixProtect(protect), MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+				if (p == MAP_FAILED)
+				{
+					return NULL;
+				}
+
+				uintptr_t start = reinterpret_cast<uintptr_t>(p);
+				base = (start + Granularity - 1) & ~(Granularity - 1);
+				if (base != start)
+				{
+					munmap(p, base - start);
+				}
+				munmap(reinterpret_cast<void*>(base + size), start + Granularity - base);
+			}
+
+			m_sizes[base] = size;
+			Remember(base, size, protect);
+			return reinterpret_cast<void*>(base);
+		}
+
+		void Release(void* pAddress)
+		{
+			std::map<uintptr_t, size_t>::iterator i = m_sizes.find(reinterpret_cast<uintptr_t>(pAddress));
+			if (i == m_sizes.end())
+			{
+				return;
+			}
+
+			munmap(pAddress, i->second);
+			m_protect.erase(m_protect.lower_bound(i->first), m_protect.lower_bound(i->first + i->second));
+			m_sizes.erase(i);
+		}
+
+		bool Protect(void* pAddress, size_t size, DWORD protect, DWORD* pOldProtect)
+		{
+			if (!Query(pAddress, pOldProtect))
+			{
+				return false;
+			}
+
+			uintptr_t begin = reinterpret_cast<uintptr_t>(pAddress) & ~(m_pageSize - 1);
+			uintptr_t end = (reinterpret_cast<uintptr_t>(pAddress) + size + m_pageSize - 1) & ~(m_pageSize - 1);
+			if (mprotect(reinterpret_cast<void*>(begin), end - begin, PosixProtect(protect)) != 0)
+			{
+				return false;
+			}
+
+			Remember(begin, end - begin, protect);
+			return true;
+		}
+
+		bool IsExecutable(void* pAddress)
+		{
+			static const DWORD PageExecuteMask
+				= (PAGE_EXECUTE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY);
+
+			DWORD protect;
+			return Query(pAddress, &protect) && (protect & PageExecuteMask) != 0;
+		}
+
+		void* FindPrevFree(void* pOrigin, void* pLimit, size_t granularity)
+		{
+			uintptr_t tryAddr = reinterpret_cast<uintptr_t>(pOrigin);
+			uintptr_t minAddr = reinterpret_cast<uintptr_t>(pLimit);
+
+			tryAddr -= tryAddr % granularity;
+			if (tryAddr < granularity)
+			{
+				return NULL;
+			}
+			tryAddr -= granularity;
+
+			std::vector<Range> ranges;
+			ReadRanges(ranges);
+
+			while (tryAddr >= minAddr)
+			{
+				const Range* pUsed = FindOverlap(ranges, tryAddr, granularity);
+				if (pUsed == NULL)
+				{
+					return reinterpret_cast<void*>(tryAddr);
+				}
+
+				uintptr_t base = pUsed->begin - pUsed->begin % granularity;
+				if (base < granularity)
+				{
+					break;
+				}
+				tryAddr = base - granularity;
+			}
+
+			return NULL;
+		}
+
+		void* FindNextFree(void* pOrigin, void* pLimit, size_t granularity)
+		{
+			uintptr_t tryAddr = reinterpret_cast<uintptr_t>(pOrigin);
+			uintptr_t maxAddr = reinterpret_cast<uintptr_t>(pLimit);
+
+			tryAddr -= tryAddr % granularity;
+			tryAddr += granularity;
+
+			std::vector<Range> ranges;
+			ReadRanges(ranges);
+
+			while (tryAddr <= maxAddr)
+			{
+				const Range* pUsed = FindOverlap(ranges, tryAddr, granularity);
+				if (pUsed == NULL)
+				{
+					return reinterpret_cast<void*>(tryAddr);
+				}
+
+				uintptr_t next = pUsed->end + granularity - 1;
+				next -= next % granularity;
+				if (next <= tryAddr)
+				{
+					break;
+				}
+				tryAddr = next;
+			}
+
+			return NULL;
+		}
+
+		void GetAddressRange(void** ppMin, void** ppMax)
+		{
+			// default vm.mmap_min_addr and top of user space less one granule, as on Windows
+			*ppMin = reinterpret_cast<void*>(Granularity);
+#if defined _M_X64
+			*ppMax = reinterpret_cast<void*>(0x7FFFFFFEFFFFULL);
+#else
+			*ppMax = reinterpret_cast<void*>(0x7FFEFFFFUL);
+#endif
+		}
+
+		// Protection of mapped page as PAGE_* value, false when address is not mapped
+		bool Query(void* pAddress, DWORD* pProtect)
+		{
+			std::map<uintptr_t, DWORD>::const_iterator i = m_protect.find(reinterpret_cast<uintptr_t>(pAddress) & ~(m_pageSize - 1));
+			if (i != m_protect.end())
+			{
+				*pProtect = i->second;
+				return true;
+			}
+
+			std::vector<Range> ranges;
+			ReadRanges(ranges);
+
+			const Range* pRange = FindOverlap(ranges, reinterpret_cast<uintptr_t>(pAddress), 1);
+			if (pRange == NULL)
+			{
+				return false;
+			}
+
+			Remember(reinterpret_cast<uintptr_t>(pAddress) & ~(m_pageSize - 1), 1, pRange->protect);
+			*pProtect = pRange->protect;
+			return true;
+		}
+
+		// Blocks allocated and not released yet
+		size_t Allocated() const
+		{
+			return m_sizes.size();
+		}
+
+	private:
+		struct Range
+		{
+			uintptr_t	begin;
+			uintptr_t	end;
+			DWORD		protect;
+		};
+
+		void Remember(uintptr_t address, size_t size, DWORD protect)
+		{
+			for (uintptr_t page = address; page < address + size; page += m_pageSize)
+			{
+				m_protect[page] = protect;
+			}
+		}
+
+		static int PosixProtect(DWORD protect)
+		{
+			switch (protect & 0xFF)
+			{
+			case PAGE_NOACCESS:			return PROT_NONE;
+			case PAGE_READONLY:			return PROT_READ;
+			case PAGE_READWRITE:
+			case PAGE_WRITECOPY:		return PROT_READ | PROT_WRITE;
+			case PAGE_EXECUTE:			return PROT_EXEC;
+			case PAGE_EXECUTE_READ:		return PROT_READ | PROT_EXEC;
+			default:					return PROT_READ | PROT_WRITE | PROT_EXEC;
+			}
+		}
+
+		static DWORD WindowsProtect(const char* perms)
+		{
+			bool r = perms[0] == 'r';
+			bool w = perms[1] == 'w';
+			bool x = perms[2] == 'x';
+
+			if (x) return w ? PAGE_EXECUTE_READWRITE : r ? PAGE_EXECUTE_READ : PAGE_EXECUTE;
+			return w ? PAGE_READWRITE : r ? PAGE_READONLY : PAGE_NOACCESS;
+		}
+
+		// Mappings of process, sorted by address as kernel lists them
+		static void ReadRanges(std::vector<Range>& ranges)
+		{
+			FILE* maps = fopen("/proc/self/maps", "r");
+			if (maps == NULL)
+			{
+				return;
+			}
+
+			char line[512];
+			while (fgets(line, sizeof(line), maps))
+			{
+				unsigned long begin, end;
+				char perms[5];
+				if (sscanf(line, "%lx-%lx %4s", &begin, &end, perms) != 3)
+				{
+					continue;
+				}
+
+				Range range = { begin, end, WindowsProtect(perms) };
+				ranges.push_back(range);
+			}
+
+			fclose(maps);
+		}
+
+		// First mapping that shares a byte with [address, address + size)
+		static const Range* FindOverlap(const std::vector<Range>& ranges, uintptr_t address, size_t size)
+		{
+			for (size_t i = 0, count = ranges.size(); i < count; ++i)
+			{
+				if (ranges[i].end > address)
+				{
+					return (ranges[i].begin < address + size) ? &ranges[i] : NULL;
+				}
+			}
+
+			return NULL;
+		}
+
+		uintptr_t m_pageSize;
+		std::map<uintptr_t, size_t> m_sizes;		// blocks by base address
+		std::map<uintptr_t, DWORD> m_protect;		// PAGE_* value of every page seen, by page address
+	};
+}
+
+#endif
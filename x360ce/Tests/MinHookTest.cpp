@@ -0,0 +1,257 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// MinHook engine on Linux: trampolines are built in mmap pages through PosixPageProvider,
+// compiled and hand written functions are hooked, then called through detour and trampoline.
+
+#include <windows.h>
+
+#include <MinHook.h>
+#include "MinHookPosix.h"
+#include "SyntheticCode.h"
+#include "Test.h"
+
+typedef int(*IntFunc)(int);
+
+namespace
+{
+	volatile int g_bias = 1;
+	IntFunc g_originalScale;
+	IntFunc g_originalClamp;
+	IntFunc g_originalSynthetic;
+
+	// Real targets, their prologues read globals through RIP and branch
+	__attribute__((noinline)) int Scale(int x)
+	{
+		return x * 3 + g_bias;
+	}
+
+	__attribute__((noinline)) int Clamp(int x)
+	{
+		if (x > 100 + g_bias) return 100;
+		return x - g_bias;
+	}
+
+	int DetourScale(int x)
+	{
+		return g_originalScale(x) + 1000;
+	}
+
+	int DetourClamp(int x)
+	{
+		return g_originalClamp(x) + 2000;
+	}
+
+	int DetourSynthetic(int x)
+	{
+		return g_originalSynthetic(x) + 3000;
+	}
+
+	// Calls through volatile pointers, so compiler neither inlines nor folds hooked calls
+	IntFunc volatile g_scale = Scale;
+	IntFunc volatile g_clamp = Clamp;
+
+	// Hook engine state and page source for one test
+	struct HookScope
+	{
+		HookScope()
+		{
+			MinHook::SetPageProvider(&pages);
+			initialized = MH_Initialize() == MH_OK;
+		}
+
+		~HookScope()
+		{
+			MH_Uninitialize();
+			MinHook::SetPageProvider(NULL);
+		}
+
+		DWORD Protection(void* p)
+		{
+			DWORD protect = 0;
+			pages.Query(p, &protect);
+			return protect;
+		}
+
+		MinHook::PosixPageProvider pages;
+		bool initialized;
+	};
+
+	uintptr_t Distance(const void* a, const void* b)
+	{
+		intptr_t d = reinterpret_cast<intptr_t>(a) - reinterpret_cast<intptr_t>(b);
+		return static_cast<uintptr_t>(d < 0 ? -d : d);
+	}
+}
+
+TEST(DetourAndTrampolineOfCompiledFunction)
+{
+	HookScope scope;
+	CHECK(scope.initialized);
+
+	uint8_t before[8];
+	memcpy(before, reinterpret_cast<void*>(&Scale), sizeof(before));
+
+	CHECK_EQ(MH_OK, MH_CreateHook(reinterpret_cast<void*>(&Scale), reinterpret_cast<void*>(&DetourScale), reinterpret_cast<void**>(&g_originalScale)));
+	CHECK_EQ(7, g_scale(2));
+	CHECK_EQ(7, g_originalScale(2));
+
+	CHECK_EQ(MH_OK, MH_EnableHook(reinterpret_cast<void*>(&Scale)));
+	CHECK_EQ(1007, g_scale(2));
+	CHECK_EQ(7, g_originalScale(2));
+	CHECK_EQ(0xE9, reinterpret_cast<uint8_t*>(&Scale)[0]);
+
+	// target page gets its protection back, trampoline is sealed and near target
+	CHECK_EQ(PAGE_EXECUTE_READ, scope.Protection(reinterpret_cast<void*>(&Scale)));
+	CHECK_EQ(PAGE_EXECUTE_READ, scope.Protection(reinterpret_cast<void*>(g_originalScale)));
+#if defined _M_X64
+	CHECK(Distance(reinterpret_cast<void*>(g_originalScale), reinterpret_cast<void*>(&Scale)) < 0x20000000);
+#endif
+
+	CHECK_EQ(MH_OK, MH_DisableHook(reinterpret_cast<void*>(&Scale)));
+	CHECK_EQ(7, g_scale(2));
+	CHECK(memcmp(before, reinterpret_cast<void*>(&Scale), sizeof(before)) == 0);
+
+	CHECK_EQ(MH_OK, MH_RemoveHook(reinterpret_cast<void*>(&Scale)));
+	CHECK_EQ(0, scope.pages.Allocated());
+}
+
+TEST(QueuedHooksApplyTogether)
+{
+	HookScope scope;
+
+	CHECK_EQ(MH_OK, MH_CreateHook(reinterpret_cast<void*>(&Scale), reinterpret_cast<void*>(&DetourScale), reinterpret_cast<void**>(&g_originalScale)));
+	CHECK_EQ(MH_OK, MH_CreateHook(reinterpret_cast<void*>(&Clamp), reinterpret_cast<void*>(&DetourClamp), reinterpret_cast<void**>(&g_originalClamp)));
+
+	CHECK_EQ(MH_OK, MH_QueueEnableHook(MH_ALL_HOOKS));
+	CHECK_EQ(7, g_scale(2));
+	CHECK_EQ(MH_OK, MH_ApplyQueued());
+	CHECK_EQ(1007, g_scale(2));
+	CHECK_EQ(2004, g_clamp(5));
+	CHECK_EQ(2100, g_clamp(500));
+	CHECK_EQ(100, g_originalClamp(500));
+
+	CHECK_EQ(MH_OK, MH_QueueDisableHook(reinterpret_cast<void*>(&Clamp)));
+	CHECK_EQ(MH_OK, MH_ApplyQueued());
+	CHECK_EQ(1007, g_scale(2));
+	CHECK_EQ(4, g_clamp(5));
+
+	// uninitialize unhooks whatever is still enabled
+	CHECK_EQ(MH_OK, MH_Uninitialize());
+	CHECK_EQ(7, g_scale(2));
+	CHECK_EQ(0, scope.pages.Allocated());
+}
+
+TEST(BranchInPrologueIsRelocated)
+{
+	HookScope scope;
+	SyntheticCode code(0x1000);
+
+	// test edi, edi; jle +4; lea eax, [rdi+rdi]; ret; xor eax, eax; ret
+	static const uint8_t twice[] = { 0x85, 0xFF, 0x7E, 0x04, 0x8D, 0x04, 0x3F, 0xC3, 0x31, 0xC0, 0xC3 };
+	void* target = code.Emit(twice, sizeof(twice));
+	CHECK(code.Seal());
+
+	CHECK_EQ(MH_OK, MH_CreateHook(target, reinterpret_cast<void*>(&DetourSynthetic), reinterpret_cast<void**>(&g_originalSynthetic)));
+	CHECK_EQ(MH_OK, MH_EnableHook(target));
+
+	IntFunc hooked = reinterpret_cast<IntFunc>(target);
+	CHECK_EQ(3010, hooked(5));
+	CHECK_EQ(3000, hooked(-5));
+	CHECK_EQ(10, g_originalSynthetic(5));
+	CHECK_EQ(0, g_originalSynthetic(-5));
+
+	CHECK_EQ(MH_OK, MH_RemoveHook(target));
+	CHECK_EQ(10, hooked(5));
+}
+
+TEST(RipRelativeOperandIsRelocated)
+{
+	HookScope scope;
+	SyntheticCode code(0x1000);
+
+	// mov eax, [rip+disp]; add eax, edi; ret, constant 40 at offset 0x100 of page
+	uint8_t add40[] = { 0x8B, 0x05, 0, 0, 0, 0, 0x01, 0xF8, 0xC3 };
+	int32_t disp = 0x100 - 6;
+	memcpy(add40 + 2, &disp, sizeof(disp));
+	void* target = code.Emit(add40, sizeof(add40));
+	CHECK(target == code.Base());
+	uint32_t constant = 40;
+	memcpy(code.Base() + 0x100, &constant, sizeof(constant));
+	CHECK(code.Seal());
+
+	CHECK_EQ(MH_OK, MH_CreateHook(target, reinterpret_cast<void*>(&DetourSynthetic), reinterpret_cast<void**>(&g_originalSynthetic)));
+	CHECK_EQ(MH_OK, MH_EnableHook(target));
+
+	CHECK_EQ(3042, reinterpret_cast<IntFunc>(target)(2));
+	CHECK_EQ(42, g_originalSynthetic(2));
+
+	CHECK_EQ(MH_OK, MH_RemoveHook(target));
+}
+
+TEST(ShortFunctionIsPatchedFromAbove)
+{
+	HookScope scope;
+	SyntheticCode code(0x1000);
+
+	// xor eax, eax; ret with no padding after it, only int3 padding above
+	static const uint8_t zero[] = { 0x31, 0xC0, 0xC3 };
+	static const uint8_t next[] = { 0x55, 0x5D, 0xC3 };
+	void* target = code.Emit(zero, sizeof(zero), 16);
+	CHECK(code.Emit(next, sizeof(next)) != NULL);
+	memcpy(static_cast<uint8_t*>(target) + sizeof(zero), next, sizeof(next));
+	CHECK(code.Seal());
+
+	CHECK_EQ(MH_OK, MH_CreateHook(target, reinterpret_cast<void*>(&DetourSynthetic), reinterpret_cast<void**>(&g_originalSynthetic)));
+	CHECK_EQ(MH_OK, MH_EnableHook(target));
+
+	CHECK_EQ(0xEB, static_cast<uint8_t*>(target)[0]);
+	CHECK_EQ(0xE9, static_cast<uint8_t*>(target)[-5]);
+	CHECK_EQ(3000, reinterpret_cast<IntFunc>(target)(9));
+	CHECK_EQ(0, g_originalSynthetic(9));
+
+	CHECK_EQ(MH_OK, MH_DisableHook(target));
+	CHECK_EQ(0x31, static_cast<uint8_t*>(target)[0]);
+	CHECK_EQ(0xCC, static_cast<uint8_t*>(target)[-5]);
+	CHECK_EQ(MH_OK, MH_RemoveHook(target));
+}
+
+TEST(StatusCodes)
+{
+	CHECK_EQ(MH_ERROR_NOT_INITIALIZED, MH_EnableHook(reinterpret_cast<void*>(&Scale)));
+
+	HookScope scope;
+	CHECK_EQ(MH_ERROR_ALREADY_INITIALIZED, MH_Initialize());
+
+	void* original;
+	static int data = 0;
+	CHECK_EQ(MH_ERROR_NOT_EXECUTABLE, MH_CreateHook(&data, reinterpret_cast<void*>(&DetourScale), &original));
+	CHECK_EQ(MH_ERROR_NOT_CREATED, MH_EnableHook(reinterpret_cast<void*>(&Scale)));
+
+	CHECK_EQ(MH_OK, MH_CreateHook(reinterpret_cast<void*>(&Scale), reinterpret_cast<void*>(&DetourScale), &original));
+	CHECK_EQ(MH_ERROR_ALREADY_CREATED, MH_CreateHook(reinterpret_cast<void*>(&Scale), reinterpret_cast<void*>(&DetourScale), &original));
+	CHECK_EQ(MH_ERROR_DISABLED, MH_DisableHook(reinterpret_cast<void*>(&Scale)));
+	CHECK_EQ(MH_OK, MH_EnableHook(reinterpret_cast<void*>(&Scale)));
+	CHECK_EQ(MH_ERROR_ENABLED, MH_EnableHook(reinterpret_cast<void*>(&Scale)));
+	CHECK_EQ(MH_OK, MH_RemoveHook(reinterpret_cast<void*>(&Scale)));
+	CHECK_EQ(MH_ERROR_NOT_CREATED, MH_RemoveHook(reinterpret_cast<void*>(&Scale)));
+	CHECK_EQ(7, g_scale(2));
+}
+
+TEST_MAIN()
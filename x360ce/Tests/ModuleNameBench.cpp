@@ -0,0 +1,53 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// LoadLibrary/GetModuleHandle name check per call: lowercase copy and five searches against single pass.
+
+#include "Test.h"
+#include <windows.h>
+#include "ModuleName.h"
+#include "ModuleNameCorpus.h"
+
+static const int ROUNDS = 100000;
+
+template<typename Check>
+static void Run(const char* name, Check check)
+{
+	size_t found = 0;
+	double start = TestSeconds();
+	for (int round = 0; round < ROUNDS; ++round)
+		for (size_t i = 0; i < _countof(g_ModuleNames); ++i)
+			found += check(g_ModuleNames[i]) != FALSE;
+	double ns = (TestSeconds() - start) * 1e9 / (ROUNDS * _countof(g_ModuleNames));
+
+	printf("%-12s %7.1f ns/name, %u matches\n", name, ns, (unsigned)found);
+}
+
+static BOOL NewSelfCheck(const char* name)
+{
+	return SelfCheck(name);
+}
+
+int main()
+{
+	printf("%u names in corpus\n", (unsigned)_countof(g_ModuleNames));
+	Run("std::string", OldSelfCheck);
+	Run("single pass", NewSelfCheck);
+	return 0;
+}
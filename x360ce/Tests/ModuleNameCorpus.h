@@ -0,0 +1,67 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _MODULENAMECORPUS_H_
+#define _MODULENAMECORPUS_H_
+
+// Library names typical engine passes to LoadLibrary and GetModuleHandle while starting,
+// and lowercase copy and search that SelfCheck replaced.
+
+#include <windows.h>
+
+#include <algorithm>
+#include <ctype.h>
+#include <string>
+
+static const char* const g_ModuleNames[] =
+{
+	"kernel32.dll", "KERNEL32.DLL", "ntdll.dll", "user32.dll", "advapi32.dll", "shell32.dll",
+	"ole32.dll", "oleaut32.dll", "version.dll", "winmm.dll", "ws2_32.dll", "dbghelp.dll",
+	"d3d9.dll", "d3d11.dll", "dxgi.dll", "d3dcompiler_43.dll", "d3dcompiler_47.dll", "d3dx9_43.dll",
+	"dinput8.dll", "dinput.dll", "dsound.dll", "xaudio2_7.dll", "X3DAudio1_7.dll", "XAPOFX1_5.dll",
+	"xinput1_3.dll", "XINPUT1_3.DLL", "xinput1_4.dll", "xinput9_1_0.dll", "XInput1_3",
+	"C:\\Windows\\system32\\xinput1_3.dll", "C:\\Windows\\SysWOW64\\XInput9_1_0.dll",
+	"steam_api.dll", "steamclient.dll", "GameOverlayRenderer.dll", "PhysXLoader.dll",
+	"PhysX3_x86.dll", "binkw32.dll", "fmodex.dll", "OpenAL32.dll", "nvapi.dll", "atiadlxx.dll",
+	"C:\\Program Files (x86)\\Steam\\steamapps\\common\\Game\\bin\\engine.dll",
+	"C:\\Program Files (x86)\\Steam\\steamapps\\common\\Game\\bin\\client.dll",
+	"setupapi.dll", "hid.dll", "wintrust.dll", "crypt32.dll", "cfgmgr32.dll", "powrprof.dll",
+	"comctl32.dll", "uxtheme.dll", "dwmapi.dll", "imm32.dll", "msvcr100.dll", "msvcp100.dll",
+	"MSVCR120.dll", "vcruntime140.dll", "api-ms-win-core-synch-l1-2-0.dll", "ext-ms-win-xinput-l1-1-0",
+};
+
+inline BOOL OldSelfCheck(const char* lpLibFileName)
+{
+	if (!lpLibFileName) return FALSE;
+
+	std::string strLib(lpLibFileName);
+	std::transform(strLib.begin(), strLib.end(), strLib.begin(), tolower);
+
+	if (strLib.find("xinput1_4") != std::string::npos ||
+			strLib.find("xinput1_3") != std::string::npos ||
+			strLib.find("xinput1_2") != std::string::npos ||
+			strLib.find("xinput1_1") != std::string::npos ||
+			strLib.find("xinput9_1_0") != std::string::npos)
+	{
+		return TRUE;
+	}
+	else return FALSE;
+}
+
+#endif
@@ -0,0 +1,97 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// XInput library name matcher of LoadLibrary/GetModuleHandle hooks against std::string search it replaced.
+
+#include "Test.h"
+#include <windows.h>
+#include "ModuleName.h"
+#include "ModuleNameCorpus.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+TEST(XInputNames)
+{
+	CHECK(SelfCheck("xinput1_3.dll"));
+	CHECK(SelfCheck("XINPUT1_4.DLL"));
+	CHECK(SelfCheck("XInput1_1"));
+	CHECK(SelfCheck("xinput1_2.dll"));
+	CHECK(SelfCheck("xinput9_1_0.dll"));
+	CHECK(SelfCheck(L"C:\\Windows\\System32\\XInput1_3.dll"));
+	CHECK(SelfCheck(L"..\\bin/xinput9_1_0.dll"));
+
+	CHECK(!SelfCheck("xinput1_5.dll"));
+	CHECK(!SelfCheck("xinput.dll"));
+	CHECK(!SelfCheck("xinput9_1_1.dll"));
+	CHECK(!SelfCheck("kernel32.dll"));
+	CHECK(!SelfCheck(""));
+	CHECK(!SelfCheck((const char*)NULL));
+	CHECK(!SelfCheck((const wchar_t*)NULL));
+}
+
+TEST(OnlyFileNameCounts)
+{
+	// directory named like XInput library does not make module one
+	CHECK(!SelfCheck("C:\\games\\xinput1_3\\d3d9.dll"));
+	CHECK(!SelfCheck(L"x:/xinput9_1_0/plugins/steam_api.dll"));
+	CHECK(SelfCheck("C:\\games\\xinput1_3\\xinput1_3.dll"));
+}
+
+TEST(CorpusMatchesOldSearch)
+{
+	for (size_t i = 0; i < _countof(g_ModuleNames); ++i)
+	{
+		const char* name = g_ModuleNames[i];
+		CHECK_EQ(OldSelfCheck(name), SelfCheck(name));
+
+		wchar_t wide[MAX_PATH];
+		size_t length = strlen(name);
+		for (size_t j = 0; j <= length; ++j) wide[j] = name[j];
+		CHECK_EQ(OldSelfCheck(name), SelfCheck(wide));
+	}
+}
+
+TEST(FuzzMatchesOldSearch)
+{
+	// names without directory part, where both must agree
+	static const char* const pieces[] = { "x", "X", "input", "INPUT", "xinput", "XInput", "1_", "9_1_", "0", "1", "3", "4", "5", "_", ".dll", "d3d" };
+
+	srand(4321);
+	char name[64];
+	for (int n = 0; n < 200000; ++n)
+	{
+		name[0] = '\0';
+		int count = 1 + rand() % 6;
+		for (int i = 0; i < count; ++i)
+		{
+			const char* piece = pieces[rand() % _countof(pieces)];
+			if (strlen(name) + strlen(piece) < sizeof(name)) strcat(name, piece);
+		}
+
+		if (OldSelfCheck(name) != SelfCheck(name))
+		{
+			CHECK_EQ(OldSelfCheck(name), SelfCheck(name));
+			printf("name \"%s\"\n", name);
+			break;
+		}
+	}
+}
+
+TEST_MAIN()
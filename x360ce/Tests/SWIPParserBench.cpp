@@ -0,0 +1,111 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Reading of game database: SWIP single pass against copy of every line into std::string,
+// and against scan of whole file per section the way GetPrivateProfileSection is called by section list.
+
+#include "SWIPParser.h"
+#include "SWIPParserCorpus.h"
+#include "Test.h"
+
+#include <vector>
+
+static const size_t SECTIONS[] = { 200, 2000, 20000 };
+static const size_t MAX_RESCAN = 2000;	// sections of largest file scanned per section
+static const int ROUNDS = 5;
+
+static size_t OnePass(const std::string& text)
+{
+	size_t keys = 0;
+	swip_parse(text.data(), text.size(),
+		[](const swip_view&) { return true; },
+		[&](const swip_view&, const swip_view&) { ++keys; });
+	return keys;
+}
+
+static size_t Strings(const std::string& text)
+{
+	size_t keys = 0;
+	SWIPModelParse(text,
+		[](const std::string&) { return true; },
+		[&](const std::string&, const std::string&) { ++keys; });
+	return keys;
+}
+
+// Section names first, then keys of one section per scan
+static size_t Rescan(const std::string& text)
+{
+	std::vector<std::string> names;
+	swip_parse(text.data(), text.size(),
+		[&](const swip_view& name) { names.push_back(std::string(name.begin, name.size())); return false; },
+		[](const swip_view&, const swip_view&) {});
+
+	size_t keys = 0;
+	for (size_t i = 0; i < names.size(); ++i)
+	{
+		const std::string& only = names[i];
+		swip_parse(text.data(), text.size(),
+			[&](const swip_view& name) { return name.size() == only.size() && memcmp(name.begin, only.data(), only.size()) == 0; },
+			[&](const swip_view&, const swip_view&) { ++keys; });
+	}
+	return keys;
+}
+
+template<typename Reader>
+static double Measure(Reader read, const std::string& text, size_t* keys)
+{
+	double best = 0;
+	for (int round = 0; round < ROUNDS; ++round)
+	{
+		double start = TestSeconds();
+		*keys = read(text);
+		double ms = (TestSeconds() - start) * 1e3;
+		if (!round || ms < best) best = ms;
+	}
+	return best;
+}
+
+int main()
+{
+	int failures = 0;
+	printf("sections      bytes   one pass ms   std::string ms   per section ms\n");
+
+	for (size_t s = 0; s < _countof(SECTIONS); ++s)
+	{
+		std::string text = SWIPDatabaseFile(SECTIONS[s]);
+		size_t one, strings, rescan = 0;
+
+		double a = Measure(OnePass, text, &one);
+		double b = Measure(Strings, text, &strings);
+		printf("%8u %10u %13.2f %16.2f", (unsigned)SECTIONS[s], (unsigned)text.size(), a, b);
+
+		if (SECTIONS[s] <= MAX_RESCAN)
+		{
+			double c = Measure(Rescan, text, &rescan);
+			printf(" %16.2f\n", c);
+			if (rescan != one) ++failures;
+		}
+		else printf(" %16s\n", "-");
+
+		if (one != strings || one != 3 * SECTIONS[s]) ++failures;
+	}
+
+	if (failures) printf("key counts differ\n");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,114 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SWIPPARSERCORPUS_H_
+#define _SWIPPARSERCORPUS_H_
+
+// Ini files for SWIP parser tests: model of profile API rules that copies every line into std::string,
+// random files built from pieces the parser cares about, and large game database like x360ce.gdb.
+
+#include <windows.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+// Line by line split the way GetPrivateProfileSection and GetPrivateProfileSectionNames read file
+template<typename SectionCallback, typename KeyCallback>
+void SWIPModelParse(const std::string& text, SectionCallback on_section, KeyCallback on_key)
+{
+	std::string data = text;
+	if (data.compare(0, 3, "\xEF\xBB\xBF") == 0) data.erase(0, 3);
+
+	bool in_section = false;
+	size_t pos = 0;
+	while (pos < data.size())
+	{
+		size_t eol = data.find_first_of("\r\n", pos);
+		if (eol == std::string::npos) eol = data.size();
+		std::string line = data.substr(pos, eol - pos);
+		pos = eol + 1;
+
+		const char* space = " \t\r\n\v\f\x1A";
+		size_t first = line.find_first_not_of(space);
+		if (first == std::string::npos) continue;
+		line = line.substr(first, line.find_last_not_of(space) - first + 1);
+		if (line[0] == ';') continue;
+
+		size_t close = line.rfind(']');
+		if (line[0] == '[' && close != std::string::npos && close >= 1)
+		{
+			in_section = on_section(line.substr(1, close - 1));
+		}
+		else if (in_section)
+		{
+			size_t equal = line.find('=');
+			if (equal == std::string::npos) on_key(line, line);
+			else on_key(line.substr(0, equal), line.substr(equal + 1));
+		}
+	}
+}
+
+// Pieces of random ini file, weighted toward characters with meaning for parser, empty one is null character
+static const char* const g_SWIPPieces[] =
+{
+	"[", "]", "=", ";", " ", "\t", "\r", "\n", "\r\n", "\r\n", "\n", "\x1A", "\v", "\f",
+	"a", "b", "X", "key", "value", "Section", "[pad1]", "[PAD1]", "[x]", "[]", "[[a]]", "a=b",
+	"FileName=game.exe", "HookMask=0x00000023", "; comment", "\xEF\xBB\xBF", "\xFF", "",
+};
+
+// Random file of up to maxpieces pieces, may start with byte order mark
+inline std::string SWIPRandomFile(unsigned int* seed, size_t maxpieces)
+{
+	std::string file;
+	if (rand_r(seed) % 8 == 0) file = "\xEF\xBB\xBF";
+
+	size_t pieces = rand_r(seed) % (maxpieces + 1);
+	for (size_t i = 0; i < pieces; ++i)
+	{
+		unsigned int piece = rand_r(seed) % (_countof(g_SWIPPieces) + 1);
+		if (piece == _countof(g_SWIPPieces)) file += static_cast<char>(rand_r(seed));
+		else if (g_SWIPPieces[piece][0]) file += g_SWIPPieces[piece];
+		else file += '\0';
+	}
+	return file;
+}
+
+// Game database with sections of settings for each game, CRLF lines like files written by x360ce app
+inline std::string SWIPDatabaseFile(size_t sections)
+{
+	std::string file = "; x360ce game database\r\n\r\n";
+	char line[128];
+	for (size_t i = 0; i < sections; ++i)
+	{
+		snprintf(line, sizeof(line), "[game%05u.exe]\r\n", (unsigned)i);
+		file += line;
+		snprintf(line, sizeof(line), "FileName = game%05u.exe\r\n", (unsigned)i);
+		file += line;
+		snprintf(line, sizeof(line), "FileProductName = Game Number %u\r\n", (unsigned)i);
+		file += line;
+		snprintf(line, sizeof(line), "HookMask=0x%08X\r\n", (unsigned)(i * 2654435761u) & 0x3F);
+		file += line;
+		if (i % 7 == 0) file += "; verified\r\n";
+		file += "\r\n";
+	}
+	return file;
+}
+
+#endif
@@ -0,0 +1,222 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// SWIP ini tokenizer against model of profile API rules. Each file is placed right before
+// inaccessible page, so reading past end of data crashes test instead of passing unnoticed.
+
+#include "SWIPParser.h"
+#include "SWIPParserCorpus.h"
+#include "Test.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+static const int FUZZ_FILES = 200000;
+static const size_t FUZZ_PIECES = 64;
+static const size_t GUARD_BUFFER = 1 << 16;
+
+// Buffer followed by PROT_NONE page
+class GuardedBuffer
+{
+public:
+	GuardedBuffer(size_t size)
+		:m_size((size + Page() - 1) / Page() * Page())
+	{
+		void* p = mmap(NULL, m_size + Page(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		m_base = p == MAP_FAILED ? NULL : static_cast<char*>(p);
+		if (m_base) mprotect(m_base + m_size, Page(), PROT_NONE);
+	}
+
+	~GuardedBuffer()
+	{
+		if (m_base) munmap(m_base, m_size + Page());
+	}
+
+	// Copy of text ending at guard page
+	const char* Place(const std::string& text)
+	{
+		if (!m_base || text.size() > m_size) return NULL;
+		char* data = m_base + m_size - text.size();
+		memcpy(data, text.data(), text.size());
+		return data;
+	}
+
+private:
+	static size_t Page()
+	{
+		return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	}
+
+	char* m_base;
+	size_t m_size;
+};
+
+// Section skipped by callback, so keys of skipped sections are tested too
+static bool Accept(const std::string& name)
+{
+	return name.find('x') == std::string::npos && name.find('X') == std::string::npos;
+}
+
+static void Append(std::string* events, char kind, const std::string& text)
+{
+	char length[16];
+	snprintf(length, sizeof(length), "%c%u:", kind, (unsigned)text.size());
+	*events += length;
+	*events += text;
+}
+
+static std::string Parse(const char* data, size_t size)
+{
+	std::string events;
+	swip_parse(data, size,
+		[&](const swip_view& name) -> bool
+		{
+			std::string text(name.begin, name.size());
+			Append(&events, 'S', text);
+			return Accept(text);
+		},
+		[&](const swip_view& key, const swip_view& value)
+		{
+			Append(&events, 'K', std::string(key.begin, key.size()));
+			Append(&events, 'V', std::string(value.begin, value.size()));
+		});
+	return events;
+}
+
+static std::string Model(const std::string& text)
+{
+	std::string events;
+	SWIPModelParse(text,
+		[&](const std::string& name) -> bool
+		{
+			Append(&events, 'S', name);
+			return Accept(name);
+		},
+		[&](const std::string& key, const std::string& value)
+		{
+			Append(&events, 'K', key);
+			Append(&events, 'V', value);
+		});
+	return events;
+}
+
+static std::string Parse(const std::string& text)
+{
+	return Parse(text.data(), text.size());
+}
+
+TEST(Sections)
+{
+	CHECK(Parse("[pad1]\r\nIndex=1\r\n") == "S4:pad1K5:IndexV1:1");
+	CHECK(Parse("  [ pad1 ] \n") == "S6: pad1 ");
+	CHECK(Parse("[a]b]\nk=v\n") == "S3:a]bK1:kV1:v");
+	CHECK(Parse("[]\nk=v\n") == "S0:K1:kV1:v");
+	CHECK(Parse("[pad1] ; comment\n") == "S4:pad1");
+
+	// no closing bracket makes key line of current section
+	CHECK(Parse("[a]\n[b\n") == "S1:aK2:[bV2:[b");
+	CHECK(Parse("[\n") == "");
+}
+
+TEST(Keys)
+{
+	CHECK(Parse("k=v\n[a]\n") == "S1:a");
+	CHECK(Parse("[a]\n  key = value  \n") == "S1:aK4:key V6: value");
+	CHECK(Parse("[a]\nk=v=w\n") == "S1:aK1:kV3:v=w");
+	CHECK(Parse("[a]\n=v\nk=\n") == "S1:aK0:V1:vK1:kV0:");
+	CHECK(Parse("[a]\nflag\n") == "S1:aK4:flagV4:flag");
+	CHECK(Parse("[a]\n;k=v\n  ;k=v\nk;=v\n") == "S1:aK2:k;V1:v");
+}
+
+TEST(SkippedSection)
+{
+	CHECK(Parse("[x]\nk=v\n[a]\nk=w\n") == "S1:xS1:aK1:kV1:w");
+}
+
+TEST(LineEnds)
+{
+	CHECK(Parse("[a]\rk=1\r\nl=2\nm=3") == "S1:aK1:kV1:1K1:lV1:2K1:mV1:3");
+	CHECK(Parse("[a]\r\n\r\n\n\rk=1\x1A") == "S1:aK1:kV1:1");
+	CHECK(Parse("") == "");
+	CHECK(Parse("\r\n \t\r\n") == "");
+}
+
+TEST(ByteOrderMark)
+{
+	CHECK(Parse("\xEF\xBB\xBF[a]\nk=v\n") == "S1:aK1:kV1:v");
+	CHECK(Parse("\xEF\xBB\xBF") == "");
+	CHECK(Parse("\xEF\xBB") == "");
+
+	// only at start of file
+	CHECK(Parse("[a]\n\xEF\xBB\xBFk=v\n") == "S1:aK4:\xEF\xBB\xBFkV1:v");
+}
+
+TEST(NullCharacter)
+{
+	std::string text("[a]\nk=v\0w\n", 10);
+	CHECK(Parse(text) == std::string("S1:aK1:kV3:v\0w", 14));
+}
+
+// Parser never reads past size, last line has no line end
+TEST(EndOfData)
+{
+	GuardedBuffer buffer(GUARD_BUFFER);
+	const char* texts[] = { "[a]\nk=v", "[a]\nk", "[a", "[a]", "[a]\n ", ";", "\xEF\xBB\xBF[" };
+	for (size_t i = 0; i < _countof(texts); ++i)
+	{
+		const char* data = buffer.Place(texts[i]);
+		CHECK(data && Parse(data, strlen(texts[i])) == Model(texts[i]));
+	}
+}
+
+TEST(FuzzMatchesModel)
+{
+	GuardedBuffer buffer(GUARD_BUFFER);
+	unsigned int seed = 2013;
+	int differences = 0;
+	size_t bytes = 0;
+
+	for (int i = 0; i < FUZZ_FILES; ++i)
+	{
+		std::string text = SWIPRandomFile(&seed, FUZZ_PIECES);
+		const char* data = buffer.Place(text);
+		if (!data) continue;
+
+		bytes += text.size();
+		if (Parse(data, text.size()) == Model(text)) continue;
+
+		if (++differences <= 5)
+		{
+			fprintf(stderr, "file %d differs:", i);
+			for (size_t j = 0; j < text.size(); ++j) fprintf(stderr, " %02X", (unsigned char)text[j]);
+			fprintf(stderr, "\n");
+		}
+	}
+
+	printf("%d random files, %u bytes\n", FUZZ_FILES, (unsigned)bytes);
+	CHECK_EQ(0, differences);
+}
+
+TEST(DatabaseMatchesModel)
+{
+	std::string text = SWIPDatabaseFile(2000);
+	CHECK(Parse(text) == Model(text));
+}
+
+TEST_MAIN()
@@ -0,0 +1,86 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SYNTHETICCODE_H_
+#define _SYNTHETICCODE_H_
+
+// Machine code hook targets for MinHook tests and benchmarks.
+// Functions are written into own mmap pages, padded with int3 like compilers do,
+// and the pages are sealed read and execute before hooks are created.
+
+#include <windows.h>
+#include <sys/mman.h>
+
+class SyntheticCode
+{
+public:
+	explicit SyntheticCode(size_t size)
+		:m_size(size)
+		, m_used(0)
+	{
+		void* p = mmap(NULL, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		m_code = (p == MAP_FAILED) ? NULL : static_cast<uint8_t*>(p);
+		if (m_code) memset(m_code, 0xCC, size);
+	}
+
+	~SyntheticCode()
+	{
+		if (m_code) munmap(m_code, m_size);
+	}
+
+	// Copies function to next 16 byte boundary after at least gap bytes of padding
+	void* Emit(const uint8_t* code, size_t size, size_t gap = 0)
+	{
+		size_t start = (m_used + gap + 15) & ~static_cast<size_t>(15);
+		if (!m_code || start + size > m_size) return NULL;
+
+		memcpy(m_code + start, code, size);
+		m_used = start + size;
+		return m_code + start;
+	}
+
+	// Function returning value: mov eax, imm32; ret
+	void* EmitReturn(uint32_t value)
+	{
+		uint8_t code[] = { 0xB8, 0, 0, 0, 0, 0xC3 };
+		memcpy(code + 1, &value, sizeof(value));
+		return Emit(code, sizeof(code));
+	}
+
+	// Code pages of a loaded module are not writable
+	bool Seal()
+	{
+		return m_code && mprotect(m_code, m_size, PROT_READ | PROT_EXEC) == 0;
+	}
+
+	uint8_t* Base() const
+	{
+		return m_code;
+	}
+
+private:
+	SyntheticCode(const SyntheticCode&);
+	SyntheticCode& operator=(const SyntheticCode&);
+
+	uint8_t* m_code;
+	size_t m_size;
+	size_t m_used;
+};
+
+#endif
@@ -0,0 +1,87 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _SYNTHETICDEVICE_H_
+#define _SYNTHETICDEVICE_H_
+
+// DirectInput device stand-in for MapGamepad, state is set by test instead of polled.
+
+#include "GamepadMap.h"
+
+struct PadState
+{
+	LONG lX, lY, lZ;
+	LONG lRx, lRy, lRz;
+	LONG rglSlider[2];
+	DWORD rgdwPOV[4];
+	BYTE rgbButtons[128];
+};
+
+struct Pad
+{
+	Pad()
+		:state()
+		, triggerdz()
+		, a2ddeadzone(0)
+		, a2doffset(0)
+		, axisdeadzone()
+		, antideadzone()
+		, axislinear()
+		, axistodpad(false)
+	{
+		for (int i = 0; i < 4; ++i) state.rgdwPOV[i] = (DWORD)-1;
+	}
+
+	void Press(int button) { state.rgbButtons[button] = 0x80; }
+
+	PadState state;
+	uint8_t triggerdz[2];
+	int32_t a2ddeadzone;
+	int32_t a2doffset;
+	int16_t axisdeadzone[4];
+	int16_t antideadzone[4];
+	int16_t axislinear[4];
+	bool axistodpad;
+};
+
+inline BOOL ButtonPressed(DWORD buttonidx, Pad& device)
+{
+	return (device.state.rgbButtons[buttonidx] & 0x80) != 0;
+}
+
+// default layout of x360ce.App: buttons 1-10, guide on 11, POV hat, sticks on X/Y and Rx/Ry, triggers on Z halves
+inline Mapping DefaultMapping()
+{
+	Mapping mapping;
+	for (int i = 0; i < 10; ++i) mapping.Button[i] = static_cast<int8_t>(i);
+	mapping.guide = 11;
+	mapping.DpadPOV = 1;
+
+	mapping.Axis[0].analogType = AXIS; mapping.Axis[0].id = 1;
+	mapping.Axis[1].analogType = AXIS; mapping.Axis[1].id = -2;
+	mapping.Axis[2].analogType = AXIS; mapping.Axis[2].id = 4;
+	mapping.Axis[3].analogType = AXIS; mapping.Axis[3].id = -5;
+
+	mapping.Trigger[0].type = HAXIS; mapping.Trigger[0].id = 3;
+	mapping.Trigger[1].type = HAXIS; mapping.Trigger[1].id = -3;
+	return mapping;
+}
+
+#endif
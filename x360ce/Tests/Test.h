@@ -0,0 +1,118 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _TEST_H_
+#define _TEST_H_
+
+// Minimal test runner, every TEST is run by main and failed CHECKs are counted.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef void(*TestFunc)();
+
+struct TestCase
+{
+	const char* name;
+	TestFunc func;
+	TestCase* next;
+};
+
+inline TestCase*& TestList()
+{
+	static TestCase* list = NULL;
+	return list;
+}
+
+inline int& TestFailures()
+{
+	static int failures = 0;
+	return failures;
+}
+
+struct TestRegister
+{
+	TestRegister(TestCase* test)
+	{
+		// keep order of definition
+		TestCase** tail = &TestList();
+		while (*tail) tail = &(*tail)->next;
+		*tail = test;
+	}
+};
+
+#define TEST(name) \
+	static void Test_##name(); \
+	static TestCase TestCase_##name = { #name, Test_##name, NULL }; \
+	static TestRegister TestRegister_##name(&TestCase_##name); \
+	static void Test_##name()
+
+#define CHECK(expr) \
+	do \
+	{ \
+		if (!(expr)) \
+		{ \
+			fprintf(stderr, "%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+			++TestFailures(); \
+		} \
+	} while (0)
+
+#define CHECK_EQ(expected, actual) \
+	do \
+	{ \
+		long long expected_ = (long long)(expected); \
+		long long actual_ = (long long)(actual); \
+		if (expected_ != actual_) \
+		{ \
+			fprintf(stderr, "%s(%d): CHECK_EQ(%s, %s) failed, %lld != %lld\n", __FILE__, __LINE__, #expected, #actual, expected_, actual_); \
+			++TestFailures(); \
+		} \
+	} while (0)
+
+// Seconds of monotonic clock, for benchmarks
+inline double TestSeconds()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+inline int RunTests()
+{
+	int count = 0;
+	for (TestCase* test = TestList(); test; test = test->next)
+	{
+		int failures = TestFailures();
+		test->func();
+		printf("%s %s\n", TestFailures() == failures ? "[ OK ]" : "[FAIL]", test->name);
+		++count;
+	}
+
+	printf("%d tests, %d failed checks\n", count, TestFailures());
+	return TestFailures() ? 1 : 0;
+}
+
+#define TEST_MAIN() \
+	int main() \
+	{ \
+		return RunTests(); \
+	}
+
+#endif
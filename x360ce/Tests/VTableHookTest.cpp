@@ -0,0 +1,325 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Vtable slot hooks on synthetic COM style vtables placed in pages protected with mprotect.
+
+#include "Test.h"
+#include <windows.h>
+#include "VTableHook.h"
+
+#include <map>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Pages owned by test, protection is tracked here because POSIX has no VirtualQuery
+class PosixPages : public iHookPageAccess
+{
+public:
+	PosixPages()
+		:protects(0)
+		, writeprotect(0)
+		, failprotect(false)
+	{
+	}
+
+	~PosixPages()
+	{
+		for (auto page = m_pages.begin(); page != m_pages.end(); ++page)
+			munmap(reinterpret_cast<void*>(page->first), PageSize());
+	}
+
+	void* Allocate(DWORD protect)
+	{
+		void* page = mmap(NULL, PageSize(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (page == MAP_FAILED) return NULL;
+		m_pages[reinterpret_cast<uintptr_t>(page)] = PAGE_READWRITE;
+
+		DWORD old;
+		Protect(page, PageSize(), protect, &old);
+		protects = 0;
+		return page;
+	}
+
+	void Free(void* page)
+	{
+		munmap(page, PageSize());
+		m_pages.erase(reinterpret_cast<uintptr_t>(page));
+	}
+
+	DWORD Get(void* address)
+	{
+		DWORD protect = 0;
+		Query(address, &protect);
+		return protect;
+	}
+
+	bool Query(void* pAddress, DWORD* pProtect)
+	{
+		auto page = m_pages.find(Page(pAddress));
+		if (page == m_pages.end()) return false;
+		*pProtect = page->second;
+		return true;
+	}
+
+	bool Protect(void* pAddress, size_t size, DWORD protect, DWORD* pOldProtect)
+	{
+		++protects;
+		auto page = m_pages.find(Page(pAddress));
+		if (failprotect || page == m_pages.end() || Page(reinterpret_cast<char*>(pAddress) + size - 1) != page->first) return false;
+
+		int prot = PROT_NONE;
+		if (protect & (PAGE_READONLY | PAGE_EXECUTE_READ)) prot = PROT_READ;
+		if (protect & (PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY)) prot = PROT_READ | PROT_WRITE;
+		if (mprotect(reinterpret_cast<void*>(page->first), PageSize(), prot) != 0) return false;
+
+		*pOldProtect = page->second;
+		page->second = protect;
+		if (prot & PROT_WRITE) writeprotect = protect;
+		return true;
+	}
+
+	int protects;
+	DWORD writeprotect;		// last protection that made page writable
+	bool failprotect;
+
+private:
+	static size_t PageSize()
+	{
+		return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	}
+
+	static uintptr_t Page(void* address)
+	{
+		return reinterpret_cast<uintptr_t>(address) & ~(PageSize() - 1);
+	}
+
+	std::map<uintptr_t, DWORD> m_pages;
+};
+
+struct Object;
+typedef int(*Method)(Object* self, int x);
+
+struct Object
+{
+	void** lpVtbl;
+	int base;
+};
+
+static int Add(Object* self, int x) { return self->base + x; }
+static int Mul(Object* self, int x) { return self->base * x; }
+static int Sub(Object* self, int x) { return self->base - x; }
+
+static Method oAdd = NULL;
+static int DetourAdd(Object* self, int x) { return oAdd(self, x) * 10; }
+
+static Method oMul = NULL;
+static int DetourMul(Object* self, int x) { return -oMul(self, x); }
+
+static int Call(Object& object, int method, int x)
+{
+	return reinterpret_cast<Method>(object.lpVtbl[method])(&object, x);
+}
+
+// vtable of three methods in its own page, read-only like vtables in module images
+struct Fixture
+{
+	Fixture(DWORD protect = PAGE_READONLY)
+	{
+		vtbl = static_cast<void**>(pages.Allocate(PAGE_READWRITE));
+		vtbl[0] = reinterpret_cast<void*>(Add);
+		vtbl[1] = reinterpret_cast<void*>(Mul);
+		vtbl[2] = reinterpret_cast<void*>(Sub);
+		DWORD old;
+		pages.Protect(vtbl, sizeof(void*) * 3, protect, &old);
+		pages.protects = 0;
+
+		object.lpVtbl = vtbl;
+		object.base = 6;
+		oAdd = NULL;
+		oMul = NULL;
+	}
+
+	PosixPages pages;
+	void** vtbl;
+	Object object;
+};
+
+TEST(PatchReadOnlySlot)
+{
+	Fixture f;
+	iHookVTable vtable(&f.pages);
+
+	CHECK_EQ(iHookVTable::VTABLE_PATCHED, vtable.Patch(&f.vtbl[0], reinterpret_cast<void*>(DetourAdd), reinterpret_cast<void**>(&oAdd)));
+	CHECK(oAdd == Add);
+	CHECK_EQ(90, Call(f.object, 0, 3));
+	CHECK_EQ(18, Call(f.object, 1, 3));
+
+	// page made writable for write only, then put back
+	CHECK_EQ(2, f.pages.protects);
+	CHECK_EQ(PAGE_READONLY, f.pages.Get(f.vtbl));
+
+	vtable.Restore();
+	CHECK_EQ(9, Call(f.object, 0, 3));
+	CHECK_EQ(PAGE_READONLY, f.pages.Get(f.vtbl));
+}
+
+TEST(ExecutablePageStaysExecutable)
+{
+	// other threads may run code from page while slot is written
+	Fixture f(PAGE_EXECUTE_READ);
+	iHookVTable vtable(&f.pages);
+
+	CHECK_EQ(iHookVTable::VTABLE_PATCHED, vtable.Patch(&f.vtbl[1], reinterpret_cast<void*>(DetourMul), reinterpret_cast<void**>(&oMul)));
+	CHECK_EQ(PAGE_EXECUTE_READWRITE, f.pages.writeprotect);
+	CHECK_EQ(-18, Call(f.object, 1, 3));
+	CHECK_EQ(PAGE_EXECUTE_READ, f.pages.Get(f.vtbl));
+}
+
+TEST(WritablePageIsNotReprotected)
+{
+	Fixture f(PAGE_READWRITE);
+	iHookVTable vtable(&f.pages);
+
+	CHECK_EQ(iHookVTable::VTABLE_PATCHED, vtable.Patch(&f.vtbl[0], reinterpret_cast<void*>(DetourAdd), reinterpret_cast<void**>(&oAdd)));
+	CHECK_EQ(0, f.pages.protects);
+	CHECK_EQ(90, Call(f.object, 0, 3));
+}
+
+TEST(SecondPatchOfSameSlotExists)
+{
+	Fixture f;
+	iHookVTable vtable(&f.pages);
+
+	CHECK_EQ(iHookVTable::VTABLE_PATCHED, vtable.Patch(&f.vtbl[0], reinterpret_cast<void*>(DetourAdd), reinterpret_cast<void**>(&oAdd)));
+	CHECK_EQ(iHookVTable::VTABLE_EXISTS, vtable.Patch(&f.vtbl[0], reinterpret_cast<void*>(DetourAdd), reinterpret_cast<void**>(&oAdd)));
+	CHECK(oAdd == Add);
+	CHECK_EQ(90, Call(f.object, 0, 3));
+}
+
+TEST(OtherVtableWithSameMethodIsShared)
+{
+	// second class reusing same implementation, its slot is patched too and original still matches
+	Fixture f;
+	Fixture g;
+	iHookVTable vtable(&f.pages);
+
+	CHECK_EQ(iHookVTable::VTABLE_PATCHED, vtable.Patch(&f.vtbl[0], reinterpret_cast<void*>(DetourAdd), reinterpret_cast<void**>(&oAdd)));
+
+	iHookVTable other(&g.pages);
+	CHECK_EQ(iHookVTable::VTABLE_PATCHED, other.Patch(&g.vtbl[0], reinterpret_cast<void*>(DetourAdd), reinterpret_cast<void**>(&oAdd)));
+	CHECK_EQ(90, Call(g.object, 0, 3));
+	other.Restore();
+}
+
+TEST(DifferentImplementationIsSkipped)
+{
+	// detour keeps one original, vtable with another method behind it can not share detour
+	Fixture f;
+	iHookVTable vtable(&f.pages);
+
+	CHECK_EQ(iHookVTable::VTABLE_PATCHED, vtable.Patch(&f.vtbl[0], reinterpret_cast<void*>(DetourAdd), reinterpret_cast<void**>(&oAdd)));
+
+	Method original = NULL;
+	CHECK_EQ(iHookVTable::VTABLE_SKIPPED, vtable.Patch(&f.vtbl[2], reinterpret_cast<void*>(DetourAdd), reinterpret_cast<void**>(&original)));
+	CHECK(original == NULL);
+	CHECK_EQ(3, Call(f.object, 2, 3));
+}
+
+TEST(InlineHookedMethodIsSkipped)
+{
+	Fixture f;
+	iHookVTable vtable(&f.pages);
+	vtable.MarkInline(reinterpret_cast<void*>(Add), reinterpret_cast<void*>(DetourAdd));
+
+	CHECK_EQ(iHookVTable::VTABLE_SKIPPED, vtable.Patch(&f.vtbl[0], reinterpret_cast<void*>(DetourAdd), reinterpret_cast<void**>(&oAdd)));
+	CHECK_EQ(9, Call(f.object, 0, 3));
+	CHECK_EQ(0, f.pages.protects);
+}
+
+TEST(UnwritableSlotFails)
+{
+	Fixture f;
+	iHookVTable vtable(&f.pages);
+	Method original = NULL;
+
+	f.pages.failprotect = true;
+	CHECK_EQ(iHookVTable::VTABLE_FAILED, vtable.Patch(&f.vtbl[0], reinterpret_cast<void*>(DetourAdd), reinterpret_cast<void**>(&original)));
+	CHECK(original == NULL);
+	CHECK_EQ(9, Call(f.object, 0, 3));
+
+
+	CHECK_EQ(iHookVTable::VTABLE_FAILED, vtable.Patch(NULL, reinterpret_cast<void*>(DetourAdd), reinterpret_cast<void**>(&original)));
+	CHECK_EQ(iHookVTable::VTABLE_FAILED, vtable.Patch(&f.vtbl[0], NULL, reinterpret_cast<void**>(&original)));
+}
+
+TEST(RestoreOfUnloadedPageIsSkipped)
+{
+	// owning module went away before Restore, its page is not touched
+	Fixture f;
+	iHookVTable vtable(&f.pages);
+	CHECK_EQ(iHookVTable::VTABLE_PATCHED, vtable.Patch(&f.vtbl[0], reinterpret_cast<void*>(DetourAdd), reinterpret_cast<void**>(&oAdd)));
+
+	f.pages.Free(f.vtbl);
+	vtable.Restore();
+
+	// registry is empty afterwards, new vtable can be hooked again
+	Fixture g;
+	iHookVTable again(&g.pages);
+	CHECK_EQ(iHookVTable::VTABLE_PATCHED, again.Patch(&g.vtbl[0], reinterpret_cast<void*>(DetourAdd), reinterpret_cast<void**>(&oAdd)));
+	CHECK_EQ(90, Call(g.object, 0, 3));
+}
+
+TEST(RestoreSingleDetour)
+{
+	Fixture f;
+	iHookVTable vtable(&f.pages);
+	CHECK_EQ(iHookVTable::VTABLE_PATCHED, vtable.Patch(&f.vtbl[0], reinterpret_cast<void*>(DetourAdd), reinterpret_cast<void**>(&oAdd)));
+	CHECK_EQ(iHookVTable::VTABLE_PATCHED, vtable.Patch(&f.vtbl[1], reinterpret_cast<void*>(DetourMul), reinterpret_cast<void**>(&oMul)));
+
+	vtable.Restore(reinterpret_cast<void*>(DetourAdd));
+	CHECK_EQ(9, Call(f.object, 0, 3));
+	CHECK_EQ(-18, Call(f.object, 1, 3));
+
+	vtable.Restore();
+	CHECK_EQ(18, Call(f.object, 1, 3));
+}
+
+TEST(RegistryIsBounded)
+{
+	PosixPages pages;
+	iHookVTable vtable(&pages);
+	void** vtbl = static_cast<void**>(pages.Allocate(PAGE_READWRITE));
+
+	// one detour per slot would overflow registry, all share Add here
+	Method original;
+	for (int i = 0; i < VTABLEHOOK_MAX_SLOTS; ++i)
+	{
+		vtbl[i] = reinterpret_cast<void*>(Add);
+		CHECK_EQ(iHookVTable::VTABLE_PATCHED, vtable.Patch(&vtbl[i], reinterpret_cast<void*>(DetourAdd), reinterpret_cast<void**>(&original)));
+	}
+
+	vtbl[VTABLEHOOK_MAX_SLOTS] = reinterpret_cast<void*>(Add);
+	CHECK_EQ(iHookVTable::VTABLE_FAILED, vtable.Patch(&vtbl[VTABLEHOOK_MAX_SLOTS], reinterpret_cast<void*>(DetourAdd), reinterpret_cast<void**>(&original)));
+
+	vtable.Restore();
+	for (int i = 0; i <= VTABLEHOOK_MAX_SLOTS; ++i)
+		CHECK(vtbl[i] == reinterpret_cast<void*>(Add));
+}
+
+TEST_MAIN()
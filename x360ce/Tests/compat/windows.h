@@ -0,0 +1,318 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _COMPAT_WINDOWS_H_
+#define _COMPAT_WINDOWS_H_
+
+// Just enough of Windows API for tests of portable x360ce parts on Linux.
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef int16_t SHORT;
+typedef int32_t LONG;
+typedef wchar_t WCHAR;
+typedef uint32_t ULONG;
+typedef int64_t LONGLONG;
+typedef int BOOL;
+typedef int INT;
+typedef void* HANDLE;
+typedef void* LPVOID;
+typedef void* HMODULE;
+typedef uintptr_t ULONG_PTR;
+
+typedef struct _IMAGE_DOS_HEADER
+{
+	WORD e_magic;
+} IMAGE_DOS_HEADER;
+
+typedef struct _GUID
+{
+	DWORD Data1;
+	WORD Data2;
+	WORD Data3;
+	BYTE Data4[8];
+} GUID;
+
+inline bool IsEqualGUID(const GUID& a, const GUID& b)
+{
+	return memcmp(&a, &b, sizeof(GUID)) == 0;
+}
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0
+#endif
+
+#define WINAPI
+#define NTAPI
+
+// MinHook picks its code generator by target machine
+#if defined(__x86_64__) && !defined(_M_X64)
+#define _M_X64 100
+#elif defined(__i386__) && !defined(_M_IX86)
+#define _M_IX86 600
+#endif
+
+#define sscanf_s sscanf
+#define _countof(a) (sizeof(a) / sizeof((a)[0]))
+#define MAX_PATH 260
+
+#define PAGE_NOACCESS 0x01
+#define PAGE_READONLY 0x02
+#define PAGE_READWRITE 0x04
+#define PAGE_WRITECOPY 0x08
+#define PAGE_EXECUTE 0x10
+#define PAGE_EXECUTE_READ 0x20
+#define PAGE_EXECUTE_READWRITE 0x40
+#define PAGE_EXECUTE_WRITECOPY 0x80
+#define PAGE_GUARD 0x100
+
+#define ERROR_SUCCESS 0L
+#define ERROR_BAD_ARGUMENTS 160L
+#define ERROR_BUSY 170L
+#define ERROR_OPERATION_ABORTED 995L
+#define ERROR_IO_INCOMPLETE 996L
+#define ERROR_IO_PENDING 997L
+#define ERROR_DEVICE_NOT_CONNECTED 1167L
+#define ERROR_CANCELLED 1223L
+#define ERROR_EMPTY 4306L
+
+#define STATUS_PENDING ((DWORD)0x00000103L)
+
+#define INFINITE 0xFFFFFFFF
+#define WAIT_OBJECT_0 0
+#define WAIT_TIMEOUT 258L
+#define WAIT_FAILED ((DWORD)0xFFFFFFFF)
+
+typedef struct _OVERLAPPED
+{
+	ULONG_PTR Internal;
+	ULONG_PTR InternalHigh;
+	DWORD Offset;
+	DWORD OffsetHigh;
+	HANDLE hEvent;
+} OVERLAPPED, *LPOVERLAPPED;
+
+#define HasOverlappedIoCompleted(lpOverlapped) (((DWORD)(lpOverlapped)->Internal) != STATUS_PENDING)
+
+inline DWORD& CompatLastError()
+{
+	static __thread DWORD error = 0;
+	return error;
+}
+
+inline DWORD GetLastError()
+{
+	return CompatLastError();
+}
+
+inline void SetLastError(DWORD error)
+{
+	CompatLastError() = error;
+}
+
+inline DWORD GetTickCount()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return static_cast<DWORD>(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+inline void Sleep(DWORD ms)
+{
+	usleep(ms * 1000);
+}
+
+inline LONG InterlockedIncrement(volatile LONG* value)
+{
+	return __sync_add_and_fetch(value, 1);
+}
+
+inline LONG InterlockedDecrement(volatile LONG* value)
+{
+	return __sync_sub_and_fetch(value, 1);
+}
+
+inline LONG InterlockedExchange(volatile LONG* target, LONG value)
+{
+	return __atomic_exchange_n(target, value, __ATOMIC_SEQ_CST);
+}
+
+inline LONG InterlockedCompareExchange(volatile LONG* target, LONG exchange, LONG comparand)
+{
+	return __sync_val_compare_and_swap(target, comparand, exchange);
+}
+
+inline void* InterlockedCompareExchangePointer(void* volatile* target, void* exchange, void* comparand)
+{
+	return __sync_val_compare_and_swap(target, comparand, exchange);
+}
+
+typedef pthread_mutex_t CRITICAL_SECTION;
+
+inline void InitializeCriticalSection(CRITICAL_SECTION* cs)
+{
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(cs, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+inline void DeleteCriticalSection(CRITICAL_SECTION* cs)
+{
+	pthread_mutex_destroy(cs);
+}
+
+inline void EnterCriticalSection(CRITICAL_SECTION* cs)
+{
+	pthread_mutex_lock(cs);
+}
+
+inline void LeaveCriticalSection(CRITICAL_SECTION* cs)
+{
+	pthread_mutex_unlock(cs);
+}
+
+// Events of synthetic backend share one lock and condition, every change wakes every waiter.
+struct CompatEvent
+{
+	bool manual;
+	bool signaled;
+};
+
+inline pthread_mutex_t* CompatEventLock()
+{
+	static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+	return &lock;
+}
+
+inline pthread_cond_t* CompatEventCond()
+{
+	static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+	return &cond;
+}
+
+inline HANDLE CreateEvent(void*, BOOL manual, BOOL initial, const char*)
+{
+	CompatEvent* event = new CompatEvent;
+	event->manual = manual != FALSE;
+	event->signaled = initial != FALSE;
+	return event;
+}
+
+inline BOOL SetEvent(HANDLE handle)
+{
+	pthread_mutex_lock(CompatEventLock());
+	static_cast<CompatEvent*>(handle)->signaled = true;
+	pthread_cond_broadcast(CompatEventCond());
+	pthread_mutex_unlock(CompatEventLock());
+	return TRUE;
+}
+
+inline BOOL ResetEvent(HANDLE handle)
+{
+	pthread_mutex_lock(CompatEventLock());
+	static_cast<CompatEvent*>(handle)->signaled = false;
+	pthread_mutex_unlock(CompatEventLock());
+	return TRUE;
+}
+
+// every handle of synthetic backend is event
+inline BOOL CloseHandle(HANDLE handle)
+{
+	delete static_cast<CompatEvent*>(handle);
+	return TRUE;
+}
+
+// Waits for any of handles, waiting for all is not supported
+inline DWORD WaitForMultipleObjects(DWORD count, const HANDLE* handles, BOOL all, DWORD ms)
+{
+	if (all) return WAIT_FAILED;
+
+	timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += ms / 1000;
+	deadline.tv_nsec += (ms % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L)
+	{
+		++deadline.tv_sec;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	pthread_mutex_lock(CompatEventLock());
+	for (;;)
+	{
+		for (DWORD i = 0; i < count; ++i)
+		{
+			CompatEvent* event = static_cast<CompatEvent*>(handles[i]);
+			if (!event->signaled) continue;
+
+			if (!event->manual) event->signaled = false;
+			pthread_mutex_unlock(CompatEventLock());
+			return WAIT_OBJECT_0 + i;
+		}
+
+		int result = ms == INFINITE ? pthread_cond_wait(CompatEventCond(), CompatEventLock())
+			: pthread_cond_timedwait(CompatEventCond(), CompatEventLock(), &deadline);
+		if (result != 0)
+		{
+			pthread_mutex_unlock(CompatEventLock());
+			return WAIT_TIMEOUT;
+		}
+	}
+}
+
+inline DWORD WaitForSingleObject(HANDLE handle, DWORD ms)
+{
+	return WaitForMultipleObjects(1, &handle, FALSE, ms);
+}
+
+// NTSTATUS of completed request turned into Win32 error the way system does for statuses used here
+inline BOOL GetOverlappedResult(HANDLE, LPOVERLAPPED overlapped, DWORD* transferred, BOOL wait)
+{
+	if (wait && overlapped->Internal == STATUS_PENDING && overlapped->hEvent)
+		WaitForSingleObject(overlapped->hEvent, INFINITE);
+
+	if (transferred) *transferred = static_cast<DWORD>(overlapped->InternalHigh);
+	switch (overlapped->Internal)
+	{
+	case 0:
+		return TRUE;
+	case STATUS_PENDING:
+		SetLastError(ERROR_IO_INCOMPLETE);
+		return FALSE;
+	case 0xC0000120:
+		SetLastError(ERROR_OPERATION_ABORTED);
+		return FALSE;
+	default:
+		SetLastError(static_cast<DWORD>(overlapped->Internal));
+		return FALSE;
+	}
+}
+
+#endif
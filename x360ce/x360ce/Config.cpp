@@ -34,6 +34,7 @@ extern std::vector<DInputDevice> g_Devices;
 bool g_bInitBeep = false;
 bool g_bNative = false;
 bool g_bDisable = false;
+bool g_bLearnHooks = false;
 std::vector<Mapping> g_Mappings;
 
 static const char* const buttonNames[] =
@@ -149,6 +150,49 @@ DWORD ReadGameDatabase()
     return ini.get_uint(exename, "HookMask");
 }
 
+// Learned hook masks, one section per executable written by learning mode
+static const char* const hookProfileName = "x360ce.lgdb";
+
+DWORD ReadHookProfile()
+{
+    SWIP ini(hookProfileName);
+
+    if(ini.is_open())
+    {
+        PrintLog("Using learned hook profile file:");
+        PrintLog("%s", ini.get_inipath().c_str());
+    }
+    return ini.get_uint(exename, "HookMask");
+}
+
+// Stores hook classes that changed any result in this run, merged with earlier runs
+// because one session does not have to touch every API game uses.
+void SaveHookProfile()
+{
+    if(!g_bLearnHooks || !pHooks) return;
+
+    DWORD learned = pHooks->GetUsefulMask();
+    if(!learned)
+    {
+        PrintLog("Hook learning: no hook changed any result, profile not written");
+        return;
+    }
+
+    // options are not learned, keep them as configured, a run that never reached the code
+    // reading PIDVID, NAME or STOP must not drop them from classes that were learned
+    learned |= pHooks->GetMask() & (iHook::HOOK_PIDVID | iHook::HOOK_NAME | iHook::HOOK_STOP | iHook::HOOK_NOTIMEOUT | iHook::HOOK_VTBL);
+
+    SWIP ini(hookProfileName);
+    learned |= ini.get_uint(exename, "HookMask");
+
+    char mask[16];
+    sprintf_s(mask, "0x%08X", learned);
+    if(ini.set_string(exename, "HookMask", mask))
+        PrintLog("Hook learning: %s HookMask=%s", exename.c_str(), mask);
+    else
+        PrintLog("Hook learning: cannot write %s", ini.get_inipath().c_str());
+}
+
 void ReadConfig()
 {
 	SWIP ini("x360ce.ini");
@@ -162,12 +206,25 @@ void ReadConfig()
 	bool file = ini.get_bool("Options", "Log");
 	bool con = ini.get_bool("Options", "Console");
 
+	// binary log is smaller and cheaper to write, Support\LogDecode turns it into text
+	bool binary = ini.get_bool("Options", "LogBinary");
+
+	// categories are LOG_* bits, level is LOGLEVEL_*, default is everything compiled in
+	LogFilter(ini.get_uint("Options", "LogCategories", LOG_ALL), ini.get_int("Options", "LogLevel", LOGLEVEL_TRACE));
+
+	// repeats of one message are always counted, LogRate 0 turns rate limit off
+	LogRateLimit(ini.get_uint("Options", "LogRate", LOGGER_RATE), ini.get_uint("Options", "LogBurst", LOGGER_BURST));
+
+	// mapped log survives crash of game without flushing every batch, LogFileSize is MB before it is rotated
+	bool mapped = ini.get_bool("Options", "LogMapped");
+	LogRotation(ini.get_uint("Options", "LogFileSize", LOGGER_FILE_LIMIT), ini.get_uint("Options", "LogFileCount", LOGGER_FILE_COUNT));
+
 	if (con) LogConsole("x360ce", legal_notice);
 	if (file)
 	{
 		char logfilename[MAX_PATH];
-		sprintf_s(logfilename, "x360ce_%s_%u.log", exename.c_str(), GetTickCount());
-		LogFile(logfilename);
+		sprintf_s(logfilename, "x360ce_%s_%u.%s", exename.c_str(), GetTickCount(), binary ? "xlog" : "log");
+		LogFile(logfilename, binary, mapped);
 	}
 
 	PrintLog("Using config file:");
@@ -182,7 +239,15 @@ void ReadConfig()
     if(pHooks)
     {
 		bool override = ini.get_bool("InputHook", "Override");
+		g_bLearnHooks = ini.get_bool("InputHook", "Learn");
         DWORD hookMask = ReadGameDatabase();
+
+        // learned profile is more exact than game database, it is skipped while learning again
+        if(!override && !g_bLearnHooks)
+        {
+            DWORD learnedMask = ReadHookProfile();
+            if(learnedMask) hookMask = learnedMask;
+        }
         if(hookMask && override == false)
         {
             pHooks->SetMask(hookMask);
@@ -225,6 +290,12 @@ void ReadConfig()
 				hookCheck = ini.get_bool("InputHook", "HookNoTimeout");
 				if (hookCheck) pHooks->EnableHook(iHook::HOOK_NOTIMEOUT);
 
+				hookCheck = ini.get_bool("InputHook", "HookNoRetire");
+				if (hookCheck) pHooks->EnableHook(iHook::HOOK_NORETIRE);
+
+				hookCheck = ini.get_bool("InputHook", "HookVTable");
+				if (hookCheck) pHooks->EnableHook(iHook::HOOK_VTBL);
+
                 if(pHooks->GetMask()) pHooks->Enable();
             }
         }
@@ -297,10 +368,16 @@ void ReadPadConfig(DWORD dwUserIndex, const SWIP &ini)
 	device.useforce = ini.get_bool(section, "UseForceFeedback");
 	device.swapmotor = ini.get_bool(section, "SwapMotor");
 	device.ff.type = (int8_t)ini.get_uint(section, "FFBType");
-    device.ff.forcepercent = static_cast<float>(ini.get_uint(section, "ForcePercent",100) * 0.01);
 	device.ff.leftPeriod = ini.get_uint(section, "LeftMotorPeriod", 60);
 	device.ff.rightPeriod = ini.get_uint(section, "RightMotorPeriod", 20);
 
+	// FFB response curves, ForcePercent is folded into the tables
+	uint32_t forcepercent = ini.get_uint(section, "ForcePercent", 100);
+	device.ff.curve[FFB_LEFTMOTOR].Set(ini.get_double(section, "LeftMotorGamma", 1.0), ini.get_uint(section, "LeftMotorDeadZone"),
+		ini.get_uint(section, "LeftMotorMax", 100), forcepercent, ini.get_string(section, "LeftMotorCurve"));
+	device.ff.curve[FFB_RIGHTMOTOR].Set(ini.get_double(section, "RightMotorGamma", 1.0), ini.get_uint(section, "RightMotorDeadZone"),
+		ini.get_uint(section, "RightMotorMax", 100), forcepercent, ini.get_string(section, "RightMotorCurve"));
+
     /* ==================================== Mapping start ============================================*/
 
     // Guide button
@@ -60,10 +60,14 @@ BOOL CALLBACK EnumObjectsCallback( const DIDEVICEOBJECTINSTANCE* pdidoi,VOID* pC
 
 BOOL CALLBACK EnumFFAxesCallback( const DIDEVICEOBJECTINSTANCE* pdidoi,VOID* pContext )
 {
-    DWORD* pdwNumForceFeedbackAxis = (DWORD*) pContext;
+    DInputFFB* ffb = (DInputFFB*) pContext;
 
     if( ((pdidoi->dwFlags & DIDOI_FFACTUATOR) != 0) )
-        (*pdwNumForceFeedbackAxis)++;
+    {
+        if(ffb->axisffbcount < FFB_MAX_ACTUATORS)
+            ffb->actuator[ffb->axisffbcount++] = pdidoi->dwOfs;
+        else return DIENUM_STOP;
+    }
 
     return DIENUM_CONTINUE;
 }
@@ -80,7 +84,7 @@ HRESULT UpdateState(DInputDevice& device)
 
     if(FAILED(hr))
     {
-        PrintLog("[PAD%d] Device Reacquired",device.dwUserIndex+1);
+        LogInfo(LOG_DINPUT, "[PAD%d] Device Reacquired",device.dwUserIndex+1);
         hr = device.device->Acquire();
     }
 
@@ -95,7 +99,7 @@ HRESULT InitDirectInput( HWND hDlg, DInputDevice& device )
 
     if(FAILED(dinput.Init()))
     {
-        PrintLog("DirectInput cannot be initialized");
+        LogError(LOG_DINPUT, "DirectInput cannot be initialized");
         MessageBox(NULL,"DirectInput cannot be initialized","x360ce - Error",MB_ICONERROR);
         ExitProcess(hr);
     }
@@ -108,7 +112,7 @@ HRESULT InitDirectInput( HWND hDlg, DInputDevice& device )
 	std::lock_guard<std::mutex> lock(mutex);
 #endif
 
-    PrintLog("[PAD%d] Creating device",device.dwUserIndex+1);
+    LogInfo(LOG_DINPUT, "[PAD%d] Creating device",device.dwUserIndex+1);
 
     bool bHookDI = false;
     bool bHookSA = false;
@@ -127,7 +131,7 @@ HRESULT InitDirectInput( HWND hDlg, DInputDevice& device )
         hr = dinput.Get()->CreateDevice( device.instanceid,&device.device, NULL );
         if(FAILED(hr))
         {
-			PrintLog("InstanceGUID %s is incorrect trying ProductGUID", GUIDtoStringA(device.instanceid).c_str());
+			LogWarning(LOG_DINPUT, "InstanceGUID %s is incorrect trying ProductGUID", GUIDtoStringA(device.instanceid).c_str());
             hr = dinput.Get()->CreateDevice( device.productid,&device.device, NULL );
         }
     }
@@ -141,7 +145,7 @@ HRESULT InitDirectInput( HWND hDlg, DInputDevice& device )
 			device.passthrough = true;
             return S_OK;
 		}
-        PrintLog("x360ce is misconfigured or device is disconnected");
+        LogError(LOG_DINPUT, "x360ce is misconfigured or device is disconnected");
         int response = MessageBoxA(NULL,"x360ce is misconfigured or device is disconnected","x360ce - Error",MB_CANCELTRYCONTINUE|MB_ICONWARNING|MB_SYSTEMMODAL);
         switch(response)
         {
@@ -156,22 +160,22 @@ HRESULT InitDirectInput( HWND hDlg, DInputDevice& device )
     }
 
     if(!device.device) return ERROR_DEVICE_NOT_CONNECTED;
-    else PrintLog("[PAD%d] Device created",device.dwUserIndex+1);
+    else LogInfo(LOG_DINPUT, "[PAD%d] Device created",device.dwUserIndex+1);
 
     hr = device.device->SetDataFormat( &c_dfDIJoystick2 );
 
-    if(FAILED(hr)) PrintLog("[PAD%d] SetDataFormat failed with code HR = %X", device.dwUserIndex+1, hr);
+    if(FAILED(hr)) LogError(LOG_DINPUT, "[PAD%d] SetDataFormat failed with code HR = %X", device.dwUserIndex+1, hr);
 
     coophr = device.device->SetCooperativeLevel(hDlg, DISCL_EXCLUSIVE | DISCL_BACKGROUND);
-    if(FAILED(coophr)) PrintLog("[PAD%d] SetCooperativeLevel (1) failed with code HR = %X", device.dwUserIndex+1, coophr);
+    if(FAILED(coophr)) LogError(LOG_DINPUT, "[PAD%d] SetCooperativeLevel (1) failed with code HR = %X", device.dwUserIndex+1, coophr);
 
     if(coophr != DI_OK)
     {
-        PrintLog("Device not exclusive acquired, disabling ForceFeedback");
+        LogInfo(LOG_DINPUT, "Device not exclusive acquired, disabling ForceFeedback");
         device.useforce = 0;
 
         coophr = device.device->SetCooperativeLevel(hDlg, DISCL_NONEXCLUSIVE | DISCL_BACKGROUND);
-        if(FAILED(coophr)) PrintLog("[PAD%d] SetCooperativeLevel (2) failed with code HR = %X", device.dwUserIndex+1, coophr);
+        if(FAILED(coophr)) LogError(LOG_DINPUT, "[PAD%d] SetCooperativeLevel (2) failed with code HR = %X", device.dwUserIndex+1, coophr);
     }
 
     dipdw.diph.dwSize = sizeof( DIPROPDWORD );
@@ -182,19 +186,20 @@ HRESULT InitDirectInput( HWND hDlg, DInputDevice& device )
     device.device->SetProperty( DIPROP_AUTOCENTER, &dipdw.diph );
 
     hr = device.device->EnumObjects(EnumObjectsCallback, ( VOID* )&device, DIDFT_AXIS);
-    if(FAILED(hr)) PrintLog("[PAD%d] EnumObjects failed with code HR = %X", device.dwUserIndex+1, hr);
-    else PrintLog("[PAD%d] Detected axis count: %d",device.dwUserIndex+1,device.axiscount);
-
-    hr = device.device->EnumObjects(EnumFFAxesCallback, ( VOID* )&device.ff.axisffbcount, DIDFT_AXIS);
-    if(FAILED(hr)) PrintLog("[PAD%d] EnumFFAxesCallback failed with code HR = %X", device.dwUserIndex+1, hr);
-
+    if(FAILED(hr)) LogError(LOG_DINPUT, "[PAD%d] EnumObjects failed with code HR = %X", device.dwUserIndex+1, hr);
+    else LogInfo(LOG_DINPUT, "[PAD%d] Detected axis count: %d",device.dwUserIndex+1,device.axiscount);
 
-    if( device.ff.axisffbcount > 2 )
-        device.ff.axisffbcount = 2;
+    // device can be initialized again, actuators are collected anew
+    device.ff.axisffbcount = 0;
+    hr = device.device->EnumObjects(EnumFFAxesCallback, ( VOID* )&device.ff, DIDFT_AXIS);
+    if(FAILED(hr)) LogError(LOG_DINPUT, "[PAD%d] EnumFFAxesCallback failed with code HR = %X", device.dwUserIndex+1, hr);
+    else LogInfo(LOG_DINPUT, "[PAD%d] Detected FFB actuator count: %d",device.dwUserIndex+1,device.ff.axisffbcount);
 
     if( device.ff.axisffbcount <= 0 )
         device.useforce = 0;
 
+    device.ff.routing.Build(device.ff.axisffbcount, device.swapmotor);
+
     hr = device.device->Acquire();
 
 	if (bHookSA) pHooks->EnableHook(iHook::HOOK_SA);
@@ -215,13 +220,13 @@ BOOL CALLBACK EnumEffectsCallback(LPCDIEFFECTINFO di, LPVOID pvRef)
     // Pointer to calling device
     ffb->ffbcaps.ConstantForce = DIEFT_GETTYPE(di->dwEffType) == DIEFT_CONSTANTFORCE;
     ffb->ffbcaps.PeriodicForce = DIEFT_GETTYPE(di->dwEffType) == DIEFT_PERIODIC;
-    PrintLog("   Effect '%s'. IsConstant = %d, IsPeriodic = %d", di->tszName, ffb->ffbcaps.ConstantForce, ffb->ffbcaps.PeriodicForce);
+    LogInfo(LOG_DINPUT, "   Effect '%s'. IsConstant = %d, IsPeriodic = %d", di->tszName, ffb->ffbcaps.ConstantForce, ffb->ffbcaps.PeriodicForce);
     return DIENUM_CONTINUE;
 }
 
-HRESULT SetDeviceForces(DInputDevice& device, WORD force, bool motor)
+HRESULT SetDeviceForces(DInputDevice& device, WORD force, uint8_t motor)
 {
-    if(!device.ff.effect[motor]) return E_FAIL;
+    if(motor >= device.ff.routing.GetCount() || !device.ff.effect[motor]) return E_FAIL;
 
     if ( force == 0)
     {
@@ -254,35 +259,34 @@ HRESULT SetDeviceForces(DInputDevice& device, WORD force, bool motor)
     return S_OK;
 }
 
-HRESULT PrepareForce(DInputDevice& device, bool motor)
+HRESULT PrepareForce(DInputDevice& device, uint8_t motor)
 {
-    if(device.ff.effect[motor]) return E_FAIL;
+    if(motor >= device.ff.routing.GetCount() || device.ff.effect[motor]) return E_FAIL;
     if(device.ff.type == 1) return PrepareForceEjocys(device,motor);
     if(device.ff.type == 2) return PrepareForceNew(device,motor);
     return PrepareForceFailsafe(device,motor);
 }
 
-HRESULT SetDeviceForcesFailsafe(DInputDevice& device, WORD force, bool motor)
+HRESULT SetDeviceForcesFailsafe(DInputDevice& device, WORD force, uint8_t motor)
 {
     // Modifying an effect is basically the same as creating a new one, except
     // you need only specify the parameters you are modifying
     HRESULT hr= S_OK;
-    LONG     rglDirection[2] = { 0, 0 };
-    DWORD    rgdwAxes[2]     = { DIJOFS_X, DIJOFS_Y };  // X- and y-axis
+    LONG     rglDirection[1] = { 0 };
 
     DICONSTANTFORCE cf;
 
     LONG magnitude = (LONG)(force/256*256-1);
 
-    rglDirection[0] = motor;
     cf.lMagnitude = magnitude;
 
+    // one effect per actuator, direction of single axis effect is ignored
     DIEFFECT eff;
     ZeroMemory( &eff, sizeof( eff ) );
     eff.dwSize = sizeof( DIEFFECT );
     eff.dwFlags = DIEFF_CARTESIAN | DIEFF_OBJECTOFFSETS;
-    eff.cAxes = device.ff.axisffbcount;
-    eff.rgdwAxes = rgdwAxes;
+    eff.cAxes = 1;
+    eff.rgdwAxes = &device.ff.actuator[motor];
     eff.rglDirection = rglDirection;
     eff.lpEnvelope = 0;
     eff.cbTypeSpecificParams = sizeof( DICONSTANTFORCE );
@@ -294,99 +298,48 @@ HRESULT SetDeviceForcesFailsafe(DInputDevice& device, WORD force, bool motor)
     return hr;
 }
 
-HRESULT PrepareForceFailsafe(DInputDevice& device, bool motor)
+HRESULT PrepareForceFailsafe(DInputDevice& device, uint8_t motor)
 {
-
     HRESULT hr= E_FAIL;
+    LONG rglDirection[1] = { 0 };
 
-    if(motor == 0)
-    {
-        // wLeftMotorSpeed
-
-        DWORD    rgdwAxes[2]     = { DIJOFS_X, DIJOFS_Y };  // X- and y-axis
-        LONG rglDirection[2] = { 0, 0 };
-
-        DICONSTANTFORCE cf;
-        DIEFFECT eff;
-
-        ZeroMemory( &eff, sizeof( eff ) );
-        eff.dwSize = sizeof( DIEFFECT );
-        eff.dwFlags = DIEFF_CARTESIAN | DIEFF_OBJECTOFFSETS;
-        eff.dwDuration = INFINITE;
-        eff.dwSamplePeriod = 0;
-        eff.dwGain = DI_FFNOMINALMAX;
-        eff.dwTriggerButton = DIEB_NOTRIGGER;
-        eff.dwTriggerRepeatInterval = 0;
-        eff.cAxes = device.ff.axisffbcount;
-        eff.rgdwAxes = rgdwAxes;
-        eff.rglDirection = rglDirection;
-        eff.lpEnvelope = 0;
-        eff.cbTypeSpecificParams = sizeof( DICONSTANTFORCE );
-        eff.lpvTypeSpecificParams = &cf;
-        eff.dwStartDelay = 0;
-
-        // Create the prepared effect
-        hr = device.device->CreateEffect(GUID_ConstantForce, &eff, &device.ff.effect[motor] , NULL);
-        if(FAILED(hr))
-        {
-            PrintLog("[PAD%d] CreateEffect (1) failed with code HR = %X", device.dwUserIndex+1, hr);
-            return hr;
-        }
+    DICONSTANTFORCE cf;
+    DIEFFECT eff;
 
-        if( NULL == device.ff.effect[motor] )
-        {
-            PrintLog("g_pEffect is NULL!!!!");
-            return E_FAIL;
-        }
+    ZeroMemory( &eff, sizeof( eff ) );
+    eff.dwSize = sizeof( DIEFFECT );
+    eff.dwFlags = DIEFF_CARTESIAN | DIEFF_OBJECTOFFSETS;
+    eff.dwDuration = INFINITE;
+    eff.dwSamplePeriod = 0;
+    eff.dwGain = DI_FFNOMINALMAX;
+    eff.dwTriggerButton = DIEB_NOTRIGGER;
+    eff.dwTriggerRepeatInterval = 0;
+    eff.cAxes = 1;
+    eff.rgdwAxes = &device.ff.actuator[motor];
+    eff.rglDirection = rglDirection;
+    eff.lpEnvelope = 0;
+    eff.cbTypeSpecificParams = sizeof( DICONSTANTFORCE );
+    eff.lpvTypeSpecificParams = &cf;
+    eff.dwStartDelay = 0;
 
-        return S_OK;
-    }
-    else if(motor ==1)
+    // Create the prepared effect
+    hr = device.device->CreateEffect(GUID_ConstantForce, &eff, &device.ff.effect[motor] , NULL);
+    if(FAILED(hr))
     {
-        DWORD    rgdwAxes[2]     = { DIJOFS_X, DIJOFS_Y };  // X- and y-axis
-        LONG rglDirection[2] = { 0, 0 };
-
-        DICONSTANTFORCE cf;
-        DIEFFECT eff;
-
-        // wRightMotorSpeed
-        ZeroMemory( &eff, sizeof( eff ) );
-        eff.dwSize = sizeof( DIEFFECT );
-        eff.dwFlags = DIEFF_CARTESIAN | DIEFF_OBJECTOFFSETS;
-        eff.dwDuration = INFINITE;
-        eff.dwSamplePeriod = 0;
-        eff.dwGain = DI_FFNOMINALMAX;
-        eff.dwTriggerButton = DIEB_NOTRIGGER;
-        eff.dwTriggerRepeatInterval = 0;
-        eff.cAxes = device.ff.axisffbcount;
-        eff.rgdwAxes = rgdwAxes;
-        eff.rglDirection = rglDirection;
-        eff.lpEnvelope = 0;
-        eff.cbTypeSpecificParams = sizeof( DICONSTANTFORCE );
-        eff.lpvTypeSpecificParams = &cf;
-        eff.dwStartDelay = 0;
-
-        // Create the prepared effect
-        hr = device.device->CreateEffect(GUID_ConstantForce, &eff,& device.ff.effect[motor], NULL);
-        if(FAILED(hr))
-        {
-            PrintLog("[PAD%d] CreateEffect (2) failed with code HR = %X", device.dwUserIndex+1, hr);
-            return hr;
-        }
-
-        if( NULL == device.ff.effect[motor] )
-        {
-            PrintLog("[PAD%d] g_pEffect is NULL!!!!",device.dwUserIndex+1);
-            return E_FAIL;
-        }
+        LogError(LOG_DINPUT, "[PAD%d] CreateEffect (%d) failed with code HR = %X", device.dwUserIndex+1, motor, hr);
+        return hr;
+    }
 
-        return S_OK;
+    if( NULL == device.ff.effect[motor] )
+    {
+        LogError(LOG_DINPUT, "[PAD%d] g_pEffect is NULL!!!!",device.dwUserIndex+1);
+        return E_FAIL;
     }
 
-    return E_FAIL;
+    return S_OK;
 }
 
-HRESULT SetDeviceForcesEjocys(DInputDevice& device, WORD force, bool motor)
+HRESULT SetDeviceForcesEjocys(DInputDevice& device, WORD force, uint8_t motor)
 {
     //// Modifying an effect is basically the same as creating a new one, except
     //// you need only specify the parameters you are modifying
@@ -424,11 +377,11 @@ HRESULT SetDeviceForcesEjocys(DInputDevice& device, WORD force, bool motor)
     //return hr;
     //return S_OK;
 
-    PrintLog("[PAD%d] SetDeviceForces (%d) %d", device.dwUserIndex+1,motor, force);
+    LogDebug(LOG_DINPUT, "[PAD%d] SetDeviceForces (%d) %d", device.dwUserIndex+1,motor, force);
     //[-10000:10000]
     //INT nForce = MulDiv(force, 2 * DI_FFNOMINALMAX, 65535) - DI_FFNOMINALMAX;
     //[0:10000]
-    INT nForce = MulDiv(force, DI_FFNOMINALMAX, 65535);
+    INT nForce = ForceCurve::ToMagnitude(force);
     DWORD period;
 
     // Keep force within bounds
@@ -436,7 +389,7 @@ HRESULT SetDeviceForcesEjocys(DInputDevice& device, WORD force, bool motor)
 
     if( nForce > +DI_FFNOMINALMAX ) nForce = +DI_FFNOMINALMAX;
 
-    if (motor == 0)
+    if (device.ff.routing.GetPrimaryMotor(motor) == FFB_LEFTMOTOR)
     {
         device.ff.xForce = nForce;
         period = 60000;
@@ -451,7 +404,7 @@ HRESULT SetDeviceForcesEjocys(DInputDevice& device, WORD force, bool motor)
     // Constant:  Duration, Gain, TriggerButton, Axes, Direction, Envelope, TypeSpecificParams, StartDelay
     // Sine Wave: Duration, Gain, TriggerButton, Axes, Direction, Envelope, TypeSpecificParams, StartDelay, SamplePeriod
     HRESULT hr = S_OK;
-    LONG rglDirection[2] = { 0, 0 };
+    LONG rglDirection[FFB_MAX_ACTUATORS] = { 0 };
     //PrintLog(_T("[DINPUT]  [PAD%d] SetDeviceForces (%d) !1! HR = %s"), idx+1,motor, DXErrStr(hr));
     DIEFFECT eff;
 
@@ -461,7 +414,8 @@ HRESULT SetDeviceForcesEjocys(DInputDevice& device, WORD force, bool motor)
         ZeroMemory( &eff, sizeof( eff ) );
         eff.dwSize = sizeof( DIEFFECT );
         eff.dwFlags = DIEFF_CARTESIAN | DIEFF_OBJECTOFFSETS;
-        eff.cAxes =  device.ff.axisffbcount;
+        // direction is set for X and Y only
+        eff.cAxes = device.ff.axisffbcount < 2 ? device.ff.axisffbcount : 2;
         eff.lpEnvelope = 0;
         eff.dwStartDelay = 0;
         //eff.cbTypeSpecificParams = sizeof( DICONSTANTFORCE );
@@ -486,7 +440,7 @@ HRESULT SetDeviceForcesEjocys(DInputDevice& device, WORD force, bool motor)
     else
     {
         //PrintLog(_T("[DINPUT]  [PAD%d] SetDeviceForces (%d) !3b! HR = %s"), idx+1,motor, DXErrStr(hr));
-        magnitude = MulDiv(force, DI_FFNOMINALMAX, 65535);
+        magnitude = ForceCurve::ToMagnitude(force);
         // Apply magnitude from both directions
         rglDirection[0] = device.ff.xForce;
         rglDirection[1] = device.ff.yForce;
@@ -520,7 +474,7 @@ HRESULT SetDeviceForcesEjocys(DInputDevice& device, WORD force, bool motor)
         hr = device.ff.effect[motor]->SetParameters(&device.ff.eff[0], DIEP_DIRECTION | DIEP_TYPESPECIFICPARAMS | DIEP_START);
         if(FAILED(hr))
         {
-            PrintLog("[PAD%d] SetDeviceForces (%d) failed with code HR = %X", device.dwUserIndex+1,motor, hr);
+            LogError(LOG_DINPUT, "[PAD%d] SetDeviceForces (%d) failed with code HR = %X", device.dwUserIndex+1,motor, hr);
             return hr;
         };
     }
@@ -533,7 +487,7 @@ HRESULT SetDeviceForcesEjocys(DInputDevice& device, WORD force, bool motor)
 // Name: PrepareDeviceForces()
 // Desc: Prepare force feedback effect.
 //-----------------------------------------------------------------------------
-HRESULT PrepareForceEjocys(DInputDevice& device, bool motor)
+HRESULT PrepareForceEjocys(DInputDevice& device, uint8_t motor)
 {
     //HRESULT hr= E_FAIL;
     //if( NULL == Gamepad[idx].g_pEffect[motor] )
@@ -580,12 +534,13 @@ HRESULT PrepareForceEjocys(DInputDevice& device, bool motor)
     // Constant:  Duration, Gain, TriggerButton, Axes, Direction, Envelope, TypeSpecificParams, StartDelay
     // Sine Wave: Duration, Gain, TriggerButton, Axes, Direction, Envelope, TypeSpecificParams, StartDelay, SamplePeriod
 
-    LONG rglDirection[2] = { 0, 0 };
+    LONG rglDirection[FFB_MAX_ACTUATORS] = { 0 };
     // Create effect
     ZeroMemory( &eff, sizeof( eff ) );
     eff.dwSize = sizeof( DIEFFECT );
     eff.dwFlags = DIEFF_CARTESIAN | DIEFF_OBJECTOFFSETS;
-    eff.cAxes = device.ff.axisffbcount;
+    // direction is set for X and Y only
+    eff.cAxes = device.ff.axisffbcount < 2 ? device.ff.axisffbcount : 2;
     eff.lpEnvelope = 0;
     eff.dwStartDelay = 0;
     eff.cbTypeSpecificParams = sizeof( DIPERIODIC );
@@ -596,24 +551,23 @@ HRESULT PrepareForceEjocys(DInputDevice& device, bool motor)
 
     if (SUCCEEDED(device.device->GetCapabilities(&didcaps)) && (didcaps.dwFlags & DIDC_FORCEFEEDBACK))
     {
-        PrintLog("[PAD%d] PrepareForce (%d) Force Feedback is available", device.dwUserIndex+1,motor);
+        LogInfo(LOG_DINPUT, "[PAD%d] PrepareForce (%d) Force Feedback is available", device.dwUserIndex+1,motor);
     }
     else
     {
-        PrintLog("[PAD%d] PrepareForce (%d) Force Feedback is NOT available", device.dwUserIndex+1,motor);
+        LogInfo(LOG_DINPUT, "[PAD%d] PrepareForce (%d) Force Feedback is NOT available", device.dwUserIndex+1,motor);
     }
 
     // Enumerate effects
     device.device->EnumEffects(&EnumEffectsCallback, &device.ff, DIEFT_ALL);
 
     // This application needs only one effect: Applying raw forces.
-    DWORD rgdwAxes[2] = { DIJOFS_X, DIJOFS_Y };
     eff.dwDuration = INFINITE;
     eff.dwSamplePeriod = 0;
     eff.dwGain = DI_FFNOMINALMAX; // no scaling
     eff.dwTriggerButton = DIEB_NOTRIGGER;
     eff.dwTriggerRepeatInterval = 0;
-    eff.rgdwAxes = rgdwAxes;
+    eff.rgdwAxes = device.ff.actuator;
     eff.rglDirection = rglDirection;
     //eff.lpvTypeSpecificParams = &cf;
     eff.lpvTypeSpecificParams =& device.ff.pf;
@@ -622,7 +576,7 @@ HRESULT PrepareForceEjocys(DInputDevice& device, bool motor)
     HRESULT hr = device.device->CreateEffect(effGuid,&eff,&device.ff.effect[motor],NULL);
     if(FAILED(hr))
     {
-        PrintLog("[DINPUT]  [PAD%d] PrepareForce (%d) failed with code HR = %X", device.dwUserIndex+1,motor, hr);
+        LogError(LOG_DINPUT, "[DINPUT]  [PAD%d] PrepareForce (%d) failed with code HR = %X", device.dwUserIndex+1,motor, hr);
         return hr;
     }
 
@@ -642,7 +596,7 @@ BOOL EffectIsPlaying(DInputDevice& device)
     return TRUE;
 }
 
-HRESULT SetDeviceForcesNew(DInputDevice& device, WORD force, bool motor)
+HRESULT SetDeviceForcesNew(DInputDevice& device, WORD force, uint8_t motor)
 {
     HRESULT hr;
 
@@ -650,10 +604,11 @@ HRESULT SetDeviceForcesNew(DInputDevice& device, WORD force, bool motor)
 
     if(EffectIsPlaying(device)) device.ff.effect[motor]->Stop();
 
-    LONG nForce = MulDiv(force, DI_FFNOMINALMAX, 65535);
+    LONG nForce = ForceCurve::ToMagnitude(force);
     nForce = clamp(nForce,-DI_FFNOMINALMAX,DI_FFNOMINALMAX);
 
-    bool bMotor = device.swapmotor ? !motor : motor;
+    // SwapMotor is already applied by routing matrix
+    uint8_t bMotor = device.ff.routing.GetPrimaryMotor(motor);
 
     if(bMotor == FFB_LEFTMOTOR)
     {
@@ -681,12 +636,12 @@ HRESULT SetDeviceForcesNew(DInputDevice& device, WORD force, bool motor)
     return S_OK;
 }
 
-HRESULT PrepareForceNew(DInputDevice& device, bool motor)
+HRESULT PrepareForceNew(DInputDevice& device, uint8_t motor)
 {
     if(!device.ff.effect[motor])
     {
 
-        LONG rglDirection[2] = { 0, 0 };
+        LONG rglDirection[1] = { 0 };
 
         // Create effect
         ZeroMemory(&device.ff.pf,sizeof(device.ff.pf));
@@ -694,7 +649,7 @@ HRESULT PrepareForceNew(DInputDevice& device, bool motor)
 
         device.ff.eff[motor].dwSize = sizeof( DIEFFECT );
         device.ff.eff[motor].dwFlags = DIEFF_POLAR | DIEFF_OBJECTOFFSETS;
-        device.ff.eff[motor].cAxes = device.ff.axisffbcount;
+        device.ff.eff[motor].cAxes = 1;
         device.ff.eff[motor].lpEnvelope = 0;
         device.ff.eff[motor].dwStartDelay = 0;
         device.ff.eff[motor].cbTypeSpecificParams = sizeof( DIPERIODIC );
@@ -705,42 +660,40 @@ HRESULT PrepareForceNew(DInputDevice& device, bool motor)
 
         if (SUCCEEDED(device.device->GetCapabilities(&didcaps)) && (didcaps.dwFlags & DIDC_FORCEFEEDBACK))
         {
-            PrintLog("[[PAD%d] PrepareForce (%d) Force Feedback is available", device.dwUserIndex+1,motor);
+            LogInfo(LOG_DINPUT, "[[PAD%d] PrepareForce (%d) Force Feedback is available", device.dwUserIndex+1,motor);
         }
         else
         {
-            PrintLog("[PAD%d] PrepareForce (%d) Force Feedback is NOT available", device.dwUserIndex+1,motor);
+            LogInfo(LOG_DINPUT, "[PAD%d] PrepareForce (%d) Force Feedback is NOT available", device.dwUserIndex+1,motor);
         }
 
         // Enumerate effects
         HRESULT hr = device.device->EnumEffects(&EnumEffectsCallback,& device, DIEFT_ALL);
         if (FAILED(hr))
         {
-            PrintLog("[PAD%d] EnumEffectsCallback failed");
+            LogError(LOG_DINPUT, "[PAD%d] EnumEffectsCallback failed");
         }
 
-        DWORD rgdwAxes[2] = { DIJOFS_X, DIJOFS_Y };
         device.ff.eff[motor].dwDuration = INFINITE;
         device.ff.eff[motor].dwSamplePeriod = 0;
         device.ff.eff[motor].dwGain = DI_FFNOMINALMAX;
         device.ff.eff[motor].dwTriggerButton = DIEB_NOTRIGGER;
         device.ff.eff[motor].dwTriggerRepeatInterval = 0;
-        device.ff.eff[motor].rgdwAxes = rgdwAxes;
+        device.ff.eff[motor].rgdwAxes = &device.ff.actuator[motor];
         device.ff.eff[motor].rglDirection = rglDirection;
         device.ff.eff[motor].lpvTypeSpecificParams =& device.ff.rf;
 
         GUID geff;
 
-        if ( motor == FFB_LEFTMOTOR ) geff = GUID_SawtoothDown;
-
-        if ( motor == FFB_RIGHTMOTOR ) geff = GUID_SawtoothUp;
+        if ( device.ff.routing.GetPrimaryMotor(motor) == FFB_LEFTMOTOR ) geff = GUID_SawtoothDown;
+        else geff = GUID_SawtoothUp;
 
         // Create the prepared effect
         hr = device.device->CreateEffect(geff,& device.ff.eff[motor],& device.ff.effect[motor], NULL);
 
         if(FAILED(hr))
         {
-            PrintLog("[PAD%d] PrepareForce (%d) failed with code HR = %X", device.dwUserIndex+1,motor, hr);
+            LogError(LOG_DINPUT, "[PAD%d] PrepareForce (%d) failed with code HR = %X", device.dwUserIndex+1,motor, hr);
             return hr;
         }
 
@@ -22,6 +22,8 @@
 
 #include <dinput.h>
 #include "Config.h"
+#include "ForceCurve.h"
+#include "ForceRouting.h"
 
 #if _MSC_VER < 1700
 #include "mutex.h"
@@ -40,6 +42,7 @@ public:
     DInputFFB()
         :effect()
         ,eff()
+        ,actuator()
         ,pf()
         ,cf()
         ,rf()
@@ -52,20 +55,22 @@ public:
         ,oldPeriod(0)
         ,leftPeriod(0)
         ,rightPeriod(0)
-        ,forcepercent(100)
         ,type(0)
         ,is_created(false)
         ,ffbcaps()
+        ,curve()
+        ,routing()
     {};
 
     virtual ~DInputFFB()
     {
-        if(effect[FFB_LEFTMOTOR]) effect[FFB_LEFTMOTOR]->Release();
-        if(effect[FFB_RIGHTMOTOR]) effect[FFB_RIGHTMOTOR]->Release();
+        for(uint8_t i = 0; i < FFB_MAX_ACTUATORS; ++i)
+            if(effect[i]) effect[i]->Release();
     }
 
-    LPDIRECTINPUTEFFECT effect[2];
-    DIEFFECT eff[2];
+    LPDIRECTINPUTEFFECT effect[FFB_MAX_ACTUATORS];
+    DIEFFECT eff[FFB_MAX_ACTUATORS];
+    DWORD actuator[FFB_MAX_ACTUATORS];
     DIPERIODIC pf;
     DICONSTANTFORCE cf;
     DIRAMPFORCE rf;
@@ -77,7 +82,6 @@ public:
     uint32_t oldPeriod;
     uint32_t leftPeriod;
     uint32_t rightPeriod;
-    float forcepercent;
     uint8_t axisffbcount;
     uint8_t type;
     bool is_created;
@@ -87,6 +91,9 @@ public:
         bool ConstantForce;
         bool PeriodicForce;
     } ffbcaps;
+
+    ForceCurve curve[FFB_MOTORS];
+    ForceRouting routing;
 };
 
 // FIXME
@@ -190,16 +197,16 @@ HRESULT UpdateState(DInputDevice& device);
 WORD EnumPadCount();
 BOOL CALLBACK EnumEffectsCallback(LPCDIEFFECTINFO di, LPVOID pvRef);
 
-HRESULT SetDeviceForces(DInputDevice& device, WORD force, bool motor);
-HRESULT PrepareForce(DInputDevice& device, bool motor);
+HRESULT SetDeviceForces(DInputDevice& device, WORD force, uint8_t motor);
+HRESULT PrepareForce(DInputDevice& device, uint8_t motor);
 
-HRESULT SetDeviceForcesFailsafe(DInputDevice& device, WORD force, bool motor);
-HRESULT PrepareForceFailsafe(DInputDevice& device, bool motor);
+HRESULT SetDeviceForcesFailsafe(DInputDevice& device, WORD force, uint8_t motor);
+HRESULT PrepareForceFailsafe(DInputDevice& device, uint8_t motor);
 
-HRESULT SetDeviceForcesEjocys(DInputDevice& device, WORD force, bool motor);
-HRESULT PrepareForceEjocys(DInputDevice& device, bool motor);
+HRESULT SetDeviceForcesEjocys(DInputDevice& device, WORD force, uint8_t motor);
+HRESULT PrepareForceEjocys(DInputDevice& device, uint8_t motor);
 
-HRESULT SetDeviceForcesNew(DInputDevice& device, WORD force, bool motor);
-HRESULT PrepareForceNew(DInputDevice& device, bool motor);
+HRESULT SetDeviceForcesNew(DInputDevice& device, WORD force, uint8_t motor);
+HRESULT PrepareForceNew(DInputDevice& device, uint8_t motor);
 
 #endif
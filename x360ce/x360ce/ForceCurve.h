@@ -0,0 +1,162 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _FORCECURVE_H_
+#define _FORCECURVE_H_
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <windows.h>
+
+#if defined(_MSC_VER) && _MSC_VER < 1700
+#include "pstdint.h"
+#else
+#include <stdint.h>
+#endif
+
+// Number of curve segments, table is indexed by high byte of motor speed
+#define FORCECURVE_STEPS 256
+#define FORCECURVE_MAXPOINTS 16
+
+// Perceptual response curve for one rumble motor.
+// Curve is evaluated once at config load and stored as table, so XInputSetState
+// only does one lookup and one integer interpolation per motor.
+class ForceCurve
+{
+public:
+	ForceCurve()
+		:m_gamma(1.0)
+		, m_deadzone(0.0)
+		, m_max(1.0)
+		, m_scale(1.0)
+		, m_count(0)
+	{
+		Compile();
+	}
+
+	// gamma - response exponent, <1 lifts weak rumble, >1 softens it
+	// deadzone - input percent below which motor stays off
+	// max - output percent at full input
+	// scale - global ForcePercent
+	// points - optional "in:out,in:out" percent pairs, replaces gamma when set
+	void Set(double gamma, uint32_t deadzone, uint32_t max, uint32_t scale, const std::string& points = std::string())
+	{
+		m_gamma = gamma > 0.0 ? gamma : 1.0;
+		m_deadzone = (deadzone < 100 ? deadzone : 100) * 0.01;
+		m_max = (max < 100 ? max : 100) * 0.01;
+		m_scale = scale * 0.01;
+		ParsePoints(points);
+		Compile();
+	}
+
+	// Reference curve, input and output in range [0:1] before ForcePercent
+	double Evaluate(double x) const
+	{
+		if (x <= 0.0) return 0.0;
+		if (x > 1.0) x = 1.0;
+		if (x <= m_deadzone) return 0.0;
+		if (m_deadzone < 1.0) x = (x - m_deadzone) / (1.0 - m_deadzone);
+
+		double y;
+		if (m_count >= 2)
+		{
+			// flat outside of points, first point may be above 0
+			y = x <= m_in[0] ? m_out[0] : m_out[m_count - 1];
+			for (uint32_t i = 1; i < m_count && x > m_in[0]; ++i)
+			{
+				if (x > m_in[i]) continue;
+				double span = m_in[i] - m_in[i - 1];
+				y = span > 0.0 ? m_out[i - 1] + (m_out[i] - m_out[i - 1]) * (x - m_in[i - 1]) / span : m_out[i];
+				break;
+			}
+		}
+		else y = pow(x, m_gamma);
+
+		return y * m_max;
+	}
+
+	// Motor speed [0:65535] mapped through the curve and ForcePercent
+	inline WORD Map(WORD speed) const
+	{
+		uint32_t idx = speed >> 8;
+		int32_t lo = m_table[idx];
+		int32_t hi = m_table[idx + 1];
+		return static_cast<WORD>(lo + (((hi - lo) * (int32_t)(speed & 0xFF)) >> 8));
+	}
+
+	// Motor speed [0:65535] to DirectInput magnitude [0:DI_FFNOMINALMAX], 16.16 fixed point
+	static inline LONG ToMagnitude(WORD force)
+	{
+		return static_cast<LONG>(((uint32_t)force * 10001u) >> 16);
+	}
+
+	const WORD* GetTable() const
+	{
+		return m_table;
+	}
+
+private:
+	void ParsePoints(const std::string& points)
+	{
+		m_count = 0;
+		const char* p = points.c_str();
+		while (*p && m_count < FORCECURVE_MAXPOINTS)
+		{
+			unsigned int in = 0, out = 0;
+			if (sscanf_s(p, "%u:%u", &in, &out) != 2) break;
+
+			double x = (in < 100 ? in : 100) * 0.01;
+			if (m_count == 0 || x > m_in[m_count - 1])
+			{
+				m_in[m_count] = x;
+				m_out[m_count] = (out < 100 ? out : 100) * 0.01;
+				++m_count;
+			}
+
+			p = strchr(p, ',');
+			if (!p) break;
+			++p;
+		}
+	}
+
+	void Compile()
+	{
+		// one extra entry, so Map can interpolate the last step
+		for (uint32_t i = 0; i <= FORCECURVE_STEPS; ++i)
+		{
+			double y = Evaluate((double)i / FORCECURVE_STEPS) * m_scale * 65535.0 + 0.5;
+			if (y > 65535.0) y = 65535.0;
+			if (y < 0.0) y = 0.0;
+			m_table[i] = static_cast<WORD>(y);
+		}
+	}
+
+	double m_gamma;
+	double m_deadzone;
+	double m_max;
+	double m_scale;
+	double m_in[FORCECURVE_MAXPOINTS];
+	double m_out[FORCECURVE_MAXPOINTS];
+	uint32_t m_count;
+	WORD m_table[FORCECURVE_STEPS + 1];
+};
+
+#endif
@@ -0,0 +1,104 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _FORCEROUTING_H_
+#define _FORCEROUTING_H_
+
+#include <string.h>
+#include <windows.h>
+
+#if defined(_MSC_VER) && _MSC_VER < 1700
+#include "pstdint.h"
+#else
+#include <stdint.h>
+#endif
+
+#include "globals.h"
+#include "ForceCurve.h"
+
+#define FFB_MAX_ACTUATORS 4
+#define FFB_MOTORS 2
+
+// Routing of XInput motors to device actuators.
+// Matrix is built once the actuator count is known and evaluated in 8.8 fixed point on every XInputSetState.
+class ForceRouting
+{
+public:
+	ForceRouting()
+		:m_count(0)
+	{
+		memset(m_weight, 0, sizeof(m_weight));
+	}
+
+	// actuators - number of FFB actuators reported by device
+	// swap - SwapMotor option
+	void Build(uint8_t actuators, bool swap)
+	{
+		m_count = actuators < FFB_MAX_ACTUATORS ? actuators : FFB_MAX_ACTUATORS;
+		memset(m_weight, 0, sizeof(m_weight));
+
+		if (m_count == 1)
+		{
+			// wheels and single actuator pads, both motors are mixed into one effect
+			m_weight[0][FFB_LEFTMOTOR] = 0x100;
+			m_weight[0][FFB_RIGHTMOTOR] = 0x100;
+			return;
+		}
+
+		// left motor drives even actuators, right motor drives odd ones
+		for (uint8_t i = 0; i < m_count; ++i)
+			m_weight[i][(i & 1) ^ (swap ? 1 : 0)] = 0x100;
+	}
+
+	// motors - left and right motor speed, out - force for each actuator
+	inline void Mix(const WORD motors[FFB_MOTORS], WORD out[FFB_MAX_ACTUATORS]) const
+	{
+		for (uint8_t i = 0; i < m_count; ++i)
+		{
+			uint32_t force = (motors[FFB_LEFTMOTOR] * m_weight[i][FFB_LEFTMOTOR] + motors[FFB_RIGHTMOTOR] * m_weight[i][FFB_RIGHTMOTOR]) >> 8;
+			out[i] = static_cast<WORD>(force > 0xFFFF ? 0xFFFF : force);
+		}
+	}
+
+	// XInputSetState motor speeds through curves of both motors and matrix, out - force for each actuator
+	inline void Apply(const ForceCurve curve[FFB_MOTORS], WORD left, WORD right, WORD out[FFB_MAX_ACTUATORS]) const
+	{
+		WORD motors[FFB_MOTORS];
+		motors[FFB_LEFTMOTOR] = curve[FFB_LEFTMOTOR].Map(left);
+		motors[FFB_RIGHTMOTOR] = curve[FFB_RIGHTMOTOR].Map(right);
+		Mix(motors, out);
+	}
+
+	inline uint8_t GetCount() const
+	{
+		return m_count;
+	}
+
+	// Motor with largest weight on actuator, used to choose effect type and period
+	inline uint8_t GetPrimaryMotor(uint8_t actuator) const
+	{
+		return m_weight[actuator][FFB_RIGHTMOTOR] > m_weight[actuator][FFB_LEFTMOTOR] ? FFB_RIGHTMOTOR : FFB_LEFTMOTOR;
+	}
+
+private:
+	uint8_t m_count;
+	uint32_t m_weight[FFB_MAX_ACTUATORS][FFB_MOTORS];
+};
+
+#endif
@@ -0,0 +1,481 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _GAMEPADMAP_H_
+#define _GAMEPADMAP_H_
+
+// Mapping of polled DirectInput state to XInput gamepad. Mapping pass is a template over
+// device, any type with DIJOYSTATE2 like state, dead zone fields and ButtonPressed(index, device)
+// found by argument lookup can be mapped.
+
+#include <windows.h>
+#include <xinput.h>
+#include <math.h>
+#include <stdlib.h>
+
+#if defined(_MSC_VER) && _MSC_VER < 1700
+#include "pstdint.h"
+#else
+#include <stdint.h>
+#endif
+
+#include "globals.h"
+#include "GuideButton.h"
+
+#ifdef _MSC_VER
+// disable C4351 - new behavior: elements of array 'array' will be default initialized
+#pragma warning( disable:4351 )
+#endif
+
+enum MappingType { NONE, DIGITAL, AXIS, SLIDER, HAXIS, HSLIDER, CBUT };
+
+enum PovIDs
+{
+    GAMEPAD_DPAD_UP,
+    GAMEPAD_DPAD_DOWN,
+    GAMEPAD_DPAD_LEFT,
+    GAMEPAD_DPAD_RIGHT
+};
+
+struct AxisMap
+{
+    MappingType analogType; // Type of analog mapping (only NONE, AXIS, and SLIDER are used)
+    int8_t id;
+    int8_t positiveButtonID, negativeButtonID; // button IDs corresponding to the positive/negative directions of the axis
+    bool hasDigital; // Indicates if there is digital input mapped to the axis
+
+    AxisMap()
+    {
+        analogType = NONE;
+        id = 0;
+        positiveButtonID = negativeButtonID = 0;
+        hasDigital = false;
+    }
+};
+struct TriggerMap
+{
+    MappingType type;
+    int8_t id;			// Index for the mapped button/axis/slider
+    int8_t but;
+    TriggerMap()
+    {
+        id = 0;
+        but = 0;
+        type = NONE;
+    }
+};
+
+struct Mapping
+{
+    // Axis indexes are positive or negative numbers, zero is invalid.
+    // All other indexer values start from zero.
+    TriggerMap Trigger[2];
+    AxisMap Axis[4];  // Index of axes to use. Negative index used if it needs to be inverted
+    int32_t pov[4];
+    int8_t Button[10];
+    int8_t guide;
+    int8_t DpadPOV; // Index of POV switch to use for the D-pad
+    bool PovIsButton;
+    Mapping()
+        :Trigger()
+        ,Axis()
+        ,Button()
+    {
+        pov[GAMEPAD_DPAD_UP] = 36000;
+        pov[GAMEPAD_DPAD_DOWN] = 18000;
+        pov[GAMEPAD_DPAD_LEFT] = 27000;
+        pov[GAMEPAD_DPAD_RIGHT] = 9000;
+
+        guide = 0;
+        DpadPOV = 0;
+        PovIsButton = false;
+    }
+};
+
+// Map internal IDs to XInput constants
+static const uint16_t buttonIDs[10] =
+{
+    XINPUT_GAMEPAD_A,
+    XINPUT_GAMEPAD_B,
+    XINPUT_GAMEPAD_X,
+    XINPUT_GAMEPAD_Y,
+    XINPUT_GAMEPAD_LEFT_SHOULDER,
+    XINPUT_GAMEPAD_RIGHT_SHOULDER,
+    XINPUT_GAMEPAD_BACK,
+    XINPUT_GAMEPAD_START,
+    XINPUT_GAMEPAD_LEFT_THUMB,
+    XINPUT_GAMEPAD_RIGHT_THUMB,
+};
+
+static const uint16_t povIDs[4] =
+{
+    XINPUT_GAMEPAD_DPAD_UP,
+    XINPUT_GAMEPAD_DPAD_DOWN,
+    XINPUT_GAMEPAD_DPAD_LEFT,
+    XINPUT_GAMEPAD_DPAD_RIGHT
+};
+
+inline LONG clamp(LONG val, LONG min, LONG max)
+{
+    if (val < min) return min;
+    if (val > max) return max;
+
+    return val;
+}
+
+inline LONG deadzone(LONG val, LONG min, LONG max, LONG lowerDZ, LONG upperDZ)
+{
+    if (val < lowerDZ) return min;
+    if (val > upperDZ) return max;
+
+    return val;
+}
+
+template<typename Device>
+inline bool GuidePressed(const Mapping& mapping, Device& device)
+{
+    // GuideButton is 1-based like other button keys, 0 means not mapped
+    return mapping.guide > 0 && ButtonPressed(mapping.guide-1,device);
+}
+
+// Builds whole gamepad from current device state, guide - set XINPUT_GAMEPAD_GUIDE,
+// it is merged after button word is rebuilt so extended state keeps it
+template<typename Device>
+void MapGamepad(const Mapping& mapping, Device& device, XINPUT_GAMEPAD& gamepad, bool guide)
+{
+    gamepad.wButtons = 0;
+    gamepad.bLeftTrigger = 0;
+    gamepad.bRightTrigger = 0;
+    gamepad.sThumbLX = 0;
+    gamepad.sThumbLY = 0;
+    gamepad.sThumbRX = 0;
+    gamepad.sThumbRY = 0;
+
+    // --- Map buttons ---
+    for (int i = 0; i < 10; ++i)
+    {
+        if (((int)mapping.Button[i] >= 0) && ButtonPressed(mapping.Button[i],device))
+            gamepad.wButtons |= buttonIDs[i];
+    }
+
+    if (guide)
+        gamepad.wButtons |= XINPUT_GAMEPAD_GUIDE;
+
+    // --- Map POV to the D-pad ---
+    if (mapping.DpadPOV > 0 && mapping.PovIsButton == false)
+    {
+        //INT pov = POVState(mapping.DpadPOV,dwUserIndex,Gamepad[dwUserIndex].povrotation);
+
+        int povdeg = device.state.rgdwPOV[mapping.DpadPOV-1];
+        if(povdeg >= 0)
+        {
+            // Up-left, up, up-right, up (at 360 degrees)
+            if (IN_RANGE2(povdeg,mapping.pov[GAMEPAD_DPAD_LEFT]+1,mapping.pov[GAMEPAD_DPAD_UP]) || IN_RANGE2(povdeg,0,mapping.pov[GAMEPAD_DPAD_RIGHT]-1))
+                gamepad.wButtons |= XINPUT_GAMEPAD_DPAD_UP;
+
+            // Up-right, right, down-right
+            if (IN_RANGE(povdeg,0,mapping.pov[GAMEPAD_DPAD_DOWN]))
+                gamepad.wButtons |= XINPUT_GAMEPAD_DPAD_RIGHT;
+
+            // Down-right, down, down-left
+            if (IN_RANGE(povdeg,mapping.pov[GAMEPAD_DPAD_RIGHT],mapping.pov[GAMEPAD_DPAD_LEFT]))
+                gamepad.wButtons |= XINPUT_GAMEPAD_DPAD_DOWN;
+
+            // Down-left, left, up-left
+            if (IN_RANGE(povdeg,mapping.pov[GAMEPAD_DPAD_DOWN],mapping.pov[GAMEPAD_DPAD_UP]))
+                gamepad.wButtons |= XINPUT_GAMEPAD_DPAD_LEFT;
+        }
+    }
+    else if(mapping.PovIsButton == true)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            if (((int)mapping.pov[i] >= 0) && ButtonPressed(mapping.pov[i],device))
+            {
+                gamepad.wButtons |= povIDs[i];
+            }
+        }
+    }
+
+    // Created so we can refer to each axis with an ID
+    LONG axis[] =
+    {
+        device.state.lX,
+        device.state.lY,
+        device.state.lZ,
+        device.state.lRx,
+        device.state.lRy,
+        device.state.lRz,
+        0
+    };
+    LONG slider[] =
+    {
+        device.state.rglSlider[0],
+        device.state.rglSlider[1]
+    };
+
+    // --- Map triggers ---
+    BYTE *targetTrigger[] =
+    {
+        & gamepad.bLeftTrigger,
+        & gamepad.bRightTrigger
+    };
+
+    for (size_t i = 0; i < 2; ++i)
+    {
+        MappingType triggerType = mapping.Trigger[i].type;
+
+        if (triggerType == DIGITAL)
+        {
+            if(ButtonPressed(mapping.Trigger[i].id,device))*(targetTrigger[i]) = 255;
+        }
+        else
+        {
+            LONG *values;
+
+            switch (triggerType)
+            {
+            case AXIS:
+            case HAXIS:
+            case CBUT:
+                values = axis;
+                break;
+
+            case SLIDER:
+            case HSLIDER:
+                values = slider;
+                break;
+
+            default:
+                values = axis;
+                break;
+            }
+
+            LONG v = 0;
+
+            if(mapping.Trigger[i].id > 0) v = values[mapping.Trigger[i].id -1];
+            else v = -values[-mapping.Trigger[i].id -1] - 1;
+
+            /* FIXME: axis negative max should be -32768
+            --- v is the full range (-32767 .. +32767) that should be projected to 0...255
+
+            --- Full ranges
+            AXIS:	(	0 to 255 from -32767 to 32767) using axis
+            SLIDER:	(	0 to 255 from -32767 to 32767) using slider
+            ------------------------------------------------------------------------------
+            --- Half ranges
+            HAXIS:	(	0 to 255 from 0 to 32767) using axis
+            HSLIDER:	(	0 to 255 from 0 to 32767) using slider
+            */
+
+            LONG v2=0;
+            LONG offset=0;
+            LONG scaling=1;
+
+            switch (triggerType)
+            {
+                // Full range
+            case AXIS:
+            case SLIDER:
+                scaling = 255;
+                offset = 32767;
+                break;
+
+                // Half range
+            case HAXIS:
+            case HSLIDER:
+            case CBUT: // add /////////////////////////////////////////////////////////
+                scaling = 127;
+                offset = 0;
+                break;
+
+            default:
+                scaling = 1;
+                offset = 0;
+                break;
+            }
+
+            //v2 = (v + offset) / scaling;
+            // Add deadzones
+            //*(targetTrigger[i]) = (BYTE) deadzone(v2, 0, 255, device.triggerdz, 255);
+
+            /////////////////////////////////////////////////////////////////////////////////////////
+            if (triggerType == CBUT)
+            {
+
+                if (ButtonPressed(mapping.Trigger[0].but,device)
+                        && ButtonPressed(mapping.Trigger[1].but,device))
+                {
+                    *(targetTrigger[0]) = 255;
+                    *(targetTrigger[1]) = 255;
+                }
+
+                if (ButtonPressed(mapping.Trigger[0].but,device)
+                        && !ButtonPressed(mapping.Trigger[1].but,device))
+                {
+                    v2 = (offset-v) / scaling;
+                    *(targetTrigger[0]) = 255;
+                    *(targetTrigger[1]) = 255 - (BYTE) deadzone(v2, 0, 255, device.triggerdz[1], 255);
+                }
+
+                if (!ButtonPressed(mapping.Trigger[0].but,device)
+                        && ButtonPressed(mapping.Trigger[1].but,device))
+                {
+                    v2 = (offset+v) / scaling;
+                    *(targetTrigger[0]) = 255 - (BYTE) deadzone(v2, 0, 255, device.triggerdz[0], 255);
+                    *(targetTrigger[1]) = 255;
+                }
+
+                if (!ButtonPressed(mapping.Trigger[0].but,device)
+                        && !ButtonPressed(mapping.Trigger[1].but,device))
+                {
+                    v2 = (offset+v) / scaling;
+                    *(targetTrigger[i]) = (BYTE) deadzone(v2, 0, 255, device.triggerdz[i], 255);
+                }
+
+            }
+            else
+            {
+                v2 = (offset+v) / scaling;
+                *(targetTrigger[i]) = (BYTE) deadzone(v2, 0, 255, device.triggerdz[i], 255);
+            }
+
+            /////////////////////////////////////////////////////////////////////////////////////////
+        }
+    }
+
+    // --- Map thumbsticks ---
+
+    // Created so we can refer to each axis with an ID
+    SHORT *targetAxis[4] =
+    {
+        & gamepad.sThumbLX,
+        & gamepad.sThumbLY,
+        & gamepad.sThumbRX,
+        & gamepad.sThumbRY
+    };
+
+    // NOTE: Could add symbolic constants as indexers, such as
+    // THUMB_LX_AXIS, THUMB_LX_POSITIVE, THUMB_LX_NEGATIVE
+    if(device.axistodpad==0)
+    {
+
+
+        for (INT i = 0; i < 4; ++i)
+        {
+            LONG *values = axis;
+
+            // Analog input
+            if (mapping.Axis[i].analogType == AXIS) values = axis;
+
+            if (mapping.Axis[i].analogType == SLIDER) values = slider;
+
+            if (mapping.Axis[i].analogType != NONE)
+            {
+
+                if(mapping.Axis[i].id > 0 )
+                {
+                    SHORT val = (SHORT) values[mapping.Axis[i].id - 1];
+                    *(targetAxis[i])= (SHORT) clamp(val,-32767,32767);
+                }
+                else if(mapping.Axis[i].id < 0 )
+                {
+                    SHORT val = (SHORT) -values[-mapping.Axis[i].id - 1];
+                    *(targetAxis[i]) = (SHORT) clamp(val,-32767,32767);
+                }
+            }
+
+            // Digital input, positive direction
+            if (mapping.Axis[i].hasDigital && mapping.Axis[i].positiveButtonID >= 0)
+            {
+
+                if (ButtonPressed(mapping.Axis[i].positiveButtonID,device))
+                    *(targetAxis[i]) = 32767;
+            }
+
+            // Digital input, negative direction
+            if (mapping.Axis[i].hasDigital && mapping.Axis[i].negativeButtonID >= 0)
+            {
+
+                if (ButtonPressed(mapping.Axis[i].negativeButtonID,device))
+                    *(targetAxis[i]) = -32767;
+            }
+        }
+    }
+
+    //WILDS - Axis to D-Pad
+    if(device.axistodpad==1)
+    {
+        //PrintLog("x: %d, y: %d, z: %d",Gamepad[dwUserIndex].state.lX,Gamepad[dwUserIndex].state.lY,Gamepad[dwUserIndex].state.lZ);
+
+        if(device.state.lX - device.a2doffset > device.a2ddeadzone)
+            gamepad.wButtons |= XINPUT_GAMEPAD_DPAD_LEFT;
+
+        if(device.state.lX - device.a2doffset < -device.a2ddeadzone)
+            gamepad.wButtons |= XINPUT_GAMEPAD_DPAD_RIGHT;
+
+        if(device.state.lY - device.a2doffset < -device.a2ddeadzone)
+            gamepad.wButtons |= XINPUT_GAMEPAD_DPAD_UP;
+
+        if(device.state.lY - device.a2doffset > device.a2ddeadzone)
+            gamepad.wButtons |= XINPUT_GAMEPAD_DPAD_DOWN;
+    }
+
+    //WILDS END
+
+    for (int i = 0; i < 4; ++i)
+    {
+
+        if (device.antideadzone[i])
+        {
+            SHORT antidz = device.antideadzone[i];
+            LONG val = *(targetAxis[i]);
+            SHORT direction = val > 0 ? 1 : -1;
+            val = (LONG)(abs(val) / (32767 / (32767 - antidz * 1.0)) + antidz);
+            if (val > 32767) val = 32767;
+
+            if(val == device.antideadzone[i] || val == -device.antideadzone[i]) val = 0;
+
+            *(targetAxis[i]) = (SHORT) (direction * val);
+        }
+
+        if (device.axisdeadzone[i])
+        {
+            SHORT dz = device.axisdeadzone[i];
+            LONG val = *(targetAxis[i]);
+
+            if((val <= dz) && (val >= -dz) ) val = 0;
+
+            *(targetAxis[i]) = (SHORT) clamp(val,-32767,32767);
+        }
+
+        // --- Do Linears ---
+
+        if (device.axislinear[i])
+        {
+
+            SHORT absval = (SHORT)((abs(*(targetAxis[i])) + (((32767.0 / 2.0) - (((abs((abs(*(targetAxis[i]))) - (32767.0 / 2.0)))))) * (device.axislinear[i] * 0.01))));
+            *(targetAxis[i]) = *(targetAxis[i]) > 0 ? absval : -absval;
+        }
+    }
+
+}
+
+#endif
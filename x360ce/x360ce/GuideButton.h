@@ -0,0 +1,202 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _GUIDEBUTTON_H_
+#define _GUIDEBUTTON_H_
+
+#if _MSC_VER < 1700
+#include "mutex.h"
+#else
+#include <mutex>
+#endif
+
+#define XINPUT_GAMEPAD_GUIDE 0x0400
+#define GUIDEWAIT_MAX_PENDING 4
+
+// OVERLAPPED::Internal holds NTSTATUS, GetOverlappedResult and HasOverlappedIoCompleted read it that way
+#define GUIDEWAIT_STATUS_SUCCESS 0x00000000UL
+#define GUIDEWAIT_STATUS_PENDING 0x00000103UL
+#define GUIDEWAIT_STATUS_CANCELLED 0xC0000120UL
+
+// Waiters for guide button of one pad.
+// Poller reports guide state on every XInputGetState, events are touched only when state changes,
+// so blocked waiters use no CPU until button is pressed or wait is canceled.
+class GuideButtonWait
+{
+public:
+	GuideButtonWait()
+		:m_pressed(false)
+		, m_waiters(0)
+		, m_pending()
+		, m_guide(CreateEvent(NULL, TRUE, FALSE, NULL))
+		, m_cancel(CreateEvent(NULL, TRUE, FALSE, NULL))
+		, m_notify(CreateEvent(NULL, FALSE, FALSE, NULL))
+	{
+	}
+
+	virtual ~GuideButtonWait()
+	{
+		Cancel();
+		if (m_guide) CloseHandle(m_guide);
+		if (m_cancel) CloseHandle(m_cancel);
+		if (m_notify) CloseHandle(m_notify);
+	}
+
+	// Called by poller with current guide button state
+	inline void Update(bool pressed)
+	{
+		if (pressed == m_pressed) return;
+
+#if _MSC_VER < 1700
+		lock_guard lock(m_mutex);
+#else
+		std::lock_guard<std::mutex> lock(m_mutex);
+#endif
+		if (pressed == m_pressed) return;
+		m_pressed = pressed;
+
+		if (pressed)
+		{
+			SetEvent(m_guide);
+			CompletePending(GUIDEWAIT_STATUS_SUCCESS);
+		}
+		else ResetEvent(m_guide);
+	}
+
+	// Event signaled by DirectInput when device state changes, see IDirectInputDevice8::SetEventNotification
+	HANDLE GetNotifyEvent() const
+	{
+		return m_notify;
+	}
+
+	// Blocks until guide button is pressed or wait is canceled.
+	// Callback polls device when DirectInput reports new data, so wait does not depend on game calling XInputGetState.
+	template<typename PollCallback>
+	DWORD Wait(PollCallback poll)
+	{
+		InterlockedIncrement(&m_waiters);
+
+		HANDLE handles[] = { m_cancel, m_guide, m_notify };
+		DWORD ret = ERROR_SUCCESS;
+
+		for (;;)
+		{
+			DWORD result = WaitForMultipleObjects(_countof(handles), handles, FALSE, INFINITE);
+
+			if (result == WAIT_OBJECT_0)
+			{
+				ret = ERROR_CANCELLED;
+				break;
+			}
+			if (result == WAIT_OBJECT_0 + 1)
+			{
+				ret = ERROR_SUCCESS;
+				break;
+			}
+			if (result == WAIT_OBJECT_0 + 2)
+			{
+				poll();
+				continue;
+			}
+
+			ret = GetLastError();
+			break;
+		}
+
+		// last waiter leaving rearms cancel event
+		if (InterlockedDecrement(&m_waiters) == 0) ResetEvent(m_cancel);
+		return ret;
+	}
+
+	// Queues overlapped wait, completed by poller or by Cancel
+	DWORD WaitAsync(LPOVERLAPPED pOverlapped)
+	{
+		if (!pOverlapped) return ERROR_BAD_ARGUMENTS;
+
+#if _MSC_VER < 1700
+		lock_guard lock(m_mutex);
+#else
+		std::lock_guard<std::mutex> lock(m_mutex);
+#endif
+		if (m_pressed)
+		{
+			Complete(pOverlapped, GUIDEWAIT_STATUS_SUCCESS);
+			return ERROR_SUCCESS;
+		}
+
+		for (uint32_t i = 0; i < GUIDEWAIT_MAX_PENDING; ++i)
+		{
+			if (m_pending[i]) continue;
+
+			pOverlapped->Internal = GUIDEWAIT_STATUS_PENDING;
+			pOverlapped->InternalHigh = 0;
+			if (pOverlapped->hEvent) ResetEvent(pOverlapped->hEvent);
+			m_pending[i] = pOverlapped;
+			return ERROR_IO_PENDING;
+		}
+
+		return ERROR_BUSY;
+	}
+
+	// Wakes all blocking waiters and completes overlapped waits as canceled, GetOverlappedResult gives ERROR_OPERATION_ABORTED
+	void Cancel()
+	{
+#if _MSC_VER < 1700
+		lock_guard lock(m_mutex);
+#else
+		std::lock_guard<std::mutex> lock(m_mutex);
+#endif
+		if (m_waiters) SetEvent(m_cancel);
+		CompletePending(GUIDEWAIT_STATUS_CANCELLED);
+	}
+
+private:
+	// status - NTSTATUS of completed wait
+	static inline void Complete(LPOVERLAPPED pOverlapped, ULONG_PTR status)
+	{
+		pOverlapped->InternalHigh = 0;
+		pOverlapped->Internal = status;
+		if (pOverlapped->hEvent) SetEvent(pOverlapped->hEvent);
+	}
+
+	void CompletePending(ULONG_PTR status)
+	{
+		for (uint32_t i = 0; i < GUIDEWAIT_MAX_PENDING; ++i)
+		{
+			if (!m_pending[i]) continue;
+			Complete(m_pending[i], status);
+			m_pending[i] = NULL;
+		}
+	}
+
+#if _MSC_VER < 1700
+	recursive_mutex m_mutex;
+#else
+	std::mutex m_mutex;
+#endif
+
+	volatile bool m_pressed;
+	volatile LONG m_waiters;
+	LPOVERLAPPED m_pending[GUIDEWAIT_MAX_PENDING];
+	HANDLE m_guide;
+	HANDLE m_cancel;
+	HANDLE m_notify;
+};
+
+#endif
@@ -0,0 +1,384 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _DEVICEID_H_
+#define _DEVICEID_H_
+
+// Device instance ID parsing and rewriting for WMI and SetupApi hooks.
+// No allocations and no Windows calls, everything works on caller buffers.
+
+#include <stddef.h>
+#include <string.h>
+#include <wchar.h>
+
+#if defined(_MSC_VER) && _MSC_VER < 1700
+#include "pstdint.h"
+#else
+#include <stdint.h>
+#endif
+
+#define DEVICEID_MAX_LENGTH 260
+#define DEVICEID_CACHE_SIZE 16
+#define DEVICEID_MAX_PROPERTY 32
+
+enum DeviceIdBus
+{
+	DEVICEID_BUS_NONE,
+	DEVICEID_BUS_USB,		// "USB\" or "root\", rewritten as USB
+	DEVICEID_BUS_HID
+};
+
+enum DeviceIdProperty
+{
+	DEVICEID_PROPERTY_NONE,
+	DEVICEID_PROPERTY_INSTANCE,	// "BUS\VID_vvvv&PID_pppp\instance"
+	DEVICEID_PROPERTY_HARDWARE	// "BUS\VID_vvvv&PID_pppp&REV_rrrr", no instance part
+};
+
+struct DeviceId
+{
+	uint16_t vid;
+	uint16_t pid;
+	DeviceIdBus bus;
+	const wchar_t* suffix;	// last '\' and everything after it, NULL when there is none
+};
+
+inline int DeviceIdHexDigit(wchar_t c)
+{
+	if (c >= L'0' && c <= L'9') return c - L'0';
+	if (c >= L'A' && c <= L'F') return c - L'A' + 10;
+	if (c >= L'a' && c <= L'f') return c - L'a' + 10;
+	return -1;
+}
+
+// Reads up to 4 hex digits like "%4X", returns number of digits read
+inline size_t DeviceIdParseHex(const wchar_t* str, uint16_t* value)
+{
+	uint16_t result = 0;
+	size_t i = 0;
+	for (; i < 4; ++i)
+	{
+		int digit = DeviceIdHexDigit(str[i]);
+		if (digit < 0) break;
+		result = static_cast<uint16_t>((result << 4) | digit);
+	}
+	if (i) *value = result;
+	return i;
+}
+
+inline bool DeviceIdMatch(const wchar_t* str, const wchar_t* token, size_t length)
+{
+	return wcsncmp(str, token, length) == 0;
+}
+
+// Single pass over instance ID, records first occurrence of every token like wcsstr did.
+// ouya - accept "VID&xxxxvvvv" and "PID&pppp" forms when "VID_" and "PID_" are missing
+inline bool ParseDeviceId(const wchar_t* str, bool ouya, DeviceId* id)
+{
+	const wchar_t* vid = NULL;
+	const wchar_t* vidamp = NULL;
+	const wchar_t* pid = NULL;
+	const wchar_t* pidamp = NULL;
+	bool usb = false;
+	bool hid = false;
+
+	id->suffix = NULL;
+
+	for (const wchar_t* p = str; *p; ++p)
+	{
+		switch (*p)
+		{
+		case L'V':
+			if (p[1] == L'I' && p[2] == L'D')
+			{
+				if (!vid && p[3] == L'_') vid = p + 4;
+				else if (!vidamp && p[3] == L'&') vidamp = p + 4;
+			}
+			break;
+		case L'P':
+			if (p[1] == L'I' && p[2] == L'D')
+			{
+				if (!pid && p[3] == L'_') pid = p + 4;
+				else if (!pidamp && p[3] == L'&') pidamp = p + 4;
+			}
+			break;
+		case L'U':
+			if (!usb && DeviceIdMatch(p, L"USB\\", 4)) usb = true;
+			break;
+		case L'r':
+			if (!usb && DeviceIdMatch(p, L"root\\", 5)) usb = true;
+			break;
+		case L'H':
+			if (!hid && DeviceIdMatch(p, L"HID\\", 4)) hid = true;
+			break;
+		case L'\\':
+			id->suffix = p;
+			break;
+		}
+	}
+
+	if (!vid || !DeviceIdParseHex(vid, &id->vid))
+	{
+		// OUYA style, first hex group is skipped
+		if (!ouya || !vidamp) return false;
+		size_t skip = DeviceIdParseHex(vidamp, &id->vid);
+		if (!skip) return false;
+		id->vid = 0;
+		DeviceIdParseHex(vidamp + skip, &id->vid);
+	}
+
+	if (!pid || !DeviceIdParseHex(pid, &id->pid))
+	{
+		if (!ouya || !pidamp || !DeviceIdParseHex(pidamp, &id->pid)) return false;
+	}
+
+	id->bus = usb ? DEVICEID_BUS_USB : hid ? DEVICEID_BUS_HID : DEVICEID_BUS_NONE;
+	return true;
+}
+
+// Case insensitive FNV-1a of ASCII property name, 0 when name is too long to be one of ours
+inline uint32_t DevicePropertyHash(const wchar_t* name)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; name[i]; ++i)
+	{
+		if (i == DEVICEID_MAX_PROPERTY) return 0;
+		wchar_t c = name[i];
+		if (c >= L'a' && c <= L'z') c -= L'a' - L'A';
+		hash ^= static_cast<uint32_t>(c);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// Case insensitive compare of ASCII property names
+inline bool DevicePropertyEqual(const wchar_t* a, const wchar_t* b)
+{
+	for (;; ++a, ++b)
+	{
+		wchar_t ca = *a;
+		wchar_t cb = *b;
+		if (ca >= L'a' && ca <= L'z') ca -= L'a' - L'A';
+		if (cb >= L'a' && cb <= L'z') cb -= L'a' - L'A';
+		if (ca != cb) return false;
+		if (!ca) return true;
+	}
+}
+
+// WMI properties that can hold device ID, checked before any value is scanned.
+// Win32_PnPEntity has DeviceID, PNPDeviceID and string arrays HardwareID and CompatibleID,
+// Win32_PnPSignedDriver has DeviceID and single strings HardWareID and CompatID.
+// Hashes are DevicePropertyHash of names, hash match is confirmed with string compare.
+inline DeviceIdProperty GetDeviceIdProperty(const wchar_t* name)
+{
+	static const struct
+	{
+		uint32_t hash;
+		const wchar_t* name;
+		DeviceIdProperty kind;
+	} properties[] =
+	{
+		{ 0x6EB81DFEu, L"DeviceID", DEVICEID_PROPERTY_INSTANCE },
+		{ 0x0F25407Au, L"PNPDeviceID", DEVICEID_PROPERTY_INSTANCE },
+		{ 0xF7E8CE7Cu, L"HardWareID", DEVICEID_PROPERTY_HARDWARE },
+		{ 0x294A0CBEu, L"CompatibleID", DEVICEID_PROPERTY_HARDWARE },
+		{ 0x3ABCAAB2u, L"CompatID", DEVICEID_PROPERTY_HARDWARE }
+	};
+
+	if (!name) return DEVICEID_PROPERTY_NONE;
+
+	uint32_t hash = DevicePropertyHash(name);
+	if (!hash) return DEVICEID_PROPERTY_NONE;
+
+	for (size_t i = 0; i < sizeof(properties) / sizeof(properties[0]); ++i)
+	{
+		if (properties[i].hash == hash && DevicePropertyEqual(name, properties[i].name)) return properties[i].kind;
+	}
+	return DEVICEID_PROPERTY_NONE;
+}
+
+inline bool IsDeviceIdProperty(const wchar_t* name)
+{
+	return GetDeviceIdProperty(name) != DEVICEID_PROPERTY_NONE;
+}
+
+// Writes value as 4 uppercase hex digits like "%04X"
+inline wchar_t* DeviceIdWriteHex(wchar_t* w, uint16_t value)
+{
+	static const wchar_t hex[] = L"0123456789ABCDEF";
+	for (int shift = 12; shift >= 0; shift -= 4) *w++ = hex[(value >> shift) & 0xF];
+	return w;
+}
+
+// Writes "BUS\VID_vvvv&PID_pppp&IG_nn\suffix", same as
+// swprintf_s(out, L"USB\\VID_%04X&PID_%04X&IG_%02d%s", vid, pid, userindex, suffix)
+// Returns length without terminator, 0 when bus is unknown or output does not fit.
+inline size_t FormatDeviceId(wchar_t* out, size_t size, const DeviceId& id, uint16_t vid, uint16_t pid, uint32_t userindex)
+{
+	const wchar_t* bus;
+	if (id.bus == DEVICEID_BUS_USB) bus = L"USB\\VID_";
+	else if (id.bus == DEVICEID_BUS_HID) bus = L"HID\\VID_";
+	else return 0;
+
+	wchar_t digits[10];
+	size_t ndigits = 0;
+	do
+	{
+		digits[ndigits++] = static_cast<wchar_t>(L'0' + userindex % 10);
+		userindex /= 10;
+	} while (userindex);
+	if (ndigits < 2) digits[ndigits++] = L'0';
+
+	size_t suffixlen = id.suffix ? wcslen(id.suffix) : 0;
+	size_t length = 8 + 4 + 5 + 4 + 4 + ndigits + suffixlen;
+	if (length + 1 > size) return 0;
+
+	wchar_t* w = out;
+	memcpy(w, bus, 8 * sizeof(wchar_t));
+	w += 8;
+	w = DeviceIdWriteHex(w, vid);
+	memcpy(w, L"&PID_", 5 * sizeof(wchar_t));
+	w += 5;
+	w = DeviceIdWriteHex(w, pid);
+	memcpy(w, L"&IG_", 4 * sizeof(wchar_t));
+	w += 4;
+	while (ndigits) *w++ = digits[--ndigits];
+	if (suffixlen) memcpy(w, id.suffix, suffixlen * sizeof(wchar_t));
+	w += suffixlen;
+	*w = L'\0';
+
+	return length;
+}
+
+// Copies hardware or compatible ID like "USB\VID_045E&PID_028E&REV_0114" with digits of its first
+// "VID_vvvv" and "PID_pppp" replaced, everything else is kept. These IDs have no instance part,
+// so FormatDeviceId would take the bus and IDs for suffix.
+// Returns length without terminator, 0 when str has no such tokens or output does not fit.
+inline size_t ReplaceDeviceIdPidVid(wchar_t* out, size_t size, const wchar_t* str, uint16_t vid, uint16_t pid)
+{
+	const wchar_t* vidpos = NULL;
+	const wchar_t* pidpos = NULL;
+	uint16_t value;
+
+	const wchar_t* p = str;
+	for (; *p; ++p)
+	{
+		if (!vidpos && DeviceIdMatch(p, L"VID_", 4) && DeviceIdParseHex(p + 4, &value) == 4) vidpos = p + 4;
+		else if (!pidpos && DeviceIdMatch(p, L"PID_", 4) && DeviceIdParseHex(p + 4, &value) == 4) pidpos = p + 4;
+	}
+	if (!vidpos || !pidpos) return 0;
+
+	size_t length = p - str;
+	if (length + 1 > size) return 0;
+
+	memcpy(out, str, (length + 1) * sizeof(wchar_t));
+	DeviceIdWriteHex(out + (vidpos - str), vid);
+	DeviceIdWriteHex(out + (pidpos - str), pid);
+	return length;
+}
+
+// Memo of rewritten instance IDs, games read the same few IDs over and over.
+// Result 0 is cached too, so IDs of other devices are rejected without parsing,
+// but not when it only means the output buffer was too small.
+// Not thread safe, caller holds the lock.
+class DeviceIdCache
+{
+public:
+	DeviceIdCache()
+		:m_next(0)
+	{
+		memset(m_entries, 0, sizeof(m_entries));
+	}
+
+	// tag - anything else result depends on, like hook flags
+	bool Find(const wchar_t* str, uint32_t tag, wchar_t* out, size_t size, size_t* length) const
+	{
+		size_t inlen;
+		uint32_t hash = Hash(str, &inlen);
+
+		for (size_t i = 0; i < DEVICEID_CACHE_SIZE; ++i)
+		{
+			const Entry& entry = m_entries[i];
+			if (!entry.used || entry.hash != hash || entry.tag != tag || entry.inlen != inlen) continue;
+			if (memcmp(entry.in, str, inlen * sizeof(wchar_t)) != 0) continue;
+
+			if (entry.outlen + 1 > size) return false;
+			memcpy(out, entry.out, (entry.outlen + 1) * sizeof(wchar_t));
+			*length = entry.outlen;
+			return true;
+		}
+		return false;
+	}
+
+	void Store(const wchar_t* str, uint32_t tag, const wchar_t* out, size_t length)
+	{
+		size_t inlen;
+		uint32_t hash = Hash(str, &inlen);
+		if (inlen >= DEVICEID_MAX_LENGTH || length >= DEVICEID_MAX_LENGTH) return;
+
+		Entry& entry = m_entries[m_next];
+		m_next = (m_next + 1) % DEVICEID_CACHE_SIZE;
+
+		entry.used = true;
+		entry.hash = hash;
+		entry.tag = tag;
+		entry.inlen = inlen;
+		entry.outlen = length;
+		memcpy(entry.in, str, inlen * sizeof(wchar_t));
+		if (length) memcpy(entry.out, out, length * sizeof(wchar_t));
+		entry.out[length] = L'\0';
+	}
+
+	void Clear()
+	{
+		memset(m_entries, 0, sizeof(m_entries));
+		m_next = 0;
+	}
+
+private:
+	// FNV-1a
+	static inline uint32_t Hash(const wchar_t* str, size_t* length)
+	{
+		uint32_t hash = 2166136261u;
+		const wchar_t* p = str;
+		for (; *p; ++p)
+		{
+			hash ^= static_cast<uint32_t>(*p);
+			hash *= 16777619u;
+		}
+		*length = p - str;
+		return hash;
+	}
+
+	struct Entry
+	{
+		bool used;
+		uint32_t hash;
+		uint32_t tag;
+		size_t inlen;
+		size_t outlen;
+		wchar_t in[DEVICEID_MAX_LENGTH];
+		wchar_t out[DEVICEID_MAX_LENGTH];
+	};
+
+	Entry m_entries[DEVICEID_CACHE_SIZE];
+	size_t m_next;
+};
+
+#endif
@@ -74,6 +74,9 @@ typedef HRESULT ( STDMETHODCALLTYPE *Next_t )(
     /* [length_is][size_is][out] */ __RPC__out_ecount_part(uCount, *puReturned) IWbemClassObject **apObjects,
     /* [out] */ __RPC__out ULONG *puReturned);
 
+typedef ULONG ( STDMETHODCALLTYPE *Release_t )(
+    IEnumWbemClassObject * This);
+
 typedef HRESULT ( STDMETHODCALLTYPE *Get_t )(
     IWbemClassObject * This,
     /* [std::string][in] */ LPCWSTR wszName,
@@ -85,6 +88,7 @@ typedef HRESULT ( STDMETHODCALLTYPE *Get_t )(
 ConnectServer_t hConnectServer = NULL;
 CreateInstanceEnum_t hCreateInstanceEnum = NULL;
 Next_t hNext = NULL;
+Release_t hRelease = NULL;
 Get_t hGet = NULL;
 
 CoUninitialize_t oCoUninitialize = NULL;
@@ -92,8 +96,93 @@ CoCreateInstance_t oCoCreateInstance = NULL;
 ConnectServer_t oConnectServer = NULL;
 CreateInstanceEnum_t oCreateInstanceEnum = NULL;
 Next_t oNext = NULL;
+Release_t oRelease = NULL;
 Get_t oGet = NULL;
 
+static iHookStat StatCoCreateInstance("CoCreateInstance", iHook::HOOK_COM);
+static iHookStat StatCoUninitialize("CoUninitialize", iHook::HOOK_COM);
+static iHookStat StatConnectServer("ConnectServer", iHook::HOOK_COM);
+static iHookStat StatCreateInstanceEnum("CreateInstanceEnum", iHook::HOOK_COM);
+static iHookStat StatNext("Next", iHook::HOOK_COM);
+static iHookStat StatRelease("Release", iHook::HOOK_COM);
+static iHookStat StatGet("Get", iHook::HOOK_COM);
+
+// Set when Next reached end of enumeration, WMI hooks are retired on following CoUninitialize
+static volatile LONG WmiEnumerated = FALSE;
+
+// Enumerators of classes whose objects carry device IDs, Next of any other enumerator is passed through.
+// Slot is freed when enumeration ends or enumerator is released, when all slots are busy one is reused round robin (size must be power of two).
+#define WMI_MAX_ENUMS 16
+static IEnumWbemClassObject* volatile WmiEnums[WMI_MAX_ENUMS] = { 0 };
+static volatile LONG WmiEnumNext = 0;
+
+static bool IsDeviceClass(const BSTR strFilter)
+{
+    static const wchar_t* const classes[] = { L"Win32_PnPEntity", L"Win32_PnPSignedDriver" };
+
+    if(!strFilter) return false;
+    for(size_t i = 0; i < _countof(classes); ++i)
+    {
+        if(_wcsicmp(strFilter, classes[i]) == 0) return true;
+    }
+    return false;
+}
+
+static void TrackEnum(IEnumWbemClassObject* pEnum)
+{
+    for(LONG i = 0; i < WMI_MAX_ENUMS; ++i)
+    {
+        if(WmiEnums[i] == pEnum) return;
+    }
+    for(LONG i = 0; i < WMI_MAX_ENUMS; ++i)
+    {
+        if(!InterlockedCompareExchangePointer(reinterpret_cast<PVOID volatile*>(&WmiEnums[i]), pEnum, NULL)) return;
+    }
+    LONG slot = InterlockedIncrement(&WmiEnumNext) & (WMI_MAX_ENUMS - 1);
+    InterlockedExchangePointer(reinterpret_cast<PVOID volatile*>(&WmiEnums[slot]), pEnum);
+}
+
+static bool IsTrackedEnum(IEnumWbemClassObject* pEnum)
+{
+    for(LONG i = 0; i < WMI_MAX_ENUMS; ++i)
+    {
+        if(WmiEnums[i] == pEnum) return true;
+    }
+    return false;
+}
+
+static void UntrackEnum(IEnumWbemClassObject* pEnum)
+{
+    for(LONG i = 0; i < WMI_MAX_ENUMS; ++i)
+    {
+        InterlockedCompareExchangePointer(reinterpret_cast<PVOID volatile*>(&WmiEnums[i]), NULL, pEnum);
+    }
+}
+
+static void UntrackAllEnums()
+{
+    for(LONG i = 0; i < WMI_MAX_ENUMS; ++i)
+    {
+        InterlockedExchangePointer(reinterpret_cast<PVOID volatile*>(&WmiEnums[i]), NULL);
+    }
+}
+
+// hardware - HardwareID and CompatibleID values, they have no instance part
+static bool RewriteDeviceIdString(BSTR* pStr, bool hardware)
+{
+    OLECHAR tempstr[MAX_PATH];
+
+    size_t length = hardware ? iHookThis->RewriteHardwareId(*pStr, tempstr, MAX_PATH)
+        : iHookThis->RewriteDeviceId(*pStr, true, tempstr, MAX_PATH);
+    if(!length) return false;
+
+    LogInfo(LOG_HOOKCOM, "%s","Device string change:");
+    LogInfo(LOG_HOOKCOM, "%ls",*pStr);
+    SysReAllocString(pStr,tempstr);
+    LogInfo(LOG_HOOKCOM, "%ls",*pStr);
+    return true;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -106,77 +195,48 @@ HRESULT STDMETHODCALLTYPE HookGet(
     /* [unique][in][out] */ CIMTYPE *pType,
     /* [unique][in][out] */ long *plFlavor)
 {
+    iHookCounter counter(StatGet);
     HRESULT hr = oGet(This,wszName,lFlags,pVal,pType,plFlavor);
 
     if(!iHookThis->GetState(iHook::HOOK_COM)) return hr;
+    if(hr != NO_ERROR) return hr;
 
-    PrintLog("*Gets*");
+    DeviceIdProperty property = GetDeviceIdProperty(wszName);
+    if(property == DEVICEID_PROPERTY_NONE) return hr;
+    bool hardware = property == DEVICEID_PROPERTY_HARDWARE;
 
-    if(hr != NO_ERROR) return hr;
+    LogDebug(LOG_HOOKCOM, "*Gets*");
 
     //PrintLog( "wszName %ls pVal->vt %d pType %d", wszName, pVal->vt, &pType);
     //if( pVal->vt == VT_BSTR) PrintLog( L"%s",pVal->bstrVal);
 
+    bool rewritten = false;
+
     if( pVal->vt == VT_BSTR && pVal->bstrVal != NULL )
     {
         //PrintLog( "  Got device ID '%ls'", pVal->bstrVal);
-        DWORD dwPid = 0, dwVid = 0, dummy;
-
-        OLECHAR* strVid = wcsstr( pVal->bstrVal, L"VID_" );
-        if(!strVid || swscanf_s( strVid, L"VID_%4X", &dwVid ) < 1 ) {
-		// Fallback VID match for OUYA style device IDs
-		strVid = wcsstr(pVal->bstrVal, L"VID&");
-		if (!strVid || swscanf_s(strVid, L"VID&%4X%4X", &dummy, &dwVid) < 1)
-			return hr;
- 		}
-
-        OLECHAR* strPid = wcsstr( pVal->bstrVal, L"PID_" );
-        if(!strPid || swscanf_s( strPid, L"PID_%4X", &dwPid ) < 1 ) {
-		// Fallback PID match for OUYA style device IDs
-		strPid = wcsstr(pVal->bstrVal, L"PID&");
-		if (!strPid || swscanf_s(strPid, L"PID&%4X", &dwPid) < 1)
-			return hr;
- 		}
-
-		for(auto padcfg = iHookThis->begin(); padcfg != iHookThis->end(); ++padcfg)
+        rewritten = RewriteDeviceIdString(&pVal->bstrVal, hardware);
+    }
+    else if( pVal->vt == (VT_ARRAY | VT_BSTR) && pVal->parray != NULL && pVal->parray->cDims == 1 )
+    {
+        // HardwareID and CompatibleID of Win32_PnPEntity are string arrays
+        BSTR* strings = NULL;
+        if(SUCCEEDED(SafeArrayAccessData(pVal->parray, reinterpret_cast<void**>(&strings))))
         {
-            if(padcfg->GetHookState() && padcfg->GetProductPIDVID() == (DWORD)MAKELONG(dwVid,dwPid))
+            for(ULONG i = 0; i < pVal->parray->rgsabound[0].cElements; ++i)
             {
-                const wchar_t* strUSB = wcsstr( pVal->bstrVal, L"USB\\" );
-				const wchar_t* strRoot = wcsstr( pVal->bstrVal, L"root\\" );
-                OLECHAR tempstr[MAX_PATH];
-
-                DWORD dwHookVid = iHookThis->GetState(iHook::HOOK_PIDVID) ? LOWORD(iHookThis->GetFakePIDVID()) : LOWORD(padcfg->GetProductPIDVID());
-                DWORD dwHookPid = iHookThis->GetState(iHook::HOOK_PIDVID) ? HIWORD(iHookThis->GetFakePIDVID()) : HIWORD(padcfg->GetProductPIDVID());
-
-                if(strUSB || strRoot)
-                {
-                    PrintLog("%s","Device string change:");
-                    PrintLog("%ls",pVal->bstrVal);
-                    const wchar_t* p = wcsrchr(pVal->bstrVal,L'\\');
-					if(p) swprintf_s(tempstr,L"USB\\VID_%04X&PID_%04X&IG_%02d%s",dwHookVid,dwHookPid, padcfg->GetUserIndex(), p );
-					else swprintf_s(tempstr,L"USB\\VID_%04X&PID_%04X&IG_%02d",dwHookVid,dwHookPid, padcfg->GetUserIndex() );
-                    SysReAllocString(&pVal->bstrVal,tempstr);
-                    PrintLog("%ls",pVal->bstrVal);
-                    continue;
-                }
-
-                OLECHAR* strHID = wcsstr( pVal->bstrVal, L"HID\\" );
-
-                if(strHID)
-                {
-                    PrintLog("%s","Device string change:");
-                    PrintLog("%ls",pVal->bstrVal);
-                    OLECHAR* p = wcsrchr(pVal->bstrVal,L'\\');
-                    swprintf_s(tempstr,L"HID\\VID_%04X&PID_%04X&IG_%02d%s",dwHookVid,dwHookPid, padcfg->GetUserIndex(), p );
-                    SysReAllocString(&pVal->bstrVal,tempstr);
-                    PrintLog("%ls",pVal->bstrVal);
-                    continue;
-                }
+                if(strings[i] && RewriteDeviceIdString(&strings[i], hardware)) rewritten = true;
             }
+            SafeArrayUnaccessData(pVal->parray);
         }
     }
 
+    if(rewritten)
+    {
+        iHookThis->MarkUseful(iHook::HOOK_COM);
+        if(iHookThis->GetState(iHook::HOOK_PIDVID)) iHookThis->MarkUseful(iHook::HOOK_PIDVID);
+    }
+
     return hr;
 }
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -189,14 +249,22 @@ HRESULT STDMETHODCALLTYPE HookNext(
     /* [length_is][size_is][out] */ __RPC__out_ecount_part(uCount, *puReturned) IWbemClassObject **apObjects,
     /* [out] */ __RPC__out ULONG *puReturned)
 {
+    iHookCounter counter(StatNext);
     HRESULT hr = oNext(This,lTimeout,uCount,apObjects,puReturned);
 
     if(!iHookThis->GetState(iHook::HOOK_COM)) return hr;
+    if(!IsTrackedEnum(This)) return hr;
 
-    PrintLog("*Next %u*",uCount);
+    LogDebug(LOG_HOOKCOM, "*Next %u*",uCount);
 
+    if(hr == WBEM_S_FALSE)
+    {
+        UntrackEnum(This);
+        InterlockedExchange(&WmiEnumerated, TRUE);
+    }
     if(hr != NO_ERROR) return hr;
 
+    iHookTransaction transaction(iHookThis->GetVTable());
     IWbemClassObject* pDevices;
 
     if(apObjects)
@@ -208,8 +276,7 @@ HRESULT STDMETHODCALLTYPE HookNext(
             if(pDevices->lpVtbl->Get)
             {
                 hGet = pDevices->lpVtbl->Get;
-                MH_CreateHook(hGet,HookGet,reinterpret_cast<void**>(&oGet));
-                if(MH_EnableHook(hGet) == MH_OK) PrintLog("Hooking Get");
+                if(transaction.HookSlot(&pDevices->lpVtbl->Get,HookGet,reinterpret_cast<void**>(&oGet))) LogInfo(LOG_HOOKCOM, "Hooking Get");
             }
         }
     }
@@ -218,6 +285,20 @@ HRESULT STDMETHODCALLTYPE HookNext(
 }
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ULONG STDMETHODCALLTYPE HookRelease(
+    IEnumWbemClassObject * This)
+{
+    iHookCounter counter(StatRelease);
+    ULONG refs = oRelease(This);
+
+    // enumerator abandoned before end of enumeration, its address may come back for another object
+    if(refs == 0) UntrackEnum(This);
+
+    return refs;
+}
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 HRESULT STDMETHODCALLTYPE HookCreateInstanceEnum(
     IWbemServices * This,
@@ -226,14 +307,16 @@ HRESULT STDMETHODCALLTYPE HookCreateInstanceEnum(
     /* [in] */ __RPC__in_opt IWbemContext *pCtx,
     /* [out] */ __RPC__deref_out_opt IEnumWbemClassObject **ppEnum)
 {
+    iHookCounter counter(StatCreateInstanceEnum);
     HRESULT hr = oCreateInstanceEnum(This,strFilter,lFlags,pCtx,ppEnum);
 
     if(!iHookThis->GetState(iHook::HOOK_COM)) return hr;
 
-    PrintLog("*CreateInstanceEnum*");
+    if(hr != NO_ERROR || !IsDeviceClass(strFilter)) return hr;
 
-    if(hr != NO_ERROR) return hr;
+    LogDebug(LOG_HOOKCOM, "*CreateInstanceEnum %ls*",strFilter);
 
+    iHookTransaction transaction(iHookThis->GetVTable());
     IEnumWbemClassObject* pEnumDevices = NULL;
 
     if(ppEnum)
@@ -241,12 +324,18 @@ HRESULT STDMETHODCALLTYPE HookCreateInstanceEnum(
         if(*ppEnum)
         {
             pEnumDevices = *ppEnum;
+            TrackEnum(pEnumDevices);
 
             if(pEnumDevices->lpVtbl->Next)
             {
                 hNext = pEnumDevices->lpVtbl->Next;
-                MH_CreateHook(hNext,HookNext,reinterpret_cast<void**>(&oNext));
-                if(MH_EnableHook(hNext) == MH_OK) PrintLog("Hooking Next");
+                if(transaction.HookSlot(&pEnumDevices->lpVtbl->Next,HookNext,reinterpret_cast<void**>(&oNext))) LogInfo(LOG_HOOKCOM, "Hooking Next");
+            }
+
+            if(pEnumDevices->lpVtbl->Release)
+            {
+                hRelease = pEnumDevices->lpVtbl->Release;
+                if(transaction.HookSlot(&pEnumDevices->lpVtbl->Release,HookRelease,reinterpret_cast<void**>(&oRelease))) LogInfo(LOG_HOOKCOM, "Hooking Release");
             }
         }
     }
@@ -268,14 +357,16 @@ HRESULT STDMETHODCALLTYPE HookConnectServer(
     /* [out] */ IWbemServices **ppNamespace)
 
 {
+    iHookCounter counter(StatConnectServer);
     HRESULT hr = oConnectServer(This,strNetworkResource,strUser,strPassword,strLocale,lSecurityFlags,strAuthority,pCtx,ppNamespace);
 
     if(!iHookThis->GetState(iHook::HOOK_COM)) return hr;
 
-    PrintLog("*ConnectServer*");
+    LogDebug(LOG_HOOKCOM, "*ConnectServer*");
 
     if(hr != NO_ERROR) return hr;
 
+    iHookTransaction transaction(iHookThis->GetVTable());
     IWbemServices* pIWbemServices = NULL;
 
     if(ppNamespace)
@@ -287,8 +378,7 @@ HRESULT STDMETHODCALLTYPE HookConnectServer(
             if(pIWbemServices->lpVtbl->CreateInstanceEnum)
             {
                 hCreateInstanceEnum = pIWbemServices->lpVtbl->CreateInstanceEnum;
-                MH_CreateHook(hCreateInstanceEnum,HookCreateInstanceEnum,reinterpret_cast<void**>(&oCreateInstanceEnum));
-                if(MH_EnableHook(hCreateInstanceEnum) == MH_OK) PrintLog("Hooking CreateInstanceEnum");
+                if(transaction.HookSlot(&pIWbemServices->lpVtbl->CreateInstanceEnum,HookCreateInstanceEnum,reinterpret_cast<void**>(&oCreateInstanceEnum))) LogInfo(LOG_HOOKCOM, "Hooking CreateInstanceEnum");
             }
         }
     }
@@ -304,12 +394,13 @@ HRESULT WINAPI HookCoCreateInstance(__in     REFCLSID rclsid,
                                     __in     REFIID riid,
                                     __deref_out LPVOID FAR* ppv)
 {
+    iHookCounter counter(StatCoCreateInstance);
     HRESULT hr = oCoCreateInstance(rclsid,pUnkOuter,dwClsContext,riid,ppv);
 
     //PrintLog(GUIDtoStringA(riid).c_str());
 
     if(!iHookThis->GetState(iHook::HOOK_COM)) return hr;
-    PrintLog("*CoCreateInstance*");
+    LogDebug(LOG_HOOKCOM, "*CoCreateInstance*");
 
     //PrintLog("%x",hr);
 
@@ -319,13 +410,14 @@ HRESULT WINAPI HookCoCreateInstance(__in     REFCLSID rclsid,
 
     if(IsEqualCLSID(rclsid,CLSID_DirectInput8))
     {
-        PrintLog("COM wants to create DirectInput8 instance");
+        LogInfo(LOG_HOOKCOM, "COM wants to create DirectInput8 instance");
         //MessageBoxA(NULL,"COM wants to create DirectInput8 instance","x360ce - Error",MB_ICONWARNING);
         //iHookThis->HookDICOM(riid,ppv);
     }
 
     if(IsEqualIID(riid,IID_IWbemLocator))
     {
+        iHookTransaction transaction(iHookThis->GetVTable());
         IWbemLocator* pIWbemLocator = NULL;
         pIWbemLocator = static_cast<IWbemLocator*>(*ppv);
 
@@ -334,8 +426,7 @@ HRESULT WINAPI HookCoCreateInstance(__in     REFCLSID rclsid,
             if(pIWbemLocator->lpVtbl->ConnectServer)
             {
                 hConnectServer = pIWbemLocator->lpVtbl->ConnectServer;
-                MH_CreateHook(hConnectServer,HookConnectServer,reinterpret_cast<void**>(&oConnectServer));
-                if(MH_EnableHook(hConnectServer) == MH_OK) PrintLog("Hooking ConnectServer");
+                if(transaction.HookSlot(&pIWbemLocator->lpVtbl->ConnectServer,HookConnectServer,reinterpret_cast<void**>(&oConnectServer))) LogInfo(LOG_HOOKCOM, "Hooking ConnectServer");
             }
         }
     }
@@ -346,29 +437,56 @@ HRESULT WINAPI HookCoCreateInstance(__in     REFCLSID rclsid,
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void WINAPI HookCoUninitialize()
 {
+    iHookCounter counter(StatCoUninitialize);
     if(!iHookThis->GetState(iHook::HOOK_COM)) return oCoUninitialize();
-    PrintLog("*CoUninitialize*");
+    LogDebug(LOG_HOOKCOM, "*CoUninitialize*");
+
+	iHookVTable* vtable = iHookThis->GetVTable();
+	if(vtable)
+	{
+		vtable->Restore(HookGet);
+		vtable->Restore(HookNext);
+		vtable->Restore(HookRelease);
+		vtable->Restore(HookCreateInstanceEnum);
+		vtable->Restore(HookConnectServer);
+	}
 
 	MH_QueueDisableHook(hGet);
 	MH_QueueDisableHook(hNext);
+	MH_QueueDisableHook(hRelease);
 	MH_QueueDisableHook(hCreateInstanceEnum);
 	MH_QueueDisableHook(hConnectServer);
 
 	MH_ApplyQueued();
 
+	// Release is not watched anymore, enumerators of this apartment are gone with it
+	UntrackAllEnums();
+
+	// game is done with WMI, CoCreateInstance does not need to be watched anymore
+	if(WmiEnumerated) iHookThis->Retire(iHook::HOOK_COM);
+
     oCoUninitialize();
 }
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void iHook::HookCOM()
+void iHook::HookCOM(iHookTransaction& transaction)
 {
-    PrintLog("Hooking COM");
+    LogInfo(LOG_HOOKCOM, "Hooking COM");
     iHookThis = this;
-    if(MH_CreateHook(CoCreateInstance,HookCoCreateInstance,reinterpret_cast<void**>(&oCoCreateInstance)) == MH_OK)
-        PrintLog("Hooking CoCreateInstance");
 
-    if(MH_CreateHook(CoUninitialize,HookCoUninitialize,reinterpret_cast<void**>(&oCoUninitialize)) == MH_OK)
-        PrintLog("Hooking CoUninitialize");
+    void* pCoCreateInstance = GetModuleProc(L"ole32.dll", "CoCreateInstance");
+    if(pCoCreateInstance && transaction.Hook(pCoCreateInstance,HookCoCreateInstance,reinterpret_cast<void**>(&oCoCreateInstance)))
+    {
+        StatCoCreateInstance.SetTarget(pCoCreateInstance);
+        LogInfo(LOG_HOOKCOM, "Hooking CoCreateInstance");
+    }
+
+    void* pCoUninitialize = GetModuleProc(L"ole32.dll", "CoUninitialize");
+    if(pCoUninitialize && transaction.Hook(pCoUninitialize,HookCoUninitialize,reinterpret_cast<void**>(&oCoUninitialize)))
+    {
+        StatCoUninitialize.SetTarget(pCoUninitialize);
+        LogInfo(LOG_HOOKCOM, "Hooking CoUninitialize");
+    }
 }
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
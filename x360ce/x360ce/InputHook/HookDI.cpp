@@ -76,79 +76,116 @@ SetCooperativeLevelW_t oSetCooperativeLevelW;
 LPDIENUMDEVICESCALLBACKA lpTrueCallbackA = NULL;
 LPDIENUMDEVICESCALLBACKW lpTrueCallbackW = NULL;
 
+static iHookStat StatDirectInput8Create("DirectInput8Create", iHook::HOOK_DI);
+static iHookStat StatCreateDeviceA("CreateDeviceA", iHook::HOOK_DI);
+static iHookStat StatCreateDeviceW("CreateDeviceW", iHook::HOOK_DI);
+static iHookStat StatEnumDevicesA("EnumDevicesA", iHook::HOOK_DI);
+static iHookStat StatEnumDevicesW("EnumDevicesW", iHook::HOOK_DI);
+static iHookStat StatGetDeviceInfoA("GetDeviceInfoA", iHook::HOOK_DI);
+static iHookStat StatGetDeviceInfoW("GetDeviceInfoW", iHook::HOOK_DI);
+static iHookStat StatGetPropertyA("GetPropertyA", iHook::HOOK_DI);
+static iHookStat StatGetPropertyW("GetPropertyW", iHook::HOOK_DI);
+static iHookStat StatSetCooperativeLevelA("SetCooperativeLevelA", iHook::HOOK_DI);
+static iHookStat StatSetCooperativeLevelW("SetCooperativeLevelW", iHook::HOOK_DI);
+
+static const char XboxNameA[] = "XBOX 360 For Windows (Controller)";
+static const wchar_t XboxNameW[] = L"XBOX 360 For Windows (Controller)";
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+inline void SetXboxName(CHAR* name)
+{
+	memcpy(name, XboxNameA, sizeof(XboxNameA));
+}
+
+inline void SetXboxName(WCHAR* name)
+{
+	memcpy(name, XboxNameW, sizeof(XboxNameW));
+}
+
+inline void LogNameChange(const char* what, const CHAR* name)
+{
+	LogInfo(LOG_HOOKDI, "%s", what);
+	LogInfo(LOG_HOOKDI, "\"%s\"", name);
+	LogInfo(LOG_HOOKDI, "\"%s\"", XboxNameA);
+}
+
+inline void LogNameChange(const char* what, const WCHAR* name)
+{
+	LogInfo(LOG_HOOKDI, "%s", what);
+	LogInfo(LOG_HOOKDI, "\"%ls\"", name);
+	LogInfo(LOG_HOOKDI, "\"%ls\"", XboxNameW);
+}
+
+// Applies precomputed spoof data to device instance of hooked pad, one index probe per device.
+// Log arguments are evaluated only when LOG_HOOKDI is enabled.
+template<typename DIDEVICEINSTANCE_T>
+bool SpoofDeviceInstance(DIDEVICEINSTANCE_T* pInst)
+{
+	const iHookDeviceIndex::Entry* entry = iHookThis->FindDevice(pInst->guidProduct);
+	if (!entry) return false;
+
+	iHookThis->MarkUseful(iHook::HOOK_DI);
+
+	if (iHookThis->GetState(iHook::HOOK_PIDVID))
+	{
+		iHookThis->MarkUseful(iHook::HOOK_PIDVID);
+		LogInfo(LOG_HOOKDI, "%s", "GUID change:");
+		LogInfo(LOG_HOOKDI, "%s", GUIDtoStringA(pInst->guidProduct).c_str());
+		LogInfo(LOG_HOOKDI, "%s", GUIDtoStringA(entry->spoofid).c_str());
+		pInst->guidProduct = entry->spoofid;
+	}
+
+	// This should not be required
+	//pInst->dwDevType = (MAKEWORD(DI8DEVTYPE_GAMEPAD, DI8DEVTYPEGAMEPAD_STANDARD) | DIDEVTYPE_HID); //66069 == 0x00010215
+	//pInst->wUsage = 0x05;
+	//pInst->wUsagePage = 0x01;
+
+	if (iHookThis->GetState(iHook::HOOK_NAME))
+	{
+		iHookThis->MarkUseful(iHook::HOOK_NAME);
+		if (LogEnabled(LOG_HOOKDI, LOGLEVEL_INFO))
+		{
+			LogNameChange("Product Name change:", pInst->tszProductName);
+			LogNameChange("Instance Name change:", pInst->tszInstanceName);
+		}
+		SetXboxName(pInst->tszProductName);
+		SetXboxName(pInst->tszInstanceName);
+	}
+
+	return true;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 BOOL FAR PASCAL HookEnumCallbackA(const DIDEVICEINSTANCEA* pInst, VOID* pContext)
 {
 	if (!iHookThis->GetState(iHook::HOOK_DI)) return lpTrueCallbackA(pInst, pContext);
-	PrintLog("*EnumCallbackA*");
+	LogDebug(LOG_HOOKDI, "*EnumCallbackA*");
 
 	// Fast return if keyboard or mouse
 	if (((pInst->dwDevType & 0xFF) == DI8DEVTYPE_KEYBOARD))
 	{
-		PrintLog("Keyboard detected - skipping");
+		LogInfo(LOG_HOOKDI, "Keyboard detected - skipping");
 		return lpTrueCallbackA(pInst, pContext);
 	}
 
 	if (((pInst->dwDevType & 0xFF) == DI8DEVTYPE_MOUSE))
 	{
-		PrintLog("Mouse detected - skipping");
+		LogInfo(LOG_HOOKDI, "Mouse detected - skipping");
 		return lpTrueCallbackA(pInst, pContext);
 	}
 
-	if (iHookThis->GetState(iHook::HOOK_STOP)) return DIENUM_STOP;
+	if (iHookThis->GetState(iHook::HOOK_STOP))
+	{
+		iHookThis->MarkUseful(iHook::HOOK_DI | iHook::HOOK_STOP);
+		return DIENUM_STOP;
+	}
 
 	if (pInst && pInst->dwSize == sizeof(DIDEVICEINSTANCEA))
 	{
-		for (auto padcfg = iHookThis->begin(); padcfg != iHookThis->end(); ++padcfg)
-		{
-			if (padcfg->GetHookState() && IsEqualGUID(padcfg->GetProductGUID(), pInst->guidProduct))
-			{
-				DIDEVICEINSTANCEA& HookInst = *(const_cast<DIDEVICEINSTANCEA*>(pInst));
-				//DIDEVICEINSTANCEA HookInst;
-				//memcpy(&HookInst,pInst,pInst->dwSize);
-
-				if (iHookThis->GetState(iHook::HOOK_PIDVID))
-				{
-					std::string strTrueguidProduct;
-					std::string strHookguidProduct;
-
-					strTrueguidProduct = GUIDtoStringA(HookInst.guidProduct);
-					HookInst.guidProduct.Data1 = iHookThis->GetFakePIDVID();
-					strHookguidProduct = GUIDtoStringA(HookInst.guidProduct);
-
-					PrintLog("%s", "GUID change:");
-					PrintLog("%s", strTrueguidProduct.c_str());
-					PrintLog("%s", strHookguidProduct.c_str());
-				}
-
-				// This should not be required
-				//HookInst.dwDevType = (MAKEWORD(DI8DEVTYPE_GAMEPAD, DI8DEVTYPEGAMEPAD_STANDARD) | DIDEVTYPE_HID); //66069 == 0x00010215
-				//HookInst.wUsage = 0x05;
-				//HookInst.wUsagePage = 0x01;
-
-				if (iHookThis->GetState(iHook::HOOK_NAME))
-				{
-					std::string OldProductName = HookInst.tszProductName;
-					std::string OldInstanceName = HookInst.tszInstanceName;
-
-					strcpy_s(HookInst.tszProductName, "XBOX 360 For Windows (Controller)");
-					strcpy_s(HookInst.tszInstanceName, "XBOX 360 For Windows (Controller)");
-
-					PrintLog("%s", "Product Name change:");
-					PrintLog("\"%s\"", OldProductName.c_str());
-					PrintLog("\"%s\"", HookInst.tszProductName);
-
-					PrintLog("%s", "Instance Name change:");
-					PrintLog("\"%s\"", OldInstanceName.c_str());
-					PrintLog("\"%s\"", HookInst.tszInstanceName);
-				}
-
-				return lpTrueCallbackA(&HookInst, pContext);
-			}
-		}
+		DIDEVICEINSTANCEA& HookInst = *(const_cast<DIDEVICEINSTANCEA*>(pInst));
+		if (SpoofDeviceInstance(&HookInst)) return lpTrueCallbackA(&HookInst, pContext);
 	}
 
 	return lpTrueCallbackA(pInst, pContext);
@@ -159,72 +196,31 @@ BOOL FAR PASCAL HookEnumCallbackA(const DIDEVICEINSTANCEA* pInst, VOID* pContext
 BOOL FAR PASCAL HookEnumCallbackW(const DIDEVICEINSTANCEW* pInst, VOID* pContext)
 {
 	if (!iHookThis->GetState(iHook::HOOK_DI)) return lpTrueCallbackW(pInst, pContext);
-	PrintLog("*EnumCallbackW*");
+	LogDebug(LOG_HOOKDI, "*EnumCallbackW*");
 
 	// Fast return if keyboard or mouse
 	if (((pInst->dwDevType & 0xFF) == DI8DEVTYPE_KEYBOARD))
 	{
-		PrintLog("Keyboard detected - skipping");
+		LogInfo(LOG_HOOKDI, "Keyboard detected - skipping");
 		return lpTrueCallbackW(pInst, pContext);
 	}
 
 	if (((pInst->dwDevType & 0xFF) == DI8DEVTYPE_MOUSE))
 	{
-		PrintLog("Mouse detected - skipping");
+		LogInfo(LOG_HOOKDI, "Mouse detected - skipping");
 		return lpTrueCallbackW(pInst, pContext);
 	}
 
-	if (iHookThis->GetState(iHook::HOOK_STOP)) return DIENUM_STOP;
+	if (iHookThis->GetState(iHook::HOOK_STOP))
+	{
+		iHookThis->MarkUseful(iHook::HOOK_DI | iHook::HOOK_STOP);
+		return DIENUM_STOP;
+	}
 
 	if (pInst && pInst->dwSize == sizeof(DIDEVICEINSTANCEW))
 	{
-		for (auto padcfg = iHookThis->begin(); padcfg != iHookThis->end(); ++padcfg)
-		{
-			if (padcfg->GetHookState() && IsEqualGUID(padcfg->GetProductGUID(), pInst->guidProduct))
-			{
-				DIDEVICEINSTANCEW& HookInst = *(const_cast<DIDEVICEINSTANCEW*>(pInst));
-				//DIDEVICEINSTANCEW HookInst;
-				//memcpy(&HookInst,pInst,pInst->dwSize);
-
-				if (iHookThis->GetState(iHook::HOOK_PIDVID))
-				{
-					std::wstring strTrueguidProduct;
-					std::wstring strHookguidProduct;
-
-					strTrueguidProduct = GUIDtoStringW(HookInst.guidProduct);
-					HookInst.guidProduct.Data1 = iHookThis->GetFakePIDVID();
-					strHookguidProduct = GUIDtoStringW(HookInst.guidProduct);
-
-					PrintLog("%s", "GUID change:");
-					PrintLog("%ls", strTrueguidProduct.c_str());
-					PrintLog("%ls", strHookguidProduct.c_str());
-				}
-
-				// This should not be required
-				//HookInst.dwDevType = (MAKEWORD(DI8DEVTYPE_GAMEPAD, DI8DEVTYPEGAMEPAD_STANDARD) | DIDEVTYPE_HID); //66069 == 0x00010215
-				//HookInst.wUsage = 0x05;
-				//HookInst.wUsagePage = 0x01;
-
-				if (iHookThis->GetState(iHook::HOOK_NAME))
-				{
-					std::wstring OldProductName(HookInst.tszProductName);
-					std::wstring OldInstanceName(HookInst.tszInstanceName);
-
-					wcscpy_s(HookInst.tszProductName, L"XBOX 360 For Windows (Controller)");
-					wcscpy_s(HookInst.tszInstanceName, L"XBOX 360 For Windows (Controller)");
-
-					PrintLog("%s", "Product Name change:");
-					PrintLog("\"%ls\"", OldProductName.c_str());
-					PrintLog("\"%ls\"", HookInst.tszProductName);
-
-					PrintLog("%s", "Instance Name change:");
-					PrintLog("\"%ls\"", OldInstanceName.c_str());
-					PrintLog("\"%ls\"", HookInst.tszInstanceName);
-				}
-
-				return lpTrueCallbackW(&HookInst, pContext);
-			}
-		}
+		DIDEVICEINSTANCEW& HookInst = *(const_cast<DIDEVICEINSTANCEW*>(pInst));
+		if (SpoofDeviceInstance(&HookInst)) return lpTrueCallbackW(&HookInst, pContext);
 	}
 
 	return lpTrueCallbackW(pInst, pContext);
@@ -234,9 +230,10 @@ BOOL FAR PASCAL HookEnumCallbackW(const DIDEVICEINSTANCEW* pInst, VOID* pContext
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 HRESULT STDMETHODCALLTYPE HookEnumDevicesA(LPDIRECTINPUT8A This, DWORD dwDevType, LPDIENUMDEVICESCALLBACKA lpCallback, LPVOID pvRef, DWORD dwFlags)
 {
+	iHookCounter counter(StatEnumDevicesA);
 	if (iHookThis->GetState(iHook::HOOK_DI))
 	{
-		PrintLog("*EnumDevicesA*");
+		LogDebug(LOG_HOOKDI, "*EnumDevicesA*");
 
 		if (lpCallback)
 		{
@@ -251,9 +248,10 @@ HRESULT STDMETHODCALLTYPE HookEnumDevicesA(LPDIRECTINPUT8A This, DWORD dwDevType
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 HRESULT STDMETHODCALLTYPE HookEnumDevicesW(LPDIRECTINPUT8W This, DWORD dwDevType, LPDIENUMDEVICESCALLBACKW lpCallback, LPVOID pvRef, DWORD dwFlags)
 {
+	iHookCounter counter(StatEnumDevicesW);
 	if (iHookThis->GetState(iHook::HOOK_DI))
 	{
-		PrintLog("*EnumDevicesW*");
+		LogDebug(LOG_HOOKDI, "*EnumDevicesW*");
 
 		if (lpCallback)
 		{
@@ -268,10 +266,11 @@ HRESULT STDMETHODCALLTYPE HookEnumDevicesW(LPDIRECTINPUT8W This, DWORD dwDevType
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 HRESULT STDMETHODCALLTYPE HookGetDeviceInfoA(LPDIRECTINPUTDEVICE8A This, LPDIDEVICEINSTANCEA pdidi)
 {
+	iHookCounter counter(StatGetDeviceInfoA);
 	HRESULT hr = oGetDeviceInfoA(This, pdidi);
 
 	if (!iHookThis->GetState(iHook::HOOK_DI)) return hr;
-	PrintLog("*GetDeviceInfoA*");
+	LogDebug(LOG_HOOKDI, "*GetDeviceInfoA*");
 
 	if (hr != NO_ERROR) return hr;
 
@@ -280,59 +279,17 @@ HRESULT STDMETHODCALLTYPE HookGetDeviceInfoA(LPDIRECTINPUTDEVICE8A This, LPDIDEV
 		// Fast return if keyboard or mouse
 		if (((pdidi->dwDevType & 0xFF) == DI8DEVTYPE_KEYBOARD))
 		{
-			PrintLog("Keyboard detected - skipping");
+			LogInfo(LOG_HOOKDI, "Keyboard detected - skipping");
 			return hr;
 		}
 
 		if (((pdidi->dwDevType & 0xFF) == DI8DEVTYPE_MOUSE))
 		{
-			PrintLog("Mouse detected - skipping");
+			LogInfo(LOG_HOOKDI, "Mouse detected - skipping");
 			return hr;
 		}
 
-		for (auto padcfg = iHookThis->begin(); padcfg != iHookThis->end(); ++padcfg)
-		{
-			if (padcfg->GetHookState() && IsEqualGUID(padcfg->GetProductGUID(), pdidi->guidProduct))
-			{
-				if (iHookThis->GetState(iHook::HOOK_PIDVID))
-				{
-					std::string strTrueguidProduct;
-					std::string strHookguidProduct;
-
-					strTrueguidProduct = GUIDtoStringA(pdidi->guidProduct);
-					pdidi->guidProduct.Data1 = iHookThis->GetFakePIDVID();
-					strHookguidProduct = GUIDtoStringA(pdidi->guidProduct);
-
-					PrintLog("%s", "GUID change:");
-					PrintLog("%s", strTrueguidProduct.c_str());
-					PrintLog("%s", strHookguidProduct.c_str());
-				}
-
-				// This should not be required
-				//pdidi->dwDevType = (MAKEWORD(DI8DEVTYPE_GAMEPAD, DI8DEVTYPEGAMEPAD_STANDARD) | DIDEVTYPE_HID); //66069 == 0x00010215
-				//pdidi->wUsage = 0x05;
-				//pdidi->wUsagePage = 0x01;
-
-				if (iHookThis->GetState(iHook::HOOK_NAME))
-				{
-					std::string OldProductName(pdidi->tszProductName);
-					std::string OldInstanceName(pdidi->tszInstanceName);
-
-					strcpy_s(pdidi->tszProductName, "XBOX 360 For Windows (Controller)");
-					strcpy_s(pdidi->tszInstanceName, "XBOX 360 For Windows (Controller)");
-
-					PrintLog("%s", "Product Name change:");
-					PrintLog("\"%s\"", OldProductName.c_str());
-					PrintLog("\"%s\"", pdidi->tszProductName);
-
-					PrintLog("%s", "Instance Name change:");
-					PrintLog("\"%s\"", OldInstanceName.c_str());
-					PrintLog("\"%s\"", pdidi->tszInstanceName);
-				}
-
-				hr = DI_OK;
-			}
-		}
+		if (SpoofDeviceInstance(pdidi)) hr = DI_OK;
 	}
 
 	return hr;
@@ -342,10 +299,11 @@ HRESULT STDMETHODCALLTYPE HookGetDeviceInfoA(LPDIRECTINPUTDEVICE8A This, LPDIDEV
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 HRESULT STDMETHODCALLTYPE HookGetDeviceInfoW(LPDIRECTINPUTDEVICE8W This, LPDIDEVICEINSTANCEW pdidi)
 {
+	iHookCounter counter(StatGetDeviceInfoW);
 	HRESULT hr = oGetDeviceInfoW(This, pdidi);
 
 	if (!iHookThis->GetState(iHook::HOOK_DI)) return hr;
-	PrintLog("*GetDeviceInfoW*");
+	LogDebug(LOG_HOOKDI, "*GetDeviceInfoW*");
 
 	if (hr != NO_ERROR) return hr;
 
@@ -354,59 +312,17 @@ HRESULT STDMETHODCALLTYPE HookGetDeviceInfoW(LPDIRECTINPUTDEVICE8W This, LPDIDEV
 		// Fast return if keyboard or mouse
 		if (((pdidi->dwDevType & 0xFF) == DI8DEVTYPE_KEYBOARD))
 		{
-			PrintLog("Keyboard detected - skipping");
+			LogInfo(LOG_HOOKDI, "Keyboard detected - skipping");
 			return hr;
 		}
 
 		if (((pdidi->dwDevType & 0xFF) == DI8DEVTYPE_MOUSE))
 		{
-			PrintLog("Mouse detected - skipping");
+			LogInfo(LOG_HOOKDI, "Mouse detected - skipping");
 			return hr;
 		}
 
-		for (auto padcfg = iHookThis->begin(); padcfg != iHookThis->end(); ++padcfg)
-		{
-			if (padcfg->GetHookState() && IsEqualGUID(padcfg->GetProductGUID(), pdidi->guidProduct))
-			{
-				if (iHookThis->GetState(iHook::HOOK_PIDVID))
-				{
-					std::wstring strTrueguidProduct;
-					std::wstring strHookguidProduct;
-
-					strTrueguidProduct = GUIDtoStringW(pdidi->guidProduct);
-					pdidi->guidProduct.Data1 = iHookThis->GetFakePIDVID();
-					strHookguidProduct = GUIDtoStringW(pdidi->guidProduct);
-
-					PrintLog("%s", "GUID change:");
-					PrintLog("%ls", strTrueguidProduct.c_str());
-					PrintLog("%ls", strHookguidProduct.c_str());
-				}
-
-				// This should not be required
-				//pdidi->dwDevType = (MAKEWORD(DI8DEVTYPE_GAMEPAD, DI8DEVTYPEGAMEPAD_STANDARD) | DIDEVTYPE_HID); //66069 == 0x00010215
-				//pdidi->wUsage = 0x05;
-				//pdidi->wUsagePage = 0x01;
-
-				if (iHookThis->GetState(iHook::HOOK_NAME))
-				{
-					std::wstring OldProductName(pdidi->tszProductName);
-					std::wstring OldInstanceName(pdidi->tszInstanceName);
-
-					wcscpy_s(pdidi->tszProductName, L"XBOX 360 For Windows (Controller)");
-					wcscpy_s(pdidi->tszInstanceName, L"XBOX 360 For Windows (Controller)");
-
-					PrintLog("%s", "Product Name change:");
-					PrintLog("\"%ls\"", OldProductName.c_str());
-					PrintLog("\"%ls\"", pdidi->tszProductName);
-
-					PrintLog("%s", "Instance Name change:");
-					PrintLog("\"%ls\"", OldInstanceName.c_str());
-					PrintLog("\"%ls\"", pdidi->tszInstanceName);
-				}
-
-				hr = DI_OK;
-			}
-		}
+		if (SpoofDeviceInstance(pdidi)) hr = DI_OK;
 	}
 
 	return hr;
@@ -416,10 +332,11 @@ HRESULT STDMETHODCALLTYPE HookGetDeviceInfoW(LPDIRECTINPUTDEVICE8W This, LPDIDEV
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 HRESULT STDMETHODCALLTYPE HookGetPropertyA(LPDIRECTINPUTDEVICE8A This, REFGUID rguidProp, LPDIPROPHEADER pdiph)
 {
+	iHookCounter counter(StatGetPropertyA);
 	HRESULT hr = oGetPropertyA(This, rguidProp, pdiph);
 
 	if (!iHookThis->GetState(iHook::HOOK_DI)) return hr;
-	PrintLog("*GetPropertyA*");
+	LogDebug(LOG_HOOKDI, "*GetPropertyA*");
 
 	if (hr != NO_ERROR) return hr;
 
@@ -429,20 +346,20 @@ HRESULT STDMETHODCALLTYPE HookGetPropertyA(LPDIRECTINPUTDEVICE8A This, REFGUID r
 		DWORD dwTruePIDVID = reinterpret_cast<LPDIPROPDWORD>(pdiph)->dwData;
 
 		reinterpret_cast<LPDIPROPDWORD>(pdiph)->dwData = dwHookPIDVID;
-		PrintLog("%s", "VIDPID change:");
-		PrintLog("%08X", dwTruePIDVID);
-		PrintLog("%08X", reinterpret_cast<LPDIPROPDWORD>(pdiph)->dwData);
+		iHookThis->MarkUseful(iHook::HOOK_DI | iHook::HOOK_PIDVID);
+		LogInfo(LOG_HOOKDI, "%s", "VIDPID change:");
+		LogInfo(LOG_HOOKDI, "%08X", dwTruePIDVID);
+		LogInfo(LOG_HOOKDI, "%08X", reinterpret_cast<LPDIPROPDWORD>(pdiph)->dwData);
 	}
 
 	if (iHookThis->GetState(iHook::HOOK_NAME) && &rguidProp == &DIPROP_PRODUCTNAME)
 	{
-		wchar_t TrueName[MAX_PATH];
-		wcscpy_s(TrueName, reinterpret_cast<LPDIPROPSTRING>(pdiph)->wsz);
+		LPDIPROPSTRING pString = reinterpret_cast<LPDIPROPSTRING>(pdiph);
+		iHookThis->MarkUseful(iHook::HOOK_DI | iHook::HOOK_NAME);
 
-		swprintf_s(reinterpret_cast<LPDIPROPSTRING>(pdiph)->wsz, L"%s", L"XBOX 360 For Windows (Controller)");
-		PrintLog("%s", "Product Name change:");
-		PrintLog("\"%ls\"", TrueName);
-		PrintLog("\"%ls\"", reinterpret_cast<LPDIPROPSTRING>(pdiph)->wsz);
+		// true name is logged before it is overwritten, no copy needed
+		if (LogEnabled(LOG_HOOKDI, LOGLEVEL_INFO)) LogNameChange("Product Name change:", pString->wsz);
+		wcscpy_s(pString->wsz, XboxNameW);
 	}
 
 	return hr;
@@ -452,10 +369,11 @@ HRESULT STDMETHODCALLTYPE HookGetPropertyA(LPDIRECTINPUTDEVICE8A This, REFGUID r
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 HRESULT STDMETHODCALLTYPE HookGetPropertyW(LPDIRECTINPUTDEVICE8W This, REFGUID rguidProp, LPDIPROPHEADER pdiph)
 {
+	iHookCounter counter(StatGetPropertyW);
 	HRESULT hr = oGetPropertyW(This, rguidProp, pdiph);
 
 	if (!iHookThis->GetState(iHook::HOOK_DI)) return hr;
-	PrintLog("*GetPropertyW*");
+	LogDebug(LOG_HOOKDI, "*GetPropertyW*");
 
 	if (hr != NO_ERROR) return hr;
 
@@ -465,20 +383,20 @@ HRESULT STDMETHODCALLTYPE HookGetPropertyW(LPDIRECTINPUTDEVICE8W This, REFGUID r
 		DWORD dwTruePIDVID = reinterpret_cast<LPDIPROPDWORD>(pdiph)->dwData;
 
 		reinterpret_cast<LPDIPROPDWORD>(pdiph)->dwData = dwHookPIDVID;
-		PrintLog("%s", "VIDPID change:");
-		PrintLog("%08X", dwTruePIDVID);
-		PrintLog("%08X", reinterpret_cast<LPDIPROPDWORD>(pdiph)->dwData);
+		iHookThis->MarkUseful(iHook::HOOK_DI | iHook::HOOK_PIDVID);
+		LogInfo(LOG_HOOKDI, "%s", "VIDPID change:");
+		LogInfo(LOG_HOOKDI, "%08X", dwTruePIDVID);
+		LogInfo(LOG_HOOKDI, "%08X", reinterpret_cast<LPDIPROPDWORD>(pdiph)->dwData);
 	}
 
 	if (iHookThis->GetState(iHook::HOOK_NAME) && &rguidProp == &DIPROP_PRODUCTNAME)
 	{
-		wchar_t TrueName[MAX_PATH];
-		wcscpy_s(TrueName, reinterpret_cast<LPDIPROPSTRING>(pdiph)->wsz);
+		LPDIPROPSTRING pString = reinterpret_cast<LPDIPROPSTRING>(pdiph);
+		iHookThis->MarkUseful(iHook::HOOK_DI | iHook::HOOK_NAME);
 
-		swprintf_s(reinterpret_cast<LPDIPROPSTRING>(pdiph)->wsz, L"%s", L"XBOX 360 For Windows (Controller)");
-		PrintLog("%s", "Product Name change:");
-		PrintLog("\"%ls\"", TrueName);
-		PrintLog("\"%ls\"", reinterpret_cast<LPDIPROPSTRING>(pdiph)->wsz);
+		// true name is logged before it is overwritten, no copy needed
+		if (LogEnabled(LOG_HOOKDI, LOGLEVEL_INFO)) LogNameChange("Product Name change:", pString->wsz);
+		wcscpy_s(pString->wsz, XboxNameW);
 	}
 
 	return hr;
@@ -487,26 +405,30 @@ HRESULT STDMETHODCALLTYPE HookGetPropertyW(LPDIRECTINPUTDEVICE8W This, REFGUID r
 
 HRESULT STDMETHODCALLTYPE HookSetCooperativeLevelA(LPDIRECTINPUTDEVICE8A This, HWND hWnd, DWORD dwFlags)
 {
+	iHookCounter counter(StatSetCooperativeLevelA);
 	if (!iHookThis->GetState(iHook::HOOK_DI)) return oSetCooperativeLevelA(This, hWnd, dwFlags);
-	PrintLog("*SetCooperativeLevelA*");
+	LogDebug(LOG_HOOKDI, "*SetCooperativeLevelA*");
 
 	if (dwFlags & DISCL_EXCLUSIVE)
 	{
 		dwFlags &= ~DISCL_EXCLUSIVE;
 		dwFlags |= DISCL_NONEXCLUSIVE;
+		iHookThis->MarkUseful(iHook::HOOK_DI);
 	}
 	return oSetCooperativeLevelA(This, hWnd, dwFlags);
 }
 
 HRESULT STDMETHODCALLTYPE HookSetCooperativeLevelW(LPDIRECTINPUTDEVICE8W This, HWND hWnd, DWORD dwFlags)
 {
+	iHookCounter counter(StatSetCooperativeLevelW);
 	if (!iHookThis->GetState(iHook::HOOK_DI)) return oSetCooperativeLevelW(This, hWnd, dwFlags);
-	PrintLog("*SetCooperativeLevelW*");
+	LogDebug(LOG_HOOKDI, "*SetCooperativeLevelW*");
 
 	if (dwFlags & DISCL_EXCLUSIVE)
 	{
 		dwFlags &= ~DISCL_EXCLUSIVE;
 		dwFlags |= DISCL_NONEXCLUSIVE;
+		iHookThis->MarkUseful(iHook::HOOK_DI);
 	}
 	return oSetCooperativeLevelW(This, hWnd, dwFlags);
 }
@@ -514,37 +436,35 @@ HRESULT STDMETHODCALLTYPE HookSetCooperativeLevelW(LPDIRECTINPUTDEVICE8W This, H
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 HRESULT STDMETHODCALLTYPE HookCreateDeviceA(LPDIRECTINPUT8A This, REFGUID rguid, LPDIRECTINPUTDEVICE8A * lplpDirectInputDevice, LPUNKNOWN pUnkOuter)
 {
+	iHookCounter counter(StatCreateDeviceA);
 	HRESULT hr = oCreateDeviceA(This, rguid, lplpDirectInputDevice, pUnkOuter);
 
 	if (!iHookThis->GetState(iHook::HOOK_DI)) return hr;
-	PrintLog("*CreateDeviceA*");
+	LogDebug(LOG_HOOKDI, "*CreateDeviceA*");
 
 	if (hr != NO_ERROR) return hr;
 
+	iHookTransaction transaction(iHookThis->GetVTable());
+
 	if (*lplpDirectInputDevice)
 	{
 		LPDIRECTINPUTDEVICE8A &ref = *lplpDirectInputDevice;
 		if (ref->lpVtbl->GetDeviceInfo)
 		{
-
 			hGetDeviceInfoA = ref->lpVtbl->GetDeviceInfo;
-			MH_CreateHook(hGetDeviceInfoA, HookGetDeviceInfoA, reinterpret_cast<void**>(&oGetDeviceInfoA));
-			if (MH_EnableHook(hGetDeviceInfoA) == MH_OK) PrintLog("Hooking GetDeviceInfoA");
+			if (transaction.HookSlot(&ref->lpVtbl->GetDeviceInfo, HookGetDeviceInfoA, reinterpret_cast<void**>(&oGetDeviceInfoA))) LogInfo(LOG_HOOKDI, "Hooking GetDeviceInfoA");
 		}
 
 		if (ref->lpVtbl->GetProperty)
 		{
-			PrintLog("Hooking GetPropertyA");
 			hGetPropertyA = ref->lpVtbl->GetProperty;
-			MH_CreateHook(hGetPropertyA, HookGetPropertyA, reinterpret_cast<void**>(&oGetPropertyA));
-			if (MH_EnableHook(hGetPropertyA) == MH_OK) PrintLog("Hooking GetPropertyA");
+			if (transaction.HookSlot(&ref->lpVtbl->GetProperty, HookGetPropertyA, reinterpret_cast<void**>(&oGetPropertyA))) LogInfo(LOG_HOOKDI, "Hooking GetPropertyA");
 		}
 
 		if (ref->lpVtbl->SetCooperativeLevel)
 		{
 			hSetCooperativeLevelA = ref->lpVtbl->SetCooperativeLevel;
-			MH_CreateHook(hSetCooperativeLevelA, HookSetCooperativeLevelA, reinterpret_cast<void**>(&oSetCooperativeLevelA));
-			if (MH_EnableHook(hSetCooperativeLevelA) == MH_OK) PrintLog("Hooking SetCooperativeLevelA");
+			if (transaction.HookSlot(&ref->lpVtbl->SetCooperativeLevel, HookSetCooperativeLevelA, reinterpret_cast<void**>(&oSetCooperativeLevelA))) LogInfo(LOG_HOOKDI, "Hooking SetCooperativeLevelA");
 		}
 	}
 
@@ -555,35 +475,35 @@ HRESULT STDMETHODCALLTYPE HookCreateDeviceA(LPDIRECTINPUT8A This, REFGUID rguid,
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 HRESULT STDMETHODCALLTYPE HookCreateDeviceW(LPDIRECTINPUT8W This, REFGUID rguid, LPDIRECTINPUTDEVICE8W * lplpDirectInputDevice, LPUNKNOWN pUnkOuter)
 {
+	iHookCounter counter(StatCreateDeviceW);
 	HRESULT hr = oCreateDeviceW(This, rguid, lplpDirectInputDevice, pUnkOuter);
 
 	if (!iHookThis->GetState(iHook::HOOK_DI)) return hr;
-	PrintLog("*CreateDeviceW*");
+	LogDebug(LOG_HOOKDI, "*CreateDeviceW*");
 
 	if (hr != NO_ERROR) return hr;
 
+	iHookTransaction transaction(iHookThis->GetVTable());
+
 	if (*lplpDirectInputDevice)
 	{
 		LPDIRECTINPUTDEVICE8W &ref = *lplpDirectInputDevice;
 		if (ref->lpVtbl->GetDeviceInfo)
 		{
 			hGetDeviceInfoW = ref->lpVtbl->GetDeviceInfo;
-			MH_CreateHook(hGetDeviceInfoW, HookGetDeviceInfoW, reinterpret_cast<void**>(&oGetDeviceInfoW));
-			if (MH_EnableHook(hGetDeviceInfoW) == MH_OK) PrintLog("Hooking GetDeviceInfoW");
+			if (transaction.HookSlot(&ref->lpVtbl->GetDeviceInfo, HookGetDeviceInfoW, reinterpret_cast<void**>(&oGetDeviceInfoW))) LogInfo(LOG_HOOKDI, "Hooking GetDeviceInfoW");
 		}
 
 		if (ref->lpVtbl->GetProperty)
 		{
 			hGetPropertyW = ref->lpVtbl->GetProperty;
-			MH_CreateHook(hGetPropertyW, HookGetPropertyW, reinterpret_cast<void**>(&oGetPropertyW));
-			if (MH_EnableHook(hGetPropertyW) == MH_OK) PrintLog("Hooking GetPropertyW");
+			if (transaction.HookSlot(&ref->lpVtbl->GetProperty, HookGetPropertyW, reinterpret_cast<void**>(&oGetPropertyW))) LogInfo(LOG_HOOKDI, "Hooking GetPropertyW");
 		}
 
 		if (ref->lpVtbl->SetCooperativeLevel)
 		{
 			hSetCooperativeLevelW = ref->lpVtbl->SetCooperativeLevel;
-			MH_CreateHook(hSetCooperativeLevelW, HookSetCooperativeLevelW, reinterpret_cast<void**>(&oSetCooperativeLevelW));
-			if (MH_EnableHook(hSetCooperativeLevelW) == MH_OK) PrintLog("Hooking SetCooperativeLevelW");
+			if (transaction.HookSlot(&ref->lpVtbl->SetCooperativeLevel, HookSetCooperativeLevelW, reinterpret_cast<void**>(&oSetCooperativeLevelW))) LogInfo(LOG_HOOKDI, "Hooking SetCooperativeLevelW");
 		}
 	}
 
@@ -594,7 +514,7 @@ HRESULT STDMETHODCALLTYPE HookCreateDeviceW(LPDIRECTINPUT8W This, REFGUID rguid,
 #if 0
 void iHook::HookDICOM(REFIID riidltf, LPVOID *ppv)
 {
-	PrintLog("Hooking HookDICOM");
+	LogInfo(LOG_HOOKDI, "Hooking HookDICOM");
 	iHookThis = this;
 
 	if(IsEqualIID(riidltf,IID_IDirectInput8A))
@@ -603,19 +523,19 @@ void iHook::HookDICOM(REFIID riidltf, LPVOID *ppv)
 
 		if(pDIA)
 		{
-			PrintLog(LOG_HOOKDI,"DirectInput8Create - ANSI interface");
+			LogInfo(LOG_HOOKDI, "DirectInput8Create - ANSI interface");
 			if(pDIA->lpVtbl->CreateDevice)
 			{
 				hCreateDeviceA = pDIA->lpVtbl->CreateDevice;
 				MH_CreateHook(hCreateDeviceA,HookCreateDeviceA,reinterpret_cast<void**>(&oCreateDeviceA));
-				if(MH_EnableHook(hCreateDeviceA) == MH_OK) PrintLog(LOG_HOOKDI,"Hooking CreateDeviceA");
+				if(MH_EnableHook(hCreateDeviceA) == MH_OK) LogInfo(LOG_HOOKDI, "Hooking CreateDeviceA");
 			}
 			if(pDIA->lpVtbl->EnumDevices)
 			{
 
 				hEnumDevicesA = pDIA->lpVtbl->EnumDevices;
 				MH_CreateHook(hEnumDevicesA,HookEnumDevicesA,reinterpret_cast<void**>(&oEnumDevicesA));
-				if(MH_EnableHook(hEnumDevicesA) == MH_OK) PrintLog(LOG_HOOKDI,"Hooking EnumDevicesA");
+				if(MH_EnableHook(hEnumDevicesA) == MH_OK) LogInfo(LOG_HOOKDI, "Hooking EnumDevicesA");
 			}
 		}
 	}
@@ -626,18 +546,18 @@ void iHook::HookDICOM(REFIID riidltf, LPVOID *ppv)
 
 		if(pDIW)
 		{
-			PrintLog(LOG_HOOKDI,"DirectInput8Create - UNICODE interface");
+			LogInfo(LOG_HOOKDI, "DirectInput8Create - UNICODE interface");
 			if(pDIW->lpVtbl->CreateDevice)
 			{
 				hCreateDeviceW = pDIW->lpVtbl->CreateDevice;
 				MH_CreateHook(hCreateDeviceW, HookCreateDeviceW, reinterpret_cast<void**>(&oCreateDeviceW));
-				if (MH_EnableHook(hCreateDeviceW) == MH_OK) PrintLog("Hooking CreateDeviceW");
+				if (MH_EnableHook(hCreateDeviceW) == MH_OK) LogInfo(LOG_HOOKDI, "Hooking CreateDeviceW");
 			}
 			if (pDIW->lpVtbl->EnumDevices)
 			{
 				hEnumDevicesW = pDIW->lpVtbl->EnumDevices;
 				MH_CreateHook(hEnumDevicesW, HookEnumDevicesW, reinterpret_cast<void**>(&oEnumDevicesW));
-				if (MH_EnableHook(hEnumDevicesW) == MH_OK) PrintLog("Hooking EnumDevicesW");
+				if (MH_EnableHook(hEnumDevicesW) == MH_OK) LogInfo(LOG_HOOKDI, "Hooking EnumDevicesW");
 			}
 		}
 	}
@@ -647,10 +567,13 @@ void iHook::HookDICOM(REFIID riidltf, LPVOID *ppv)
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 HRESULT WINAPI HookDirectInput8Create(HINSTANCE hinst, DWORD dwVersion, REFIID riidltf, LPVOID *ppvOut, LPUNKNOWN punkOuter)
 {
+	iHookCounter counter(StatDirectInput8Create);
 	HRESULT hr = oDirectInput8Create(hinst, dwVersion, riidltf, ppvOut, punkOuter);
 
 	if (!iHookThis->GetState(iHook::HOOK_DI)) return hr;
-	PrintLog("*DirectInput8Create*");
+	LogDebug(LOG_HOOKDI, "*DirectInput8Create*");
+
+	iHookTransaction transaction(iHookThis->GetVTable());
 
 	if (IsEqualIID(riidltf, IID_IDirectInput8A))
 	{
@@ -658,18 +581,16 @@ HRESULT WINAPI HookDirectInput8Create(HINSTANCE hinst, DWORD dwVersion, REFIID r
 
 		if (pDIA)
 		{
-			PrintLog("DirectInput8Create - ANSI interface");
+			LogInfo(LOG_HOOKDI, "DirectInput8Create - ANSI interface");
 			if (pDIA->lpVtbl->CreateDevice)
 			{
 				hCreateDeviceA = pDIA->lpVtbl->CreateDevice;
-				MH_CreateHook(hCreateDeviceA, HookCreateDeviceA, reinterpret_cast<void**>(&oCreateDeviceA));
-				if (MH_EnableHook(hCreateDeviceA) == MH_OK) PrintLog("Hooking CreateDeviceA");
+				if (transaction.HookSlot(&pDIA->lpVtbl->CreateDevice, HookCreateDeviceA, reinterpret_cast<void**>(&oCreateDeviceA))) LogInfo(LOG_HOOKDI, "Hooking CreateDeviceA");
 			}
 			if (pDIA->lpVtbl->EnumDevices)
 			{
 				hEnumDevicesA = pDIA->lpVtbl->EnumDevices;
-				MH_CreateHook(hEnumDevicesA, HookEnumDevicesA, reinterpret_cast<void**>(&oEnumDevicesA));
-				if (MH_EnableHook(hEnumDevicesA) == MH_OK) PrintLog("Hooking EnumDevicesA");
+				if (transaction.HookSlot(&pDIA->lpVtbl->EnumDevices, HookEnumDevicesA, reinterpret_cast<void**>(&oEnumDevicesA))) LogInfo(LOG_HOOKDI, "Hooking EnumDevicesA");
 			}
 		}
 	}
@@ -680,18 +601,16 @@ HRESULT WINAPI HookDirectInput8Create(HINSTANCE hinst, DWORD dwVersion, REFIID r
 
 		if (pDIW)
 		{
-			PrintLog("DirectInput8Create - UNICODE interface");
+			LogInfo(LOG_HOOKDI, "DirectInput8Create - UNICODE interface");
 			if (pDIW->lpVtbl->CreateDevice)
 			{
 				hCreateDeviceW = pDIW->lpVtbl->CreateDevice;
-				MH_CreateHook(hCreateDeviceW, HookCreateDeviceW, reinterpret_cast<void**>(&oCreateDeviceW));
-				if (MH_EnableHook(hCreateDeviceW) == MH_OK) PrintLog("Hooking CreateDeviceW");
+				if (transaction.HookSlot(&pDIW->lpVtbl->CreateDevice, HookCreateDeviceW, reinterpret_cast<void**>(&oCreateDeviceW))) LogInfo(LOG_HOOKDI, "Hooking CreateDeviceW");
 			}
 			if (pDIW->lpVtbl->EnumDevices)
 			{
 				hEnumDevicesW = pDIW->lpVtbl->EnumDevices;
-				MH_CreateHook(hEnumDevicesW, HookEnumDevicesW, reinterpret_cast<void**>(&oEnumDevicesW));
-				if (MH_EnableHook(hEnumDevicesW) == MH_OK) PrintLog("Hooking EnumDevicesW");
+				if (transaction.HookSlot(&pDIW->lpVtbl->EnumDevices, HookEnumDevicesW, reinterpret_cast<void**>(&oEnumDevicesW))) LogInfo(LOG_HOOKDI, "Hooking EnumDevicesW");
 			}
 		}
 	}
@@ -701,12 +620,16 @@ HRESULT WINAPI HookDirectInput8Create(HINSTANCE hinst, DWORD dwVersion, REFIID r
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void iHook::HookDI()
+void iHook::HookDI(iHookTransaction& transaction)
 {
-	PrintLog( "Hooking DirectInput");
+	LogInfo(LOG_HOOKDI, "Hooking DirectInput");
 	iHookThis = this;
 
-	if (MH_CreateHook(DirectInput8Create, HookDirectInput8Create, reinterpret_cast<void**>(&oDirectInput8Create)) == MH_OK)
-		PrintLog( "Hooking DirectInput8Create");
+	void* pDirectInput8Create = GetModuleProc(L"dinput8.dll", "DirectInput8Create");
+	if (pDirectInput8Create && transaction.Hook(pDirectInput8Create, HookDirectInput8Create, reinterpret_cast<void**>(&oDirectInput8Create)))
+	{
+		StatDirectInput8Create.SetTarget(pDirectInput8Create);
+		LogInfo(LOG_HOOKDI, "Hooking DirectInput8Create");
+	}
 }
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
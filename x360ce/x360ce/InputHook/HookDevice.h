@@ -0,0 +1,163 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _HOOKDEVICE_H_
+#define _HOOKDEVICE_H_
+
+#include <vector>
+
+class iHookDevice
+{
+public:
+	iHookDevice(DWORD userindex, const GUID& productid, const GUID& instanceid)
+		:m_enabled(true)
+		, m_productid(productid)
+		, m_instanceid(instanceid)
+		, m_userindex(userindex)
+	{}
+	virtual ~iHookDevice() {};
+
+	inline void Enable()
+	{
+		m_enabled = true;
+	}
+
+	inline void Disable()
+	{
+		m_enabled = false;
+	}
+
+	inline bool GetHookState() const
+	{
+		return m_enabled;
+	}
+
+	inline GUID GetProductGUID() const
+	{
+		return m_productid;
+	}
+
+	inline GUID GetInstanceGUID() const
+	{
+		return m_instanceid;
+	}
+
+	inline DWORD GetProductPIDVID() const
+	{
+		return m_productid.Data1;
+	}
+
+	inline DWORD GetUserIndex() const
+	{
+		return m_userindex;
+	}
+
+private:
+	bool  m_enabled;
+	GUID  m_productid;
+	GUID  m_instanceid;
+	DWORD m_userindex;
+};
+
+// Immutable product GUID to device index, open addressing on 128-bit GUID.
+// Built once in ExecuteHooks, so DirectInput enumeration does one probe instead of scanning every device.
+// Slots keep positions in device list, not pointers, so growing list never leaves them dangling.
+class iHookDeviceIndex
+{
+public:
+	struct Entry
+	{
+		GUID productid;			// true product GUID, key
+		GUID spoofid;			// product GUID with fake PIDVID
+		size_t position;		// position in device list plus one, 0 - empty slot
+	};
+
+	iHookDeviceIndex()
+		:m_mask(0)
+	{
+	}
+
+	// Every device gets slot, devices sharing product GUID follow each other in list order along probe chain
+	void Build(const std::vector<iHookDevice>& devices, DWORD fakepidvid)
+	{
+		size_t capacity = 8;
+		while (capacity < devices.size() * 2) capacity <<= 1;
+
+		m_slots.assign(capacity, Entry());
+		m_mask = capacity - 1;
+
+		for (size_t i = 0; i < devices.size(); ++i)
+		{
+			GUID productid = devices[i].GetProductGUID();
+			size_t slot = Hash(productid) & m_mask;
+			while (m_slots[slot].position) slot = (slot + 1) & m_mask;
+
+			m_slots[slot].productid = productid;
+			m_slots[slot].spoofid = productid;
+			m_slots[slot].spoofid.Data1 = fakepidvid;
+			m_slots[slot].position = i + 1;
+		}
+	}
+
+	// First hooked device with given product GUID, same as linear scan skipping unhooked devices
+	inline const Entry* Find(const GUID& productid, const std::vector<iHookDevice>& devices) const
+	{
+		if (m_slots.empty()) return nullptr;
+
+		size_t slot = Hash(productid) & m_mask;
+		while (m_slots[slot].position)
+		{
+			const Entry& entry = m_slots[slot];
+			if (IsEqualGUID(entry.productid, productid) && entry.position <= devices.size()
+				&& devices[entry.position - 1].GetHookState())
+				return &entry;
+			slot = (slot + 1) & m_mask;
+		}
+		return nullptr;
+	}
+
+	inline bool Empty() const
+	{
+		return m_slots.empty();
+	}
+
+	inline void Clear()
+	{
+		m_slots.clear();
+		m_mask = 0;
+	}
+
+private:
+	static inline size_t Hash(const GUID& guid)
+	{
+		const DWORD* p = reinterpret_cast<const DWORD*>(&guid);
+		DWORD h = p[0];
+		h = (h * 0x9E3779B1) ^ p[1];
+		h = (h * 0x9E3779B1) ^ p[2];
+		h = (h * 0x9E3779B1) ^ p[3];
+		h *= 0x9E3779B1;
+		return h ^ (h >> 16);
+	}
+
+	std::vector<Entry> m_slots;
+	size_t m_mask;
+};
+
+#endif
@@ -23,11 +23,14 @@
 #include "Logger.h"
 
 #include "InputHook.h"
-
-#include <algorithm>
+#include "ModuleName.h"
 
 static iHook *iHookThis = NULL;
 
+// Resolved once in HookLL, hooks run for every module lookup in process
+static char EmulatorPathA[MAX_PATH];
+static wchar_t EmulatorPathW[MAX_PATH];
+
 typedef HMODULE (WINAPI* LoadLibraryA_t)(LPCSTR lpLibFileName);
 typedef HMODULE (WINAPI* LoadLibraryW_t)(LPCWSTR lpLibFileName);
 
@@ -52,101 +55,88 @@ GetModuleHandleW_t oGetModuleHandleW = NULL;
 GetModuleHandleExA_t oGetModuleHandleExA = NULL;
 GetModuleHandleExW_t oGetModuleHandleExW = NULL;
 
-BOOL SelfCheckA(LPCSTR lpLibFileName)
-{
-    if(!lpLibFileName) return FALSE;
-
-    std::string strLib(lpLibFileName);
-    std::transform(strLib.begin(), strLib.end(), strLib.begin(), tolower);
-
-    if(strLib.find("xinput1_4") != std::string::npos ||
-            strLib.find("xinput1_3") != std::string::npos  ||
-            strLib.find("xinput1_2") != std::string::npos  ||
-            strLib.find("xinput1_1") != std::string::npos  ||
-            strLib.find("xinput9_1_0") != std::string::npos )
-    {
-        return TRUE;
-    }
-    else return FALSE;
-}
-
-BOOL SelfCheckW(LPCWSTR lpLibFileName)
-{
-    if(!lpLibFileName) return FALSE;
-
-    std::wstring strLib(lpLibFileName);
-    std::transform(strLib.begin(), strLib.end(), strLib.begin(), towlower);
-
-    if(strLib.find(L"xinput1_4") != std::wstring::npos ||
-            strLib.find(L"xinput1_3") != std::wstring::npos  ||
-            strLib.find(L"xinput1_2") != std::wstring::npos  ||
-            strLib.find(L"xinput1_1") != std::wstring::npos  ||
-            strLib.find(L"xinput9_1_0") != std::wstring::npos )
-    {
-        return TRUE;
-    }
-    else return FALSE;
-}
+static iHookStat StatLoadLibraryA("LoadLibraryA", iHook::HOOK_LL, LoadLibraryA);
+static iHookStat StatLoadLibraryW("LoadLibraryW", iHook::HOOK_LL, LoadLibraryW);
+static iHookStat StatLoadLibraryExA("LoadLibraryExA", iHook::HOOK_LL, LoadLibraryExA);
+static iHookStat StatLoadLibraryExW("LoadLibraryExW", iHook::HOOK_LL, LoadLibraryExW);
+static iHookStat StatGetModuleHandleA("GetModuleHandleA", iHook::HOOK_LL, GetModuleHandleA);
+static iHookStat StatGetModuleHandleW("GetModuleHandleW", iHook::HOOK_LL, GetModuleHandleW);
+static iHookStat StatGetModuleHandleExA("GetModuleHandleExA", iHook::HOOK_LL, GetModuleHandleExA);
+static iHookStat StatGetModuleHandleExW("GetModuleHandleExW", iHook::HOOK_LL, GetModuleHandleExW);
 
 HMODULE WINAPI HookLoadLibraryA(LPCSTR lpLibFileName)
 {
-    if(!iHookThis->GetState(iHook::HOOK_LL)) return oLoadLibraryA(lpLibFileName);
+    iHookCounter counter(StatLoadLibraryA);
+    if(!iHookThis->GetState(iHook::HOOK_LL) || StatLoadLibraryA.IsRetired()) return iHookThis->ModuleLoaded(oLoadLibraryA(lpLibFileName));
 
-    if(SelfCheckA(lpLibFileName))
+    if(SelfCheck(lpLibFileName))
     {
-        PrintLog("*LoadLibraryA*");
-        return oLoadLibraryA(ModuleFullPathA(iHookThis->GetEmulator()).c_str());
+        LogDebug(LOG_HOOKLL, "*LoadLibraryA*");
+        iHookThis->MarkUseful(iHook::HOOK_LL);
+        iHookThis->Retire(StatLoadLibraryA);
+        return oLoadLibraryA(EmulatorPathA);
     }
 
-    return oLoadLibraryA(lpLibFileName);
+    return iHookThis->ModuleLoaded(oLoadLibraryA(lpLibFileName));
 }
 
 HMODULE WINAPI HookLoadLibraryW(LPCWSTR lpLibFileName)
 {
-    if(!iHookThis->GetState(iHook::HOOK_LL)) return oLoadLibraryW(lpLibFileName);
+    iHookCounter counter(StatLoadLibraryW);
+    if(!iHookThis->GetState(iHook::HOOK_LL) || StatLoadLibraryW.IsRetired()) return iHookThis->ModuleLoaded(oLoadLibraryW(lpLibFileName));
 
-    if(SelfCheckW(lpLibFileName))
+    if(SelfCheck(lpLibFileName))
     {
-        PrintLog("*LoadLibraryW*");
-        return oLoadLibraryW(ModuleFullPathW(iHookThis->GetEmulator()).c_str());
+        LogDebug(LOG_HOOKLL, "*LoadLibraryW*");
+        iHookThis->MarkUseful(iHook::HOOK_LL);
+        iHookThis->Retire(StatLoadLibraryW);
+        return oLoadLibraryW(EmulatorPathW);
     }
 
-    return oLoadLibraryW(lpLibFileName);
+    return iHookThis->ModuleLoaded(oLoadLibraryW(lpLibFileName));
 }
 
 HMODULE WINAPI HookLoadLibraryExA(LPCSTR lpLibFileName, HANDLE hFile, DWORD dwFlags)
 {
-    if(!iHookThis->GetState(iHook::HOOK_LL)) return oLoadLibraryExA(lpLibFileName,hFile,dwFlags);
+    iHookCounter counter(StatLoadLibraryExA);
+    if(!iHookThis->GetState(iHook::HOOK_LL) || StatLoadLibraryExA.IsRetired()) return iHookThis->ModuleLoaded(oLoadLibraryExA(lpLibFileName,hFile,dwFlags));
 
-    if(SelfCheckA(lpLibFileName))
+    if(SelfCheck(lpLibFileName))
     {
-        PrintLog("*LoadLibraryExA*");
-        return oLoadLibraryExA(ModuleFullPathA(iHookThis->GetEmulator()).c_str(),hFile,dwFlags);
+        LogDebug(LOG_HOOKLL, "*LoadLibraryExA*");
+        iHookThis->MarkUseful(iHook::HOOK_LL);
+        iHookThis->Retire(StatLoadLibraryExA);
+        return oLoadLibraryExA(EmulatorPathA,hFile,dwFlags);
     }
 
-    return oLoadLibraryExA(lpLibFileName,hFile,dwFlags);
+    return iHookThis->ModuleLoaded(oLoadLibraryExA(lpLibFileName,hFile,dwFlags));
 }
 
 HMODULE WINAPI HookLoadLibraryExW(LPCWSTR lpLibFileName, HANDLE hFile, DWORD dwFlags)
 {
-    if(!iHookThis->GetState(iHook::HOOK_LL)) return oLoadLibraryExW(lpLibFileName,hFile,dwFlags);
+    iHookCounter counter(StatLoadLibraryExW);
+    if(!iHookThis->GetState(iHook::HOOK_LL) || StatLoadLibraryExW.IsRetired()) return iHookThis->ModuleLoaded(oLoadLibraryExW(lpLibFileName,hFile,dwFlags));
 
-    if(SelfCheckW(lpLibFileName))
+    if(SelfCheck(lpLibFileName))
     {
-        PrintLog("*LoadLibraryExW*");
-        return oLoadLibraryExW(ModuleFullPathW(iHookThis->GetEmulator()).c_str(),hFile,dwFlags);
+        LogDebug(LOG_HOOKLL, "*LoadLibraryExW*");
+        iHookThis->MarkUseful(iHook::HOOK_LL);
+        iHookThis->Retire(StatLoadLibraryExW);
+        return oLoadLibraryExW(EmulatorPathW,hFile,dwFlags);
     }
 
-    return oLoadLibraryExW(lpLibFileName,hFile,dwFlags);
+    return iHookThis->ModuleLoaded(oLoadLibraryExW(lpLibFileName,hFile,dwFlags));
 }
 
 HMODULE WINAPI HookGetModuleHandleA(LPCSTR lpModuleName)
 {
+    iHookCounter counter(StatGetModuleHandleA);
     if(!iHookThis->GetState(iHook::HOOK_LL)) return oGetModuleHandleA(lpModuleName);
 
-    if(SelfCheckA(lpModuleName))
+    if(SelfCheck(lpModuleName))
     {
-        PrintLog("*GetModuleHandleA*");
+        LogDebug(LOG_HOOKLL, "*GetModuleHandleA*");
+        iHookThis->MarkUseful(iHook::HOOK_LL);
         return iHookThis->GetEmulator();
     }
 
@@ -155,11 +145,13 @@ HMODULE WINAPI HookGetModuleHandleA(LPCSTR lpModuleName)
 
 HMODULE WINAPI HookGetModuleHandleW(LPCWSTR lpModuleName)
 {
+    iHookCounter counter(StatGetModuleHandleW);
     if(!iHookThis->GetState(iHook::HOOK_LL)) return oGetModuleHandleW(lpModuleName);
 
-    if(SelfCheckW(lpModuleName))
+    if(SelfCheck(lpModuleName))
     {
-        PrintLog("*GetModuleHandleW*");
+        LogDebug(LOG_HOOKLL, "*GetModuleHandleW*");
+        iHookThis->MarkUseful(iHook::HOOK_LL);
         return iHookThis->GetEmulator();
     }
 
@@ -168,11 +160,13 @@ HMODULE WINAPI HookGetModuleHandleW(LPCWSTR lpModuleName)
 
 BOOL WINAPI HookGetModuleHandleExA(DWORD dwFlags, LPCSTR lpModuleName, HMODULE* phModule)
 {
+    iHookCounter counter(StatGetModuleHandleExA);
     if(!iHookThis->GetState(iHook::HOOK_LL)) return oGetModuleHandleExA(dwFlags,lpModuleName,phModule);
 
-    if(SelfCheckA(lpModuleName))
+    if(SelfCheck(lpModuleName))
     {
-        PrintLog("*GetModuleHandleExA*");
+        LogDebug(LOG_HOOKLL, "*GetModuleHandleExA*");
+        iHookThis->MarkUseful(iHook::HOOK_LL);
         static HMODULE hModExA = iHookThis->GetEmulator();
         phModule = &hModExA;
         return TRUE;
@@ -183,11 +177,13 @@ BOOL WINAPI HookGetModuleHandleExA(DWORD dwFlags, LPCSTR lpModuleName, HMODULE*
 
 BOOL WINAPI HookGetModuleHandleExW(DWORD dwFlags, LPCWSTR lpModuleName, HMODULE* phModule)
 {
+    iHookCounter counter(StatGetModuleHandleExW);
     if(!iHookThis->GetState(iHook::HOOK_LL)) return oGetModuleHandleExW(dwFlags,lpModuleName,phModule);
 
-    if(SelfCheckW(lpModuleName))
+    if(SelfCheck(lpModuleName))
     {
-        PrintLog("*GetModuleHandleExW*");
+        LogDebug(LOG_HOOKLL, "*GetModuleHandleExW*");
+        iHookThis->MarkUseful(iHook::HOOK_LL);
         static HMODULE hModExW = iHookThis->GetEmulator();
         phModule = &hModExW;
         return TRUE;
@@ -197,41 +193,44 @@ BOOL WINAPI HookGetModuleHandleExW(DWORD dwFlags, LPCWSTR lpModuleName, HMODULE*
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void iHook::HookLL()
+void iHook::HookLL(iHookTransaction& transaction)
 {
-    PrintLog("Hooking DLL Loader");
+    LogInfo(LOG_HOOKLL, "Hooking DLL Loader");
     iHookThis = this;
 
+    GetModuleFileNameA(GetEmulator(), EmulatorPathA, MAX_PATH);
+    GetModuleFileNameW(GetEmulator(), EmulatorPathW, MAX_PATH);
+
 #if 1
-    if(MH_CreateHook(LoadLibraryA,HookLoadLibraryA,reinterpret_cast<void**>(&oLoadLibraryA)) == MH_OK)
-        PrintLog("Hooking LoadLibraryA");
+    if(transaction.Hook(LoadLibraryA,HookLoadLibraryA,reinterpret_cast<void**>(&oLoadLibraryA)))
+        LogInfo(LOG_HOOKLL, "Hooking LoadLibraryA");
 
-    if(MH_CreateHook(LoadLibraryW,HookLoadLibraryW,reinterpret_cast<void**>(&oLoadLibraryW)) == MH_OK)
-        PrintLog("Hooking LoadLibraryW");
+    if(transaction.Hook(LoadLibraryW,HookLoadLibraryW,reinterpret_cast<void**>(&oLoadLibraryW)))
+        LogInfo(LOG_HOOKLL, "Hooking LoadLibraryW");
 #endif
 
 #if 1
-    if(MH_CreateHook(LoadLibraryExA,HookLoadLibraryExA,reinterpret_cast<void**>(&oLoadLibraryExA)) == MH_OK)
-        PrintLog("Hooking LoadLibraryExA");
+    if(transaction.Hook(LoadLibraryExA,HookLoadLibraryExA,reinterpret_cast<void**>(&oLoadLibraryExA)))
+        LogInfo(LOG_HOOKLL, "Hooking LoadLibraryExA");
 
-    if(MH_CreateHook(LoadLibraryExW,HookLoadLibraryExW,reinterpret_cast<void**>(&oLoadLibraryExW)) == MH_OK)
-        PrintLog("Hooking LoadLibraryExW");
+    if(transaction.Hook(LoadLibraryExW,HookLoadLibraryExW,reinterpret_cast<void**>(&oLoadLibraryExW)))
+        LogInfo(LOG_HOOKLL, "Hooking LoadLibraryExW");
 #endif
 
 #if 1
-    if(MH_CreateHook(GetModuleHandleA,HookGetModuleHandleA,reinterpret_cast<void**>(&oGetModuleHandleA)) == MH_OK)
-        PrintLog("Hooking GetModuleHandleA");
+    if(transaction.Hook(GetModuleHandleA,HookGetModuleHandleA,reinterpret_cast<void**>(&oGetModuleHandleA)))
+        LogInfo(LOG_HOOKLL, "Hooking GetModuleHandleA");
 
-    if(MH_CreateHook(GetModuleHandleW,HookGetModuleHandleW,reinterpret_cast<void**>(&oGetModuleHandleW)) == MH_OK)
-        PrintLog("Hooking GetModuleHandleW");
+    if(transaction.Hook(GetModuleHandleW,HookGetModuleHandleW,reinterpret_cast<void**>(&oGetModuleHandleW)))
+        LogInfo(LOG_HOOKLL, "Hooking GetModuleHandleW");
 #endif
 
 #if 1
-    if(MH_CreateHook(GetModuleHandleExA,HookGetModuleHandleExA,reinterpret_cast<void**>(&oGetModuleHandleExA)) == MH_OK)
-        PrintLog("Hooking GetModuleHandleExA");
+    if(transaction.Hook(GetModuleHandleExA,HookGetModuleHandleExA,reinterpret_cast<void**>(&oGetModuleHandleExA)))
+        LogInfo(LOG_HOOKLL, "Hooking GetModuleHandleExA");
 
-    if(MH_CreateHook(GetModuleHandleExW,HookGetModuleHandleExW,reinterpret_cast<void**>(&oGetModuleHandleExW)) == MH_OK)
-        PrintLog("Hooking GetModuleHandleExW");
+    if(transaction.Hook(GetModuleHandleExW,HookGetModuleHandleExW,reinterpret_cast<void**>(&oGetModuleHandleExW)))
+        LogInfo(LOG_HOOKLL, "Hooking GetModuleHandleExW");
 #endif
 }
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
@@ -0,0 +1,153 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _HOOKPLAN_H_
+#define _HOOKPLAN_H_
+
+// Decides when each hook class is installed.
+// Class is due once it is enabled and module holding its targets is loaded, so hooks are not created
+// for libraries game never uses. No Windows calls, caller reports loaded modules and installs due classes.
+
+#include <stddef.h>
+
+#if defined(_MSC_VER) && _MSC_VER < 1700
+#include "pstdint.h"
+#else
+#include <stdint.h>
+#endif
+
+#define HOOKPLAN_MAX_CLASSES 8
+
+class iHookPlan
+{
+public:
+	iHookPlan()
+		:m_count(0)
+		, m_pending(0)
+	{
+	}
+
+	// module - file name like L"dinput8.dll", NULL when targets are always present
+	bool Add(uint32_t flag, const wchar_t* module)
+	{
+		if (m_count == HOOKPLAN_MAX_CLASSES) return false;
+
+		m_classes[m_count].flag = flag;
+		m_classes[m_count].module = module;
+		++m_count;
+		return true;
+	}
+
+	// enabled - classes to install, isloaded(module) tells whether module is loaded already.
+	// Returns classes due now, rest waits for OnModuleLoaded.
+	template<typename IsLoaded>
+	uint32_t Start(uint32_t enabled, IsLoaded isloaded)
+	{
+		uint32_t due = 0;
+		m_pending = 0;
+
+		for (size_t i = 0; i < m_count; ++i)
+		{
+			const Class& entry = m_classes[i];
+			if (!(entry.flag & enabled)) continue;
+
+			if (!entry.module || isloaded(entry.module)) due |= entry.flag;
+			else m_pending |= entry.flag;
+		}
+
+		m_pending &= ~due;
+		return due;
+	}
+
+	// path - full path or bare name of loaded module, extension may be missing like in LoadLibrary.
+	// Returns waiting classes that became due, each class is returned only once.
+	uint32_t OnModuleLoaded(const wchar_t* path)
+	{
+		if (!m_pending || !path) return 0;
+
+		const wchar_t* name = FileName(path);
+		uint32_t due = 0;
+
+		for (size_t i = 0; i < m_count; ++i)
+		{
+			const Class& entry = m_classes[i];
+			if ((entry.flag & m_pending) && entry.module && SameModule(name, entry.module)) due |= entry.flag;
+		}
+
+		m_pending &= ~due;
+		return due;
+	}
+
+	// Stops waiting, classes still pending are never returned
+	inline void Cancel()
+	{
+		m_pending = 0;
+	}
+
+	// Classes still waiting for their module
+	inline uint32_t GetPending() const
+	{
+		return m_pending;
+	}
+
+	static const wchar_t* FileName(const wchar_t* path)
+	{
+		const wchar_t* name = path;
+		for (const wchar_t* p = path; *p; ++p)
+		{
+			if (*p == L'\\' || *p == L'/') name = p + 1;
+		}
+		return name;
+	}
+
+	// Case insensitive compare of file names, name without extension matches module ending with ".dll"
+	static bool SameModule(const wchar_t* name, const wchar_t* module)
+	{
+		size_t i = 0;
+		for (; name[i] && module[i]; ++i)
+		{
+			if (Lower(name[i]) != Lower(module[i])) return false;
+		}
+
+		if (!name[i] && !module[i]) return true;
+		if (name[i]) return false;
+
+		const wchar_t* ext = module + i;
+		return Lower(ext[0]) == L'.' && Lower(ext[1]) == L'd' && Lower(ext[2]) == L'l' && Lower(ext[3]) == L'l' && !ext[4];
+	}
+
+private:
+	struct Class
+	{
+		uint32_t flag;
+		const wchar_t* module;
+	};
+
+	static inline wchar_t Lower(wchar_t c)
+	{
+		return (c >= L'A' && c <= L'Z') ? static_cast<wchar_t>(c + (L'a' - L'A')) : c;
+	}
+
+	Class m_classes[HOOKPLAN_MAX_CLASSES];
+	size_t m_count;
+	uint32_t m_pending;
+};
+
+#endif
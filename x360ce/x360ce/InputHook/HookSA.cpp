@@ -23,7 +23,6 @@
 #include "Misc.h"
 
 #include <Setupapi.h>
-#pragma comment(lib,"Setupapi.lib")
 
 #include "InputHook.h"
 
@@ -40,6 +39,8 @@ typedef BOOL (WINAPI* SetupDiGetDeviceInstanceIdW_t)(
 // NOTE: SetupDiGetDeviceInstanceIdW is called inside SetupDiGetDeviceInstanceIdA
 SetupDiGetDeviceInstanceIdW_t oSetupDiGetDeviceInstanceIdW = NULL;
 
+static iHookStat StatSetupDiGetDeviceInstanceIdW("SetupDiGetDeviceInstanceIdW", iHook::HOOK_SA);
+
 BOOL WINAPI HookSetupDiGetDeviceInstanceIdW(
     _In_       HDEVINFO DeviceInfoSet,
     _In_       PSP_DEVINFO_DATA DeviceInfoData,
@@ -48,99 +49,50 @@ BOOL WINAPI HookSetupDiGetDeviceInstanceIdW(
     _Out_opt_  PDWORD RequiredSize
 )
 {
+    iHookCounter counter(StatSetupDiGetDeviceInstanceIdW);
     BOOL ret = oSetupDiGetDeviceInstanceIdW(DeviceInfoSet,DeviceInfoData,DeviceInstanceId,DeviceInstanceIdSize,RequiredSize);
     if(!iHookThis->GetState(iHook::HOOK_SA)) return ret;
-    PrintLog("*SetupDiGetDeviceInstanceIdW*");
+    LogDebug(LOG_HOOKSA, "*SetupDiGetDeviceInstanceIdW*");
 
     if(GetLastError() == ERROR_INSUFFICIENT_BUFFER) return ret;
 
     if(DeviceInstanceId && ret)
     {
-        DWORD dwPid = 0, dwVid = 0;
-
-        wchar_t* strVid = wcsstr( DeviceInstanceId, L"VID_" );
-        if(!strVid || swscanf_s( strVid, L"VID_%4X", &dwVid ) < 1 )
-            return ret;
-
-        wchar_t* strPid = wcsstr( DeviceInstanceId, L"PID_" );
-        if(!strPid || swscanf_s( strPid, L"PID_%4X", &dwPid ) < 1 )
-            return ret;
+        wchar_t tempstr[MAX_PATH];
+        DWORD dwLength = (DWORD) iHookThis->RewriteDeviceId(DeviceInstanceId, false, tempstr, MAX_PATH);
+        if(!dwLength) return ret;
 
-		for(auto padcfg = iHookThis->begin(); padcfg != iHookThis->end(); ++padcfg)
+        if(DeviceInstanceIdSize <= dwLength)
         {
-            if(padcfg->GetHookState() && padcfg->GetProductPIDVID() == (DWORD)MAKELONG(dwVid,dwPid))
-            {
-                const wchar_t* strUSB = wcsstr( DeviceInstanceId, L"USB\\" );
-				const wchar_t* strRoot = wcsstr( DeviceInstanceId, L"root\\" );
-                OLECHAR tempstr[MAX_PATH];
-
-                DWORD dwHookVid = iHookThis->GetState(iHook::HOOK_PIDVID) ? LOWORD(iHookThis->GetFakePIDVID()) : LOWORD(padcfg->GetProductPIDVID());
-                DWORD dwHookPid = iHookThis->GetState(iHook::HOOK_PIDVID) ? HIWORD(iHookThis->GetFakePIDVID()) : HIWORD(padcfg->GetProductPIDVID());
-
-                if(strUSB || strRoot)
-                {
-                    const wchar_t* p = wcsrchr(DeviceInstanceId,L'\\');
-					if(p) swprintf_s(tempstr,L"USB\\VID_%04X&PID_%04X&IG_%02d%s",dwHookVid,dwHookPid, padcfg->GetUserIndex(), p );
-					else swprintf_s(tempstr,L"USB\\VID_%04X&PID_%04X&IG_%02d",dwHookVid,dwHookPid, padcfg->GetUserIndex() );
-
-                    if(DeviceInstanceIdSize < wcslen(tempstr))
-                    {
-                        SetLastError(ERROR_INSUFFICIENT_BUFFER);
-                        if(RequiredSize) *RequiredSize = (DWORD) wcslen(tempstr)+1;
-                        //return FALSE; //NOTE: return FALSE here breaks Beat Hazard
-                        continue;
-                    }
-
-                    if(DeviceInstanceIdSize > wcslen(tempstr))
-                    {
-                        PrintLog("Device string change:",DeviceInstanceId);
-                        PrintLog("%ls",DeviceInstanceId);
-                        wcscpy_s(DeviceInstanceId,DeviceInstanceIdSize,tempstr);
-                        if(RequiredSize) *RequiredSize = (DWORD) wcslen(tempstr)+1;
-                        PrintLog("%ls",DeviceInstanceId);
-                        continue;
-                    }
-                }
-
-                wchar_t* strHID = wcsstr( DeviceInstanceId, L"HID\\" );
-
-                if(strHID)
-                {
-                    wchar_t* p = wcsrchr(DeviceInstanceId,L'\\');
-                    swprintf_s(tempstr,L"HID\\VID_%04X&PID_%04X&IG_%02d%s",dwHookVid,dwHookPid, padcfg->GetUserIndex(), p );
-
-                    if(DeviceInstanceIdSize < wcslen(tempstr))
-                    {
-                        SetLastError(ERROR_INSUFFICIENT_BUFFER);
-                        if(RequiredSize) *RequiredSize = (DWORD) wcslen(tempstr)+1;
-                        //return FALSE; //NOTE: return FALSE here breaks Beat Hazard
-                        continue;
-                    }
-
-                    if(DeviceInstanceIdSize > wcslen(tempstr))
-                    {
-                        PrintLog("Device string change:",DeviceInstanceId);
-                        PrintLog("%ls",DeviceInstanceId);
-                        wcscpy_s(DeviceInstanceId,DeviceInstanceIdSize,tempstr);
-                        if(RequiredSize) *RequiredSize = (DWORD) wcslen(tempstr)+1;
-                        PrintLog("%ls",DeviceInstanceId);
-                        continue;
-                    }
-                }
-            }
+            SetLastError(ERROR_INSUFFICIENT_BUFFER);
+            if(RequiredSize) *RequiredSize = dwLength+1;
+            //return FALSE; //NOTE: return FALSE here breaks Beat Hazard
+            return ret;
         }
+
+        iHookThis->MarkUseful(iHook::HOOK_SA);
+        if(iHookThis->GetState(iHook::HOOK_PIDVID)) iHookThis->MarkUseful(iHook::HOOK_PIDVID);
+        LogInfo(LOG_HOOKSA, "Device string change:");
+        LogInfo(LOG_HOOKSA, "%ls",DeviceInstanceId);
+        memcpy(DeviceInstanceId,tempstr,(dwLength+1)*sizeof(wchar_t));
+        if(RequiredSize) *RequiredSize = dwLength+1;
+        LogInfo(LOG_HOOKSA, "%ls",DeviceInstanceId);
     }
 
     return ret;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void iHook::HookSA()
+void iHook::HookSA(iHookTransaction& transaction)
 {
-    PrintLog("Hooking SetupApi");
+    LogInfo(LOG_HOOKSA, "Hooking SetupApi");
     iHookThis = this;
 
-    if(MH_CreateHook(SetupDiGetDeviceInstanceIdW,HookSetupDiGetDeviceInstanceIdW,reinterpret_cast<void**>(&oSetupDiGetDeviceInstanceIdW)) == MH_OK)
-        PrintLog("Hooking SetupDiGetDeviceInstanceId");
+    void* pSetupDiGetDeviceInstanceIdW = GetModuleProc(L"setupapi.dll", "SetupDiGetDeviceInstanceIdW");
+    if(pSetupDiGetDeviceInstanceIdW && transaction.Hook(pSetupDiGetDeviceInstanceIdW,HookSetupDiGetDeviceInstanceIdW,reinterpret_cast<void**>(&oSetupDiGetDeviceInstanceIdW)))
+    {
+        StatSetupDiGetDeviceInstanceIdW.SetTarget(pSetupDiGetDeviceInstanceIdW);
+        LogInfo(LOG_HOOKSA, "Hooking SetupDiGetDeviceInstanceId");
+    }
 }
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
@@ -0,0 +1,184 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HOOKSTAT_H_
+#define _HOOKSTAT_H_
+
+#include "Logger.h"
+
+// Hit and latency counters of one detour, defined static next to detour.
+// All counters are linked into one list at DLL load, list is never changed later so walking it needs no lock.
+class iHookStat
+{
+public:
+	// flag - hook class (iHook::HOOK_*) retired together with this hook
+	// target - hooked function, NULL when it is resolved at install time (see SetTarget)
+	// or for COM methods which are disabled by their own hooks
+	iHookStat(const char* name, DWORD flag, LPVOID target = NULL)
+		:m_name(name)
+		, m_flag(flag)
+		, m_target(target)
+		, m_hits(0)
+		, m_ticks(0)
+		, m_retired(0)
+		, m_next(Head())
+	{
+		Head() = this;
+	}
+
+	inline void Add(LONGLONG ticks)
+	{
+		InterlockedIncrement(&m_hits);
+		InterlockedExchangeAdd64(&m_ticks, ticks);
+	}
+
+	// Hook finished its job, its detour passes calls through until monitor thread disables it.
+	// Returns false when hook was retired before.
+	inline bool Retire()
+	{
+		return InterlockedCompareExchange(&m_retired, 1, 0) == 0;
+	}
+
+	inline bool IsRetired() const
+	{
+		return m_retired != 0;
+	}
+
+	// Monitor thread takes each retired hook once to disable it
+	inline bool TakeRetired()
+	{
+		return InterlockedCompareExchange(&m_retired, 2, 1) == 1;
+	}
+
+	inline const char* GetName() const
+	{
+		return m_name;
+	}
+
+	inline DWORD GetFlag() const
+	{
+		return m_flag;
+	}
+
+	inline LPVOID GetTarget() const
+	{
+		return m_target;
+	}
+
+	// Set once hook of function taken from loaded module is created
+	inline void SetTarget(LPVOID target)
+	{
+		m_target = target;
+	}
+
+	inline iHookStat* GetNext() const
+	{
+		return m_next;
+	}
+
+	static inline iHookStat* First()
+	{
+		return Head();
+	}
+
+	// Set once at hook install, counters cost two QueryPerformanceCounter calls per detour call
+	static inline void SetCounting(bool counting)
+	{
+		Counting() = counting;
+	}
+
+	static inline bool GetCounting()
+	{
+		return Counting();
+	}
+
+	// Writes counters of hooks in flag classes to log, hooks never called are skipped
+	static void Log(DWORD flag)
+	{
+		if (!LogEnabled(LOG_HOOK, LOGLEVEL_INFO)) return;
+
+		LARGE_INTEGER frequency;
+		if (!QueryPerformanceFrequency(&frequency) || !frequency.QuadPart) return;
+
+		for (iHookStat* stat = First(); stat; stat = stat->GetNext())
+		{
+			if (!(stat->m_flag & flag)) continue;
+
+			LONG hits = stat->m_hits;
+			if (!hits) continue;
+
+			LONGLONG us = stat->m_ticks * 1000000 / frequency.QuadPart;
+			LogInfo(LOG_HOOK, "Hook %s: %d calls, %I64d us total, %I64d us average", stat->m_name, hits, us, us / hits);
+		}
+	}
+
+private:
+	iHookStat(const iHookStat&);
+	iHookStat& operator=(const iHookStat&);
+
+	static inline iHookStat*& Head()
+	{
+		static iHookStat* head = NULL;
+		return head;
+	}
+
+	static inline bool& Counting()
+	{
+		static bool counting = false;
+		return counting;
+	}
+
+	const char* m_name;
+	DWORD m_flag;
+	volatile LPVOID m_target;
+	volatile LONG m_hits;
+	volatile LONGLONG m_ticks;
+	volatile LONG m_retired;	// 0 - active, 1 - retired, 2 - disabled
+	iHookStat* m_next;
+};
+
+// Counts one detour call, time is taken from detour entry to return including original function.
+// Does nothing unless counting was switched on at hook install.
+class iHookCounter
+{
+public:
+	iHookCounter(iHookStat& stat)
+		:m_stat(iHookStat::GetCounting() ? &stat : NULL)
+	{
+		if (m_stat) QueryPerformanceCounter(&m_start);
+	}
+
+	~iHookCounter()
+	{
+		if (!m_stat) return;
+
+		LARGE_INTEGER end;
+		QueryPerformanceCounter(&end);
+		m_stat->Add(end.QuadPart - m_start.QuadPart);
+	}
+
+private:
+	iHookCounter(const iHookCounter&);
+	iHookCounter& operator=(const iHookCounter&);
+
+	iHookStat* m_stat;
+	LARGE_INTEGER m_start;
+};
+
+#endif
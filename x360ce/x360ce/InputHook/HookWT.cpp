@@ -33,7 +33,8 @@ WinVerifyTrust_t oWinVerifyTrust = NULL;
 LONG WINAPI HookWinVerifyTrust(HWND hwnd, GUID *pgActionID,LPVOID pWVTData)
 {
     if(!iHookThis->GetState(iHook::HOOK_WT)) return oWinVerifyTrust(hwnd,pgActionID,pWVTData);
-    PrintLog("*WinVerifyTrust*");
+    LogDebug(LOG_HOOKWT, "*WinVerifyTrust*");
+    iHookThis->MarkUseful(iHook::HOOK_WT);
 
     UNREFERENCED_PARAMETER(hwnd);
     UNREFERENCED_PARAMETER(pgActionID);
@@ -41,9 +42,11 @@ LONG WINAPI HookWinVerifyTrust(HWND hwnd, GUID *pgActionID,LPVOID pWVTData)
     return 0;
 }
 
-void iHook::HookWT()
+void iHook::HookWT(iHookTransaction& transaction)
 {
     iHookThis = this;
-    if(MH_CreateHook(WinVerifyTrust,HookWinVerifyTrust,reinterpret_cast<void**>(&oWinVerifyTrust)) == MH_OK)
-        PrintLog("Hooking WinVerifyTrust");
+
+    void* pWinVerifyTrust = GetModuleProc(L"wintrust.dll", "WinVerifyTrust");
+    if(pWinVerifyTrust && transaction.Hook(pWinVerifyTrust,HookWinVerifyTrust,reinterpret_cast<void**>(&oWinVerifyTrust)))
+        LogInfo(LOG_HOOKWT, "Hooking WinVerifyTrust");
 }
\ No newline at end of file
@@ -24,6 +24,11 @@
 #include <vector>
 #include <MinHook.h>
 #include "Logger.h"
+#include "DeviceId.h"
+#include "HookDevice.h"
+#include "VTableHook.h"
+#include "HookStat.h"
+#include "HookPlan.h"
 
 #if _MSC_VER < 1700
 #include "mutex.h"
@@ -31,57 +36,57 @@
 #include <mutex>
 #endif
 
-class iHookDevice
+// Hooks created at runtime, from COM and DirectInput hooks, are only queued here
+// and enabled in one go when transaction goes out of scope, so other threads are frozen once per call.
+class iHookTransaction
 {
 public:
-	iHookDevice(DWORD userindex, const GUID& productid, const GUID& instanceid)
-		:m_enabled(true)
-		, m_productid(productid)
-		, m_instanceid(instanceid)
-		, m_userindex(userindex)
-	{}
-	virtual ~iHookDevice() {};
-
-	inline void Enable()
+	// vtable - when set, COM methods are hooked by swapping vtable slots, see HookSlot
+	iHookTransaction(iHookVTable* vtable = NULL)
+		:m_vtable(vtable)
+		, m_queued(0)
 	{
-		m_enabled = true;
 	}
 
-	inline void Disable()
+	virtual ~iHookTransaction()
 	{
-		m_enabled = false;
+		if (m_queued) MH_ApplyQueued();
 	}
 
-	inline bool GetHookState()
+	// Returns true when hook for target was created now, false when it already existed or failed.
+	// Existing hooks are queued too, they may have been disabled in meantime.
+	bool Hook(void* target, void* const detour, void** original)
 	{
-		return m_enabled;
-	}
+		MH_STATUS status = MH_CreateHook(target, detour, original);
+		if (status != MH_OK && status != MH_ERROR_ALREADY_CREATED) return false;
 
-	inline GUID GetProductGUID()
-	{
-		return m_productid;
+		if (MH_QueueEnableHook(target) == MH_OK) ++m_queued;
+		return status == MH_OK;
 	}
 
-	inline GUID GetInstanceGUID()
+	// COM method hook, slot is address of method in interface vtable, like &pDevice->lpVtbl->GetDeviceInfo.
+	// Swaps vtable slot when vtable hooking is enabled, falls back to inline hook of method when slot is read-only.
+	template<typename T>
+	bool HookSlot(T const* slot, void* const detour, void** original)
 	{
-		return m_instanceid;
-	}
+		void** method = reinterpret_cast<void**>(const_cast<T*>(slot));
 
-	inline DWORD GetProductPIDVID()
-	{
-		return m_productid.Data1;
-	}
+		if (m_vtable)
+		{
+			iHookVTable::Result result = m_vtable->Patch(method, detour, original);
+			if (result != iHookVTable::VTABLE_FAILED) return result == iHookVTable::VTABLE_PATCHED;
+			m_vtable->MarkInline(*method, detour);
+		}
 
-	inline DWORD GetUserIndex()
-	{
-		return m_userindex;
+		return Hook(*method, detour, original);
 	}
 
 private:
-	bool  m_enabled;
-	GUID  m_productid;
-	GUID  m_instanceid;
-	DWORD m_userindex;
+	iHookTransaction(const iHookTransaction&);
+	iHookTransaction& operator=(const iHookTransaction&);
+
+	iHookVTable* m_vtable;
+	DWORD m_queued;
 };
 
 class iHook
@@ -98,19 +103,37 @@ public:
 		:m_hookmask(0x80000000)
 		, m_fakepidvid(MAKELONG(0x045E, 0x028E))
 		, m_timeout(30)
+		, m_timeout_thread(NULL)
+		, m_retire_event(NULL)
+		, m_retired(0)
+		, m_pending(0)
+		, m_useful(0)
+		, m_loadcookie(NULL)
+		, m_installer(0)
 	{
+		// module holding targets of each hook class, class is installed when module gets loaded
+		m_plan.Add(HOOK_LL, NULL);
+		m_plan.Add(HOOK_COM, L"ole32.dll");
+		m_plan.Add(HOOK_DI, L"dinput8.dll");
+		m_plan.Add(HOOK_SA, L"setupapi.dll");
+		m_plan.Add(HOOK_WT, L"wintrust.dll");
 	}
 	virtual ~iHook()
 	{
+		UnregisterLoadNotification();
+
 #if _MSC_VER < 1700
 		lock_guard lock(m_mutex);
 #else
 		std::lock_guard<std::mutex> lock(m_mutex);
 #endif
+		m_vtable.Restore();
 		MH_Uninitialize();
+		m_index.Clear();
 		m_devices.clear();
 
 		if (m_timeout_thread) CloseHandle(m_timeout_thread);
+		if (m_retire_event) CloseHandle(m_retire_event);
 	};
 
 	static const DWORD HOOK_NONE		= (DWORD)0;			// 0x00000000
@@ -120,10 +143,12 @@ public:
 	static const DWORD HOOK_PIDVID		= (DWORD)1 << 3;	// 0x00000008
 	static const DWORD HOOK_NAME		= (DWORD)1 << 4;	// 0x00000010
 	static const DWORD HOOK_SA			= (DWORD)1 << 5;	// 0x00000020
+	static const DWORD HOOK_VTBL		= (DWORD)1 << 6;	// 0x00000040
 
 	static const DWORD HOOK_WT			= (DWORD)1 << 24;	// 0x10000000
 	static const DWORD HOOK_STOP		= (DWORD)1 << 25;	// 0x20000000
 	static const DWORD HOOK_NOTIMEOUT	= (DWORD)1 << 26;	// 0x40000000
+	static const DWORD HOOK_NORETIRE	= (DWORD)1 << 27;	// 0x08000000
 	static const DWORD HOOK_DISABLE		= (DWORD)1 << 31;	// 0x80000000
 
 	typedef std::vector<iHookDevice>::iterator iterator;
@@ -147,32 +172,73 @@ public:
 	inline void EnableHook(const DWORD& flag)
 	{
 		m_hookmask |= flag;
+		ClearDeviceIds();
 	}
 
 	inline void DisableHook(const DWORD& flag)
 	{
 		m_hookmask &= ~flag;
+		ClearDeviceIds();
 	}
 
 	inline const bool GetState(const DWORD& flag = HOOK_NONE) const
 	{
 		if (m_hookmask & HOOK_DISABLE || m_hookmask == HOOK_NONE) return false;
+		if (m_retired & flag) return false;
 		return (m_hookmask & flag) == flag;
 	}
 
+	// Hook class finished its job, its detours pass calls through from now on
+	// and monitor thread disables its hooks in one batch.
+	// Does nothing with HOOK_NORETIRE, hooks stay for games that enumerate again later.
+	inline void Retire(const DWORD& flag)
+	{
+		if (!m_retire_event) return;
+		if ((DWORD)InterlockedOr(&m_retired, flag) & flag) return;
+
+		for (iHookStat* stat = iHookStat::First(); stat; stat = stat->GetNext())
+		{
+			if (stat->GetFlag() & flag) stat->Retire();
+		}
+
+		InterlockedOr(&m_pending, flag);
+		SetEvent(m_retire_event);
+	}
+
+	// Same for single hook, other hooks of its class stay.
+	// Detour checks stat.IsRetired() itself until monitor thread disables it.
+	inline void Retire(iHookStat& stat)
+	{
+		if (!m_retire_event) return;
+		if (stat.Retire()) SetEvent(m_retire_event);
+	}
+
 	inline DWORD GetMask()
 	{
 		return m_hookmask;
 	}
 
+	// Hook classes that changed result of hooked API at least once, collected for learning mode
+	inline void MarkUseful(const DWORD& flag)
+	{
+		if (((DWORD)m_useful & flag) != flag) InterlockedOr(&m_useful, flag);
+	}
+
+	inline DWORD GetUsefulMask() const
+	{
+		return m_useful;
+	}
+
 	inline void SetMask(const DWORD& mask)
 	{
 		m_hookmask = mask;
+		ClearDeviceIds();
 	}
 
 	inline void SetFakePIDVID(const DWORD& pidvid)
 	{
 		m_fakepidvid = pidvid;
+		ClearDeviceIds();
 	}
 
 	inline DWORD GetFakePIDVID()
@@ -190,16 +256,44 @@ public:
 		return m_devices.at(dwUserIndex);
 	}
 
+	// Vtable hook registry, NULL when COM methods are hooked inline
+	inline iHookVTable* GetVTable()
+	{
+		return GetState(HOOK_VTBL) ? &m_vtable : NULL;
+	}
+
+	inline const iHookDeviceIndex::Entry* FindDevice(const GUID& productid) const
+	{
+		return m_index.Find(productid, m_devices);
+	}
+
+	// Builds spoofed instance ID for hooked pad into out, returns its length or 0 when id is not one of hooked pads.
+	// ouya - also accept OUYA style "VID&"/"PID&" ids
+	size_t RewriteDeviceId(const wchar_t* id, bool ouya, wchar_t* out, size_t size)
+	{
+		return RewriteId(id, ouya, false, out, size);
+	}
+
+	// Same for hardware and compatible IDs, only their VID and PID are replaced and only with HOOK_PIDVID
+	size_t RewriteHardwareId(const wchar_t* id, wchar_t* out, size_t size)
+	{
+		return RewriteId(id, false, true, out, size);
+	}
+
 #if _MSC_VER < 1700
 	inline void AddHook(DWORD userindex, const GUID& productid, const GUID& instanceid)
 	{
 		iHookDevice hdevice(userindex, productid, instanceid);
 		m_devices.push_back(hdevice);
+		if (!m_index.Empty()) m_index.Build(m_devices, m_fakepidvid);
+		ClearDeviceIds();
 	}
 #else
 	inline void AddHook(DWORD userindex, const GUID& productid, const GUID& instanceid)
 	{
 		m_devices.emplace_back(userindex, productid, instanceid);
+		if (!m_index.Empty()) m_index.Build(m_devices, m_fakepidvid);
+		ClearDeviceIds();
 	}
 #endif
 
@@ -210,18 +304,83 @@ public:
 
 	inline static DWORD WINAPI ThreadProc(_In_  LPVOID lpParameter)
 	{
-		DWORD* pTimeout = reinterpret_cast<DWORD*>(lpParameter);
-		if (!pTimeout) return 0;
+		iHook* pHook = reinterpret_cast<iHook*>(lpParameter);
+		if (!pHook) return 0;
 
-		PrintLog("Waiting for hooks...");
-		Sleep(*pTimeout * 1000);
+		bool timed = pHook->HasTimeout();
+		if (timed) LogInfo(LOG_HOOK, "Waiting for hooks...");
+		DWORD deadline = GetTickCount() + pHook->m_timeout * 1000;
 
-		PrintLog("Hook timeout");
-		MH_Uninitialize();
+		for (;;)
+		{
+			DWORD wait = INFINITE;
+			if (timed)
+			{
+				LONG left = (LONG)(deadline - GetTickCount());
+				if (left <= 0) break;
+				wait = (DWORD)left;
+			}
+
+			// timeout only, nothing to retire
+			if (!pHook->m_retire_event)
+			{
+				Sleep(wait);
+				break;
+			}
+
+			if (WaitForSingleObject(pHook->m_retire_event, wait) != WAIT_OBJECT_0) break;
+			pHook->DisableRetired();
+		}
+
+		// without timeout wait ends only when iHook closes the event
+		if (!timed) return 0;
+
+		LogWarning(LOG_HOOK, "Hook timeout");
+
+		// loader lock is taken before m_mutex by load notifications, so unregister outside of it
+		pHook->UnregisterLoadNotification();
+		iHookStat::Log(~(DWORD)pHook->m_retired);
+
+		{
+			// module load reported through LoadLibrary hooks may be installing hooks right now
+#if _MSC_VER < 1700
+			lock_guard lock(pHook->m_mutex);
+#else
+			std::lock_guard<std::mutex> lock(pHook->m_mutex);
+#endif
+			pHook->m_plan.Cancel();
+			pHook->m_vtable.Restore();
+			MH_Uninitialize();
+		}
 
 		ExitThread(0);
 	}
 
+	// Runs on monitor thread, disables hooks retired since last call, alone or with their class
+	void DisableRetired()
+	{
+		DWORD retired = (DWORD)InterlockedExchange(&m_pending, 0);
+
+		DWORD count = 0;
+		for (iHookStat* stat = iHookStat::First(); stat; stat = stat->GetNext())
+		{
+			if (!stat->TakeRetired()) continue;
+			if (!(stat->GetFlag() & retired)) LogInfo(LOG_HOOK, "Retired hook %s", stat->GetName());
+			if (!stat->GetTarget()) continue;
+			if (MH_QueueDisableHook(stat->GetTarget()) == MH_OK) ++count;
+		}
+		if (count) MH_ApplyQueued();
+
+		if (!retired) return;
+		LogInfo(LOG_HOOK, "Retired hooks 0x%08X, %u disabled", retired, count);
+		iHookStat::Log(retired);
+	}
+
+	inline bool HasTimeout()
+	{
+		return m_timeout > 0 && !GetState(HOOK_NOTIMEOUT);
+	}
+
 	inline void ExecuteHooks()
 	{
 		if (!GetState())
@@ -236,45 +395,253 @@ public:
 		std::lock_guard<std::mutex> lock(m_mutex);
 #endif
 
-		PrintLog("InputHook starting with mask 0x%08X", m_hookmask);
+		LogInfo(LOG_HOOK, "InputHook starting with mask 0x%08X", m_hookmask);
+
+		// read once, detours skip counting when nobody logs the counters
+		iHookStat::SetCounting(LogEnabled(LOG_HOOK, LOGLEVEL_INFO));
+
+		m_index.Build(m_devices, m_fakepidvid);
 
 		MH_Initialize();
 
-		if (GetState(HOOK_LL))
-			HookLL();
+		static const DWORD classes[] = { HOOK_LL, HOOK_COM, HOOK_DI, HOOK_SA, HOOK_WT };
+		DWORD enabled = 0;
+		for (size_t i = 0; i < _countof(classes); ++i)
+		{
+			if (GetState(classes[i])) enabled |= classes[i];
+		}
 
-		if (GetState(HOOK_COM))
-			HookCOM();
+		// registered before modules are checked, so no load is missed in between
+		RegisterLoadNotification();
+		InstallHooks(m_plan.Start(enabled, IsModuleLoaded));
 
-		if (GetState(HOOK_DI))
-			HookDI();
+		if (m_plan.GetPending()) LogInfo(LOG_HOOK, "Hooks 0x%08X wait for their modules", m_plan.GetPending());
+		else UnregisterLoadNotification();
 
-		if (GetState(HOOK_SA))
-			HookSA();
+		// monitor thread waits for timeout and disables retired hooks, with or without timeout
+		if (!GetState(HOOK_NORETIRE)) m_retire_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+		if (HasTimeout() || m_retire_event) m_timeout_thread = CreateThread(NULL, NULL, ThreadProc, this, NULL, NULL);
+	}
 
-		if (GetState(HOOK_WT))
-			HookWT();
+	void HookDICOM(REFIID riidltf, LPVOID *ppv);
 
-		MH_EnableHook(MH_ALL_HOOKS);
+	// Installs waiting hook classes whose module is path
+	void OnModuleLoaded(const wchar_t* path)
+	{
+		if (!m_plan.GetPending() || m_installer == GetCurrentThreadId()) return;
 
-		if (m_timeout > 0 && !GetState(HOOK_NOTIMEOUT)) m_timeout_thread = CreateThread(NULL, NULL, ThreadProc, (LPVOID*)&m_timeout, NULL, NULL);
+#if _MSC_VER < 1700
+		lock_guard lock(m_mutex);
+#else
+		std::lock_guard<std::mutex> lock(m_mutex);
+#endif
+		DWORD due = m_plan.OnModuleLoaded(path);
+		if (!due) return;
+
+		LogInfo(LOG_HOOK, "Module %ls loaded, installing hooks 0x%08X", path, due);
+		InstallHooks(due);
+
+		if (!m_plan.GetPending()) UnregisterLoadNotification();
 	}
 
-	void HookDICOM(REFIID riidltf, LPVOID *ppv);
+	// LoadLibrary hooks report loaded modules when loader notifications are not available (before Vista)
+	inline HMODULE ModuleLoaded(HMODULE hModule)
+	{
+		if (!hModule || m_loadcookie || !m_plan.GetPending()) return hModule;
+
+		wchar_t path[MAX_PATH];
+		if (GetModuleFileNameW(hModule, path, MAX_PATH)) OnModuleLoaded(path);
+		return hModule;
+	}
+
+	// Target of hook class that is installed once its module is loaded
+	static inline void* GetModuleProc(const wchar_t* module, const char* name)
+	{
+		HMODULE hModule = GetModuleHandleW(module);
+		return hModule ? reinterpret_cast<void*>(GetProcAddress(hModule, name)) : NULL;
+	}
 
 private:
+	// Rewrites instance ID, or VID and PID of hardware ID, through cache
+	size_t RewriteId(const wchar_t* id, bool ouya, bool hardware, wchar_t* out, size_t size)
+	{
+		DWORD tag = (ouya ? 1 : 0) | (GetState(HOOK_PIDVID) ? 2 : 0) | (hardware ? 4 : 0);
+		size_t length = 0;
+
+		// pads are enabled and disabled through GetPadConfig, so their state goes to the tag
+		for (size_t i = 0; i < m_devices.size() && i < 29; ++i)
+		{
+			if (m_devices[i].GetHookState()) tag |= (DWORD)8 << i;
+		}
+
+#if _MSC_VER < 1700
+		lock_guard lock(m_idmutex);
+#else
+		std::lock_guard<std::mutex> lock(m_idmutex);
+#endif
+		if (m_idcache.Find(id, tag, out, size, &length)) return length;
+
+		DeviceId parsed;
+		if (ParseDeviceId(id, ouya, &parsed) && (hardware || parsed.bus != DEVICEID_BUS_NONE))
+		{
+			// last hooked pad with matching PIDVID wins
+			iHookDevice* device = nullptr;
+			DWORD pidvid = MAKELONG(parsed.vid, parsed.pid);
+			for (auto padcfg = m_devices.begin(); padcfg != m_devices.end(); ++padcfg)
+			{
+				if (padcfg->GetHookState() && padcfg->GetProductPIDVID() == pidvid)
+					device = &(*padcfg);
+			}
+
+			if (device && !hardware)
+			{
+				DWORD hookpidvid = (tag & 2) ? m_fakepidvid : device->GetProductPIDVID();
+				length = FormatDeviceId(out, size, parsed, LOWORD(hookpidvid), HIWORD(hookpidvid), device->GetUserIndex());
+
+				// output did not fit, caller with bigger buffer must not get the failure from cache
+				if (!length) return 0;
+			}
+			else if (device && (tag & 2))
+			{
+				// no instance part to rebuild, VID and PID digits are replaced in place
+				length = ReplaceDeviceIdPidVid(out, size, id, LOWORD(m_fakepidvid), HIWORD(m_fakepidvid));
+				if (!length) return 0;
+			}
+		}
+
+		m_idcache.Store(id, tag, out, length);
+		return length;
+	}
+
+	// Cached instance IDs depend on hook flags, fake PIDVID and pad list.
+	inline void ClearDeviceIds()
+	{
+#if _MSC_VER < 1700
+		lock_guard lock(m_idmutex);
+#else
+		std::lock_guard<std::mutex> lock(m_idmutex);
+#endif
+		m_idcache.Clear();
+	}
+
+#if _MSC_VER < 1700
+	recursive_mutex m_idmutex;
+#else
+	std::mutex m_idmutex;
+#endif
+	DeviceIdCache m_idcache;
+
 	DWORD m_hookmask;
 	DWORD m_fakepidvid;
 	DWORD m_timeout;
 	HANDLE m_timeout_thread;
+	HANDLE m_retire_event;
+	volatile LONG m_retired;	// hook classes retired, see Retire
+	volatile LONG m_pending;	// retired classes not disabled yet
+	volatile LONG m_useful;		// see MarkUseful
 
 	std::vector<iHookDevice> m_devices;
+	iHookDeviceIndex m_index;
+	iHookVTable m_vtable;
+	iHookPlan m_plan;
+	PVOID m_loadcookie;			// loader notification, NULL when LoadLibrary hooks report loads
+	volatile DWORD m_installer;	// thread running InstallHooks, its own loads (forwarded exports) are ignored
+
+	// LdrRegisterDllNotification (Vista and later), structures are not in SDK headers
+	struct LdrString
+	{
+		USHORT Length;
+		USHORT MaximumLength;
+		PWSTR Buffer;
+	};
+
+	struct LdrDllLoaded
+	{
+		ULONG Flags;
+		const LdrString* FullDllName;
+		const LdrString* BaseDllName;
+		PVOID DllBase;
+		ULONG SizeOfImage;
+	};
+
+	typedef VOID (CALLBACK *LdrDllNotification_t)(ULONG reason, const LdrDllLoaded* data, PVOID context);
+	typedef LONG (NTAPI *LdrRegisterDllNotification_t)(ULONG flags, LdrDllNotification_t callback, PVOID context, PVOID* cookie);
+	typedef LONG (NTAPI *LdrUnregisterDllNotification_t)(PVOID cookie);
+
+	static VOID CALLBACK LoadNotification(ULONG reason, const LdrDllLoaded* data, PVOID context)
+	{
+		static const ULONG LDR_DLL_NOTIFICATION_REASON_LOADED = 1;
+		if (reason != LDR_DLL_NOTIFICATION_REASON_LOADED || !data || !data->BaseDllName || !data->BaseDllName->Buffer) return;
+
+		// BaseDllName is counted string, not terminated
+		wchar_t name[MAX_PATH];
+		size_t length = data->BaseDllName->Length / sizeof(wchar_t);
+		if (length >= MAX_PATH) length = MAX_PATH - 1;
+		memcpy(name, data->BaseDllName->Buffer, length * sizeof(wchar_t));
+		name[length] = L'\0';
+
+		reinterpret_cast<iHook*>(context)->OnModuleLoaded(name);
+	}
+
+	void RegisterLoadNotification()
+	{
+		if (m_loadcookie) return;
+
+		LdrRegisterDllNotification_t pRegister = reinterpret_cast<LdrRegisterDllNotification_t>(
+			GetProcAddress(GetModuleHandleW(L"ntdll.dll"), "LdrRegisterDllNotification"));
+		if (!pRegister || pRegister(0, LoadNotification, this, &m_loadcookie) < 0) m_loadcookie = NULL;
+	}
+
+	void UnregisterLoadNotification()
+	{
+		PVOID cookie = InterlockedExchangePointer(&m_loadcookie, NULL);
+		if (!cookie) return;
+
+		LdrUnregisterDllNotification_t pUnregister = reinterpret_cast<LdrUnregisterDllNotification_t>(
+			GetProcAddress(GetModuleHandleW(L"ntdll.dll"), "LdrUnregisterDllNotification"));
+		if (pUnregister) pUnregister(cookie);
+	}
+
+	static bool IsModuleLoaded(const wchar_t* module)
+	{
+		return GetModuleHandleW(module) != NULL;
+	}
+
+	// Creates hooks of classes in due and enables them with one thread freeze.
+	// Class retired while it waited for its module is skipped.
+	void InstallHooks(DWORD due)
+	{
+		// classes switched off for a moment (x360ce loading DirectInput itself) are still installed
+		due &= ~(DWORD)m_retired;
+		if (!due) return;
+
+		m_installer = GetCurrentThreadId();
+		{
+			iHookTransaction transaction;
+
+			if (due & HOOK_LL)
+				HookLL(transaction);
+
+			if (due & HOOK_COM)
+				HookCOM(transaction);
+
+			if (due & HOOK_DI)
+				HookDI(transaction);
+
+			if (due & HOOK_SA)
+				HookSA(transaction);
+
+			if (due & HOOK_WT)
+				HookWT(transaction);
+		}
+		m_installer = 0;
+	}
 
-	void HookLL();
-	void HookCOM();
-	void HookDI();
-	void HookWT();
-	void HookSA();
+	void HookLL(iHookTransaction& transaction);
+	void HookCOM(iHookTransaction& transaction);
+	void HookDI(iHookTransaction& transaction);
+	void HookWT(iHookTransaction& transaction);
+	void HookSA(iHookTransaction& transaction);
 };
 
 #endif
@@ -0,0 +1,67 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _MODULENAME_H_
+#define _MODULENAME_H_
+
+// XInput library name matching for LoadLibrary and GetModuleHandle hooks.
+// Works on A and W names alike, no Windows calls.
+
+#include <stddef.h>
+#include <windows.h>
+
+template<typename T>
+inline T LowerAscii(T c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<T>(c + ('a' - 'A')) : c;
+}
+
+// Case insensitive match of xinput1_1 - xinput1_4 and xinput9_1_0 in file name part of path.
+// Single pass without copies, match is forgotten when directory separator follows it.
+template<typename T>
+BOOL SelfCheck(const T* lpLibFileName)
+{
+    if(!lpLibFileName) return FALSE;
+
+    static const char prefix[] = "xinput";
+    BOOL found = FALSE;
+
+    for(const T* p = lpLibFileName; *p; ++p)
+    {
+        if(*p == '\\' || *p == '/')
+        {
+            found = FALSE;
+            continue;
+        }
+
+        if(found || LowerAscii(*p) != 'x') continue;
+
+        size_t i = 1;
+        while(i < 6 && LowerAscii(p[i]) == prefix[i]) ++i;
+        if(i < 6) continue;
+
+        const T* t = p + 6;
+        if(t[0] == '1' && t[1] == '_' && t[2] >= '1' && t[2] <= '4') found = TRUE;
+        else if(t[0] == '9' && t[1] == '_' && t[2] == '1' && t[3] == '_' && t[4] == '0') found = TRUE;
+    }
+
+    return found;
+}
+
+#endif
@@ -0,0 +1,223 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _VTABLEHOOK_H_
+#define _VTABLEHOOK_H_
+
+#include <stddef.h>
+#include <windows.h>
+
+#if _MSC_VER < 1700
+#include "mutex.h"
+#else
+#include <mutex>
+#endif
+
+#define VTABLEHOOK_MAX_SLOTS 32
+
+// Page protection seen by iHookVTable, so slot swapping can run on other memory than process pages.
+// Protection values are PAGE_* constants.
+class iHookPageAccess
+{
+public:
+	virtual ~iHookPageAccess() {}
+
+	// Protection of committed page holding pAddress, false when page is not committed
+	virtual bool Query(void* pAddress, DWORD* pProtect) = 0;
+	virtual bool Protect(void* pAddress, size_t size, DWORD protect, DWORD* pOldProtect) = 0;
+};
+
+#ifdef _WIN32
+class iHookVirtualPages : public iHookPageAccess
+{
+public:
+	bool Query(void* pAddress, DWORD* pProtect)
+	{
+		MEMORY_BASIC_INFORMATION mbi;
+		if (!VirtualQuery(pAddress, &mbi, sizeof(mbi)) || mbi.State != MEM_COMMIT) return false;
+		*pProtect = mbi.Protect;
+		return true;
+	}
+
+	bool Protect(void* pAddress, size_t size, DWORD protect, DWORD* pOldProtect)
+	{
+		return VirtualProtect(pAddress, size, protect, pOldProtect) != FALSE;
+	}
+
+	static iHookVirtualPages& Instance()
+	{
+		static iHookVirtualPages pages;
+		return pages;
+	}
+};
+#endif
+
+// COM method hooks done by swapping vtable slot with one interlocked pointer write.
+// No code is patched and no thread is suspended, calls through other vtables are not affected.
+// Every patched slot is recorded, so it can be put back before owning module goes away.
+class iHookVTable
+{
+public:
+	enum Result
+	{
+		VTABLE_PATCHED,		// slot now points to detour
+		VTABLE_EXISTS,		// slot already points to detour
+		VTABLE_SKIPPED,		// detour already hooks method inline, or another implementation than this slot
+		VTABLE_FAILED		// slot can not be written, use inline hook
+	};
+
+#ifdef _WIN32
+	// pages - NULL uses VirtualQuery and VirtualProtect
+	iHookVTable(iHookPageAccess* pages = NULL)
+		:m_pages(pages ? pages : &iHookVirtualPages::Instance())
+		, m_count(0)
+	{
+	}
+#else
+	iHookVTable(iHookPageAccess* pages)
+		:m_pages(pages)
+		, m_count(0)
+	{
+	}
+#endif
+
+	virtual ~iHookVTable()
+	{
+		Restore();
+	}
+
+	// slot - address of method pointer in vtable
+	// original - receives method that was in slot, same as trampoline of inline hook
+	Result Patch(void** slot, void* detour, void** original)
+	{
+#if _MSC_VER < 1700
+		lock_guard lock(m_mutex);
+#else
+		std::lock_guard<std::mutex> lock(m_mutex);
+#endif
+		if (!slot || !detour || !original) return VTABLE_FAILED;
+
+		void* current = *slot;
+		if (current == detour) return VTABLE_EXISTS;
+
+		// Detour has one original pointer, vtable holding different implementation can not share it.
+		// Inline hooked method already reaches detour through every vtable.
+		for (DWORD i = 0; i < m_count; ++i)
+		{
+			if (m_slots[i].detour != detour) continue;
+			if (!m_slots[i].slot || m_slots[i].original != current) return VTABLE_SKIPPED;
+		}
+
+		if (m_count == VTABLEHOOK_MAX_SLOTS) return VTABLE_FAILED;
+
+		if (!Exchange(slot, current, detour)) return VTABLE_FAILED;
+		*original = current;
+
+		m_slots[m_count].slot = slot;
+		m_slots[m_count].original = current;
+		m_slots[m_count].detour = detour;
+		++m_count;
+		return VTABLE_PATCHED;
+	}
+
+	// Records that detour fell back to inline hook of target, later vtables are left alone
+	void MarkInline(void* target, void* detour)
+	{
+#if _MSC_VER < 1700
+		lock_guard lock(m_mutex);
+#else
+		std::lock_guard<std::mutex> lock(m_mutex);
+#endif
+		if (m_count == VTABLEHOOK_MAX_SLOTS) return;
+
+		m_slots[m_count].slot = NULL;
+		m_slots[m_count].original = target;
+		m_slots[m_count].detour = detour;
+		++m_count;
+	}
+
+	// Puts original methods back, detour NULL restores all slots
+	void Restore(void* detour = NULL)
+	{
+#if _MSC_VER < 1700
+		lock_guard lock(m_mutex);
+#else
+		std::lock_guard<std::mutex> lock(m_mutex);
+#endif
+		DWORD kept = 0;
+		for (DWORD i = 0; i < m_count; ++i)
+		{
+			Slot& entry = m_slots[i];
+			if (detour && entry.detour != detour)
+			{
+				m_slots[kept++] = entry;
+				continue;
+			}
+
+			if (entry.slot) Exchange(entry.slot, entry.detour, entry.original);
+		}
+		m_count = kept;
+	}
+
+private:
+	struct Slot
+	{
+		void** slot;		// NULL for method hooked inline
+		void* original;
+		void* detour;
+	};
+
+	// Vtables usually live in read-only data of owning module, page is made writable only for the write.
+	// Fails when page is gone, for example owning module was unloaded before Restore.
+	bool Exchange(void** slot, void* expected, void* value)
+	{
+		static const DWORD writable = PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+		static const DWORD executable = PAGE_EXECUTE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+
+		DWORD current;
+		if (!m_pages || !m_pages->Query(slot, &current)) return false;
+		if (current & (PAGE_NOACCESS | PAGE_GUARD)) return false;
+
+		if (current & writable)
+			return InterlockedCompareExchangePointer(slot, value, expected) == expected;
+
+		// keep page executable, other threads may run code from it
+		DWORD oldProtect;
+		DWORD protect = (current & executable) ? PAGE_EXECUTE_READWRITE : PAGE_READWRITE;
+		if (!m_pages->Protect(slot, sizeof(void*), protect, &oldProtect)) return false;
+
+		bool done = InterlockedCompareExchangePointer(slot, value, expected) == expected;
+
+		m_pages->Protect(slot, sizeof(void*), oldProtect, &oldProtect);
+		return done;
+	}
+
+	iHookPageAccess* m_pages;
+
+#if _MSC_VER < 1700
+	recursive_mutex m_mutex;
+#else
+	std::mutex m_mutex;
+#endif
+
+	Slot m_slots[VTABLEHOOK_MAX_SLOTS];
+	DWORD m_count;
+};
+
+#endif
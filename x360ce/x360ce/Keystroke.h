@@ -0,0 +1,259 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _KEYSTROKE_H_
+#define _KEYSTROKE_H_
+
+#if _MSC_VER < 1700
+#include "mutex.h"
+#else
+#include <mutex>
+#endif
+
+#define KEYSTROKE_QUEUE_SIZE 64		// must be power of two
+#define KEYSTROKE_REPEAT_DELAY 400	// ms before first repeat
+#define KEYSTROKE_REPEAT_RATE 100	// ms between repeats
+#define KEYSTROKE_POLL_INTERVAL 16	// ms, XInputGetKeystroke polls itself only when state is older
+#define KEYSTROKE_IDLE_TIMEOUT 5000	// ms without XInputGetKeystroke after which new keystrokes are not queued
+#define KEYSTROKE_BUTTONS 14
+
+// Bounded lock-free queue, safe for multiple producers and consumers.
+// Each cell carries sequence number, so push and pop only race on one index with InterlockedCompareExchange.
+template<typename T, uint32_t N>
+class BoundedQueue
+{
+public:
+	BoundedQueue()
+		:m_enqueue(0)
+		, m_dequeue(0)
+	{
+		for (uint32_t i = 0; i < N; ++i)
+			m_cells[i].sequence = i;
+	}
+
+	bool Push(const T& data)
+	{
+		Cell* cell;
+		LONG pos = m_enqueue;
+		for (;;)
+		{
+			cell = &m_cells[pos & (N - 1)];
+			LONG diff = cell->sequence - pos;
+			if (diff == 0)
+			{
+				if (InterlockedCompareExchange(&m_enqueue, pos + 1, pos) == pos) break;
+				pos = m_enqueue;
+			}
+			else if (diff < 0) return false; // full
+			else pos = m_enqueue;
+		}
+
+		cell->data = data;
+		InterlockedExchange(&cell->sequence, pos + 1);
+		return true;
+	}
+
+	bool Pop(T& data)
+	{
+		Cell* cell;
+		LONG pos = m_dequeue;
+		for (;;)
+		{
+			cell = &m_cells[pos & (N - 1)];
+			LONG diff = cell->sequence - (pos + 1);
+			if (diff == 0)
+			{
+				if (InterlockedCompareExchange(&m_dequeue, pos + 1, pos) == pos) break;
+				pos = m_dequeue;
+			}
+			else if (diff < 0) return false; // empty
+			else pos = m_dequeue;
+		}
+
+		data = cell->data;
+		InterlockedExchange(&cell->sequence, pos + N);
+		return true;
+	}
+
+	// Queued items, never less than real count while consumers pop concurrently
+	inline LONG Size() const
+	{
+		return m_enqueue - m_dequeue;
+	}
+
+private:
+	struct Cell
+	{
+		volatile LONG sequence;
+		T data;
+	};
+
+	Cell m_cells[N];
+	volatile LONG m_enqueue;
+	volatile LONG m_dequeue;
+};
+
+// Turns mapped button state of one user into XInput keystrokes.
+// Fed by XInputGetState after mapping, drained by XInputGetKeystroke.
+// Updates of one user are serialized, so keystrokes keep order and repeat timing is consistent.
+// KEYUP of every queued KEYDOWN always fits in queue: KEYDOWN is queued only while a slot for each
+// held button stays free, repeats only while twice that is free. Press that does not fit is dropped
+// together with its repeats and KEYUP, so reader never sees orphan KEYDOWN or KEYUP.
+// When nobody calls XInputGetKeystroke for KEYSTROKE_IDLE_TIMEOUT, new presses are not queued at all.
+class KeystrokeGenerator
+{
+public:
+	KeystrokeGenerator()
+		:m_buttons(0)
+		, m_lastupdate(0)
+		, m_lastread(0)
+		, m_reading(false)
+		, m_dropped(0)
+		, m_repeat()
+	{
+	}
+
+	// buttons - mapped wButtons, now - time in ms (dwPacketNumber)
+	void Update(DWORD dwUserIndex, WORD buttons, DWORD now)
+	{
+#if _MSC_VER < 1700
+		lock_guard lock(m_mutex);
+#else
+		std::lock_guard<std::mutex> lock(m_mutex);
+#endif
+		WORD previous = static_cast<WORD>(InterlockedExchange(&m_buttons, buttons));
+		WORD changed = previous ^ buttons;
+		m_lastupdate = now;
+
+		if (!changed && !buttons) return;
+
+		bool reading = m_reading && (LONG)(now - m_lastread) < KEYSTROKE_IDLE_TIMEOUT;
+
+		for (uint32_t i = 0; i < KEYSTROKE_BUTTONS; ++i)
+		{
+			WORD button = ButtonIDs()[i];
+
+			if (changed & button)
+			{
+				if (buttons & button)
+				{
+					m_repeat[i] = now + KEYSTROKE_REPEAT_DELAY;
+					if (reading && m_queue.Size() < KEYSTROKE_QUEUE_SIZE - KEYSTROKE_BUTTONS)
+						Push(dwUserIndex, i, XINPUT_KEYSTROKE_KEYDOWN);
+					else m_dropped |= button;
+				}
+				else if (m_dropped & button) m_dropped &= ~button;
+				else Push(dwUserIndex, i, XINPUT_KEYSTROKE_KEYUP);
+			}
+			else if ((buttons & button) && (LONG)(now - m_repeat[i]) >= 0)
+			{
+				m_repeat[i] = now + KEYSTROKE_REPEAT_RATE;
+				if (reading && !(m_dropped & button) && m_queue.Size() < KEYSTROKE_QUEUE_SIZE - 2 * KEYSTROKE_BUTTONS)
+					Push(dwUserIndex, i, XINPUT_KEYSTROKE_KEYDOWN | XINPUT_KEYSTROKE_REPEAT);
+			}
+		}
+	}
+
+	// now - time in ms, marks reader as active
+	inline bool Pop(XINPUT_KEYSTROKE& keystroke, DWORD now)
+	{
+		m_lastread = now;
+		m_reading = true;
+		return m_queue.Pop(keystroke);
+	}
+
+	inline DWORD GetLastUpdate() const
+	{
+		return m_lastupdate;
+	}
+
+private:
+	static const WORD* ButtonIDs()
+	{
+		static const WORD ids[KEYSTROKE_BUTTONS] =
+		{
+			XINPUT_GAMEPAD_A,
+			XINPUT_GAMEPAD_B,
+			XINPUT_GAMEPAD_X,
+			XINPUT_GAMEPAD_Y,
+			XINPUT_GAMEPAD_LEFT_SHOULDER,
+			XINPUT_GAMEPAD_RIGHT_SHOULDER,
+			XINPUT_GAMEPAD_BACK,
+			XINPUT_GAMEPAD_START,
+			XINPUT_GAMEPAD_LEFT_THUMB,
+			XINPUT_GAMEPAD_RIGHT_THUMB,
+			XINPUT_GAMEPAD_DPAD_UP,
+			XINPUT_GAMEPAD_DPAD_DOWN,
+			XINPUT_GAMEPAD_DPAD_LEFT,
+			XINPUT_GAMEPAD_DPAD_RIGHT
+		};
+		return ids;
+	}
+
+	static const WORD* KeyIDs()
+	{
+		static const WORD ids[KEYSTROKE_BUTTONS] =
+		{
+			VK_PAD_A,
+			VK_PAD_B,
+			VK_PAD_X,
+			VK_PAD_Y,
+			VK_PAD_LSHOULDER,
+			VK_PAD_RSHOULDER,
+			VK_PAD_BACK,
+			VK_PAD_START,
+			VK_PAD_LTHUMB_PRESS,
+			VK_PAD_RTHUMB_PRESS,
+			VK_PAD_DPAD_UP,
+			VK_PAD_DPAD_DOWN,
+			VK_PAD_DPAD_LEFT,
+			VK_PAD_DPAD_RIGHT
+		};
+		return ids;
+	}
+
+	inline void Push(DWORD dwUserIndex, uint32_t button, WORD flags)
+	{
+		XINPUT_KEYSTROKE keystroke;
+		keystroke.VirtualKey = KeyIDs()[button];
+		keystroke.Unicode = 0;
+		keystroke.Flags = flags;
+		keystroke.UserIndex = (BYTE)dwUserIndex;
+		keystroke.HidCode = 0;
+
+		// Update leaves room, so push can not fail
+		m_queue.Push(keystroke);
+	}
+
+#if _MSC_VER < 1700
+	recursive_mutex m_mutex;
+#else
+	std::mutex m_mutex;
+#endif
+
+	volatile LONG m_buttons;
+	volatile DWORD m_lastupdate;
+	volatile DWORD m_lastread;
+	volatile bool m_reading;
+	WORD m_dropped;		// held buttons whose KEYDOWN was not queued, guarded by m_mutex
+	DWORD m_repeat[KEYSTROKE_BUTTONS];		// guarded by m_mutex
+	BoundedQueue<XINPUT_KEYSTROKE, KEYSTROKE_QUEUE_SIZE> m_queue;
+};
+
+#endif
@@ -0,0 +1,516 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LOGFORMAT_H_
+#define _LOGFORMAT_H_
+
+// Deferred printf formatting shared by logger and Support\LogDecode.
+// Caller copies raw arguments of log message, text is produced later from format string and those bytes.
+// No Windows calls, so binary log files can be decoded anywhere.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <wchar.h>
+
+#if defined(_MSC_VER) && _MSC_VER < 1700
+#include "pstdint.h"
+#else
+#include <stdint.h>
+#endif
+
+#define LOGFORMAT_MAX_ARGS 16
+#define LOGFORMAT_MAX_STRING 1024	// bytes of one string argument when formatted
+
+// Binary log file: LogFileHeader, then LogFileRecord each followed by length bytes of data
+#define LOGFILE_MAGIC "x360clog"
+#define LOGFILE_VERSION 1
+#define LOGFILE_TEXT 0			// message formatted by caller, data is text without terminator
+#define LOGFILE_FORMAT 0xFFFF	// defines call site, data is 16-bit site followed by format string
+
+#define LOGARG_NULL 0xFFFF		// length of NULL string argument
+
+enum LogArgType
+{
+	LOGARG_NONE,
+	LOGARG_INT32,
+	LOGARG_INT64,
+	LOGARG_DOUBLE,
+	LOGARG_POINTER,		// stored as 64 bits
+	LOGARG_STRING,		// 16-bit length, then bytes
+	LOGARG_WSTRING		// 16-bit length, then UTF-16 units
+};
+
+#pragma pack(push, 1)
+struct LogFileHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t pointer;		// pointer size of process that wrote log, decides size of %Iu and %p
+	int64_t frequency;		// counter ticks per second
+	int64_t counter;		// counter value at time
+	int64_t time;			// local time as FILETIME, 100 ns units since 1601
+};
+
+struct LogFileRecord
+{
+	uint16_t site;
+	uint16_t length;
+	uint32_t thread;
+	int64_t counter;
+};
+#pragma pack(pop)
+
+// One conversion of format string, without '%'
+struct LogSpec
+{
+	char flags[8];
+	int width;			// -1 none, -2 taken from argument
+	int precision;		// -1 none, -2 taken from argument
+	char size;			// 0, 'h' short, 'c' char, 'l' long, 'q' 64-bit, 'z' pointer sized, 'w' wide
+	char conversion;
+};
+
+// Reads conversion after '%', returns character after it or NULL when conversion is not supported
+inline const char* LogParseSpec(const char* p, LogSpec* spec)
+{
+	size_t nflags = 0;
+	while (*p && strchr("-+ #0", *p))
+	{
+		if (nflags < sizeof(spec->flags) - 1) spec->flags[nflags++] = *p;
+		++p;
+	}
+	spec->flags[nflags] = '\0';
+
+	spec->width = -1;
+	if (*p == '*')
+	{
+		spec->width = -2;
+		++p;
+	}
+	else if (*p >= '0' && *p <= '9')
+	{
+		for (spec->width = 0; *p >= '0' && *p <= '9'; ++p) spec->width = spec->width * 10 + (*p - '0');
+	}
+
+	spec->precision = -1;
+	if (*p == '.')
+	{
+		++p;
+		if (*p == '*')
+		{
+			spec->precision = -2;
+			++p;
+		}
+		else for (spec->precision = 0; *p >= '0' && *p <= '9'; ++p) spec->precision = spec->precision * 10 + (*p - '0');
+	}
+
+	spec->size = 0;
+	switch (*p)
+	{
+	case 'h':
+		++p;
+		if (*p == 'h')
+		{
+			spec->size = 'c';
+			++p;
+		}
+		else spec->size = 'h';
+		break;
+	case 'l':
+		++p;
+		if (*p == 'l')
+		{
+			spec->size = 'q';
+			++p;
+		}
+		else spec->size = 'l';
+		break;
+	case 'I':
+		++p;
+		if (p[0] == '6' && p[1] == '4')
+		{
+			spec->size = 'q';
+			p += 2;
+		}
+		else if (p[0] == '3' && p[1] == '2') p += 2;
+		else spec->size = 'z';
+		break;
+	case 'j':
+		spec->size = 'q';
+		++p;
+		break;
+	case 'z':
+	case 't':
+		spec->size = 'z';
+		++p;
+		break;
+	case 'w':
+		spec->size = 'w';
+		++p;
+		break;
+	case 'L':
+		++p;
+		break;
+	}
+
+	spec->conversion = *p;
+	if (!*p || !strchr("diouxXcCeEfFgGaApsS", *p)) return NULL;
+	return p + 1;
+}
+
+// Type of argument of conversion, pointer - pointer size of logging process
+inline LogArgType LogSpecType(const LogSpec& spec, size_t pointer)
+{
+	switch (spec.conversion)
+	{
+	case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+		if (spec.size == 'q' || (spec.size == 'z' && pointer == 8)) return LOGARG_INT64;
+		return LOGARG_INT32;
+	case 'c': case 'C':
+		return LOGARG_INT32;
+	case 'p':
+		return LOGARG_POINTER;
+	case 's':
+		return spec.size == 'l' || spec.size == 'w' ? LOGARG_WSTRING : LOGARG_STRING;
+	case 'S':
+		return spec.size == 'h' ? LOGARG_STRING : LOGARG_WSTRING;
+	default:
+		return LOGARG_DOUBLE;
+	}
+}
+
+// Fills types with arguments of format in call order, '*' width and precision included.
+// Returns number of arguments or -1 when format can not be captured and must be formatted by caller.
+inline int LogParseFormat(const char* format, size_t pointer, unsigned char* types)
+{
+	int count = 0;
+	for (const char* p = format; *p; ++p)
+	{
+		if (*p != '%') continue;
+		if (p[1] == '%')
+		{
+			++p;
+			continue;
+		}
+
+		LogSpec spec;
+		const char* next = LogParseSpec(p + 1, &spec);
+		if (!next) return -1;
+
+		int needed = 1 + (spec.width == -2) + (spec.precision == -2);
+		if (count + needed > LOGFORMAT_MAX_ARGS) return -1;
+
+		if (spec.width == -2) types[count++] = LOGARG_INT32;
+		if (spec.precision == -2) types[count++] = LOGARG_INT32;
+		types[count++] = static_cast<unsigned char>(LogSpecType(spec, pointer));
+		p = next - 1;
+	}
+	return count;
+}
+
+inline bool LogPut(unsigned char*& out, const unsigned char* end, const void* value, size_t size)
+{
+	if (static_cast<size_t>(end - out) < size) return false;
+	memcpy(out, value, size);
+	out += size;
+	return true;
+}
+
+// Copies arguments described by types, strings are truncated to fit.
+// Returns bytes written, capture stops at first argument that does not fit.
+inline size_t LogCaptureArgs(const unsigned char* types, int count, unsigned char* out, size_t size, va_list vaargs)
+{
+	unsigned char* w = out;
+	const unsigned char* end = out + size;
+
+	for (int i = 0; i < count; ++i)
+	{
+		switch (types[i])
+		{
+		case LOGARG_INT32:
+		{
+			int32_t value = va_arg(vaargs, int);
+			if (!LogPut(w, end, &value, sizeof(value))) return w - out;
+			break;
+		}
+		case LOGARG_INT64:
+		{
+			int64_t value = va_arg(vaargs, long long);
+			if (!LogPut(w, end, &value, sizeof(value))) return w - out;
+			break;
+		}
+		case LOGARG_DOUBLE:
+		{
+			double value = va_arg(vaargs, double);
+			if (!LogPut(w, end, &value, sizeof(value))) return w - out;
+			break;
+		}
+		case LOGARG_POINTER:
+		{
+			uint64_t value = reinterpret_cast<uintptr_t>(va_arg(vaargs, void*));
+			if (!LogPut(w, end, &value, sizeof(value))) return w - out;
+			break;
+		}
+		case LOGARG_STRING:
+		{
+			const char* str = va_arg(vaargs, const char*);
+			if (end - w < 2) return w - out;
+
+			size_t room = end - w - 2;
+			size_t length = str ? strlen(str) : 0;
+			if (length > room) length = room;
+
+			uint16_t header = str ? static_cast<uint16_t>(length) : LOGARG_NULL;
+			LogPut(w, end, &header, sizeof(header));
+			LogPut(w, end, str, length);
+			break;
+		}
+		case LOGARG_WSTRING:
+		{
+			const wchar_t* str = va_arg(vaargs, const wchar_t*);
+			if (end - w < 2) return w - out;
+
+			size_t room = (end - w - 2) / 2;
+			size_t length = str ? wcslen(str) : 0;
+			if (length > room) length = room;
+
+			uint16_t header = str ? static_cast<uint16_t>(length) : LOGARG_NULL;
+			LogPut(w, end, &header, sizeof(header));
+			for (size_t j = 0; j < length; ++j)
+			{
+				uint16_t unit = static_cast<uint16_t>(str[j]);
+				LogPut(w, end, &unit, sizeof(unit));
+			}
+			break;
+		}
+		default:
+			return w - out;
+		}
+	}
+	return w - out;
+}
+
+// printf into fixed buffer, returns length written without terminator
+inline size_t LogPrintf(char* out, size_t size, const char* format, ...)
+{
+	if (!size) return 0;
+
+	va_list vaargs;
+	va_start(vaargs, format);
+#ifdef _MSC_VER
+	int length = _vsnprintf_s(out, size, _TRUNCATE, format, vaargs);
+#else
+	int length = vsnprintf(out, size, format, vaargs);
+#endif
+	va_end(vaargs);
+
+	if (length < 0 || static_cast<size_t>(length) >= size) return strlen(out);
+	return length;
+}
+
+// Reads captured arguments in order
+class LogArgReader
+{
+public:
+	LogArgReader(const unsigned char* data, size_t length)
+		:m_pos(data)
+		, m_end(data + length)
+	{
+	}
+
+	bool Read(void* value, size_t size)
+	{
+		if (static_cast<size_t>(m_end - m_pos) < size) return false;
+		memcpy(value, m_pos, size);
+		m_pos += size;
+		return true;
+	}
+
+	// String argument as NUL terminated UTF-8, NULL string gives "(null)" like CRT
+	bool ReadString(bool wide, char* out, size_t size)
+	{
+		uint16_t length;
+		if (!Read(&length, sizeof(length))) return false;
+
+		if (length == LOGARG_NULL)
+		{
+			LogPrintf(out, size, "(null)");
+			return true;
+		}
+
+		size_t w = 0;
+		for (size_t i = 0; i < length; ++i)
+		{
+			unsigned int c;
+			if (wide)
+			{
+				uint16_t unit;
+				if (!Read(&unit, sizeof(unit))) return false;
+				c = unit;
+			}
+			else
+			{
+				unsigned char byte;
+				if (!Read(&byte, sizeof(byte))) return false;
+				c = byte;
+			}
+
+			// wide characters are written as UTF-8, surrogates are not paired
+			char encoded[3];
+			size_t n = 0;
+			if (!wide || c < 0x80) encoded[n++] = static_cast<char>(c);
+			else if (c < 0x800)
+			{
+				encoded[n++] = static_cast<char>(0xC0 | (c >> 6));
+				encoded[n++] = static_cast<char>(0x80 | (c & 0x3F));
+			}
+			else
+			{
+				encoded[n++] = static_cast<char>(0xE0 | (c >> 12));
+				encoded[n++] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+				encoded[n++] = static_cast<char>(0x80 | (c & 0x3F));
+			}
+
+			if (w + n < size)
+			{
+				memcpy(out + w, encoded, n);
+				w += n;
+			}
+		}
+		out[w] = '\0';
+		return true;
+	}
+
+private:
+	const unsigned char* m_pos;
+	const unsigned char* m_end;
+};
+
+// Writes message from format and captured arguments, same text as printf with original arguments.
+// Output is truncated to size, formatting stops where captured data ends.
+// Returns length without terminator.
+inline size_t LogFormatMessage(char* out, size_t size, const char* format, size_t pointer, const unsigned char* data, size_t length)
+{
+	if (!size) return 0;
+
+	LogArgReader args(data, length);
+	size_t w = 0;
+	const char* p = format;
+
+	while (*p && w + 1 < size)
+	{
+		if (*p != '%')
+		{
+			out[w++] = *p++;
+			continue;
+		}
+		if (p[1] == '%')
+		{
+			out[w++] = '%';
+			p += 2;
+			continue;
+		}
+
+		LogSpec spec;
+		const char* next = LogParseSpec(p + 1, &spec);
+		if (!next) break;
+
+		int32_t width = spec.width;
+		int32_t precision = spec.precision;
+		if (width == -2 && !args.Read(&width, sizeof(width))) break;
+		if (precision == -2 && !args.Read(&precision, sizeof(precision))) break;
+
+		// rebuild conversion for one argument, sizes are replaced by what this CRT expects
+		char conversion[32];
+		size_t c = LogPrintf(conversion, sizeof(conversion), "%%%s", spec.flags);
+		if (width >= 0) c += LogPrintf(conversion + c, sizeof(conversion) - c, "%d", width);
+		else if (spec.width == -2) c += LogPrintf(conversion + c, sizeof(conversion) - c, "-%d", -width);
+		if (precision >= 0) c += LogPrintf(conversion + c, sizeof(conversion) - c, ".%d", precision);
+
+		char* rest = out + w;
+		size_t room = size - w;
+		LogArgType type = LogSpecType(spec, pointer);
+
+		if (type == LOGARG_INT64)
+		{
+			int64_t value;
+			if (!args.Read(&value, sizeof(value))) break;
+			LogPrintf(conversion + c, sizeof(conversion) - c, "ll%c", spec.conversion);
+			w += LogPrintf(rest, room, conversion, static_cast<long long>(value));
+		}
+		else if (type == LOGARG_INT32)
+		{
+			int32_t value;
+			if (!args.Read(&value, sizeof(value))) break;
+
+			char conv = spec.conversion;
+			if (conv == 'c' || conv == 'C')
+			{
+				// wide characters outside ASCII can not be shown by "%c"
+				if ((conv == 'C' || spec.size == 'l' || spec.size == 'w') && (value < 0 || value > 0x7F)) value = '?';
+				conv = 'c';
+				LogPrintf(conversion + c, sizeof(conversion) - c, "c");
+			}
+			else if (spec.size == 'h') LogPrintf(conversion + c, sizeof(conversion) - c, "h%c", conv);
+			else if (spec.size == 'c') LogPrintf(conversion + c, sizeof(conversion) - c, "hh%c", conv);
+			else LogPrintf(conversion + c, sizeof(conversion) - c, "%c", conv);
+			w += LogPrintf(rest, room, conversion, static_cast<int>(value));
+		}
+		else if (type == LOGARG_DOUBLE)
+		{
+			double value;
+			if (!args.Read(&value, sizeof(value))) break;
+			LogPrintf(conversion + c, sizeof(conversion) - c, "%c", spec.conversion);
+			w += LogPrintf(rest, room, conversion, value);
+		}
+		else if (type == LOGARG_POINTER)
+		{
+			// CRT of logging process prints pointer as fixed width upper case hex
+			uint64_t value;
+			if (!args.Read(&value, sizeof(value))) break;
+			w += LogPrintf(rest, room, "%0*llX", static_cast<int>(pointer * 2), static_cast<unsigned long long>(value));
+		}
+		else
+		{
+			char str[LOGFORMAT_MAX_STRING];
+			if (!args.ReadString(type == LOGARG_WSTRING, str, sizeof(str))) break;
+			LogPrintf(conversion + c, sizeof(conversion) - c, "s");
+			w += LogPrintf(rest, room, conversion, str);
+		}
+
+		p = next;
+	}
+
+	out[w] = '\0';
+	return w;
+}
+
+// Converts counter value to FILETIME based time, 100 ns units
+inline int64_t LogCounterToTime(const LogFileHeader& header, int64_t counter)
+{
+	if (header.frequency <= 0) return header.time;
+
+	int64_t delta = counter - header.counter;
+	int64_t seconds = delta / header.frequency;
+	int64_t rest = delta % header.frequency;
+	return header.time + seconds * 10000000 + rest * 10000000 / header.frequency;
+}
+
+#endif
@@ -0,0 +1,111 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LOGLEVEL_H_
+#define _LOGLEVEL_H_
+
+// Front end of logger: categories, levels and log statements.
+// Statements expand to test of LogMasks and call of PrintLogSite, which is defined by includer,
+// so filtering builds without Logger and its Windows headers.
+
+#include "LogFormat.h"
+
+// Log categories, one bit each
+#define LOG_CORE		0x00000001	// startup, configuration and everything without own category
+#define LOG_XINPUT		0x00000002
+#define LOG_DINPUT		0x00000004
+#define LOG_HOOK		0x00000008	// InputHook setup and statistics
+#define LOG_HOOKLL		0x00000010
+#define LOG_HOOKCOM		0x00000020
+#define LOG_HOOKDI		0x00000040
+#define LOG_HOOKSA		0x00000080
+#define LOG_HOOKWT		0x00000100
+#define LOG_ALL			0xFFFFFFFF
+
+#define LOGLEVEL_ERROR		1
+#define LOGLEVEL_WARNING	2
+#define LOGLEVEL_INFO		3
+#define LOGLEVEL_DEBUG		4	// every call of hooked function
+#define LOGLEVEL_TRACE		5	// every poll of device
+
+// Statements above LOG_MAX_LEVEL or outside LOG_CATEGORIES are compiled out, both can be set by project
+#ifndef LOG_MAX_LEVEL
+#if defined(DEBUG) | defined(_DEBUG)
+#define LOG_MAX_LEVEL LOGLEVEL_TRACE
+#else
+#define LOG_MAX_LEVEL LOGLEVEL_DEBUG
+#endif
+#endif
+
+#ifndef LOG_CATEGORIES
+#define LOG_CATEGORIES LOG_ALL
+#endif
+
+// Categories enabled at each level, all 0 until log file or console is open.
+// Plain static array, so statement filtered out at run time costs one load and test.
+inline volatile DWORD* LogMasks()
+{
+	static volatile DWORD masks[LOGLEVEL_TRACE + 1];
+	return masks;
+}
+
+#define LOGSITE_PENDING -1		// being registered by another thread
+#define LOGSITE_TEXT -2			// format can not be captured, formatted by caller
+
+// Format string of one PrintLog call, static next to call.
+// Registered on first use, then messages carry only its ID and raw arguments.
+struct LogSite
+{
+	const char* format;
+	DWORD category;
+	int level;
+	volatile LONG id;
+	int count;
+	unsigned char index;	// bit number of category
+	unsigned char types[LOGFORMAT_MAX_ARGS];
+};
+
+// For work done only for log, arguments of log statements need no check
+#define LogEnabled(category, level) \
+	((level) <= LOG_MAX_LEVEL && (LOG_CATEGORIES & (category)) && (LogMasks()[level] & (category)))
+
+// Arguments are evaluated only when statement is enabled, disabled statement allocates nothing.
+// Every call site gets its own static LogSite, so format is parsed once per site.
+#define PrintLogEx(category, level, format, ...) \
+	do \
+	{ \
+		if (LogEnabled(category, level)) \
+		{ \
+			static LogSite logsite_ = { format, category, level, 0, 0, 0, {} }; \
+			PrintLogSite(logsite_, format, __VA_ARGS__); \
+		} \
+	} while (0)
+
+#define LogError(category, format, ...) PrintLogEx(category, LOGLEVEL_ERROR, format, __VA_ARGS__)
+#define LogWarning(category, format, ...) PrintLogEx(category, LOGLEVEL_WARNING, format, __VA_ARGS__)
+#define LogInfo(category, format, ...) PrintLogEx(category, LOGLEVEL_INFO, format, __VA_ARGS__)
+#define LogDebug(category, format, ...) PrintLogEx(category, LOGLEVEL_DEBUG, format, __VA_ARGS__)
+#define LogTrace(category, format, ...) PrintLogEx(category, LOGLEVEL_TRACE, format, __VA_ARGS__)
+
+#define PrintLog(format, ...) LogInfo(LOG_CORE, format, __VA_ARGS__)
+
+#define PrintFunc() PrintLog(__FUNCTION__)
+#define PrintFuncSig() PrintLog(__FUNCSIG__)
+
+#endif
@@ -0,0 +1,160 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LOGLIMIT_H_
+#define _LOGLIMIT_H_
+
+// Decides which log messages reach log file, used by log writer thread only.
+// Identical messages of one call site are counted instead of written, until summary interval passes,
+// and each category has token bucket so flood of new messages can not fill disk.
+// Held back messages are reported by Flush. Every check is O(1), no Windows calls.
+
+#include <string.h>
+
+#if defined(_MSC_VER) && _MSC_VER < 1700
+#include "pstdint.h"
+#else
+#include <stdint.h>
+#endif
+
+#define LOGLIMIT_MAX_SITES 1024
+#define LOGLIMIT_CATEGORIES 32
+#define LOGLIMIT_MAX_DATA 488	// bytes of message kept per site, longer messages are never deduplicated
+
+class LogLimiter
+{
+public:
+	LogLimiter()
+		:m_interval(0)
+		, m_tolerance(0)
+		, m_expiry(0)
+	{
+		memset(m_sites, 0, sizeof(m_sites));
+		memset(m_buckets, 0, sizeof(m_buckets));
+	}
+
+	// rate - messages per second of one category, 0 is unlimited
+	// burst - messages of one category let through at once
+	// frequency - counter ticks per second
+	void SetRate(uint32_t rate, uint32_t burst, int64_t frequency)
+	{
+		m_interval = rate && frequency > 0 ? frequency / rate : 0;
+		m_tolerance = m_interval * (burst ? burst - 1 : 0);
+	}
+
+	// ticks - counter ticks after which repeat of message is written again, 0 is never
+	void SetExpiry(int64_t ticks)
+	{
+		m_expiry = ticks;
+	}
+
+	// site - call site ID, 0 for message without one, it is never deduplicated
+	// limited - message is subject to rate limit of category
+	// data - bytes that tell messages of site apart, like captured arguments
+	// repeated - receives number of held back repeats of site to report before this message
+	// Returns true when message is to be written.
+	bool Check(uint16_t site, unsigned int category, bool limited, int64_t counter, const void* data, size_t length, uint32_t* repeated)
+	{
+		*repeated = 0;
+
+		Site* state = site && site < LOGLIMIT_MAX_SITES && length <= LOGLIMIT_MAX_DATA ? &m_sites[site] : NULL;
+
+		if (state && state->valid && state->length == length && memcmp(state->data, data, length) == 0
+			&& !(m_expiry && counter - state->since >= m_expiry))
+		{
+			++state->repeats;
+			return false;
+		}
+
+		if (limited && !Take(category % LOGLIMIT_CATEGORIES, counter))
+		{
+			++m_buckets[category % LOGLIMIT_CATEGORIES].suppressed;
+			return false;
+		}
+
+		if (state)
+		{
+			*repeated = state->repeats;
+			state->repeats = 0;
+			state->valid = true;
+			state->since = counter;
+			state->length = length;
+			memcpy(state->data, data, length);
+		}
+		return true;
+	}
+
+	// Hands out held back counts and clears them, repeats keep being counted against same message.
+	// repeat(site, count) for sites, suppress(category, count) for rate limited categories.
+	template<typename RepeatCallback, typename SuppressCallback>
+	void Flush(RepeatCallback repeat, SuppressCallback suppress)
+	{
+		for (uint16_t site = 1; site < LOGLIMIT_MAX_SITES; ++site)
+		{
+			if (!m_sites[site].repeats) continue;
+			repeat(site, m_sites[site].repeats);
+			m_sites[site].repeats = 0;
+		}
+
+		for (unsigned int category = 0; category < LOGLIMIT_CATEGORIES; ++category)
+		{
+			if (!m_buckets[category].suppressed) continue;
+			suppress(category, m_buckets[category].suppressed);
+			m_buckets[category].suppressed = 0;
+		}
+	}
+
+private:
+	// Generic cell rate algorithm, bucket is theoretical arrival time of next message
+	bool Take(unsigned int category, int64_t counter)
+	{
+		if (!m_interval) return true;
+
+		Bucket& bucket = m_buckets[category];
+		int64_t arrival = bucket.arrival > counter ? bucket.arrival : counter;
+		if (arrival - m_tolerance > counter) return false;
+
+		bucket.arrival = arrival + m_interval;
+		return true;
+	}
+
+	// Last written message of call site
+	struct Site
+	{
+		bool valid;
+		int64_t since;		// counter of message
+		size_t length;
+		uint32_t repeats;
+		unsigned char data[LOGLIMIT_MAX_DATA];
+	};
+
+	struct Bucket
+	{
+		int64_t arrival;
+		uint32_t suppressed;
+	};
+
+	int64_t m_interval;		// ticks per message
+	int64_t m_tolerance;	// ticks arrival may be ahead of counter
+	int64_t m_expiry;		// ticks message is deduplicated for
+	Site m_sites[LOGLIMIT_MAX_SITES];
+	Bucket m_buckets[LOGLIMIT_CATEGORIES];
+};
+
+#endif
@@ -0,0 +1,356 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LOGMAPFILE_H_
+#define _LOGMAPFILE_H_
+
+// Log file written through memory mapping, used by log writer thread only.
+// Data is copied into mapped view and header offset is moved after it, no system call per write.
+// Pages of view belong to system cache, so everything up to committed offset survives crash of process.
+// File grows in LOGMAP_CHUNK steps and is cut to committed size when closed.
+// Only header and chunk being written are mapped, so big limit needs no big free block of address space.
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_MSC_VER) && _MSC_VER < 1700
+#include "pstdint.h"
+#else
+#include <stdint.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define LOGMAP_MAGIC "x360cmap"
+#define LOGMAP_VERSION 1
+#define LOGMAP_CHUNK (1 << 20)			// bytes file grows by and bytes of data mapped at once
+#define LOGMAP_MAX_LIMIT 0x7FF00000		// committed offset is 32-bit so it can be stored atomically
+#define LOGMAP_MAX_PATH 300
+
+// Start of file, data follows header
+struct LogMapHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t size;					// header size
+	volatile uint32_t committed;	// bytes of data after header, rest of file is zeros
+	uint32_t reserved;
+};
+
+class LogMapFile
+{
+public:
+	LogMapFile()
+		:m_header(NULL)
+		, m_window(NULL)
+		, m_windowstart(0)
+		, m_size(0)
+		, m_committed(0)
+		, m_limit(LOGMAP_MAX_LIMIT)
+		, m_count(0)
+		, m_untruncated(0)
+#ifdef _WIN32
+		, m_file(INVALID_HANDLE_VALUE)
+		, m_mapping(NULL)
+#else
+		, m_fd(-1)
+#endif
+	{
+		m_path[0] = '\0';
+	}
+
+	virtual ~LogMapFile()
+	{
+		Close();
+	}
+
+	// limit - file size that starts new file, count - older files kept as path.1 to path.count
+	bool Open(const char* path, uint32_t limit, uint32_t count)
+	{
+		Close();
+		if (strlen(path) + 12 > LOGMAP_MAX_PATH) return false;
+
+		memcpy(m_path, path, strlen(path) + 1);
+		m_limit = limit < LOGMAP_CHUNK ? LOGMAP_CHUNK : limit > LOGMAP_MAX_LIMIT ? LOGMAP_MAX_LIMIT : limit;
+		m_count = count;
+		return Create();
+	}
+
+	inline bool IsOpen() const
+	{
+		return m_header != NULL;
+	}
+
+	// Number of closed files that could not be cut to committed size since last call.
+	// Their tail after committed offset is zeros, readers that ignore header see it as data.
+	inline uint32_t TakeUntruncated()
+	{
+		uint32_t count = m_untruncated;
+		m_untruncated = 0;
+		return count;
+	}
+
+	// True when data would take file over limit, file with no data is never full
+	inline bool Full(size_t length) const
+	{
+		return m_committed && sizeof(LogMapHeader) + m_committed + length > m_limit;
+	}
+
+	// Committed offset is moved only after whole data is in file,
+	// data crossing chunk boundary is copied one window at a time
+	bool Write(const void* data, size_t length)
+	{
+		if (!m_header) return false;
+
+		size_t offset = sizeof(LogMapHeader) + m_committed;
+		if (offset + length > LOGMAP_MAX_LIMIT) return false;
+
+		const char* source = static_cast<const char*>(data);
+		size_t left = length;
+		while (left)
+		{
+			uint32_t start = static_cast<uint32_t>(offset / LOGMAP_CHUNK * LOGMAP_CHUNK);
+			if ((!m_window || start != m_windowstart) && !MapWindow(start)) return false;
+
+			size_t part = start + LOGMAP_CHUNK - offset;
+			if (part > left) part = left;
+			memcpy(m_window + (offset - start), source, part);
+			source += part;
+			offset += part;
+			left -= part;
+		}
+
+		m_committed += static_cast<uint32_t>(length);
+		Commit();
+		return true;
+	}
+
+	// Moves path to path.1, path.1 to path.2 and so on, oldest is deleted, then starts empty file
+	bool Rotate()
+	{
+		CloseFile();
+
+		if (m_count)
+		{
+			char from[LOGMAP_MAX_PATH];
+			char to[LOGMAP_MAX_PATH];
+
+			RotatedPath(to, m_count);
+			remove(to);
+			for (uint32_t i = m_count; i > 1; --i)
+			{
+				RotatedPath(from, i - 1);
+				RotatedPath(to, i);
+				rename(from, to);
+			}
+			RotatedPath(to, 1);
+			rename(m_path, to);
+		}
+
+		return Create();
+	}
+
+	void Close()
+	{
+		CloseFile();
+	}
+
+private:
+	LogMapFile(const LogMapFile&);
+	LogMapFile& operator=(const LogMapFile&);
+
+	// Open checks that path with any 32-bit index fits
+	void RotatedPath(char* out, uint32_t index) const
+	{
+#ifdef _MSC_VER
+		_snprintf_s(out, LOGMAP_MAX_PATH, _TRUNCATE, "%.*s.%u", LOGMAP_MAX_PATH - 12, m_path, index);
+#else
+		snprintf(out, LOGMAP_MAX_PATH, "%.*s.%u", LOGMAP_MAX_PATH - 12, m_path, index);
+#endif
+	}
+
+	inline void Commit()
+	{
+		// data has to be in view before offset that covers it
+#ifdef _WIN32
+		MemoryBarrier();
+#else
+		__sync_synchronize();
+#endif
+		m_header->committed = m_committed;
+	}
+
+	bool Create()
+	{
+#ifdef _WIN32
+		m_file = CreateFileA(m_path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (m_file == INVALID_HANDLE_VALUE) return false;
+#else
+		m_fd = open(m_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (m_fd < 0) return false;
+#endif
+
+		m_committed = 0;
+		m_size = 0;
+		if (!Grow(LOGMAP_CHUNK) || !MapHeader())
+		{
+			CloseFile();
+			return false;
+		}
+
+		LogMapHeader* header = m_header;
+		memcpy(header->magic, LOGMAP_MAGIC, sizeof(header->magic));
+		header->version = LOGMAP_VERSION;
+		header->size = sizeof(LogMapHeader);
+		header->reserved = 0;
+		Commit();
+		return true;
+	}
+
+	// Extends file to size, views of old mapping stay valid
+	bool Grow(uint32_t size)
+	{
+#ifdef _WIN32
+		HANDLE mapping = CreateFileMappingA(m_file, NULL, PAGE_READWRITE, 0, size, NULL);
+		if (!mapping) return false;
+		if (m_mapping) CloseHandle(m_mapping);
+		m_mapping = mapping;
+#else
+		if (ftruncate(m_fd, size) != 0) return false;
+#endif
+		m_size = size;
+		return true;
+	}
+
+	bool MapHeader()
+	{
+#ifdef _WIN32
+		m_header = static_cast<LogMapHeader*>(MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, 0, sizeof(LogMapHeader)));
+		return m_header != NULL;
+#else
+		void* view = mmap(NULL, sizeof(LogMapHeader), PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+		if (view == MAP_FAILED) return false;
+		m_header = static_cast<LogMapHeader*>(view);
+		return true;
+#endif
+	}
+
+	// Maps chunk at start instead of current one, file is extended when chunk is past its end
+	bool MapWindow(uint32_t start)
+	{
+		UnmapWindow();
+		if (start + LOGMAP_CHUNK > m_size && !Grow(start + LOGMAP_CHUNK)) return false;
+
+#ifdef _WIN32
+		m_window = static_cast<char*>(MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, start, LOGMAP_CHUNK));
+		if (!m_window) return false;
+#else
+		void* view = mmap(NULL, LOGMAP_CHUNK, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, start);
+		if (view == MAP_FAILED) return false;
+		m_window = static_cast<char*>(view);
+#endif
+
+		m_windowstart = start;
+		return true;
+	}
+
+	void UnmapWindow()
+	{
+		if (!m_window) return;
+
+#ifdef _WIN32
+		UnmapViewOfFile(m_window);
+#else
+		munmap(m_window, LOGMAP_CHUNK);
+#endif
+		m_window = NULL;
+	}
+
+	void Unmap()
+	{
+		UnmapWindow();
+
+		if (m_header)
+		{
+#ifdef _WIN32
+			UnmapViewOfFile(m_header);
+#else
+			munmap(m_header, sizeof(LogMapHeader));
+#endif
+			m_header = NULL;
+		}
+
+#ifdef _WIN32
+		if (m_mapping) CloseHandle(m_mapping);
+		m_mapping = NULL;
+#endif
+		m_size = 0;
+	}
+
+	// Cuts unused end of last chunk, so closed file holds exactly header and committed data
+	void CloseFile()
+	{
+		Unmap();
+		uint32_t size = sizeof(LogMapHeader) + m_committed;
+
+#ifdef _WIN32
+		if (m_file != INVALID_HANDLE_VALUE)
+		{
+			LARGE_INTEGER end;
+			end.QuadPart = size;
+			if (!SetFilePointerEx(m_file, end, NULL, FILE_BEGIN) || !SetEndOfFile(m_file)) ++m_untruncated;
+			CloseHandle(m_file);
+			m_file = INVALID_HANDLE_VALUE;
+		}
+#else
+		if (m_fd >= 0)
+		{
+			if (ftruncate(m_fd, size) != 0) ++m_untruncated;
+			close(m_fd);
+			m_fd = -1;
+		}
+#endif
+		m_committed = 0;
+	}
+
+	char m_path[LOGMAP_MAX_PATH];
+	LogMapHeader* m_header;
+	char* m_window;				// LOGMAP_CHUNK bytes of file from m_windowstart
+	uint32_t m_windowstart;
+	uint32_t m_size;			// file size
+	uint32_t m_committed;
+	uint32_t m_limit;
+	uint32_t m_count;
+	uint32_t m_untruncated;		// see TakeUntruncated
+
+#ifdef _WIN32
+	HANDLE m_file;
+	HANDLE m_mapping;
+#else
+	int m_fd;
+#endif
+};
+
+#endif
@@ -0,0 +1,104 @@
+/*  x360ce - XBOX360 Controller Emulator
+ *
+ *  https://code.google.com/p/x360ce/
+ *
+ *  Copyright (C) 2002-2010 Racer_S
+ *  Copyright (C) 2010-2013 Robert Krawczyk
+ *
+ *  x360ce is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Foundation,
+ *  either version 3 of the License, or any later version.
+ *
+ *  x360ce is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with x360ce.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LOGQUEUE_H_
+#define _LOGQUEUE_H_
+
+// Queue between threads that log and log writer, only Interlocked calls of Windows are used.
+
+#define LOGGER_QUEUE_SIZE 1024		// records, must be power of two
+#define LOGGER_LINE_SIZE 488		// bytes of message text or captured arguments, longer messages are truncated
+
+// One message, time is raw performance counter and is turned into local time by writer.
+// site is LOGFILE_TEXT for text formatted by caller, otherwise data holds captured arguments.
+struct LogRecord
+{
+	volatile LONG sequence;
+	DWORD thread;
+	LONGLONG counter;
+	WORD site;
+	WORD length;
+	BYTE category;		// bit number
+	BYTE level;
+	char data[LOGGER_LINE_SIZE];
+};
+
+// Bounded queue of log records, written by any thread and read only by log writer.
+// Producer claims cell with one InterlockedCompareExchange and formats message in place,
+// sequence number of cell tells reader when message is complete.
+class LogQueue
+{
+public:
+	LogQueue()
+		:m_enqueue(0)
+		, m_dequeue(0)
+	{
+		for (LONG i = 0; i < LOGGER_QUEUE_SIZE; ++i)
+			m_cells[i].sequence = i;
+	}
+
+	// Returns free record or NULL when queue is full, record must be passed to Commit
+	LogRecord* Claim()
+	{
+		LONG pos = m_enqueue;
+		for (;;)
+		{
+			LogRecord* cell = &m_cells[pos & (LOGGER_QUEUE_SIZE - 1)];
+			LONG diff = cell->sequence - pos;
+			if (diff == 0)
+			{
+				if (InterlockedCompareExchange(&m_enqueue, pos + 1, pos) == pos) return cell;
+				pos = m_enqueue;
+			}
+			else if (diff < 0) return NULL; // full
+			else pos = m_enqueue;
+		}
+	}
+
+	inline void Commit(LogRecord* record)
+	{
+		InterlockedIncrement(&record->sequence);
+	}
+
+	// Oldest committed record or NULL, reader only
+	inline LogRecord* Front()
+	{
+		LogRecord* cell = &m_cells[m_dequeue & (LOGGER_QUEUE_SIZE - 1)];
+		return cell->sequence == m_dequeue + 1 ? cell : NULL;
+	}
+
+	// Gives record returned by Front back to producers, reader only
+	inline void Pop(LogRecord* record)
+	{
+		InterlockedExchange(&record->sequence, m_dequeue + LOGGER_QUEUE_SIZE);
+		m_dequeue = m_dequeue + 1;
+	}
+
+	inline LONG Pending() const
+	{
+		return m_enqueue - m_dequeue;
+	}
+
+private:
+	LogRecord m_cells[LOGGER_QUEUE_SIZE];
+	volatile LONG m_enqueue;
+	volatile LONG m_dequeue;
+};
+
+#endif
@@ -7,8 +7,8 @@
 #include <memory>
 
 #include <io.h>
-#include <fcntl.h> 
-#include <windows.h> 
+#include <fcntl.h>
+#include <windows.h>
 
 // Windows headers
 #include <shlwapi.h>
@@ -20,6 +20,12 @@
 #include <mutex>
 #endif
 
+#include "LogFormat.h"
+#include "LogLevel.h"
+#include "LogLimit.h"
+#include "LogMapFile.h"
+#include "LogQueue.h"
+
 // warning C4127: conditional expression is constant
 #pragma warning(disable: 4127)
 
@@ -29,19 +35,38 @@ extern "C" IMAGE_DOS_HEADER __ImageBase;
 #define CURRENT_MODULE reinterpret_cast<HMODULE>(&__ImageBase)
 #endif
 
+#define LOGGER_TEXT_SIZE 1024		// characters of message formatted by writer
+#define LOGGER_BATCH_SIZE 65536		// bytes handed to file and console with one write
+#define LOGGER_MAX_SITES LOGLIMIT_MAX_SITES	// PrintLog call sites with own format ID
+
+#if LOGGER_LINE_SIZE > LOGLIMIT_MAX_DATA
+#error Log limiter has to keep whole record of site
+#endif
+#define LOGGER_FLUSH_INTERVAL 100	// ms between writer passes while queue is not filling up
+#define LOGGER_SUMMARY_INTERVAL 10000	// ms between reports of repeated and rate limited messages
+#define LOGGER_RATE 100				// default messages per second of one category, errors and warnings are not limited
+#define LOGGER_BURST 1000			// default messages of one category let through at once
+#define LOGGER_STOP_TIMEOUT 2000	// ms to wait for writer to drain on shutdown
+#define LOGGER_FILE_LIMIT 64		// default MB of mapped log file before it is rotated
+#define LOGGER_FILE_COUNT 3			// default rotated mapped log files kept
+
 #if _MSC_VER < 1700
 #define INITIALIZE_LOGGER std::unique_ptr<Logger> Logger::m_instance;
 #else
 #define INITIALIZE_LOGGER std::unique_ptr<Logger> Logger::m_instance; std::once_flag Logger::m_onceFlag;
 #endif
 
+// Callers only copy message into queue, background thread formats it, adds time stamps
+// and writes whole batches to file and console with one flush per batch.
+// When queue is full messages are dropped and their count is written instead.
+// Binary log file gets records as they are, see LogFormat.h and Support\LogDecode.cpp.
 class Logger
 {
 public:
 	static Logger& GetInstance()
 	{
 #if _MSC_VER < 1700
-		m_instance.reset(new Logger);
+		if (!m_instance) m_instance.reset(new Logger);
 #else
 		std::call_once(m_onceFlag,
 			[] {
@@ -53,6 +78,14 @@ public:
 
 	virtual ~Logger()
 	{
+		Stop();
+
+		// writer terminated on process exit may have been draining, its busy flag would skip final drain
+		m_draining = 0;
+
+		// messages logged after writer stopped, or all of them when it never ran
+		Drain(true);
+
 		if (m_console != nullptr)
 		{
 			FreeConsole();
@@ -63,9 +96,16 @@ public:
 		{
 			fclose(m_file);
 		}
+
+		m_map.Close();
+
+		if (m_wake) CloseHandle(m_wake);
+		if (m_stopped) CloseHandle(m_stopped);
 	}
 
-	bool file(const char* filename)
+	// binary - write records with raw arguments, decoded later by LogDecode
+	// mapped - write through memory mapping, file is rotated at limit given by rotation
+	bool file(const char* filename, bool binary = false, bool mapped = false)
 	{
 		char logpath[MAX_PATH];
 		if (PathIsRelativeA(filename))
@@ -75,9 +115,31 @@ public:
 				PathAppendA(logpath, filename);
 			else strncpy_s(logpath, filename, _TRUNCATE);
 		}
+		else strncpy_s(logpath, filename, _TRUNCATE);
 
-		m_file = _fsopen(logpath, "wt", _SH_DENYWR);
-		return m_file != nullptr;
+		if (mapped)
+		{
+			if (!m_map.Open(logpath, m_filelimit, m_filecount)) return false;
+			m_mapped = true;
+		}
+		else
+		{
+			FILE* file = _fsopen(logpath, binary ? "wb" : "wt", _SH_DENYWR);
+			if (file == nullptr) return false;
+			m_file = file;
+		}
+
+		if (binary)
+		{
+			LogFileHeader header;
+			FileHeader(&header);
+			Output(&header, sizeof(header));
+			m_binary = true;
+		}
+
+		ApplyFilter();
+		Start();
+		return true;
 	}
 
 	bool console(const char* title = nullptr, const char* console_notice = nullptr)
@@ -99,47 +161,89 @@ public:
 				ShowWindow(GetConsoleWindow(), SW_MAXIMIZE);
 				if (title) SetConsoleTitle(title);
 				if (console_notice) puts(console_notice);
+
+				ApplyFilter();
+				Start();
 				return true;
 			}
 		}
 		return false;
 	}
 
-	void print(const char* format, va_list vaargs)
+	// rate - messages per second of one category, 0 is unlimited, burst - messages let through at once.
+	// Set before log file or console is open.
+	void ratelimit(DWORD rate, DWORD burst)
+	{
+		m_limiter.SetRate(rate, burst, m_frequency);
+	}
+
+	// limit - MB of mapped log file before it is moved to name.1, 0 is no limit, count - rotated files kept.
+	// Set before log file is open.
+	void rotation(DWORD limit, DWORD count)
+	{
+		m_filelimit = !limit || limit > LOGMAP_MAX_LIMIT >> 20 ? LOGMAP_MAX_LIMIT : limit << 20;
+		m_filecount = count;
+	}
+
+	// Categories written at level and above, takes effect once file or console is open
+	void filter(DWORD categories, int level)
+	{
+		m_categories = categories;
+		m_level = level;
+		if (enabled()) ApplyFilter();
+	}
+
+	inline bool enabled() const
+	{
+		return m_file != nullptr || m_console != nullptr || m_mapped;
+	}
+
+	// Arguments are copied raw when format of site can be captured, formatting is left to writer
+	void print(LogSite& site, const char* format, va_list vaargs)
 	{
-		bool log = m_file != nullptr;
-		bool con = m_console != nullptr;
-		if ((log || con) && format)
+		if (!enabled() || !format) return;
+
+		LONG id = site.id;
+		if (!id)
 		{
-#if _MSC_VER < 1700
-			lock_guard lock(m_mtx);
-#else
-			std::lock_guard<std::mutex> lock(m_mtx);
-#endif
-			static char* stamp = "[TIME]\t\t[THREAD]\t[LOG]";
-			if (stamp)
-			{
-				if (con) puts(stamp);
-				if (log) { fputs(stamp, m_file); putc('\n', m_file); }
-				stamp = nullptr;
-			}
+			Register(site);
+			id = site.id;
+		}
 
-			GetLocalTime(&m_systime);
-			if (con) {
-				printf_s("%02u:%02u:%02u.%03u\t%08u\t", m_systime.wHour, m_systime.wMinute,
-					m_systime.wSecond, m_systime.wMilliseconds, GetCurrentThreadId());
-				vprintf_s(format, vaargs);
-				putc('\n', stdout);
-			}
-			if (log) {
-				fprintf_s(m_file, "%02u:%02u:%02u.%03u\t%08u\t", m_systime.wHour, m_systime.wMinute,
-					m_systime.wSecond, m_systime.wMilliseconds, GetCurrentThreadId());
-				vfprintf_s(m_file, format, vaargs);
-				putc('\n', m_file);
-				fflush(m_file);
-			}
+		LogRecord* record = m_queue.Claim();
+		if (!record)
+		{
+			InterlockedIncrement(&m_dropped);
+			return;
+		}
+
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+		record->counter = counter.QuadPart;
+		record->thread = GetCurrentThreadId();
+		record->category = site.index;
+		record->level = static_cast<BYTE>(site.level);
+
+		// format not literal gives site of first call, so pointer is checked
+		if (id > 0 && site.format == format)
+		{
+			record->site = static_cast<WORD>(id);
+			record->length = static_cast<WORD>(LogCaptureArgs(site.types, site.count,
+				reinterpret_cast<unsigned char*>(record->data), LOGGER_LINE_SIZE, vaargs));
+		}
+		else
+		{
+			record->site = LOGFILE_TEXT;
+			_vsnprintf_s(record->data, _TRUNCATE, format, vaargs);
+			record->length = static_cast<WORD>(strlen(record->data));
 		}
+		m_queue.Commit(record);
+
+		// without writer thread caller writes, otherwise writer is woken early only when queue fills up
+		if (!m_writer) Drain();
+		else if (m_queue.Pending() >= LOGGER_QUEUE_SIZE / 2) SetEvent(m_wake);
 	}
+
 private:
 	static std::unique_ptr<Logger> m_instance;
 #if _MSC_VER >= 1700
@@ -150,27 +254,386 @@ private:
 	Logger(const Logger& src);
 	Logger& operator=(const Logger& rhs);
 
-	SYSTEMTIME m_systime;
-
 	FILE* m_console;
 	FILE* m_file;
+	LogMapFile m_map;		// used instead of m_file for mapped log, writer only
+	bool m_mapped;
+	DWORD m_filelimit;
+	DWORD m_filecount;
 
-#if _MSC_VER < 1700
-	recursive_mutex m_mtx;
-#else
-	std::mutex m_mtx;
-#endif
+	LogQueue m_queue;
+	volatile LONG m_dropped;
+	volatile LONG m_draining;
+	volatile bool m_stop;
+	bool m_stamp;
+	bool m_binary;
+
+	DWORD m_categories;
+	int m_level;
+
+	// counter value at known system time, converts record counters to time
+	LONGLONG m_frequency;
+	LONGLONG m_counter;
+	FILETIME m_time;
+
+	LogSite* m_sites[LOGGER_MAX_SITES];
+	volatile LONG m_sitecount;
+
+	LogLimiter m_limiter;
+	LONGLONG m_summary;		// counter of last report of held back messages
+	bool m_defined[LOGGER_MAX_SITES];	// format already in binary file, writer only
+
+	HANDLE m_writer;
+	HANDLE m_wake;
+	HANDLE m_stopped;
+
+	char m_line[LOGGER_TEXT_SIZE];
+	char m_batch[LOGGER_BATCH_SIZE];		// text for console and text file
+	char m_binbatch[LOGGER_BATCH_SIZE];		// records for binary file
+	size_t m_used;
+	size_t m_binused;
 
 	Logger()
 	{
 		m_file = nullptr;
 		m_console = nullptr;
+		m_mapped = false;
+		m_filelimit = LOGGER_FILE_LIMIT << 20;
+		m_filecount = LOGGER_FILE_COUNT;
+		m_dropped = 0;
+		m_draining = 0;
+		m_stop = false;
+		m_stamp = true;
+		m_binary = false;
+		m_categories = LOG_ALL;
+		m_level = LOGLEVEL_TRACE;
+		m_sitecount = 0;
+		m_used = 0;
+		m_binused = 0;
+		memset(m_sites, 0, sizeof(m_sites));
+		memset(m_defined, 0, sizeof(m_defined));
+
+		LARGE_INTEGER frequency, counter;
+		QueryPerformanceFrequency(&frequency);
+		GetSystemTimeAsFileTime(&m_time);
+		QueryPerformanceCounter(&counter);
+		m_frequency = frequency.QuadPart;
+		m_counter = counter.QuadPart;
+		m_summary = m_counter;
+		m_limiter.SetRate(LOGGER_RATE, LOGGER_BURST, m_frequency);
+		m_limiter.SetExpiry(m_frequency * LOGGER_SUMMARY_INTERVAL / 1000);
+
+		m_writer = NULL;
+		m_wake = CreateEvent(NULL, FALSE, FALSE, NULL);
+		m_stopped = CreateEvent(NULL, TRUE, FALSE, NULL);
+	}
+
+	void ApplyFilter()
+	{
+		volatile DWORD* masks = LogMasks();
+		for (int level = LOGLEVEL_ERROR; level <= LOGLEVEL_TRACE; ++level)
+			masks[level] = level <= m_level ? m_categories : 0;
+	}
+
+	// Thread is created on first output, it starts running after DllMain returns.
+	// Messages logged before that wait in queue.
+	void Start()
+	{
+		if (m_writer || !m_wake || !m_stopped) return;
+		m_writer = CreateThread(NULL, 0, WriterProc, this, 0, NULL);
+	}
+
+	// Runs under loader lock when DLL is unloaded, so thread handle is not enough to wait for:
+	// writer signals m_stopped once it is done and its exit is left to the system.
+	// On process exit writer is already terminated and its handle is signaled.
+	void Stop()
+	{
+		if (!m_writer) return;
+
+		m_stop = true;
+		SetEvent(m_wake);
+
+		HANDLE handles[] = { m_stopped, m_writer };
+		WaitForMultipleObjects(_countof(handles), handles, FALSE, LOGGER_STOP_TIMEOUT);
+
+		CloseHandle(m_writer);
+		m_writer = NULL;
+	}
+
+	static DWORD WINAPI WriterProc(LPVOID lpParameter)
+	{
+		Logger* logger = reinterpret_cast<Logger*>(lpParameter);
+
+		while (!logger->m_stop)
+		{
+			WaitForSingleObject(logger->m_wake, LOGGER_FLUSH_INTERVAL);
+			logger->Drain(logger->m_stop);
+		}
+
+		SetEvent(logger->m_stopped);
+		return 0;
+	}
+
+	// Gives site ID, or LOGSITE_TEXT when its format has to be formatted by caller.
+	// Thread losing race for site formats its message itself until ID is published.
+	void Register(LogSite& site)
+	{
+		if (InterlockedCompareExchange(&site.id, LOGSITE_PENDING, 0) != 0) return;
+
+		unsigned char index = 0;
+		for (DWORD bits = site.category; bits && !(bits & 1); bits >>= 1) ++index;
+		site.index = index;
+
+		LONG id = LOGSITE_TEXT;
+		int count = site.format ? LogParseFormat(site.format, sizeof(void*), site.types) : -1;
+		if (count >= 0)
+		{
+			LONG next = InterlockedIncrement(&m_sitecount);
+			if (next < LOGGER_MAX_SITES)
+			{
+				site.count = count;
+				m_sites[next] = &site;
+				id = next;
+			}
+		}
+		InterlockedExchange(&site.id, id);
+	}
+
+	// Writes all committed records that pass limiter, one reader at a time.
+	// Busy flag is not a lock, so thread terminated while draining can not block the one draining at shutdown.
+	// final - report held back messages now
+	void Drain(bool final = false)
+	{
+		if (InterlockedCompareExchange(&m_draining, 1, 0) != 0) return;
+
+		if (m_stamp && m_queue.Front())
+		{
+			m_used = LogPrintf(m_batch, LOGGER_BATCH_SIZE, "[TIME]\t\t[THREAD]\t[LOG]\n");
+			m_stamp = false;
+		}
+
+		for (LogRecord* record = m_queue.Front(); record; record = m_queue.Front())
+		{
+			uint32_t repeated;
+			bool write = m_limiter.Check(record->site, record->category, record->level >= LOGLEVEL_INFO,
+				record->counter, record->data, record->length, &repeated);
+
+			if (repeated) AppendRepeat(record->counter, record->thread, record->site, repeated);
+			if (write)
+			{
+				if (m_binary) AppendRecord(record->site, record->thread, record->counter, record->data, record->length);
+				if (!m_binary || m_console) AppendText(record->counter, record->thread, FormatRecord(record));
+			}
+			m_queue.Pop(record);
+		}
+
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+		DWORD thread = GetCurrentThreadId();
+
+		LONG dropped = InterlockedExchange(&m_dropped, 0);
+		if (dropped)
+		{
+			char text[64];
+			sprintf_s(text, "Log queue full, %d messages dropped", dropped);
+			AppendLine(counter.QuadPart, thread, text);
+		}
+
+		uint32_t untruncated = m_mapped ? m_map.TakeUntruncated() : 0;
+		if (untruncated)
+		{
+			char text[96];
+			sprintf_s(text, "%u rotated log files not cut to committed size, zeros follow their data", untruncated);
+			AppendLine(counter.QuadPart, thread, text);
+		}
+
+		if (final || counter.QuadPart - m_summary >= m_frequency * LOGGER_SUMMARY_INTERVAL / 1000)
+		{
+			m_summary = counter.QuadPart;
+			LONGLONG now = counter.QuadPart;
+			m_limiter.Flush(
+				[&](uint16_t site, uint32_t count) { AppendRepeat(now, thread, site, count); },
+				[&](unsigned int category, uint32_t count)
+				{
+					char text[96];
+					sprintf_s(text, "Rate limit of %s log reached, %u messages suppressed", LogCategoryName(category), count);
+					AppendLine(now, thread, text);
+				});
+		}
+
+		Write();
+		InterlockedExchange(&m_draining, 0);
+	}
+
+	// Line written by writer itself, goes to every output
+	void AppendLine(LONGLONG counter, DWORD thread, const char* text)
+	{
+		if (m_binary) AppendRecord(LOGFILE_TEXT, thread, counter, text, strlen(text));
+		if (!m_binary || m_console) AppendText(counter, thread, text);
+	}
+
+	void AppendRepeat(LONGLONG counter, DWORD thread, WORD site, uint32_t count)
+	{
+		char text[LOGGER_TEXT_SIZE];
+		sprintf_s(text, "Message \"%.900s\" repeated %u times", m_sites[site]->format, count);
+		AppendLine(counter, thread, text);
+	}
+
+	static const char* LogCategoryName(unsigned int index)
+	{
+		static const char* names[] = { "CORE", "XINPUT", "DINPUT", "HOOK", "HOOKLL", "HOOKCOM", "HOOKDI", "HOOKSA", "HOOKWT" };
+		return index < _countof(names) ? names[index] : "other";
+	}
+
+	const char* FormatRecord(LogRecord* record)
+	{
+		if (record->site == LOGFILE_TEXT) return record->data;
+
+		LogFormatMessage(m_line, LOGGER_TEXT_SIZE, m_sites[record->site]->format, sizeof(void*),
+			reinterpret_cast<unsigned char*>(record->data), record->length);
+		return m_line;
+	}
+
+	void AppendText(LONGLONG counter, DWORD thread, const char* text)
+	{
+		if (m_used + LOGGER_TEXT_SIZE + 32 > LOGGER_BATCH_SIZE) Write();
+
+		LONGLONG elapsed = counter - m_counter;
+		ULARGE_INTEGER time;
+		time.LowPart = m_time.dwLowDateTime;
+		time.HighPart = m_time.dwHighDateTime;
+		if (m_frequency > 0) time.QuadPart += elapsed / m_frequency * 10000000 + elapsed % m_frequency * 10000000 / m_frequency;
+
+		FILETIME system, local;
+		SYSTEMTIME systime;
+		system.dwLowDateTime = time.LowPart;
+		system.dwHighDateTime = time.HighPart;
+		FileTimeToLocalFileTime(&system, &local);
+		FileTimeToSystemTime(&local, &systime);
+
+		m_used += LogPrintf(m_batch + m_used, LOGGER_BATCH_SIZE - m_used, "%02u:%02u:%02u.%03u\t%08u\t%s\n",
+			systime.wHour, systime.wMinute, systime.wSecond, systime.wMilliseconds, thread, text);
+	}
+
+	// Format of site goes to file before first record of site
+	void AppendRecord(WORD site, DWORD thread, LONGLONG counter, const void* data, size_t length)
+	{
+		if (site != LOGFILE_TEXT && site < LOGGER_MAX_SITES && !m_defined[site])
+		{
+			const char* format = m_sites[site]->format;
+			size_t formatlength = strlen(format);
+			if (formatlength > LOGGER_TEXT_SIZE) formatlength = LOGGER_TEXT_SIZE;
+
+			unsigned char definition[sizeof(WORD) + LOGGER_TEXT_SIZE];
+			memcpy(definition, &site, sizeof(WORD));
+			memcpy(definition + sizeof(WORD), format, formatlength);
+
+			m_defined[site] = true;
+			AppendRecord(LOGFILE_FORMAT, thread, counter, definition, sizeof(WORD) + formatlength);
+		}
+
+		if (m_binused + sizeof(LogFileRecord) + length > LOGGER_BATCH_SIZE) Write();
+
+		LogFileRecord header;
+		header.site = site;
+		header.length = static_cast<uint16_t>(length);
+		header.thread = thread;
+		header.counter = counter;
+
+		memcpy(m_binbatch + m_binused, &header, sizeof(header));
+		memcpy(m_binbatch + m_binused + sizeof(header), data, length);
+		m_binused += sizeof(header) + length;
+	}
+
+	void Write()
+	{
+		if (m_used)
+		{
+			if (m_console) fwrite(m_batch, 1, m_used, stdout);
+			if (!m_binary) Output(m_batch, m_used);
+			m_used = 0;
+		}
+
+		if (m_binused)
+		{
+			Output(m_binbatch, m_binused);
+			m_binused = 0;
+		}
+
+		if (m_file) fflush(m_file);
+	}
+
+	// Batch goes whole to one file, mapped file is rotated before batch that does not fit
+	void Output(const void* data, size_t length)
+	{
+		if (m_file) fwrite(data, 1, length, m_file);
+		if (!m_mapped) return;
+
+		if (m_map.Full(length)) Rotate();
+		m_map.Write(data, length);
+	}
+
+	// New file has to be readable alone: binary one gets header and formats of all sites again
+	void Rotate()
+	{
+		if (!m_map.Rotate()) return;
+
+		if (m_binary)
+		{
+			LogFileHeader header;
+			FileHeader(&header);
+			m_map.Write(&header, sizeof(header));
+
+			LARGE_INTEGER counter;
+			QueryPerformanceCounter(&counter);
+
+			LONG count = m_sitecount < LOGGER_MAX_SITES ? m_sitecount + 1 : LOGGER_MAX_SITES;
+			for (LONG site = 1; site < count; ++site)
+			{
+				if (!m_sites[site]) continue;
+
+				size_t formatlength = strlen(m_sites[site]->format);
+				if (formatlength > LOGGER_TEXT_SIZE) formatlength = LOGGER_TEXT_SIZE;
+
+				LogFileRecord record;
+				record.site = LOGFILE_FORMAT;
+				record.length = static_cast<uint16_t>(sizeof(WORD) + formatlength);
+				record.thread = GetCurrentThreadId();
+				record.counter = counter.QuadPart;
+
+				WORD id = static_cast<WORD>(site);
+				unsigned char definition[sizeof(LogFileRecord) + sizeof(WORD) + LOGGER_TEXT_SIZE];
+				memcpy(definition, &record, sizeof(record));
+				memcpy(definition + sizeof(record), &id, sizeof(id));
+				memcpy(definition + sizeof(record) + sizeof(id), m_sites[site]->format, formatlength);
+				m_map.Write(definition, sizeof(record) + record.length);
+				m_defined[site] = true;
+			}
+		}
+		else
+		{
+			const char stamp[] = "[TIME]\t\t[THREAD]\t[LOG]\n";
+			m_map.Write(stamp, sizeof(stamp) - 1);
+		}
+	}
+
+	void FileHeader(LogFileHeader* header)
+	{
+		memcpy(header->magic, LOGFILE_MAGIC, sizeof(header->magic));
+		header->version = LOGFILE_VERSION;
+		header->pointer = sizeof(void*);
+		header->frequency = m_frequency;
+		header->counter = m_counter;
+
+		FILETIME local;
+		FileTimeToLocalFileTime(&m_time, &local);
+		header->time = (static_cast<int64_t>(local.dwHighDateTime) << 32) | local.dwLowDateTime;
 	}
 };
 
-inline void LogFile(const char* logname)
+inline void LogFile(const char* logname, bool binary = false, bool mapped = false)
 {
-	Logger::GetInstance().file(logname);
+	Logger::GetInstance().file(logname, binary, mapped);
 }
 
 inline void LogConsole(const char* title = nullptr, const char* console_notice = nullptr)
@@ -178,22 +641,55 @@ inline void LogConsole(const char* title = nullptr, const char* console_notice =
 	Logger::GetInstance().console(title, console_notice);
 }
 
-inline void PrintLog(const char* format, ...)
+inline void LogFilter(DWORD categories, int level)
+{
+	Logger::GetInstance().filter(categories, level);
+}
+
+inline void LogRateLimit(DWORD rate, DWORD burst)
+{
+	Logger::GetInstance().ratelimit(rate, burst);
+}
+
+inline void LogRotation(DWORD limit, DWORD count)
+{
+	Logger::GetInstance().rotation(limit, count);
+}
+
+inline void PrintLogSite(LogSite& site, const char* format, ...)
 {
 	va_list vaargs;
 	va_start(vaargs, format);
-	Logger::GetInstance().print(format, vaargs);
+	Logger::GetInstance().print(site, format, vaargs);
 	va_end(vaargs);
 }
 
-#define PrintFunc() PrintLog(__FUNCTION__)
-#define PrintFuncSig() PrintLog(__FUNCSIG__)
-
 #else
-#define LogFile(logname) logname
+#undef LogEnabled
+#undef PrintLogEx
+#undef LogError
+#undef LogWarning
+#undef LogInfo
+#undef LogDebug
+#undef LogTrace
+#undef PrintLog
+#undef PrintFunc
+#undef PrintFuncSig
+
+#define LogFile(logname, ...) logname
 #define LogConsole(title) title
+#define LogFilter(categories, level)
+#define LogRateLimit(rate, burst)
+#define LogRotation(limit, count)
+#define LogEnabled(category, level) false
+#define PrintLogEx(category, level, format, ...) format
+#define LogError(category, format, ...) format
+#define LogWarning(category, format, ...) format
+#define LogInfo(category, format, ...) format
+#define LogDebug(category, format, ...) format
+#define LogTrace(category, format, ...) format
 #define PrintLog(format, ...) format
 #define PrintFunc()
 #define PrintFuncSig()
 
-#endif
\ No newline at end of file
+#endif
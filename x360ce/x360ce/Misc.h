@@ -66,22 +66,6 @@ inline std::wstring ModuleFileNameW(HMODULE hModule = NULL)
     return PathFindFileNameW(strPath);
 }
 
-inline LONG clamp(LONG val, LONG min, LONG max)
-{
-    if (val < min) return min;
-    if (val > max) return max;
-
-    return val;
-}
-
-inline LONG deadzone(LONG val, LONG min, LONG max, LONG lowerDZ, LONG upperDZ)
-{
-    if (val < lowerDZ) return min;
-    if (val > upperDZ) return max;
-
-    return val;
-}
-
 inline static WORD flipShort(WORD s)
 {
     return (WORD) ((s>>8) | (s<<8));
@@ -37,6 +37,8 @@
 #include <mutex>
 #endif
 
+#include "SWIPParser.h"
+
 // Windows headers
 #include <shlwapi.h>
 #include <Shlobj.h>
@@ -60,7 +62,8 @@ extern "C" IMAGE_DOS_HEADER __ImageBase;
 #define CURRENT_MODULE reinterpret_cast<HMODULE>(&__ImageBase)
 #endif
 
-#define SWIP_BUFFERSIZE 32767
+// larger file is not mapped
+#define SWIP_MAX_FILESIZE (256 * 1024 * 1024)
 
 class SWIP
 {
@@ -192,6 +195,18 @@ public:
         return _strtoui64(strval.c_str(),NULL,0); 
     }
 
+	double get_double(const std::string& section, const std::string& key, const double& def = 0.0) const
+    {
+        // get string, default is not used because conversion are slow!
+        const std::string& strval = this->get_string(section,key);
+
+        // and we can return default if empty here
+        if(strval.empty()) return def;
+
+        // convert to double and return
+        return strtod(strval.c_str(),NULL); 
+    }
+
     section_t get_section(const std::string& section) const
     {
         auto secit = m_inimap.find(section);
@@ -356,113 +371,124 @@ private:
 
     size_t populate_section(const std::string& section)
     {
-		char *keyvalbuf = new char[SWIP_BUFFERSIZE];
+        return this->populate(section);
+    }
 
-        // read all section data to buffer using WinAPI
+    bool populate_ini()
+    {
+        this->populate(std::string());
+        return !m_inimap.empty();
+    }
+
+    // Maps ini file and reads it in one pass, only - section to read, all sections when empty.
+    // Returns number of keys added.
+    size_t populate(const std::string& only)
+    {
 #if _MSC_VER < 1700
 		lock_guard lock(m_mutex);
 #else
 		std::lock_guard<std::recursive_mutex> lock(m_mutex);
 #endif
-		GetPrivateProfileSectionA(section.c_str(), keyvalbuf, SWIP_BUFFERSIZE, m_inipath.c_str());
-
-        // store pointer for data iteration
-        char* pData = keyvalbuf;
+        HANDLE file = CreateFileA(m_inipath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if(file == INVALID_HANDLE_VALUE) return 0;
 
         size_t count = 0;
+        LARGE_INTEGER size;
 
-        // last "key=value" string is double null terminated
-        while (*pData != '\0')
+        // empty file can not be mapped
+        if(GetFileSizeEx(file, &size) && size.QuadPart > 0 && size.QuadPart <= SWIP_MAX_FILESIZE)
         {
-            // set both, key and val to "key=value" string
-            std::string strSection(section);
-            std::string strkey(pData);
-            std::string strval(pData);
-
-            // get real key and value from "key=value" string
-            strkey = strkey.substr(0,strkey.find("="));
-            strval = strval.substr(strval.find("=")+1,strval.length());
-
-            // strip commentary NOTE: WinAPI strip only ';' commentaries at start of line!
-			strip_comment_and_trim(&strSection);
-			strip_comment_and_trim(&strkey);
-			strip_comment_and_trim(&strval);
-
-            // add key/value to correct section, skip empty to save memory
-            if(!strSection.empty() && !strkey.empty() && !strval.empty()) 
+            HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if(mapping)
             {
-                m_inimap[strSection][strkey] = strval;
-                ++count;
+                const char* view = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                if(view)
+                {
+                    count = this->parse(view, static_cast<size_t>(size.QuadPart), only);
+                    UnmapViewOfFile(view);
+                }
+                CloseHandle(mapping);
             }
-
-            // get next "key=value" string
-            pData = pData + strlen(pData) + 1;
         }
-        delete [] keyvalbuf;
+        CloseHandle(file);
         return count;
     }
 
-    bool populate_ini()
+    size_t parse(const char* data, size_t size, const std::string& only)
     {
-        // allocate buffers
-		char *sectionbuf = new char[SWIP_BUFFERSIZE];
-
-		// read all section names to buffer using WinAPI
-#if _MSC_VER < 1700
-		lock_guard lock(m_mutex);
-#else
-		std::lock_guard<std::recursive_mutex> lock(m_mutex);
-#endif
-		GetPrivateProfileSectionNamesA(sectionbuf, SWIP_BUFFERSIZE, m_inipath.c_str());
-
-        // store pointer for sections iteration
-        char* pSection = sectionbuf;
-
-        // last section name is double null terminated
-        while (*pSection != '\0')
+        // WinAPI reads UTF-16 file too and gives it in ANSI code page
+        std::vector<char> ansi;
+        if(size >= 2 && static_cast<unsigned char>(data[0]) == 0xFF && static_cast<unsigned char>(data[1]) == 0xFE)
         {
-            this->populate_section(pSection);
-            // get next section name
-            pSection = pSection + strlen(pSection) + 1;
+            const wchar_t* wide = reinterpret_cast<const wchar_t*>(data + 2);
+            int length = static_cast<int>((size - 2) / sizeof(wchar_t));
+            int ansisize = length ? WideCharToMultiByte(CP_ACP, 0, wide, length, NULL, 0, NULL, NULL) : 0;
+            if(ansisize <= 0) return 0;
+
+            ansi.resize(ansisize);
+            WideCharToMultiByte(CP_ACP, 0, wide, length, &ansi[0], ansisize, NULL, NULL);
+            data = &ansi[0];
+            size = ansi.size();
         }
-        delete [] sectionbuf;
-        return !m_inimap.empty();
-    }
 
-    void strip_comment_and_trim(std::string* str) const
-    {
-        size_t pos = std::string::npos;
+        std::string filter = lowercase(only.data(), only.data() + only.size());
 
-        if(str == nullptr)
-            return;
+        // WinAPI gives keys of first section with given name for every section of that name
+        MAP_TYPE<std::string, bool> seen;
+        std::string name;
+        section_t* current = nullptr;
+        size_t count = 0;
 
-		std::transform(str->begin(), str->end(), str->begin(), tolower);
+        swip_parse(data, size,
+            [&](const swip_view& section) -> bool
+            {
+                std::string raw = lowercase(section.begin, section.end);
+                if(!filter.empty() && raw != filter) return false;
+                if(!seen.insert(std::make_pair(raw, true)).second) return false;
+
+                // section is added with its first key, skip empty to save memory
+                name = strip_comment_and_trim(section);
+                current = nullptr;
+                return !name.empty();
+            },
+            [&](const swip_view& keyview, const swip_view& valview)
+            {
+                std::string key = strip_comment_and_trim(keyview);
+                if(key.empty()) return;
 
-		pos = str->find('#');
-        if( pos != std::string::npos)
-			str->resize(pos);
+                std::string val = strip_comment_and_trim(valview);
+                if(val.empty()) return;
 
-		pos = str->find(';');
-        if( pos != std::string::npos)
-			str->resize(pos);
+                if(!current) current = &m_inimap[name];
+                (*current)[key].swap(val);
+                ++count;
+            });
+        return count;
+    }
 
-		pos = str->find_first_not_of(' ');
-        if( pos != std::string::npos)
-			str->erase(0, pos);
+    static std::string lowercase(const char* begin, const char* end)
+    {
+        std::string str(begin, end);
+        for(size_t i = 0; i < str.size(); ++i)
+            str[i] = static_cast<char>(tolower(static_cast<unsigned char>(str[i])));
+        return str;
+    }
 
-		pos = str->find_last_not_of(' ') + 1;
-        if( pos != std::string::npos)
-			str->resize(pos);
+    // strip commentary NOTE: WinAPI strip only ';' commentaries at start of line!
+    // Text is cut at '#' or ';', then spaces and quotes are trimmed and rest is lowercased.
+    static std::string strip_comment_and_trim(swip_view str)
+    {
+        const char* end = str.begin;
+        while(end < str.end && *end != '#' && *end != ';') ++end;
+        str.end = end;
 
-		pos = str->find_first_not_of('"');
-        if( pos != std::string::npos)
-			str->erase(0, pos);
+        while(str.begin < str.end && *str.begin == ' ') ++str.begin;
+        while(str.end > str.begin && str.end[-1] == ' ') --str.end;
 
-		pos = str->find_last_not_of('"') + 1;
-        if( pos != std::string::npos)
-			str->resize(pos);
+        while(str.begin < str.end && *str.begin == '"') ++str.begin;
+        while(str.end > str.begin && str.end[-1] == '"') --str.end;
 
-		return;
+        return lowercase(str.begin, str.end);
     }
 
 private:
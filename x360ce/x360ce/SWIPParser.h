@@ -0,0 +1,92 @@
+/*  SWIP - Simple Windows Ini Parser
+*
+*  Copyright (C) 2013 Robert Krawczyk
+*
+*  SWIP is free software: you can redistribute it and/or modify it under the terms
+*  of the GNU Lesser General Public License as published by the Free Software Found-
+*  ation, either version 3 of the License, or (at your option) any later version.
+*
+*  SWIP is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+*  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+*  PURPOSE.  See the GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License along with SWIP.
+*  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _SWIPPARSER_H_
+#define _SWIPPARSER_H_
+
+// Single pass ini tokenizer, it splits lines the way profile API does and hands out
+// pointers into ini text, nothing is copied. No Windows headers, so it builds anywhere.
+
+#include <stddef.h>
+#include <string.h>
+
+// piece of ini text, not null terminated
+struct swip_view
+{
+	const char* begin;
+	const char* end;
+
+	size_t size() const
+	{
+		return static_cast<size_t>(end - begin);
+	}
+};
+
+// whitespace ignored around lines, 0x1A is end of file mark of old editors
+inline bool swip_isspace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f' || c == '\x1A';
+}
+
+// on_section(name) is called for every "[name]" line and returns false to skip keys of section,
+// name is text between '[' and last ']' of line.
+// on_key(key, value) is called for every other line of section, except empty ones and ';' comments,
+// key is text before first '=', value is text after it, line without '=' is both key and value.
+// Lines before first section are ignored, line ends are "\n", "\r\n" or "\r".
+template<typename SectionCallback, typename KeyCallback>
+void swip_parse(const char* data, size_t size, SectionCallback on_section, KeyCallback on_key)
+{
+	const char* end = data + size;
+	if (size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0) data += 3;
+
+	bool in_section = false;
+	const char* line = data;
+	while (line < end)
+	{
+		const char* eol = line;
+		while (eol < end && *eol != '\n' && *eol != '\r') ++eol;
+		const char* next = eol < end ? eol + 1 : end;
+
+		while (line < eol && swip_isspace(*line)) ++line;
+		while (eol > line && swip_isspace(eol[-1])) --eol;
+
+		if (line < eol && *line != ';')
+		{
+			const char* close = eol;
+			if (*line == '[')
+			{
+				while (close > line + 1 && close[-1] != ']') --close;
+			}
+
+			if (*line == '[' && close > line + 1)
+			{
+				swip_view name = { line + 1, close - 1 };
+				in_section = on_section(name);
+			}
+			else if (in_section)
+			{
+				const char* equal = static_cast<const char*>(memchr(line, '=', eol - line));
+				swip_view key = { line, equal ? equal : eol };
+				swip_view value = { equal ? equal + 1 : line, eol };
+				on_key(key, value);
+			}
+		}
+		line = next;
+	}
+}
+
+#endif
@@ -55,6 +55,7 @@ void __cdecl ExitInstance()
 	if (hMsgWnd && DestroyWindow(hMsgWnd)) 
 		PrintLog("Message window destroyed");
 
+	SaveHookProfile();
 	SAFE_DELETE(pHooks);
 	if (xinput.dll)
 	{
@@ -95,6 +96,7 @@ VOID InitInstance()
 extern "C" VOID WINAPI reset()
 {
 	PrintLog("%s", "Restarting");
+	SaveHookProfile();
 	SAFE_DELETE(pHooks);
 
 	g_Devices.clear();
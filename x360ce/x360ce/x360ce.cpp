@@ -24,6 +24,8 @@
 #include "Config.h"
 #include "Logger.h"
 #include "DirectInput.h"
+#include "GuideButton.h"
+#include "Keystroke.h"
 #include "InputHook\InputHook.h"
 
 extern std::vector<Mapping> g_Mappings;
@@ -40,6 +42,16 @@ HWND hMsgWnd = NULL;
 
 xinput_dll xinput;
 
+static GuideButtonWait g_GuideWait[XUSER_MAX_COUNT];
+static KeystrokeGenerator g_Keystrokes[XUSER_MAX_COUNT];
+
+// Device state of pad is polled by game threads and by guide button waiters
+#if _MSC_VER < 1700
+static recursive_mutex g_DeviceMutex[XUSER_MAX_COUNT];
+#else
+static std::recursive_mutex g_DeviceMutex[XUSER_MAX_COUNT];
+#endif
+
 VOID CreateMsgWnd()
 {
     hMsgWnd = CreateWindow(
@@ -129,17 +141,19 @@ static void DeviceInitialize(DInputDevice& device)
     }
 }
 
-extern "C" DWORD WINAPI XInputGetState(DWORD dwUserIndex, XINPUT_STATE* pState)
+// One poll and one mapping pass for both XInputGetState and XInputGetStateEx,
+// extended state adds guide button from same device state
+static DWORD GetMappedState(DWORD dwUserIndex, XINPUT_STATE* pState, bool extended)
 {
-    //PrintLog("XInputGetState");
-    if(g_bDisable) return ERROR_DEVICE_NOT_CONNECTED;
+    if (!pState || !(dwUserIndex < XUSER_MAX_COUNT) || !(dwUserIndex < g_Devices.size())) return ERROR_BAD_ARGUMENTS;
 
-    if((dwUserIndex+1 > g_Devices.size() || g_Devices[dwUserIndex].passthrough) && XInputInitialize())
-		return xinput.XInputGetState(dwUserIndex, pState);
+#if _MSC_VER < 1700
+    lock_guard lock(g_DeviceMutex[dwUserIndex]);
+#else
+    std::lock_guard<std::recursive_mutex> lock(g_DeviceMutex[dwUserIndex]);
+#endif
 
     DInputDevice& device = g_Devices[dwUserIndex];
-    if (!pState || !(dwUserIndex < XUSER_MAX_COUNT)) return ERROR_BAD_ARGUMENTS;
-
     HRESULT hr = E_FAIL;
 
     if(hMsgWnd == NULL) CreateMsgWnd();
@@ -152,334 +166,43 @@ extern "C" DWORD WINAPI XInputGetState(DWORD dwUserIndex, XINPUT_STATE* pState)
     if(XInputIsEnabled.bEnabled || !XInputIsEnabled.bUseEnabled)
         hr = UpdateState(device);
 
-#if defined(DEBUG) | defined(_DEBUG)
-    PrintLog("UpdateState %d %d",dwUserIndex,hr);
-#endif
+    LogTrace(LOG_XINPUT, "UpdateState %d %d",dwUserIndex,hr);
 
     if(FAILED(hr)) return ERROR_DEVICE_NOT_CONNECTED;
 
     Mapping& mapping = g_Mappings[dwUserIndex];
     XINPUT_STATE& xstate = *pState;
 
-    xstate.Gamepad.wButtons = 0;
-    xstate.Gamepad.bLeftTrigger = 0;
-    xstate.Gamepad.bRightTrigger = 0;
-    xstate.Gamepad.sThumbLX = 0;
-    xstate.Gamepad.sThumbLY = 0;
-    xstate.Gamepad.sThumbRX = 0;
-    xstate.Gamepad.sThumbRY = 0;
-
-    if(!XInputIsEnabled.bEnabled && XInputIsEnabled.bUseEnabled) return ERROR_SUCCESS;
-
-    // timestamp packet
-    xstate.dwPacketNumber=GetTickCount();
+    // wake XInputWaitForGuideButton waiters, events are touched only on state change
+    bool guide = GuidePressed(mapping,device);
+    g_GuideWait[dwUserIndex].Update(guide);
 
-    // --- Map buttons ---
-    for (int i = 0; i < 10; ++i)
-    {
-        if (((int)mapping.Button[i] >= 0) && ButtonPressed(mapping.Button[i],device))
-            xstate.Gamepad.wButtons |= buttonIDs[i];
-    }
-
-    // --- Map POV to the D-pad ---
-    if (mapping.DpadPOV > 0 && mapping.PovIsButton == false)
-    {
-        //INT pov = POVState(mapping.DpadPOV,dwUserIndex,Gamepad[dwUserIndex].povrotation);
-
-        int povdeg = device.state.rgdwPOV[mapping.DpadPOV-1];
-        if(povdeg >= 0)
-        {
-            // Up-left, up, up-right, up (at 360 degrees)
-            if (IN_RANGE2(povdeg,mapping.pov[GAMEPAD_DPAD_LEFT]+1,mapping.pov[GAMEPAD_DPAD_UP]) || IN_RANGE2(povdeg,0,mapping.pov[GAMEPAD_DPAD_RIGHT]-1))
-                xstate.Gamepad.wButtons |= XINPUT_GAMEPAD_DPAD_UP;
-
-            // Up-right, right, down-right
-            if (IN_RANGE(povdeg,0,mapping.pov[GAMEPAD_DPAD_DOWN]))
-                xstate.Gamepad.wButtons |= XINPUT_GAMEPAD_DPAD_RIGHT;
-
-            // Down-right, down, down-left
-            if (IN_RANGE(povdeg,mapping.pov[GAMEPAD_DPAD_RIGHT],mapping.pov[GAMEPAD_DPAD_LEFT]))
-                xstate.Gamepad.wButtons |= XINPUT_GAMEPAD_DPAD_DOWN;
-
-            // Down-left, left, up-left
-            if (IN_RANGE(povdeg,mapping.pov[GAMEPAD_DPAD_DOWN],mapping.pov[GAMEPAD_DPAD_UP]))
-                xstate.Gamepad.wButtons |= XINPUT_GAMEPAD_DPAD_LEFT;
-        }
-    }
-    else if(mapping.PovIsButton == true)
-    {
-        for (int i = 0; i < 4; ++i)
-        {
-            if (((int)mapping.pov[i] >= 0) && ButtonPressed(mapping.pov[i],device))
-            {
-                xstate.Gamepad.wButtons |= povIDs[i];
-            }
-        }
-    }
-
-    // Created so we can refer to each axis with an ID
-    LONG axis[] =
-    {
-        device.state.lX,
-        device.state.lY,
-        device.state.lZ,
-        device.state.lRx,
-        device.state.lRy,
-        device.state.lRz,
-        0
-    };
-    LONG slider[] =
-    {
-        device.state.rglSlider[0],
-        device.state.rglSlider[1]
-    };
-
-    // --- Map triggers ---
-    BYTE *targetTrigger[] =
-    {
-        & xstate.Gamepad.bLeftTrigger,
-        & xstate.Gamepad.bRightTrigger
-    };
-
-    for (size_t i = 0; i < 2; ++i)
-    {
-        MappingType triggerType = mapping.Trigger[i].type;
-
-        if (triggerType == DIGITAL)
-        {
-            if(ButtonPressed(mapping.Trigger[i].id,device))*(targetTrigger[i]) = 255;
-        }
-        else
-        {
-            LONG *values;
-
-            switch (triggerType)
-            {
-            case AXIS:
-            case HAXIS:
-            case CBUT:
-                values = axis;
-                break;
-
-            case SLIDER:
-            case HSLIDER:
-                values = slider;
-                break;
-
-            default:
-                values = axis;
-                break;
-            }
-
-            LONG v = 0;
-
-            if(mapping.Trigger[i].id > 0) v = values[mapping.Trigger[i].id -1];
-            else v = -values[-mapping.Trigger[i].id -1] - 1;
-
-            /* FIXME: axis negative max should be -32768
-            --- v is the full range (-32767 .. +32767) that should be projected to 0...255
-
-            --- Full ranges
-            AXIS:	(	0 to 255 from -32767 to 32767) using axis
-            SLIDER:	(	0 to 255 from -32767 to 32767) using slider
-            ------------------------------------------------------------------------------
-            --- Half ranges
-            HAXIS:	(	0 to 255 from 0 to 32767) using axis
-            HSLIDER:	(	0 to 255 from 0 to 32767) using slider
-            */
-
-            LONG v2=0;
-            LONG offset=0;
-            LONG scaling=1;
-
-            switch (triggerType)
-            {
-                // Full range
-            case AXIS:
-            case SLIDER:
-                scaling = 255;
-                offset = 32767;
-                break;
-
-                // Half range
-            case HAXIS:
-            case HSLIDER:
-            case CBUT: // add /////////////////////////////////////////////////////////
-                scaling = 127;
-                offset = 0;
-                break;
-
-            default:
-                scaling = 1;
-                offset = 0;
-                break;
-            }
-
-            //v2 = (v + offset) / scaling;
-            // Add deadzones
-            //*(targetTrigger[i]) = (BYTE) deadzone(v2, 0, 255, device.triggerdz, 255);
-
-            /////////////////////////////////////////////////////////////////////////////////////////
-            if (triggerType == CBUT)
-            {
-
-                if (ButtonPressed(mapping.Trigger[0].but,device)
-                        && ButtonPressed(mapping.Trigger[1].but,device))
-                {
-                    *(targetTrigger[0]) = 255;
-                    *(targetTrigger[1]) = 255;
-                }
-
-                if (ButtonPressed(mapping.Trigger[0].but,device)
-                        && !ButtonPressed(mapping.Trigger[1].but,device))
-                {
-                    v2 = (offset-v) / scaling;
-                    *(targetTrigger[0]) = 255;
-                    *(targetTrigger[1]) = 255 - (BYTE) deadzone(v2, 0, 255, device.triggerdz[1], 255);
-                }
-
-                if (!ButtonPressed(mapping.Trigger[0].but,device)
-                        && ButtonPressed(mapping.Trigger[1].but,device))
-                {
-                    v2 = (offset+v) / scaling;
-                    *(targetTrigger[0]) = 255 - (BYTE) deadzone(v2, 0, 255, device.triggerdz[0], 255);
-                    *(targetTrigger[1]) = 255;
-                }
-
-                if (!ButtonPressed(mapping.Trigger[0].but,device)
-                        && !ButtonPressed(mapping.Trigger[1].but,device))
-                {
-                    v2 = (offset+v) / scaling;
-                    *(targetTrigger[i]) = (BYTE) deadzone(v2, 0, 255, device.triggerdz[i], 255);
-                }
-
-            }
-            else
-            {
-                v2 = (offset+v) / scaling;
-                *(targetTrigger[i]) = (BYTE) deadzone(v2, 0, 255, device.triggerdz[i], 255);
-            }
-
-            /////////////////////////////////////////////////////////////////////////////////////////
-        }
-    }
-
-    // --- Map thumbsticks ---
-
-    // Created so we can refer to each axis with an ID
-    SHORT *targetAxis[4] =
-    {
-        & xstate.Gamepad.sThumbLX,
-        & xstate.Gamepad.sThumbLY,
-        & xstate.Gamepad.sThumbRX,
-        & xstate.Gamepad.sThumbRY
-    };
-
-    // NOTE: Could add symbolic constants as indexers, such as
-    // THUMB_LX_AXIS, THUMB_LX_POSITIVE, THUMB_LX_NEGATIVE
-    if(device.axistodpad==0)
-    {
-
-
-        for (INT i = 0; i < 4; ++i)
-        {
-            LONG *values = axis;
-
-            // Analog input
-            if (mapping.Axis[i].analogType == AXIS) values = axis;
-
-            if (mapping.Axis[i].analogType == SLIDER) values = slider;
-
-            if (mapping.Axis[i].analogType != NONE)
-            {
-
-                if(mapping.Axis[i].id > 0 )
-                {
-                    SHORT val = (SHORT) values[mapping.Axis[i].id - 1];
-                    *(targetAxis[i])= (SHORT) clamp(val,-32767,32767);
-                }
-                else if(mapping.Axis[i].id < 0 )
-                {
-                    SHORT val = (SHORT) -values[-mapping.Axis[i].id - 1];
-                    *(targetAxis[i]) = (SHORT) clamp(val,-32767,32767);
-                }
-            }
-
-            // Digital input, positive direction
-            if (mapping.Axis[i].hasDigital && mapping.Axis[i].positiveButtonID >= 0)
-            {
-
-                if (ButtonPressed(mapping.Axis[i].positiveButtonID,device))
-                    *(targetAxis[i]) = 32767;
-            }
-
-            // Digital input, negative direction
-            if (mapping.Axis[i].hasDigital && mapping.Axis[i].negativeButtonID >= 0)
-            {
-
-                if (ButtonPressed(mapping.Axis[i].negativeButtonID,device))
-                    *(targetAxis[i]) = -32767;
-            }
-        }
-    }
-
-    //WILDS - Axis to D-Pad
-    if(device.axistodpad==1)
+    if(!XInputIsEnabled.bEnabled && XInputIsEnabled.bUseEnabled)
     {
-        //PrintLog("x: %d, y: %d, z: %d",Gamepad[dwUserIndex].state.lX,Gamepad[dwUserIndex].state.lY,Gamepad[dwUserIndex].state.lZ);
-
-        if(device.state.lX - device.a2doffset > device.a2ddeadzone)
-            xstate.Gamepad.wButtons |= XINPUT_GAMEPAD_DPAD_LEFT;
-
-        if(device.state.lX - device.a2doffset < -device.a2ddeadzone)
-            xstate.Gamepad.wButtons |= XINPUT_GAMEPAD_DPAD_RIGHT;
-
-        if(device.state.lY - device.a2doffset < -device.a2ddeadzone)
-            xstate.Gamepad.wButtons |= XINPUT_GAMEPAD_DPAD_UP;
-
-        if(device.state.lY - device.a2doffset > device.a2ddeadzone)
-            xstate.Gamepad.wButtons |= XINPUT_GAMEPAD_DPAD_DOWN;
+        ZeroMemory(&xstate.Gamepad,sizeof(xstate.Gamepad));
+        return ERROR_SUCCESS;
     }
 
-    //WILDS END
-
-    for (int i = 0; i < 4; ++i)
-    {
-
-        if (device.antideadzone[i])
-        {
-            SHORT antidz = device.antideadzone[i];
-            LONG val = *(targetAxis[i]);
-            SHORT direction = val > 0 ? 1 : -1;
-            val = (LONG)(abs(val) / (32767 / (32767 - antidz * 1.0)) + antidz);
-            val = min(val, 32767);
-
-            if(val == device.antideadzone[i] || val == -device.antideadzone[i]) val = 0;
-
-            *(targetAxis[i]) = (SHORT) (direction * val);
-        }
+    // timestamp packet
+    xstate.dwPacketNumber=GetTickCount();
 
-        if (device.axisdeadzone[i])
-        {
-            SHORT dz = device.axisdeadzone[i];
-            LONG val = *(targetAxis[i]);
+    MapGamepad(mapping,device,xstate.Gamepad,extended && guide);
 
-            if((val <= dz) && (val >= -dz) ) val = 0;
+    // feed keystroke queue with mapped buttons
+    g_Keystrokes[dwUserIndex].Update(dwUserIndex,xstate.Gamepad.wButtons,xstate.dwPacketNumber);
 
-            *(targetAxis[i]) = (SHORT) clamp(val,-32767,32767);
-        }
-
-        // --- Do Linears ---
+    return ERROR_SUCCESS;
+}
 
-        if (device.axislinear[i])
-        {
+extern "C" DWORD WINAPI XInputGetState(DWORD dwUserIndex, XINPUT_STATE* pState)
+{
+    //PrintLog("XInputGetState");
+    if(g_bDisable) return ERROR_DEVICE_NOT_CONNECTED;
 
-            SHORT absval = (SHORT)((abs(*(targetAxis[i])) + (((32767.0 / 2.0) - (((abs((abs(*(targetAxis[i]))) - (32767.0 / 2.0)))))) * (device.axislinear[i] * 0.01))));
-            *(targetAxis[i]) = *(targetAxis[i]) > 0 ? absval : -absval;
-        }
-    }
+    if((dwUserIndex+1 > g_Devices.size() || g_Devices[dwUserIndex].passthrough) && XInputInitialize())
+		return xinput.XInputGetState(dwUserIndex, pState);
 
-    return ERROR_SUCCESS;
+    return GetMappedState(dwUserIndex,pState,false);
 }
 
 extern "C" DWORD WINAPI XInputSetState(DWORD dwUserIndex, XINPUT_VIBRATION* pVibration)
@@ -507,34 +230,29 @@ extern "C" DWORD WINAPI XInputSetState(DWORD dwUserIndex, XINPUT_VIBRATION* pVib
 
     if(!device.useforce) return ERROR_SUCCESS;
 
-    WORD wLeftMotorSpeed = 0;
-    WORD wRightMotorSpeed = 0;
+    uint8_t actuators = device.ff.routing.GetCount();
 
-    PrepareForce(device,FFB_LEFTMOTOR);
-    PrepareForce(device,FFB_RIGHTMOTOR);
+    for(uint8_t i = 0; i < actuators; ++i)
+        PrepareForce(device,i);
 
     if(!XInputIsEnabled.bEnabled && XInputIsEnabled.bUseEnabled)
     {
-        SetDeviceForces(device,0,FFB_LEFTMOTOR);
-        SetDeviceForces(device,0,FFB_RIGHTMOTOR);
+        for(uint8_t i = 0; i < actuators; ++i)
+            SetDeviceForces(device,0,i);
         return ERROR_SUCCESS;
     }
 
-    WORD left =  static_cast<WORD>(xvib.wLeftMotorSpeed * device.ff.forcepercent);
-    WORD right = static_cast<WORD>(xvib.wRightMotorSpeed * device.ff.forcepercent);
-
-    wLeftMotorSpeed = device.swapmotor ? right : left;
-    wRightMotorSpeed = device.swapmotor ? left : right;
-
-    hr = SetDeviceForces(device,wLeftMotorSpeed,FFB_LEFTMOTOR);
-
-    if(FAILED(hr))
-        PrintLog("SetDeviceForces for pad %d failed with code HR = %X", dwUserIndex, hr);
+    // routing matrix applies SwapMotor and mixes motors for single actuator devices
+    WORD forces[FFB_MAX_ACTUATORS];
+    device.ff.routing.Apply(device.ff.curve,xvib.wLeftMotorSpeed,xvib.wRightMotorSpeed,forces);
 
-    hr = SetDeviceForces(device,wRightMotorSpeed,FFB_RIGHTMOTOR);
+    for(uint8_t i = 0; i < actuators; ++i)
+    {
+        hr = SetDeviceForces(device,forces[i],i);
 
-    if(FAILED(hr))
-        PrintLog("SetDeviceForces for pad %d failed with code HR = %X", dwUserIndex, hr);
+        if(FAILED(hr))
+            PrintLog("SetDeviceForces for pad %d failed with code HR = %X", dwUserIndex, hr);
+    }
 
     return ERROR_SUCCESS;
 }
@@ -650,6 +368,25 @@ extern "C" DWORD WINAPI XInputGetKeystroke(DWORD dwUserIndex, DWORD dwReserved,
 {
     if(g_bDisable) return ERROR_DEVICE_NOT_CONNECTED;
 
+    if(dwUserIndex == XUSER_INDEX_ANY)
+    {
+        if (!pKeystroke) return ERROR_BAD_ARGUMENTS;
+
+        // round robin, so one busy pad does not starve others
+        static LONG next = 0;
+        DWORD first = (DWORD)InterlockedIncrement(&next);
+        DWORD ret = ERROR_DEVICE_NOT_CONNECTED;
+
+        for(DWORD i = 0; i < XUSER_MAX_COUNT; ++i)
+        {
+            DWORD result = XInputGetKeystroke((first + i) % XUSER_MAX_COUNT, dwReserved, pKeystroke);
+            if(result == ERROR_SUCCESS) return ERROR_SUCCESS;
+            if(result == ERROR_EMPTY) ret = ERROR_EMPTY;
+        }
+
+        return ret;
+    }
+
     if((dwUserIndex+1 > g_Devices.size() || g_Devices[dwUserIndex].passthrough) && XInputInitialize())
     {
         //PrintLog("flags: %u, hidcode: %u, unicode: %c, user: %u, vk: 0x%X",pKeystroke->Flags,pKeystroke->HidCode,pKeystroke->Unicode,pKeystroke->UserIndex,pKeystroke->VirtualKey);
@@ -666,112 +403,24 @@ extern "C" DWORD WINAPI XInputGetKeystroke(DWORD dwUserIndex, DWORD dwReserved,
         DeviceInitialize(device);
     if(!device.device) return ERROR_DEVICE_NOT_CONNECTED;
 
-    XINPUT_KEYSTROKE& xkey = *pKeystroke;
-
-    XINPUT_STATE xstate;
-    ZeroMemory(&xstate,sizeof(XINPUT_STATE));
-    XInputGetState(dwUserIndex,&xstate);
-
-    static WORD repeat[14];
-    static WORD flags[14];
+    KeystrokeGenerator& keystrokes = g_Keystrokes[dwUserIndex];
 
-    WORD vkey = NULL;
-    WORD curretFlags = NULL;
+    DWORD now = GetTickCount();
+    if(keystrokes.Pop(*pKeystroke,now)) return ERROR_SUCCESS;
 
-    static const WORD allButtonIDs[14] =
+    // queue is fed by XInputGetState, poll only if game did not do it recently
+    if(now - keystrokes.GetLastUpdate() >= KEYSTROKE_POLL_INTERVAL)
     {
-        XINPUT_GAMEPAD_A,
-        XINPUT_GAMEPAD_B,
-        XINPUT_GAMEPAD_X,
-        XINPUT_GAMEPAD_Y,
-        XINPUT_GAMEPAD_LEFT_SHOULDER,
-        XINPUT_GAMEPAD_RIGHT_SHOULDER,
-        XINPUT_GAMEPAD_BACK,
-        XINPUT_GAMEPAD_START,
-        XINPUT_GAMEPAD_LEFT_THUMB,
-        XINPUT_GAMEPAD_RIGHT_THUMB,
-        XINPUT_GAMEPAD_DPAD_UP,
-        XINPUT_GAMEPAD_DPAD_DOWN,
-        XINPUT_GAMEPAD_DPAD_LEFT,
-        XINPUT_GAMEPAD_DPAD_RIGHT
-    };
-
-    static const uint16_t keyIDs[14] =
-    {
-        VK_PAD_A,
-        VK_PAD_B,
-        VK_PAD_X,
-        VK_PAD_Y,
-        VK_PAD_LSHOULDER,
-        VK_PAD_RSHOULDER,
-        VK_PAD_BACK,
-        VK_PAD_START,
-        VK_PAD_LTHUMB_PRESS,
-        VK_PAD_RTHUMB_PRESS,
-        VK_PAD_DPAD_UP,
-        VK_PAD_DPAD_DOWN,
-        VK_PAD_DPAD_LEFT,
-        VK_PAD_DPAD_RIGHT
-    };
-
-    for(int i = 0; i < 14; i++)
-    {
-        if(xstate.Gamepad.wButtons & allButtonIDs[i])
-        {
-            if(flags[i] == NULL)
-            {
-                vkey = keyIDs[i];
-                curretFlags = flags[i] = XINPUT_KEYSTROKE_KEYDOWN;
-                break;
-            }
-            if((flags[i] & XINPUT_KEYSTROKE_KEYDOWN))
-            {
-                if(repeat[i] <= 0)
-                {
-                    repeat[i] = 5;
-                    vkey = keyIDs[i];
-                    curretFlags = flags[i] = XINPUT_KEYSTROKE_KEYDOWN | XINPUT_KEYSTROKE_REPEAT;
-                    break;
-                }
-                else
-                {
-                    repeat[i]--;
-                    continue;
-                }
-            }
-        }
-        if(!(xstate.Gamepad.wButtons & allButtonIDs[i]))
-        {
-            if(flags[i] & XINPUT_KEYSTROKE_KEYDOWN)
-            {
-                repeat[i] = 5*4;
-                vkey = keyIDs[i];
-                curretFlags = flags[i] = XINPUT_KEYSTROKE_KEYUP;
-                break;
-            }
-            if(flags[i] & XINPUT_KEYSTROKE_KEYUP)
-            {
-                curretFlags = flags[i] = NULL;
-                break;
-            }
-        }
-    }
-
-    DWORD ret = ERROR_EMPTY;
+        XINPUT_STATE xstate;
+        ZeroMemory(&xstate,sizeof(XINPUT_STATE));
+        GetMappedState(dwUserIndex,&xstate,false);
 
-    if(vkey)
-    {
-        xkey.UserIndex = (BYTE)dwUserIndex;
-        xkey.Unicode = NULL;
-        xkey.HidCode = NULL;
-        xkey.Flags = curretFlags;
-        xkey.VirtualKey = vkey;
-        ret = ERROR_SUCCESS;
+        if(keystrokes.Pop(*pKeystroke,now)) return ERROR_SUCCESS;
     }
 
-    //PrintLog("ret: %u, flags: %u, hid: %u, unicode: %c, user: %u, vk: 0x%X",ret,pKeystroke->Flags,pKeystroke->HidCode,pKeystroke->Unicode,pKeystroke->UserIndex,pKeystroke->VirtualKey);
+    //PrintLog("flags: %u, hid: %u, unicode: %c, user: %u, vk: 0x%X",pKeystroke->Flags,pKeystroke->HidCode,pKeystroke->Unicode,pKeystroke->UserIndex,pKeystroke->VirtualKey);
 
-    return ret;
+    return ERROR_EMPTY;
 }
 
 //undocumented
@@ -782,16 +431,9 @@ extern "C" DWORD WINAPI XInputGetStateEx(DWORD dwUserIndex, XINPUT_STATE *pState
     if((dwUserIndex+1 > g_Devices.size() || g_Devices[dwUserIndex].passthrough) && XInputInitialize())
 		return xinput.XInputGetStateEx(dwUserIndex, pState);
 
-    DInputDevice& device = g_Devices[dwUserIndex];
-    Mapping& mapping = g_Mappings[dwUserIndex];
-    XINPUT_STATE& xState = *pState;
-
-    if (mapping.guide && ButtonPressed(mapping.guide,device))
-        xState.Gamepad.wButtons |= 0x400;
-
     //PrintLog("XInputGetStateEx %u",xstate.Gamepad.wButtons);
 
-    return XInputGetState(dwUserIndex,pState);
+    return GetMappedState(dwUserIndex,pState,true);
 }
 
 extern "C" DWORD WINAPI XInputWaitForGuideButton(DWORD dwUserIndex, DWORD dwFlag, LPVOID pVoid)
@@ -801,11 +443,49 @@ extern "C" DWORD WINAPI XInputWaitForGuideButton(DWORD dwUserIndex, DWORD dwFlag
     if((dwUserIndex+1 > g_Devices.size() || g_Devices[dwUserIndex].passthrough) && XInputInitialize())
         return xinput.XInputWaitForGuideButton(dwUserIndex,dwFlag,pVoid);
 
-    PrintLog("%s %s","Call to unimplemented function", __FUNCTION__);
+    if (!(dwUserIndex < XUSER_MAX_COUNT)) return ERROR_BAD_ARGUMENTS;
 
-    //DInputDevice& device = g_Devices[dwUserIndex];
+    DInputDevice& device = g_Devices[dwUserIndex];
+    Mapping& mapping = g_Mappings[dwUserIndex];
+    GuideButtonWait& wait = g_GuideWait[dwUserIndex];
 
-    return ERROR_SUCCESS;
+    if(hMsgWnd == NULL) CreateMsgWnd();
+
+    {
+#if _MSC_VER < 1700
+        lock_guard lock(g_DeviceMutex[dwUserIndex]);
+#else
+        std::lock_guard<std::recursive_mutex> lock(g_DeviceMutex[dwUserIndex]);
+#endif
+        if(device.device == NULL && device.dwUserIndex == dwUserIndex)
+            DeviceInitialize(device);
+        if(!device.device) return ERROR_DEVICE_NOT_CONNECTED;
+
+        // dwFlag != 0 - asynchronous wait, pVoid is OVERLAPPED completed by poller or XInputCancelGuideButtonWait
+        if(dwFlag) return wait.WaitAsync(reinterpret_cast<LPOVERLAPPED>(pVoid));
+
+        // let DirectInput signal new data, so waiter can poll itself when nobody calls XInputGetState
+        static bool notify[XUSER_MAX_COUNT] = {};
+        if(!notify[dwUserIndex])
+        {
+            notify[dwUserIndex] = true;
+            device.device->Unacquire();
+            HRESULT hr = device.device->SetEventNotification(wait.GetNotifyEvent());
+            if(hr != DI_OK) PrintLog("[PAD%d] SetEventNotification returned HR = %X, guide wait depends on polling", dwUserIndex+1, hr);
+            device.device->Acquire();
+        }
+    }
+
+    // lock is taken only for poll, not while waiting
+    return wait.Wait([&]()
+    {
+#if _MSC_VER < 1700
+        lock_guard lock(g_DeviceMutex[dwUserIndex]);
+#else
+        std::lock_guard<std::recursive_mutex> lock(g_DeviceMutex[dwUserIndex]);
+#endif
+        if(SUCCEEDED(UpdateState(device))) wait.Update(GuidePressed(mapping,device));
+    });
 }
 
 extern "C" DWORD WINAPI XInputCancelGuideButtonWait(DWORD dwUserIndex)
@@ -815,9 +495,9 @@ extern "C" DWORD WINAPI XInputCancelGuideButtonWait(DWORD dwUserIndex)
     if((dwUserIndex+1 > g_Devices.size() || g_Devices[dwUserIndex].passthrough) && XInputInitialize())
 		return xinput.XInputCancelGuideButtonWait(dwUserIndex);
 
-    PrintLog("%s %s","Call to unimplemented function", __FUNCTION__);
+    if (!(dwUserIndex < XUSER_MAX_COUNT)) return ERROR_BAD_ARGUMENTS;
 
-    //DInputDevice& device = g_Devices[dwUserIndex];
+    g_GuideWait[dwUserIndex].Cancel();
 
     return ERROR_SUCCESS;
 }